@@ -62,4 +62,7 @@
 
 #define SO_RXQ_OVFL             40
 
+#define SO_ATTACH_BPF           50
+#define SO_DETACH_BPF           SO_DETACH_FILTER
+
 #endif /* __ASM_AVR32_SOCKET_H */
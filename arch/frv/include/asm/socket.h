@@ -62,5 +62,8 @@
 
 #define SO_RXQ_OVFL             40
 
+#define SO_ATTACH_BPF           50
+#define SO_DETACH_BPF           SO_DETACH_FILTER
+
 #endif /* _ASM_SOCKET_H */
 
@@ -31,6 +31,7 @@
 #include <asm/aes.h>
 #include <crypto/scatterwalk.h>
 #include <crypto/internal/aead.h>
+#include <crypto/internal/skcipher.h>
 #include <linux/workqueue.h>
 #include <linux/spinlock.h>
 
@@ -46,12 +47,20 @@
 #define HAS_PCBC
 #endif
 
-#if defined(CONFIG_CRYPTO_XTS) || defined(CONFIG_CRYPTO_XTS_MODULE)
+#if defined(CONFIG_CRYPTO_XTS) || defined(CONFIG_CRYPTO_XTS_MODULE) || \
+	defined(CONFIG_X86_64)
 #define HAS_XTS
 #endif
 
+typedef int (*aesni_blk_fn)(struct blkcipher_desc *desc,
+			    struct scatterlist *dst, struct scatterlist *src,
+			    unsigned int nbytes);
+
 struct async_aes_ctx {
 	struct cryptd_ablkcipher *cryptd_tfm;
+	/* child operations without kernel_fpu_begin(), for request lists */
+	aesni_blk_fn encrypt;
+	aesni_blk_fn decrypt;
 };
 
 /* This data is stored at the end of the crypto_tfm struct.
@@ -80,6 +89,12 @@ struct aesni_hash_subkey_req_data {
 #define AES_BLOCK_MASK	(~(AES_BLOCK_SIZE-1))
 #define RFC4106_HASH_SUBKEY_SIZE 16
 
+/* The first half of an XTS key encrypts the data, the second the tweak */
+struct aesni_xts_ctx {
+	u8 raw_tweak_ctx[sizeof(struct crypto_aes_ctx) + AESNI_ALIGN - 1];
+	u8 raw_crypt_ctx[sizeof(struct crypto_aes_ctx) + AESNI_ALIGN - 1];
+};
+
 asmlinkage int aesni_set_key(struct crypto_aes_ctx *ctx, const u8 *in_key,
 			     unsigned int key_len);
 asmlinkage void aesni_enc(struct crypto_aes_ctx *ctx, u8 *out,
@@ -102,6 +117,15 @@ void crypto_fpu_exit(void);
 asmlinkage void aesni_ctr_enc(struct crypto_aes_ctx *ctx, u8 *out,
 			      const u8 *in, unsigned int len, u8 *iv);
 
+/*
+ * iv is the tweak of the first block, already encrypted with the tweak
+ * key; it is advanced past the last block processed.
+ */
+asmlinkage void aesni_xts_enc(struct crypto_aes_ctx *ctx, u8 *out,
+			      const u8 *in, unsigned int len, u8 *iv);
+asmlinkage void aesni_xts_dec(struct crypto_aes_ctx *ctx, u8 *out,
+			      const u8 *in, unsigned int len, u8 *iv);
+
 /* asmlinkage void aesni_gcm_enc()
  * void *ctx,  AES Key schedule. Starts on a 16 byte boundary.
  * u8 *out, Ciphertext output. Encrypt in-place is allowed.
@@ -276,9 +300,9 @@ static struct crypto_alg __aesni_alg = {
 	}
 };
 
-static int ecb_encrypt(struct blkcipher_desc *desc,
-		       struct scatterlist *dst, struct scatterlist *src,
-		       unsigned int nbytes)
+static int __ecb_encrypt(struct blkcipher_desc *desc,
+			 struct scatterlist *dst, struct scatterlist *src,
+			 unsigned int nbytes)
 {
 	struct crypto_aes_ctx *ctx = aes_ctx(crypto_blkcipher_ctx(desc->tfm));
 	struct blkcipher_walk walk;
@@ -288,21 +312,32 @@ static int ecb_encrypt(struct blkcipher_desc *desc,
 	err = blkcipher_walk_virt(desc, &walk);
 	desc->flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
 
-	kernel_fpu_begin();
 	while ((nbytes = walk.nbytes)) {
 		aesni_ecb_enc(ctx, walk.dst.virt.addr, walk.src.virt.addr,
 			      nbytes & AES_BLOCK_MASK);
 		nbytes &= AES_BLOCK_SIZE - 1;
 		err = blkcipher_walk_done(desc, &walk, nbytes);
 	}
-	kernel_fpu_end();
 
 	return err;
 }
 
-static int ecb_decrypt(struct blkcipher_desc *desc,
+static int ecb_encrypt(struct blkcipher_desc *desc,
 		       struct scatterlist *dst, struct scatterlist *src,
 		       unsigned int nbytes)
+{
+	int err;
+
+	kernel_fpu_begin();
+	err = __ecb_encrypt(desc, dst, src, nbytes);
+	kernel_fpu_end();
+
+	return err;
+}
+
+static int __ecb_decrypt(struct blkcipher_desc *desc,
+			 struct scatterlist *dst, struct scatterlist *src,
+			 unsigned int nbytes)
 {
 	struct crypto_aes_ctx *ctx = aes_ctx(crypto_blkcipher_ctx(desc->tfm));
 	struct blkcipher_walk walk;
@@ -312,13 +347,24 @@ static int ecb_decrypt(struct blkcipher_desc *desc,
 	err = blkcipher_walk_virt(desc, &walk);
 	desc->flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
 
-	kernel_fpu_begin();
 	while ((nbytes = walk.nbytes)) {
 		aesni_ecb_dec(ctx, walk.dst.virt.addr, walk.src.virt.addr,
 			      nbytes & AES_BLOCK_MASK);
 		nbytes &= AES_BLOCK_SIZE - 1;
 		err = blkcipher_walk_done(desc, &walk, nbytes);
 	}
+
+	return err;
+}
+
+static int ecb_decrypt(struct blkcipher_desc *desc,
+		       struct scatterlist *dst, struct scatterlist *src,
+		       unsigned int nbytes)
+{
+	int err;
+
+	kernel_fpu_begin();
+	err = __ecb_decrypt(desc, dst, src, nbytes);
 	kernel_fpu_end();
 
 	return err;
@@ -346,9 +392,9 @@ static struct crypto_alg blk_ecb_alg = {
 	},
 };
 
-static int cbc_encrypt(struct blkcipher_desc *desc,
-		       struct scatterlist *dst, struct scatterlist *src,
-		       unsigned int nbytes)
+static int __cbc_encrypt(struct blkcipher_desc *desc,
+			 struct scatterlist *dst, struct scatterlist *src,
+			 unsigned int nbytes)
 {
 	struct crypto_aes_ctx *ctx = aes_ctx(crypto_blkcipher_ctx(desc->tfm));
 	struct blkcipher_walk walk;
@@ -358,21 +404,32 @@ static int cbc_encrypt(struct blkcipher_desc *desc,
 	err = blkcipher_walk_virt(desc, &walk);
 	desc->flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
 
-	kernel_fpu_begin();
 	while ((nbytes = walk.nbytes)) {
 		aesni_cbc_enc(ctx, walk.dst.virt.addr, walk.src.virt.addr,
 			      nbytes & AES_BLOCK_MASK, walk.iv);
 		nbytes &= AES_BLOCK_SIZE - 1;
 		err = blkcipher_walk_done(desc, &walk, nbytes);
 	}
-	kernel_fpu_end();
 
 	return err;
 }
 
-static int cbc_decrypt(struct blkcipher_desc *desc,
+static int cbc_encrypt(struct blkcipher_desc *desc,
 		       struct scatterlist *dst, struct scatterlist *src,
 		       unsigned int nbytes)
+{
+	int err;
+
+	kernel_fpu_begin();
+	err = __cbc_encrypt(desc, dst, src, nbytes);
+	kernel_fpu_end();
+
+	return err;
+}
+
+static int __cbc_decrypt(struct blkcipher_desc *desc,
+			 struct scatterlist *dst, struct scatterlist *src,
+			 unsigned int nbytes)
 {
 	struct crypto_aes_ctx *ctx = aes_ctx(crypto_blkcipher_ctx(desc->tfm));
 	struct blkcipher_walk walk;
@@ -382,13 +439,24 @@ static int cbc_decrypt(struct blkcipher_desc *desc,
 	err = blkcipher_walk_virt(desc, &walk);
 	desc->flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
 
-	kernel_fpu_begin();
 	while ((nbytes = walk.nbytes)) {
 		aesni_cbc_dec(ctx, walk.dst.virt.addr, walk.src.virt.addr,
 			      nbytes & AES_BLOCK_MASK, walk.iv);
 		nbytes &= AES_BLOCK_SIZE - 1;
 		err = blkcipher_walk_done(desc, &walk, nbytes);
 	}
+
+	return err;
+}
+
+static int cbc_decrypt(struct blkcipher_desc *desc,
+		       struct scatterlist *dst, struct scatterlist *src,
+		       unsigned int nbytes)
+{
+	int err;
+
+	kernel_fpu_begin();
+	err = __cbc_decrypt(desc, dst, src, nbytes);
 	kernel_fpu_end();
 
 	return err;
@@ -432,9 +500,9 @@ static void ctr_crypt_final(struct crypto_aes_ctx *ctx,
 	crypto_inc(ctrblk, AES_BLOCK_SIZE);
 }
 
-static int ctr_crypt(struct blkcipher_desc *desc,
-		     struct scatterlist *dst, struct scatterlist *src,
-		     unsigned int nbytes)
+static int __ctr_crypt(struct blkcipher_desc *desc,
+		       struct scatterlist *dst, struct scatterlist *src,
+		       unsigned int nbytes)
 {
 	struct crypto_aes_ctx *ctx = aes_ctx(crypto_blkcipher_ctx(desc->tfm));
 	struct blkcipher_walk walk;
@@ -444,7 +512,6 @@ static int ctr_crypt(struct blkcipher_desc *desc,
 	err = blkcipher_walk_virt_block(desc, &walk, AES_BLOCK_SIZE);
 	desc->flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
 
-	kernel_fpu_begin();
 	while ((nbytes = walk.nbytes) >= AES_BLOCK_SIZE) {
 		aesni_ctr_enc(ctx, walk.dst.virt.addr, walk.src.virt.addr,
 			      nbytes & AES_BLOCK_MASK, walk.iv);
@@ -455,6 +522,18 @@ static int ctr_crypt(struct blkcipher_desc *desc,
 		ctr_crypt_final(ctx, &walk);
 		err = blkcipher_walk_done(desc, &walk, 0);
 	}
+
+	return err;
+}
+
+static int ctr_crypt(struct blkcipher_desc *desc,
+		     struct scatterlist *dst, struct scatterlist *src,
+		     unsigned int nbytes)
+{
+	int err;
+
+	kernel_fpu_begin();
+	err = __ctr_crypt(desc, dst, src, nbytes);
 	kernel_fpu_end();
 
 	return err;
@@ -482,6 +561,116 @@ static struct crypto_alg blk_ctr_alg = {
 		},
 	},
 };
+
+static int xts_aesni_setkey(struct crypto_tfm *tfm, const u8 *key,
+			    unsigned int keylen)
+{
+	struct aesni_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+	int err;
+
+	/* key consists of keys of equal size concatenated */
+	if (keylen % 2) {
+		tfm->crt_flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+
+	err = aes_set_key_common(tfm, ctx->raw_crypt_ctx, key, keylen / 2);
+	if (err)
+		return err;
+
+	return aes_set_key_common(tfm, ctx->raw_tweak_ctx, key + keylen / 2,
+				  keylen / 2);
+}
+
+static int __xts_crypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes, bool enc)
+{
+	struct aesni_xts_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct crypto_aes_ctx *crypt_ctx = aes_ctx(ctx->raw_crypt_ctx);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+	desc->flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
+
+	/* the first tweak is the encrypted IV */
+	aesni_enc(aes_ctx(ctx->raw_tweak_ctx), walk.iv, walk.iv);
+
+	while ((nbytes = walk.nbytes)) {
+		if (enc)
+			aesni_xts_enc(crypt_ctx, walk.dst.virt.addr,
+				      walk.src.virt.addr,
+				      nbytes & AES_BLOCK_MASK, walk.iv);
+		else
+			aesni_xts_dec(crypt_ctx, walk.dst.virt.addr,
+				      walk.src.virt.addr,
+				      nbytes & AES_BLOCK_MASK, walk.iv);
+		nbytes &= AES_BLOCK_SIZE - 1;
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int __xts_encrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+			 struct scatterlist *src, unsigned int nbytes)
+{
+	return __xts_crypt(desc, dst, src, nbytes, true);
+}
+
+static int __xts_decrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+			 struct scatterlist *src, unsigned int nbytes)
+{
+	return __xts_crypt(desc, dst, src, nbytes, false);
+}
+
+static int xts_crypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		     struct scatterlist *src, unsigned int nbytes, bool enc)
+{
+	int err;
+
+	kernel_fpu_begin();
+	err = __xts_crypt(desc, dst, src, nbytes, enc);
+	kernel_fpu_end();
+
+	return err;
+}
+
+static int xts_encrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	return xts_crypt(desc, dst, src, nbytes, true);
+}
+
+static int xts_decrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	return xts_crypt(desc, dst, src, nbytes, false);
+}
+
+static struct crypto_alg blk_xts_alg = {
+	.cra_name		= "__xts-aes-aesni",
+	.cra_driver_name	= "__driver-xts-aes-aesni",
+	.cra_priority		= 0,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesni_xts_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(blk_xts_alg.cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= 2 * AES_MIN_KEY_SIZE,
+			.max_keysize	= 2 * AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= xts_aesni_setkey,
+			.encrypt	= xts_encrypt,
+			.decrypt	= xts_decrypt,
+		},
+	},
+};
 #endif
 
 static int ablk_set_key(struct crypto_ablkcipher *tfm, const u8 *key,
@@ -542,6 +731,79 @@ static int ablk_decrypt(struct ablkcipher_request *req)
 	}
 }
 
+/*
+ * Process a list of requests under a single kernel_fpu_begin().  Results
+ * are stashed in the (otherwise unused) request context and the callbacks
+ * run only after kernel_fpu_end(), since they may submit more requests.
+ */
+static void ablk_crypt_list(struct list_head *reqs, bool enc)
+{
+	struct ablkcipher_request *req, *n;
+	struct crypto_ablkcipher *tfm;
+	struct async_aes_ctx *ctx;
+	struct blkcipher_desc desc;
+	aesni_blk_fn fn;
+
+	req = list_first_entry(reqs, struct ablkcipher_request, base.list);
+	tfm = crypto_ablkcipher_reqtfm(req);
+	ctx = crypto_ablkcipher_ctx(tfm);
+	fn = enc ? ctx->encrypt : ctx->decrypt;
+
+	if (!fn) {
+		if (enc)
+			skcipher_default_encrypt_list(reqs);
+		else
+			skcipher_default_decrypt_list(reqs);
+		return;
+	}
+
+	if (!irq_fpu_usable()) {
+		LIST_HEAD(cryptd_reqs);
+
+		list_for_each_entry_safe(req, n, reqs, base.list) {
+			struct ablkcipher_request *cryptd_req =
+				ablkcipher_request_ctx(req);
+
+			list_del(&req->base.list);
+			memcpy(cryptd_req, req, sizeof(*req));
+			ablkcipher_request_set_tfm(cryptd_req,
+						   &ctx->cryptd_tfm->base);
+			list_add_tail(&cryptd_req->base.list, &cryptd_reqs);
+		}
+		if (enc)
+			crypto_ablkcipher_encrypt_list(&cryptd_reqs);
+		else
+			crypto_ablkcipher_decrypt_list(&cryptd_reqs);
+		return;
+	}
+
+	desc.tfm = cryptd_ablkcipher_child(ctx->cryptd_tfm);
+	kernel_fpu_begin();
+	list_for_each_entry(req, reqs, base.list) {
+		desc.info = req->info;
+		desc.flags = 0;
+		*(int *)ablkcipher_request_ctx(req) =
+			fn(&desc, req->dst, req->src, req->nbytes);
+	}
+	kernel_fpu_end();
+
+	list_for_each_entry_safe(req, n, reqs, base.list) {
+		list_del(&req->base.list);
+		req->base.complete(&req->base,
+				   *(int *)ablkcipher_request_ctx(req));
+	}
+}
+
+static void ablk_encrypt_list(struct list_head *reqs)
+{
+	ablk_crypt_list(reqs, true);
+}
+
+static void ablk_decrypt_list(struct list_head *reqs)
+{
+	ablk_crypt_list(reqs, false);
+}
+
 static void ablk_exit(struct crypto_tfm *tfm)
 {
 	struct async_aes_ctx *ctx = crypto_tfm_ctx(tfm);
@@ -550,11 +812,14 @@ static void ablk_exit(struct crypto_tfm *tfm)
 }
 
 static void ablk_init_common(struct crypto_tfm *tfm,
-			     struct cryptd_ablkcipher *cryptd_tfm)
+			     struct cryptd_ablkcipher *cryptd_tfm,
+			     aesni_blk_fn encrypt, aesni_blk_fn decrypt)
 {
 	struct async_aes_ctx *ctx = crypto_tfm_ctx(tfm);
 
 	ctx->cryptd_tfm = cryptd_tfm;
+	ctx->encrypt = encrypt;
+	ctx->decrypt = decrypt;
 	tfm->crt_ablkcipher.reqsize = sizeof(struct ablkcipher_request) +
 		crypto_ablkcipher_reqsize(&cryptd_tfm->base);
 }
@@ -566,7 +831,7 @@ static int ablk_ecb_init(struct crypto_tfm *tfm)
 	cryptd_tfm = cryptd_alloc_ablkcipher("__driver-ecb-aes-aesni", 0, 0);
 	if (IS_ERR(cryptd_tfm))
 		return PTR_ERR(cryptd_tfm);
-	ablk_init_common(tfm, cryptd_tfm);
+	ablk_init_common(tfm, cryptd_tfm, __ecb_encrypt, __ecb_decrypt);
 	return 0;
 }
 
@@ -590,6 +855,8 @@ static struct crypto_alg ablk_ecb_alg = {
 			.setkey		= ablk_set_key,
 			.encrypt	= ablk_encrypt,
 			.decrypt	= ablk_decrypt,
+			.encrypt_list	= ablk_encrypt_list,
+			.decrypt_list	= ablk_decrypt_list,
 		},
 	},
 };
@@ -601,7 +868,7 @@ static int ablk_cbc_init(struct crypto_tfm *tfm)
 	cryptd_tfm = cryptd_alloc_ablkcipher("__driver-cbc-aes-aesni", 0, 0);
 	if (IS_ERR(cryptd_tfm))
 		return PTR_ERR(cryptd_tfm);
-	ablk_init_common(tfm, cryptd_tfm);
+	ablk_init_common(tfm, cryptd_tfm, __cbc_encrypt, __cbc_decrypt);
 	return 0;
 }
 
@@ -626,6 +893,8 @@ static struct crypto_alg ablk_cbc_alg = {
 			.setkey		= ablk_set_key,
 			.encrypt	= ablk_encrypt,
 			.decrypt	= ablk_decrypt,
+			.encrypt_list	= ablk_encrypt_list,
+			.decrypt_list	= ablk_decrypt_list,
 		},
 	},
 };
@@ -638,7 +907,7 @@ static int ablk_ctr_init(struct crypto_tfm *tfm)
 	cryptd_tfm = cryptd_alloc_ablkcipher("__driver-ctr-aes-aesni", 0, 0);
 	if (IS_ERR(cryptd_tfm))
 		return PTR_ERR(cryptd_tfm);
-	ablk_init_common(tfm, cryptd_tfm);
+	ablk_init_common(tfm, cryptd_tfm, __ctr_crypt, __ctr_crypt);
 	return 0;
 }
 
@@ -663,6 +932,8 @@ static struct crypto_alg ablk_ctr_alg = {
 			.setkey		= ablk_set_key,
 			.encrypt	= ablk_encrypt,
 			.decrypt	= ablk_encrypt,
+			.encrypt_list	= ablk_encrypt_list,
+			.decrypt_list	= ablk_encrypt_list,
 			.geniv		= "chainiv",
 		},
 	},
@@ -677,7 +948,7 @@ static int ablk_rfc3686_ctr_init(struct crypto_tfm *tfm)
 		"rfc3686(__driver-ctr-aes-aesni)", 0, 0);
 	if (IS_ERR(cryptd_tfm))
 		return PTR_ERR(cryptd_tfm);
-	ablk_init_common(tfm, cryptd_tfm);
+	ablk_init_common(tfm, cryptd_tfm, NULL, NULL);
 	return 0;
 }
 
@@ -702,6 +973,8 @@ static struct crypto_alg ablk_rfc3686_ctr_alg = {
 			.setkey	     = ablk_set_key,
 			.encrypt     = ablk_encrypt,
 			.decrypt     = ablk_decrypt,
+			.encrypt_list = ablk_encrypt_list,
+			.decrypt_list = ablk_decrypt_list,
 			.geniv	     = "seqiv",
 		},
 	},
@@ -718,7 +991,7 @@ static int ablk_lrw_init(struct crypto_tfm *tfm)
 					     0, 0);
 	if (IS_ERR(cryptd_tfm))
 		return PTR_ERR(cryptd_tfm);
-	ablk_init_common(tfm, cryptd_tfm);
+	ablk_init_common(tfm, cryptd_tfm, NULL, NULL);
 	return 0;
 }
 
@@ -743,6 +1016,8 @@ static struct crypto_alg ablk_lrw_alg = {
 			.setkey		= ablk_set_key,
 			.encrypt	= ablk_encrypt,
 			.decrypt	= ablk_decrypt,
+			.encrypt_list	= ablk_encrypt_list,
+			.decrypt_list	= ablk_decrypt_list,
 		},
 	},
 };
@@ -757,7 +1032,7 @@ static int ablk_pcbc_init(struct crypto_tfm *tfm)
 					     0, 0);
 	if (IS_ERR(cryptd_tfm))
 		return PTR_ERR(cryptd_tfm);
-	ablk_init_common(tfm, cryptd_tfm);
+	ablk_init_common(tfm, cryptd_tfm, NULL, NULL);
 	return 0;
 }
 
@@ -782,6 +1057,8 @@ static struct crypto_alg ablk_pcbc_alg = {
 			.setkey		= ablk_set_key,
 			.encrypt	= ablk_encrypt,
 			.decrypt	= ablk_decrypt,
+			.encrypt_list	= ablk_encrypt_list,
+			.decrypt_list	= ablk_decrypt_list,
 		},
 	},
 };
@@ -792,11 +1069,19 @@ static int ablk_xts_init(struct crypto_tfm *tfm)
 {
 	struct cryptd_ablkcipher *cryptd_tfm;
 
+#ifdef CONFIG_X86_64
+	cryptd_tfm = cryptd_alloc_ablkcipher("__driver-xts-aes-aesni", 0, 0);
+#else
 	cryptd_tfm = cryptd_alloc_ablkcipher("fpu(xts(__driver-aes-aesni))",
 					     0, 0);
+#endif
 	if (IS_ERR(cryptd_tfm))
 		return PTR_ERR(cryptd_tfm);
-	ablk_init_common(tfm, cryptd_tfm);
+#ifdef CONFIG_X86_64
+	ablk_init_common(tfm, cryptd_tfm, __xts_encrypt, __xts_decrypt);
+#else
+	ablk_init_common(tfm, cryptd_tfm, NULL, NULL);
+#endif
 	return 0;
 }
 
@@ -821,6 +1106,8 @@ static struct crypto_alg ablk_xts_alg = {
 			.setkey		= ablk_set_key,
 			.encrypt	= ablk_encrypt,
 			.decrypt	= ablk_decrypt,
+			.encrypt_list	= ablk_encrypt_list,
+			.decrypt_list	= ablk_decrypt_list,
 		},
 	},
 };
@@ -944,7 +1231,8 @@ static int rfc4106_set_key(struct crypto_aead *parent, const u8 *key,
 	}
 	/*Account for 4 byte nonce at the end.*/
 	key_len -= 4;
-	if (key_len != AES_KEYSIZE_128) {
+	if (key_len != AES_KEYSIZE_128 && key_len != AES_KEYSIZE_192 &&
+	    key_len != AES_KEYSIZE_256) {
 		crypto_tfm_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN);
 		return -EINVAL;
 	}
@@ -1048,6 +1336,61 @@ static int rfc4106_decrypt(struct aead_request *req)
 	}
 }
 
+/* As ablk_crypt_list(), for the GCM driver behind cryptd. */
+static void rfc4106_crypt_list(struct list_head *reqs, bool enc)
+{
+	struct aead_request *req, *n;
+	struct crypto_aead *tfm;
+	struct aesni_rfc4106_gcm_ctx *ctx;
+	struct crypto_aead *cryptd_child;
+
+	req = list_first_entry(reqs, struct aead_request, base.list);
+	tfm = crypto_aead_reqtfm(req);
+	ctx = aesni_rfc4106_gcm_ctx_get(tfm);
+
+	if (!irq_fpu_usable()) {
+		LIST_HEAD(cryptd_reqs);
+
+		list_for_each_entry_safe(req, n, reqs, base.list) {
+			struct aead_request *cryptd_req =
+				(struct aead_request *) aead_request_ctx(req);
+
+			list_del(&req->base.list);
+			memcpy(cryptd_req, req, sizeof(*req));
+			aead_request_set_tfm(cryptd_req, &ctx->cryptd_tfm->base);
+			list_add_tail(&cryptd_req->base.list, &cryptd_reqs);
+		}
+		if (enc)
+			crypto_aead_encrypt_list(&cryptd_reqs);
+		else
+			crypto_aead_decrypt_list(&cryptd_reqs);
+		return;
+	}
+
+	cryptd_child = cryptd_aead_child(ctx->cryptd_tfm);
+	kernel_fpu_begin();
+	list_for_each_entry(req, reqs, base.list)
+		*(int *)aead_request_ctx(req) = enc ?
+			cryptd_child->base.crt_aead.encrypt(req) :
+			cryptd_child->base.crt_aead.decrypt(req);
+	kernel_fpu_end();
+
+	list_for_each_entry_safe(req, n, reqs, base.list) {
+		list_del(&req->base.list);
+		req->base.complete(&req->base, *(int *)aead_request_ctx(req));
+	}
+}
+
+static void rfc4106_encrypt_list(struct list_head *reqs)
+{
+	rfc4106_crypt_list(reqs, true);
+}
+
+static void rfc4106_decrypt_list(struct list_head *reqs)
+{
+	rfc4106_crypt_list(reqs, false);
+}
+
 static struct crypto_alg rfc4106_alg = {
 	.cra_name = "rfc4106(gcm(aes))",
 	.cra_driver_name = "rfc4106-gcm-aesni",
@@ -1067,6 +1410,8 @@ static struct crypto_alg rfc4106_alg = {
 			.setauthsize = rfc4106_set_authsize,
 			.encrypt = rfc4106_encrypt,
 			.decrypt = rfc4106_decrypt,
+			.encrypt_list = rfc4106_encrypt_list,
+			.decrypt_list = rfc4106_decrypt_list,
 			.geniv = "seqiv",
 			.ivsize = 8,
 			.maxauthsize = 16,
@@ -1280,6 +1625,8 @@ static int __init aesni_init(void)
 		goto blk_ctr_err;
 	if ((err = crypto_register_alg(&ablk_ctr_alg)))
 		goto ablk_ctr_err;
+	if ((err = crypto_register_alg(&blk_xts_alg)))
+		goto blk_xts_err;
 	if ((err = crypto_register_alg(&__rfc4106_alg)))
 		goto __aead_gcm_err;
 	if ((err = crypto_register_alg(&rfc4106_alg)))
@@ -1323,6 +1670,8 @@ ablk_rfc3686_ctr_err:
 aead_gcm_err:
 	crypto_unregister_alg(&__rfc4106_alg);
 __aead_gcm_err:
+	crypto_unregister_alg(&blk_xts_alg);
+blk_xts_err:
 	crypto_unregister_alg(&ablk_ctr_alg);
 ablk_ctr_err:
 	crypto_unregister_alg(&blk_ctr_alg);
@@ -1361,6 +1710,7 @@ static void __exit aesni_exit(void)
 #endif
 	crypto_unregister_alg(&rfc4106_alg);
 	crypto_unregister_alg(&__rfc4106_alg);
+	crypto_unregister_alg(&blk_xts_alg);
 	crypto_unregister_alg(&ablk_ctr_alg);
 	crypto_unregister_alg(&blk_ctr_alg);
 #endif
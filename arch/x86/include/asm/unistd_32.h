@@ -352,10 +352,15 @@
 #define __NR_syncfs             344
 #define __NR_sendmmsg		345
 #define __NR_setns		346
+#define __NR_io_uring_setup	347
+#define __NR_io_uring_enter	348
+#define __NR_io_uring_register	349
+#define __NR_copy_file_range	350
+#define __NR_bpf		351
 
 #ifdef __KERNEL__
 
-#define NR_syscalls 347
+#define NR_syscalls 352
 
 #define __ARCH_WANT_IPC_PARSE_VERSION
 #define __ARCH_WANT_OLD_READDIR
@@ -683,6 +683,16 @@ __SYSCALL(__NR_sendmmsg, sys_sendmmsg)
 __SYSCALL(__NR_setns, sys_setns)
 #define __NR_getcpu				309
 __SYSCALL(__NR_getcpu, sys_getcpu)
+#define __NR_io_uring_setup			310
+__SYSCALL(__NR_io_uring_setup, sys_io_uring_setup)
+#define __NR_io_uring_enter			311
+__SYSCALL(__NR_io_uring_enter, sys_io_uring_enter)
+#define __NR_io_uring_register			312
+__SYSCALL(__NR_io_uring_register, sys_io_uring_register)
+#define __NR_copy_file_range			313
+__SYSCALL(__NR_copy_file_range, sys_copy_file_range)
+#define __NR_bpf				314
+__SYSCALL(__NR_bpf, sys_bpf)
 
 #ifndef __NO_STUBS
 #define __ARCH_WANT_OLD_READDIR
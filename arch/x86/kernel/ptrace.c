@@ -1378,8 +1378,14 @@ long syscall_trace_enter(struct pt_regs *regs)
 	if (test_thread_flag(TIF_SINGLESTEP))
 		regs->flags |= X86_EFLAGS_TF;
 
-	/* do the secure computing check first */
-	secure_computing(regs->orig_ax);
+	/*
+	 * Do the secure computing check first; a filter may have
+	 * decided to skip the call with its return value already set.
+	 */
+	if (secure_computing(regs->orig_ax)) {
+		ret = -1L;
+		goto out;
+	}
 
 	if (unlikely(test_thread_flag(TIF_SYSCALL_EMU)))
 		ret = -1L;
@@ -1406,6 +1412,7 @@ long syscall_trace_enter(struct pt_regs *regs)
 #endif
 	}
 
+out:
 	return ret ?: regs->orig_ax;
 }
 
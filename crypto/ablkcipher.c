@@ -359,6 +359,30 @@ int skcipher_null_givdecrypt(struct skcipher_givcrypt_request *req)
 	return crypto_ablkcipher_decrypt(&req->creq);
 }
 
+void skcipher_default_encrypt_list(struct list_head *reqs)
+{
+	struct ablkcipher_request *req, *n;
+
+	list_for_each_entry_safe(req, n, reqs, base.list) {
+		list_del(&req->base.list);
+		crypto_list_request_done(&req->base,
+					 crypto_ablkcipher_encrypt(req));
+	}
+}
+EXPORT_SYMBOL_GPL(skcipher_default_encrypt_list);
+
+void skcipher_default_decrypt_list(struct list_head *reqs)
+{
+	struct ablkcipher_request *req, *n;
+
+	list_for_each_entry_safe(req, n, reqs, base.list) {
+		list_del(&req->base.list);
+		crypto_list_request_done(&req->base,
+					 crypto_ablkcipher_decrypt(req));
+	}
+}
+EXPORT_SYMBOL_GPL(skcipher_default_decrypt_list);
+
 static int crypto_init_ablkcipher_ops(struct crypto_tfm *tfm, u32 type,
 				      u32 mask)
 {
@@ -371,6 +395,8 @@ static int crypto_init_ablkcipher_ops(struct crypto_tfm *tfm, u32 type,
 	crt->setkey = setkey;
 	crt->encrypt = alg->encrypt;
 	crt->decrypt = alg->decrypt;
+	crt->encrypt_list = alg->encrypt_list ?: skcipher_default_encrypt_list;
+	crt->decrypt_list = alg->decrypt_list ?: skcipher_default_decrypt_list;
 	if (!alg->ivsize) {
 		crt->givencrypt = skcipher_null_givencrypt;
 		crt->givdecrypt = skcipher_null_givdecrypt;
@@ -424,6 +450,8 @@ static int crypto_init_givcipher_ops(struct crypto_tfm *tfm, u32 type,
 		      alg->setkey : setkey;
 	crt->encrypt = alg->encrypt;
 	crt->decrypt = alg->decrypt;
+	crt->encrypt_list = alg->encrypt_list ?: skcipher_default_encrypt_list;
+	crt->decrypt_list = alg->decrypt_list ?: skcipher_default_decrypt_list;
 	crt->givencrypt = alg->givencrypt;
 	crt->givdecrypt = alg->givdecrypt ?: no_givdecrypt;
 	crt->base = __crypto_ablkcipher_cast(tfm);
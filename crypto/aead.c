@@ -88,6 +88,40 @@ static int no_givcrypt(struct aead_givcrypt_request *req)
 	return -ENOSYS;
 }
 
+void aead_default_encrypt_list(struct list_head *reqs)
+{
+	struct aead_request *req, *n;
+
+	list_for_each_entry_safe(req, n, reqs, base.list) {
+		list_del(&req->base.list);
+		crypto_list_request_done(&req->base, crypto_aead_encrypt(req));
+	}
+}
+EXPORT_SYMBOL_GPL(aead_default_encrypt_list);
+
+void aead_default_decrypt_list(struct list_head *reqs)
+{
+	struct aead_request *req, *n;
+
+	list_for_each_entry_safe(req, n, reqs, base.list) {
+		list_del(&req->base.list);
+		crypto_list_request_done(&req->base, crypto_aead_decrypt(req));
+	}
+}
+EXPORT_SYMBOL_GPL(aead_default_decrypt_list);
+
+void aead_default_givencrypt_list(struct list_head *reqs)
+{
+	struct aead_givcrypt_request *req, *n;
+
+	list_for_each_entry_safe(req, n, reqs, areq.base.list) {
+		list_del(&req->areq.base.list);
+		crypto_list_request_done(&req->areq.base,
+					 crypto_aead_givencrypt(req));
+	}
+}
+EXPORT_SYMBOL_GPL(aead_default_givencrypt_list);
+
 static int crypto_init_aead_ops(struct crypto_tfm *tfm, u32 type, u32 mask)
 {
 	struct aead_alg *alg = &tfm->__crt_alg->cra_aead;
@@ -102,6 +136,10 @@ static int crypto_init_aead_ops(struct crypto_tfm *tfm, u32 type, u32 mask)
 	crt->decrypt = alg->decrypt;
 	crt->givencrypt = alg->givencrypt ?: no_givcrypt;
 	crt->givdecrypt = alg->givdecrypt ?: no_givcrypt;
+	crt->encrypt_list = alg->encrypt_list ?: aead_default_encrypt_list;
+	crt->decrypt_list = alg->decrypt_list ?: aead_default_decrypt_list;
+	crt->givencrypt_list = alg->givencrypt_list ?:
+			       aead_default_givencrypt_list;
 	crt->base = __crypto_aead_cast(tfm);
 	crt->ivsize = alg->ivsize;
 	crt->authsize = alg->maxauthsize;
@@ -154,6 +192,9 @@ static int crypto_init_nivaead_ops(struct crypto_tfm *tfm, u32 type, u32 mask)
 	crt->setkey = setkey;
 	crt->encrypt = alg->encrypt;
 	crt->decrypt = alg->decrypt;
+	crt->encrypt_list = alg->encrypt_list ?: aead_default_encrypt_list;
+	crt->decrypt_list = alg->decrypt_list ?: aead_default_decrypt_list;
+	crt->givencrypt_list = aead_default_givencrypt_list;
 	if (!alg->ivsize) {
 		crt->givencrypt = aead_null_givencrypt;
 		crt->givdecrypt = aead_null_givdecrypt;
@@ -292,6 +333,8 @@ struct crypto_instance *aead_geniv_alloc(struct crypto_template *tmpl,
 	inst->alg.cra_aead.setauthsize = alg->cra_aead.setauthsize;
 	inst->alg.cra_aead.encrypt = alg->cra_aead.encrypt;
 	inst->alg.cra_aead.decrypt = alg->cra_aead.decrypt;
+	inst->alg.cra_aead.encrypt_list = alg->cra_aead.encrypt_list;
+	inst->alg.cra_aead.decrypt_list = alg->cra_aead.decrypt_list;
 
 out:
 	return inst;
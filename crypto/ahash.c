@@ -351,6 +351,16 @@ static int ahash_def_finup(struct ahash_request *req)
 	return ahash_def_finup_finish1(req, tfm->update(req));
 }
 
+static void ahash_def_digest_list(struct list_head *reqs)
+{
+	struct ahash_request *req, *n;
+
+	list_for_each_entry_safe(req, n, reqs, base.list) {
+		list_del(&req->base.list);
+		crypto_list_request_done(&req->base, crypto_ahash_digest(req));
+	}
+}
+
 static int ahash_no_export(struct ahash_request *req, void *out)
 {
 	return -ENOSYS;
@@ -369,6 +379,7 @@ static int crypto_ahash_init_tfm(struct crypto_tfm *tfm)
 	hash->setkey = ahash_nosetkey;
 	hash->export = ahash_no_export;
 	hash->import = ahash_no_import;
+	hash->digest_list = ahash_def_digest_list;
 
 	if (tfm->__crt_alg->cra_type != &crypto_ahash_type)
 		return crypto_init_shash_ops_async(tfm);
@@ -385,6 +396,8 @@ static int crypto_ahash_init_tfm(struct crypto_tfm *tfm)
 		hash->export = alg->export;
 	if (alg->import)
 		hash->import = alg->import;
+	if (alg->digest_list)
+		hash->digest_list = alg->digest_list;
 
 	return 0;
 }
@@ -17,10 +17,12 @@
 
 #include <linux/err.h>
 #include <linux/errno.h>
+#include <linux/hardirq.h>
 #include <linux/kernel.h>
 #include <linux/kmod.h>
 #include <linux/module.h>
 #include <linux/param.h>
+#include <linux/percpu.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/string.h>
@@ -602,5 +604,71 @@ int crypto_has_alg(const char *name, u32 type, u32 mask)
 }
 EXPORT_SYMBOL_GPL(crypto_has_alg);
 
+static DEFINE_PER_CPU(struct crypto_plug *, crypto_plug);
+
+static void crypto_flush_plug(struct crypto_plug *plug)
+{
+	LIST_HEAD(reqs);
+
+	/* The callbacks run by submit() may plug further requests. */
+	while (plug->count) {
+		void (*submit)(struct list_head *reqs) = plug->submit;
+
+		list_splice_init(&plug->list, &reqs);
+		plug->count = 0;
+		plug->tfm = NULL;
+		submit(&reqs);
+	}
+}
+
+void crypto_start_plug(struct crypto_plug *plug)
+{
+	INIT_LIST_HEAD(&plug->list);
+	plug->submit = NULL;
+	plug->tfm = NULL;
+	plug->count = 0;
+
+	WARN_ON_ONCE(!in_softirq());
+	if (!__this_cpu_read(crypto_plug))
+		__this_cpu_write(crypto_plug, plug);
+}
+EXPORT_SYMBOL_GPL(crypto_start_plug);
+
+void crypto_finish_plug(struct crypto_plug *plug)
+{
+	if (__this_cpu_read(crypto_plug) != plug)
+		return;
+
+	crypto_flush_plug(plug);
+	__this_cpu_write(crypto_plug, NULL);
+}
+EXPORT_SYMBOL_GPL(crypto_finish_plug);
+
+/*
+ * Queue @req on this CPU's plug, to be submitted later through @submit
+ * together with the requests around it.  Returns false if there is no plug
+ * and the caller has to submit the request itself.
+ */
+bool crypto_plug_request(struct crypto_async_request *req,
+			 void (*submit)(struct list_head *reqs))
+{
+	struct crypto_plug *plug = this_cpu_read(crypto_plug);
+
+	if (!plug)
+		return false;
+
+	if (plug->count && (plug->tfm != req->tfm || plug->submit != submit))
+		crypto_flush_plug(plug);
+
+	list_add_tail(&req->list, &plug->list);
+	plug->tfm = req->tfm;
+	plug->submit = submit;
+	if (++plug->count >= CRYPTO_PLUG_MAX)
+		crypto_flush_plug(plug);
+
+	return true;
+}
+EXPORT_SYMBOL_GPL(crypto_plug_request);
+
 MODULE_DESCRIPTION("Cryptographic core API");
 MODULE_LICENSE("GPL");
@@ -32,6 +32,7 @@
 #include <linux/slab.h>
 
 #define CRYPTD_MAX_CPU_QLEN 100
+#define CRYPTD_BATCH 16
 
 struct cryptd_cpu_queue {
 	struct crypto_queue queue;
@@ -128,29 +129,60 @@ static int cryptd_enqueue_request(struct cryptd_queue *queue,
 	return err;
 }
 
-/* Called in workqueue context, do one real cryption work (via
- * req->complete) and reschedule itself if there are more work to
- * do. */
+/* Queue a list of requests, already set up to run from the worker,
+ * and kick the worker once for all of them.  Requests that do not fit
+ * into the queue are failed with -EBUSY. */
+static void cryptd_enqueue_list(struct cryptd_queue *queue,
+				struct list_head *reqs)
+{
+	struct crypto_async_request *req, *n;
+	struct cryptd_cpu_queue *cpu_queue;
+	LIST_HEAD(busy);
+	int cpu;
+
+	cpu = get_cpu();
+	cpu_queue = this_cpu_ptr(queue->cpu_queue);
+	list_for_each_entry_safe(req, n, reqs, list) {
+		if (crypto_enqueue_request(&cpu_queue->queue, req) == -EBUSY &&
+		    !(req->flags & CRYPTO_TFM_REQ_MAY_BACKLOG))
+			list_add_tail(&req->list, &busy);
+	}
+	queue_work_on(cpu, kcrypto_wq, &cpu_queue->work);
+	put_cpu();
+
+	INIT_LIST_HEAD(reqs);
+	list_for_each_entry_safe(req, n, &busy, list) {
+		list_del(&req->list);
+		req->complete(req, -EBUSY);
+	}
+}
+
+/* Called in workqueue context, do up to CRYPTD_BATCH real cryption
+ * works (via req->complete) and reschedule itself if there are more
+ * work to do. */
 static void cryptd_queue_worker(struct work_struct *work)
 {
 	struct cryptd_cpu_queue *cpu_queue;
 	struct crypto_async_request *req, *backlog;
+	int budget = CRYPTD_BATCH;
 
 	cpu_queue = container_of(work, struct cryptd_cpu_queue, work);
-	/* Only handle one request at a time to avoid hogging crypto
-	 * workqueue. preempt_disable/enable is used to prevent
+	/* Handle a bounded batch of requests per run to avoid hogging
+	 * crypto workqueue. preempt_disable/enable is used to prevent
 	 * being preempted by cryptd_enqueue_request() */
-	preempt_disable();
-	backlog = crypto_get_backlog(&cpu_queue->queue);
-	req = crypto_dequeue_request(&cpu_queue->queue);
-	preempt_enable();
+	do {
+		preempt_disable();
+		backlog = crypto_get_backlog(&cpu_queue->queue);
+		req = crypto_dequeue_request(&cpu_queue->queue);
+		preempt_enable();
 
-	if (!req)
-		return;
+		if (!req)
+			return;
 
-	if (backlog)
-		backlog->complete(backlog, -EINPROGRESS);
-	req->complete(req, 0);
+		if (backlog)
+			backlog->complete(backlog, -EINPROGRESS);
+		req->complete(req, 0);
+	} while (--budget);
 
 	if (cpu_queue->queue.qlen)
 		queue_work(kcrypto_wq, &cpu_queue->work);
@@ -192,7 +224,8 @@ static void cryptd_blkcipher_crypt(struct ablkcipher_request *req,
 
 	rctx = ablkcipher_request_ctx(req);
 
-	if (unlikely(err == -EINPROGRESS))
+	/* backlog notification, or failed to queue from a request list */
+	if (unlikely(err))
 		goto out;
 
 	desc.tfm = child;
@@ -251,6 +284,35 @@ static int cryptd_blkcipher_decrypt_enqueue(struct ablkcipher_request *req)
 	return cryptd_blkcipher_enqueue(req, cryptd_blkcipher_decrypt);
 }
 
+static void cryptd_blkcipher_enqueue_list(struct list_head *reqs,
+					  crypto_completion_t complete)
+{
+	struct cryptd_blkcipher_request_ctx *rctx;
+	struct ablkcipher_request *req;
+	struct cryptd_queue *queue;
+
+	req = list_first_entry(reqs, struct ablkcipher_request, base.list);
+	queue = cryptd_get_queue(req->base.tfm);
+
+	list_for_each_entry(req, reqs, base.list) {
+		rctx = ablkcipher_request_ctx(req);
+		rctx->complete = req->base.complete;
+		req->base.complete = complete;
+	}
+
+	cryptd_enqueue_list(queue, reqs);
+}
+
+static void cryptd_blkcipher_encrypt_list(struct list_head *reqs)
+{
+	cryptd_blkcipher_enqueue_list(reqs, cryptd_blkcipher_encrypt);
+}
+
+static void cryptd_blkcipher_decrypt_list(struct list_head *reqs)
+{
+	cryptd_blkcipher_enqueue_list(reqs, cryptd_blkcipher_decrypt);
+}
+
 static int cryptd_blkcipher_init_tfm(struct crypto_tfm *tfm)
 {
 	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
@@ -353,6 +415,8 @@ static int cryptd_create_blkcipher(struct crypto_template *tmpl,
 	inst->alg.cra_ablkcipher.setkey = cryptd_blkcipher_setkey;
 	inst->alg.cra_ablkcipher.encrypt = cryptd_blkcipher_encrypt_enqueue;
 	inst->alg.cra_ablkcipher.decrypt = cryptd_blkcipher_decrypt_enqueue;
+	inst->alg.cra_ablkcipher.encrypt_list = cryptd_blkcipher_encrypt_list;
+	inst->alg.cra_ablkcipher.decrypt_list = cryptd_blkcipher_decrypt_list;
 
 	err = crypto_register_instance(tmpl, inst);
 	if (err) {
@@ -530,7 +594,8 @@ static void cryptd_hash_digest(struct crypto_async_request *req_async, int err)
 	struct cryptd_hash_request_ctx *rctx = ahash_request_ctx(req);
 	struct shash_desc *desc = &rctx->desc;
 
-	if (unlikely(err == -EINPROGRESS))
+	/* backlog notification, or failed to queue from a request list */
+	if (unlikely(err))
 		goto out;
 
 	desc->tfm = child;
@@ -551,6 +616,35 @@ static int cryptd_hash_digest_enqueue(struct ahash_request *req)
 	return cryptd_hash_enqueue(req, cryptd_hash_digest);
 }
 
+static void cryptd_hash_digest_list(struct list_head *reqs)
+{
+	struct cryptd_hash_request_ctx *rctx;
+	struct ahash_request *req, *n;
+	struct crypto_ahash *tfm;
+	struct cryptd_queue *queue;
+
+	req = list_first_entry(reqs, struct ahash_request, base.list);
+	tfm = crypto_ahash_reqtfm(req);
+	queue = cryptd_get_queue(crypto_ahash_tfm(tfm));
+
+	list_for_each_entry_safe(req, n, reqs, base.list) {
+		/* leave the bounce buffer for the result to the API code */
+		if ((unsigned long)req->result & crypto_ahash_alignmask(tfm)) {
+			list_del(&req->base.list);
+			crypto_list_request_done(&req->base,
+						 crypto_ahash_digest(req));
+			continue;
+		}
+
+		rctx = ahash_request_ctx(req);
+		rctx->complete = req->base.complete;
+		req->base.complete = cryptd_hash_digest;
+	}
+
+	if (!list_empty(reqs))
+		cryptd_enqueue_list(queue, reqs);
+}
+
 static int cryptd_hash_export(struct ahash_request *req, void *out)
 {
 	struct cryptd_hash_request_ctx *rctx = ahash_request_ctx(req);
@@ -609,6 +703,7 @@ static int cryptd_create_hash(struct crypto_template *tmpl, struct rtattr **tb,
 	inst->alg.import = cryptd_hash_import;
 	inst->alg.setkey = cryptd_hash_setkey;
 	inst->alg.digest = cryptd_hash_digest_enqueue;
+	inst->alg.digest_list = cryptd_hash_digest_list;
 
 	err = ahash_register_instance(tmpl, inst);
 	if (err) {
@@ -630,7 +725,8 @@ static void cryptd_aead_crypt(struct aead_request *req,
 	struct cryptd_aead_request_ctx *rctx;
 	rctx = aead_request_ctx(req);
 
-	if (unlikely(err == -EINPROGRESS))
+	/* backlog notification, or failed to queue from a request list */
+	if (unlikely(err))
 		goto out;
 	aead_request_set_tfm(req, child);
 	err = crypt( req );
@@ -683,6 +779,35 @@ static int cryptd_aead_decrypt_enqueue(struct aead_request *req)
 	return cryptd_aead_enqueue(req, cryptd_aead_decrypt );
 }
 
+static void cryptd_aead_enqueue_list(struct list_head *reqs,
+				     crypto_completion_t complete)
+{
+	struct cryptd_aead_request_ctx *rctx;
+	struct aead_request *req;
+	struct cryptd_queue *queue;
+
+	req = list_first_entry(reqs, struct aead_request, base.list);
+	queue = cryptd_get_queue(req->base.tfm);
+
+	list_for_each_entry(req, reqs, base.list) {
+		rctx = aead_request_ctx(req);
+		rctx->complete = req->base.complete;
+		req->base.complete = complete;
+	}
+
+	cryptd_enqueue_list(queue, reqs);
+}
+
+static void cryptd_aead_encrypt_list(struct list_head *reqs)
+{
+	cryptd_aead_enqueue_list(reqs, cryptd_aead_encrypt);
+}
+
+static void cryptd_aead_decrypt_list(struct list_head *reqs)
+{
+	cryptd_aead_enqueue_list(reqs, cryptd_aead_decrypt);
+}
+
 static int cryptd_aead_init_tfm(struct crypto_tfm *tfm)
 {
 	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
@@ -746,6 +871,8 @@ static int cryptd_create_aead(struct crypto_template *tmpl,
 	inst->alg.cra_aead.maxauthsize = alg->cra_aead.maxauthsize;
 	inst->alg.cra_aead.encrypt     = cryptd_aead_encrypt_enqueue;
 	inst->alg.cra_aead.decrypt     = cryptd_aead_decrypt_enqueue;
+	inst->alg.cra_aead.encrypt_list = cryptd_aead_encrypt_list;
+	inst->alg.cra_aead.decrypt_list = cryptd_aead_decrypt_list;
 	inst->alg.cra_aead.givencrypt  = alg->cra_aead.givencrypt;
 	inst->alg.cra_aead.givdecrypt  = alg->cra_aead.givdecrypt;
 
@@ -140,7 +140,7 @@ static int seqiv_givencrypt(struct skcipher_givcrypt_request *req)
 	return err;
 }
 
-static int seqiv_aead_givencrypt(struct aead_givcrypt_request *req)
+static int seqiv_aead_setup(struct aead_givcrypt_request *req)
 {
 	struct crypto_aead *geniv = aead_givcrypt_reqtfm(req);
 	struct seqiv_ctx *ctx = crypto_aead_ctx(geniv);
@@ -150,7 +150,6 @@ static int seqiv_aead_givencrypt(struct aead_givcrypt_request *req)
 	void *data;
 	u8 *info;
 	unsigned int ivsize;
-	int err;
 
 	aead_request_set_tfm(subreq, aead_geniv_base(geniv));
 
@@ -180,12 +179,60 @@ static int seqiv_aead_givencrypt(struct aead_givcrypt_request *req)
 	seqiv_geniv(ctx, info, req->seq, ivsize);
 	memcpy(req->giv, info, ivsize);
 
+	return 0;
+}
+
+static int seqiv_aead_givencrypt(struct aead_givcrypt_request *req)
+{
+	struct aead_request *subreq = aead_givcrypt_reqctx(req);
+	int err;
+
+	err = seqiv_aead_setup(req);
+	if (err)
+		return err;
+
 	err = crypto_aead_encrypt(subreq);
-	if (unlikely(info != areq->iv))
+	if (unlikely(subreq->iv != req->areq.iv))
 		seqiv_aead_complete2(req, err);
 	return err;
 }
 
+static void seqiv_aead_givencrypt_list(struct list_head *reqs)
+{
+	struct aead_givcrypt_request *req, *n;
+	struct aead_request *subreq;
+	LIST_HEAD(subreqs);
+	int err;
+
+	/* Let the first request pick the salt. */
+	req = list_first_entry(reqs, struct aead_givcrypt_request,
+			       areq.base.list);
+	if (unlikely(crypto_aead_crt(aead_givcrypt_reqtfm(req))->givencrypt !=
+		     seqiv_aead_givencrypt)) {
+		aead_default_givencrypt_list(reqs);
+		return;
+	}
+
+	list_for_each_entry_safe(req, n, reqs, areq.base.list) {
+		list_del(&req->areq.base.list);
+
+		err = seqiv_aead_setup(req);
+		if (err) {
+			aead_givcrypt_complete(req, err);
+			continue;
+		}
+
+		subreq = aead_givcrypt_reqctx(req);
+		list_add_tail(&subreq->base.list, &subreqs);
+	}
+
+	/*
+	 * The subrequests carry the callers' callbacks, or
+	 * seqiv_aead_complete() for a bounced IV.
+	 */
+	crypto_aead_encrypt_list(&subreqs);
+}
+
 static int seqiv_givencrypt_first(struct skcipher_givcrypt_request *req)
 {
 	struct crypto_ablkcipher *geniv = skcipher_givcrypt_reqtfm(req);
@@ -288,6 +335,7 @@ static struct crypto_instance *seqiv_aead_alloc(struct rtattr **tb)
 		goto out;
 
 	inst->alg.cra_aead.givencrypt = seqiv_aead_givencrypt_first;
+	inst->alg.cra_aead.givencrypt_list = seqiv_aead_givencrypt_list;
 
 	inst->alg.cra_init = seqiv_aead_init;
 	inst->alg.cra_exit = aead_geniv_exit;
@@ -20,6 +20,7 @@
  *
  */
 
+#include <crypto/aead.h>
 #include <crypto/hash.h>
 #include <linux/err.h>
 #include <linux/module.h>
@@ -70,6 +71,16 @@ struct tcrypt_result {
 	int err;
 };
 
+/* per-request state of the list tests, too big for the stack */
+struct tcrypt_list {
+	struct tcrypt_result result[XBUFSIZE];
+	struct scatterlist sg[XBUFSIZE];
+	struct scatterlist asg[XBUFSIZE];
+	char iv[XBUFSIZE][MAX_IVLEN];
+	char giv[XBUFSIZE][MAX_IVLEN];
+	char digest[XBUFSIZE][64];
+};
+
 struct aead_test_suite {
 	struct {
 		struct aead_testvec *vecs;
@@ -184,6 +195,35 @@ static int do_one_async_hash_op(struct ahash_request *req,
 	return ret;
 }
 
+/*
+ * The list tests submit XBUFSIZE copies of a test vector, one per page of
+ * xbuf, as a single request list.  Every request has to be completed
+ * through its callback exactly once.
+ */
+static int wait_list_complete(struct tcrypt_result *result, const char *type,
+			      unsigned int j, const char *algo)
+{
+	unsigned int k;
+	int ret;
+
+	for (k = 0; k < XBUFSIZE; k++) {
+		ret = wait_for_completion_interruptible(&result[k].completion);
+		if (ret)
+			return ret;
+	}
+
+	for (k = 0; k < XBUFSIZE; k++) {
+		if (try_wait_for_completion(&result[k].completion)) {
+			printk(KERN_ERR "alg: %s: Callback of request %u ran "
+			       "more than once on list test %d for %s\n",
+			       type, k, j, algo);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
 static int test_hash(struct crypto_ahash *tfm, struct hash_testvec *template,
 		     unsigned int tcount, bool use_digest)
 {
@@ -358,6 +398,110 @@ out_nobuf:
 	return ret;
 }
 
+static int test_hash_list(struct crypto_ahash *tfm,
+			  struct hash_testvec *template, unsigned int tcount)
+{
+	const char *algo = crypto_tfm_alg_driver_name(crypto_ahash_tfm(tfm));
+	unsigned int i, j, k;
+	struct ahash_request *req[XBUFSIZE] = { NULL };
+	struct tcrypt_list *tl;
+	char *xbuf[XBUFSIZE];
+	LIST_HEAD(reqs);
+	int ret = -ENOMEM;
+
+	if (testmgr_alloc_buf(xbuf))
+		goto out_nobuf;
+
+	tl = kmalloc(sizeof(*tl), GFP_KERNEL);
+	if (!tl)
+		goto out_notl;
+
+	for (k = 0; k < XBUFSIZE; k++) {
+		req[k] = ahash_request_alloc(tfm, GFP_KERNEL);
+		if (!req[k]) {
+			printk(KERN_ERR "alg: hash: Failed to allocate list "
+			       "request for %s\n", algo);
+			goto out;
+		}
+		ahash_request_set_callback(req[k], CRYPTO_TFM_REQ_MAY_BACKLOG,
+					   tcrypt_complete, &tl->result[k]);
+	}
+
+	j = 0;
+	for (i = 0; i < tcount; i++) {
+		if (template[i].np)
+			continue;
+
+		j++;
+
+		ret = -EINVAL;
+		if (WARN_ON(template[i].psize > PAGE_SIZE))
+			goto out;
+
+		if (template[i].ksize) {
+			crypto_ahash_clear_flags(tfm, ~0);
+			ret = crypto_ahash_setkey(tfm, template[i].key,
+						  template[i].ksize);
+			if (ret) {
+				printk(KERN_ERR "alg: hash: setkey failed on "
+				       "list test %d for %s: ret=%d\n", j,
+				       algo, -ret);
+				goto out;
+			}
+		}
+
+		for (k = 0; k < XBUFSIZE; k++) {
+			memset(tl->digest[k], 0, 64);
+			memcpy(xbuf[k], template[i].plaintext,
+			       template[i].psize);
+			sg_init_one(&tl->sg[k], xbuf[k], template[i].psize);
+			ahash_request_set_crypt(req[k], &tl->sg[k],
+						tl->digest[k],
+						template[i].psize);
+			init_completion(&tl->result[k].completion);
+			list_add_tail(&req[k]->base.list, &reqs);
+		}
+
+		crypto_ahash_digest_list(&reqs);
+
+		ret = wait_list_complete(tl->result, "hash", j, algo);
+		if (ret)
+			goto out;
+
+		for (k = 0; k < XBUFSIZE; k++) {
+			ret = tl->result[k].err;
+			if (ret) {
+				printk(KERN_ERR "alg: hash: digest failed on "
+				       "list test %d request %u for %s: "
+				       "ret=%d\n", j, k, algo, -ret);
+				goto out;
+			}
+
+			if (memcmp(tl->digest[k], template[i].digest,
+				   crypto_ahash_digestsize(tfm))) {
+				printk(KERN_ERR "alg: hash: List test %d "
+				       "failed on request %u for %s\n", j, k,
+				       algo);
+				hexdump(tl->digest[k],
+					crypto_ahash_digestsize(tfm));
+				ret = -EINVAL;
+				goto out;
+			}
+		}
+	}
+
+	ret = 0;
+
+out:
+	for (k = 0; k < XBUFSIZE; k++)
+		ahash_request_free(req[k]);
+	kfree(tl);
+out_notl:
+	testmgr_free_buf(xbuf);
+out_nobuf:
+	return ret;
+}
+
 static int test_aead(struct crypto_aead *tfm, int enc,
 		     struct aead_testvec *template, unsigned int tcount)
 {
@@ -686,6 +830,233 @@ out_noxbuf:
 	return ret;
 }
 
+/*
+ * For an IV generator the list test also encrypts through givencrypt_list
+ * and checks that the result decrypts back to the plain text with the
+ * generated IVs.
+ */
+static int test_aead_list(struct crypto_aead *tfm, int enc,
+			  struct aead_testvec *template, unsigned int tcount)
+{
+	const char *algo = crypto_tfm_alg_driver_name(crypto_aead_tfm(tfm));
+	bool geniv = enc && (crypto_aead_tfm(tfm)->__crt_alg->cra_flags &
+			     CRYPTO_ALG_GENIV);
+	unsigned int i, j, k;
+	int ret = -ENOMEM;
+	struct aead_request *req[XBUFSIZE] = { NULL };
+	struct aead_givcrypt_request *greq[XBUFSIZE] = { NULL };
+	struct tcrypt_list *tl;
+	const char *e;
+	unsigned int authsize;
+	char *xbuf[XBUFSIZE];
+	char *axbuf[XBUFSIZE];
+	LIST_HEAD(reqs);
+
+	if (testmgr_alloc_buf(xbuf))
+		goto out_noxbuf;
+	if (testmgr_alloc_buf(axbuf))
+		goto out_noaxbuf;
+
+	tl = kmalloc(sizeof(*tl), GFP_KERNEL);
+	if (!tl)
+		goto out_notl;
+
+	if (enc == ENCRYPT)
+		e = "encryption";
+	else
+		e = "decryption";
+
+	for (k = 0; k < XBUFSIZE; k++) {
+		req[k] = aead_request_alloc(tfm, GFP_KERNEL);
+		if (geniv)
+			greq[k] = aead_givcrypt_alloc(tfm, GFP_KERNEL);
+		if (!req[k] || (geniv && !greq[k])) {
+			printk(KERN_ERR "alg: aead: Failed to allocate list "
+			       "request for %s\n", algo);
+			goto out;
+		}
+		aead_request_set_callback(req[k], CRYPTO_TFM_REQ_MAY_BACKLOG,
+					  tcrypt_complete, &tl->result[k]);
+		if (geniv)
+			aead_givcrypt_set_callback(greq[k],
+						   CRYPTO_TFM_REQ_MAY_BACKLOG,
+						   tcrypt_complete,
+						   &tl->result[k]);
+	}
+
+	for (i = 0, j = 0; i < tcount; i++) {
+		if (template[i].np)
+			continue;
+
+		j++;
+
+		ret = -EINVAL;
+		if (WARN_ON(template[i].ilen > PAGE_SIZE ||
+			    template[i].alen > PAGE_SIZE))
+			goto out;
+
+		crypto_aead_clear_flags(tfm, ~0);
+		if (template[i].wk)
+			crypto_aead_set_flags(tfm, CRYPTO_TFM_REQ_WEAK_KEY);
+
+		ret = crypto_aead_setkey(tfm, template[i].key,
+					 template[i].klen);
+		if (!ret == template[i].fail) {
+			printk(KERN_ERR "alg: aead: setkey failed on list test "
+			       "%d for %s: flags=%x\n", j, algo,
+			       crypto_aead_get_flags(tfm));
+			goto out;
+		} else if (ret)
+			continue;
+
+		authsize = abs(template[i].rlen - template[i].ilen);
+		ret = crypto_aead_setauthsize(tfm, authsize);
+		if (ret) {
+			printk(KERN_ERR "alg: aead: Failed to set authsize to "
+			       "%u on list test %d for %s\n", authsize, j,
+			       algo);
+			goto out;
+		}
+
+		for (k = 0; k < XBUFSIZE; k++) {
+			memcpy(xbuf[k], template[i].input, template[i].ilen);
+			memcpy(axbuf[k], template[i].assoc, template[i].alen);
+			if (template[i].iv)
+				memcpy(tl->iv[k], template[i].iv, MAX_IVLEN);
+			else
+				memset(tl->iv[k], 0, MAX_IVLEN);
+
+			sg_init_one(&tl->sg[k], xbuf[k],
+				    template[i].ilen + (enc ? authsize : 0));
+			sg_init_one(&tl->asg[k], axbuf[k], template[i].alen);
+
+			aead_request_set_crypt(req[k], &tl->sg[k], &tl->sg[k],
+					       template[i].ilen, tl->iv[k]);
+			aead_request_set_assoc(req[k], &tl->asg[k],
+					       template[i].alen);
+			init_completion(&tl->result[k].completion);
+			list_add_tail(&req[k]->base.list, &reqs);
+		}
+
+		if (enc)
+			crypto_aead_encrypt_list(&reqs);
+		else
+			crypto_aead_decrypt_list(&reqs);
+
+		ret = wait_list_complete(tl->result, "aead", j, algo);
+		if (ret)
+			goto out;
+
+		for (k = 0; k < XBUFSIZE; k++) {
+			ret = tl->result[k].err;
+			if (ret == -EBADMSG && template[i].novrfy)
+				/* verification failure was expected */
+				continue;
+			if (!ret && template[i].novrfy) {
+				printk(KERN_ERR "alg: aead: %s failed on list "
+				       "test %d request %u for %s: ret was 0, "
+				       "expected -EBADMSG\n", e, j, k, algo);
+				ret = -EBADMSG;
+				goto out;
+			}
+			if (ret) {
+				printk(KERN_ERR "alg: aead: %s failed on list "
+				       "test %d request %u for %s: ret=%d\n",
+				       e, j, k, algo, -ret);
+				goto out;
+			}
+
+			if (memcmp(xbuf[k], template[i].result,
+				   template[i].rlen)) {
+				printk(KERN_ERR "alg: aead: List test %d "
+				       "failed on %s request %u for %s\n", j,
+				       e, k, algo);
+				hexdump(xbuf[k], template[i].rlen);
+				ret = -EINVAL;
+				goto out;
+			}
+		}
+
+		if (!geniv)
+			continue;
+
+		for (k = 0; k < XBUFSIZE; k++) {
+			memcpy(xbuf[k], template[i].input, template[i].ilen);
+			aead_givcrypt_set_crypt(greq[k], &tl->sg[k], &tl->sg[k],
+						template[i].ilen, tl->iv[k]);
+			aead_givcrypt_set_assoc(greq[k], &tl->asg[k],
+						template[i].alen);
+			aead_givcrypt_set_giv(greq[k], tl->giv[k], k);
+			init_completion(&tl->result[k].completion);
+			list_add_tail(&greq[k]->areq.base.list, &reqs);
+		}
+
+		crypto_aead_givencrypt_list(&reqs);
+
+		ret = wait_list_complete(tl->result, "aead", j, algo);
+		if (ret)
+			goto out;
+
+		for (k = 0; k < XBUFSIZE; k++) {
+			ret = tl->result[k].err;
+			if (ret) {
+				printk(KERN_ERR "alg: aead: givencrypt failed "
+				       "on list test %d request %u for %s: "
+				       "ret=%d\n", j, k, algo, -ret);
+				goto out;
+			}
+
+			aead_request_set_crypt(req[k], &tl->sg[k], &tl->sg[k],
+					       template[i].ilen + authsize,
+					       tl->giv[k]);
+			init_completion(&tl->result[k].completion);
+			list_add_tail(&req[k]->base.list, &reqs);
+		}
+
+		crypto_aead_decrypt_list(&reqs);
+
+		ret = wait_list_complete(tl->result, "aead", j, algo);
+		if (ret)
+			goto out;
+
+		for (k = 0; k < XBUFSIZE; k++) {
+			ret = tl->result[k].err;
+			if (ret) {
+				printk(KERN_ERR "alg: aead: decryption of "
+				       "givencrypt result failed on list test "
+				       "%d request %u for %s: ret=%d\n", j, k,
+				       algo, -ret);
+				goto out;
+			}
+
+			if (memcmp(xbuf[k], template[i].input,
+				   template[i].ilen)) {
+				printk(KERN_ERR "alg: aead: Givencrypt list "
+				       "test %d failed on request %u for %s\n",
+				       j, k, algo);
+				hexdump(xbuf[k], template[i].ilen);
+				ret = -EINVAL;
+				goto out;
+			}
+		}
+	}
+
+	ret = 0;
+
+out:
+	for (k = 0; k < XBUFSIZE; k++) {
+		aead_request_free(req[k]);
+		aead_givcrypt_free(greq[k]);
+	}
+	kfree(tl);
+out_notl:
+	testmgr_free_buf(axbuf);
+out_noaxbuf:
+	testmgr_free_buf(xbuf);
+out_noxbuf:
+	return ret;
+}
+
 static int test_cipher(struct crypto_cipher *tfm, int enc,
 		       struct cipher_testvec *template, unsigned int tcount)
 {
@@ -984,6 +1355,129 @@ out_nobuf:
 	return ret;
 }
 
+static int test_skcipher_list(struct crypto_ablkcipher *tfm, int enc,
+			      struct cipher_testvec *template,
+			      unsigned int tcount)
+{
+	const char *algo =
+		crypto_tfm_alg_driver_name(crypto_ablkcipher_tfm(tfm));
+	unsigned int i, j, k;
+	struct ablkcipher_request *req[XBUFSIZE] = { NULL };
+	struct tcrypt_list *tl;
+	const char *e;
+	char *xbuf[XBUFSIZE];
+	LIST_HEAD(reqs);
+	int ret = -ENOMEM;
+
+	if (testmgr_alloc_buf(xbuf))
+		goto out_nobuf;
+
+	tl = kmalloc(sizeof(*tl), GFP_KERNEL);
+	if (!tl)
+		goto out_notl;
+
+	if (enc == ENCRYPT)
+		e = "encryption";
+	else
+		e = "decryption";
+
+	for (k = 0; k < XBUFSIZE; k++) {
+		req[k] = ablkcipher_request_alloc(tfm, GFP_KERNEL);
+		if (!req[k]) {
+			printk(KERN_ERR "alg: skcipher: Failed to allocate "
+			       "list request for %s\n", algo);
+			goto out;
+		}
+		ablkcipher_request_set_callback(req[k],
+						CRYPTO_TFM_REQ_MAY_BACKLOG,
+						tcrypt_complete,
+						&tl->result[k]);
+	}
+
+	j = 0;
+	for (i = 0; i < tcount; i++) {
+		if (template[i].np)
+			continue;
+
+		j++;
+
+		ret = -EINVAL;
+		if (WARN_ON(template[i].ilen > PAGE_SIZE))
+			goto out;
+
+		crypto_ablkcipher_clear_flags(tfm, ~0);
+		if (template[i].wk)
+			crypto_ablkcipher_set_flags(tfm,
+						    CRYPTO_TFM_REQ_WEAK_KEY);
+
+		ret = crypto_ablkcipher_setkey(tfm, template[i].key,
+					       template[i].klen);
+		if (!ret == template[i].fail) {
+			printk(KERN_ERR "alg: skcipher: setkey failed on list "
+			       "test %d for %s: flags=%x\n", j, algo,
+			       crypto_ablkcipher_get_flags(tfm));
+			goto out;
+		} else if (ret)
+			continue;
+
+		for (k = 0; k < XBUFSIZE; k++) {
+			memcpy(xbuf[k], template[i].input, template[i].ilen);
+			if (template[i].iv)
+				memcpy(tl->iv[k], template[i].iv, MAX_IVLEN);
+			else
+				memset(tl->iv[k], 0, MAX_IVLEN);
+
+			sg_init_one(&tl->sg[k], xbuf[k], template[i].ilen);
+			ablkcipher_request_set_crypt(req[k], &tl->sg[k],
+						     &tl->sg[k],
+						     template[i].ilen,
+						     tl->iv[k]);
+			init_completion(&tl->result[k].completion);
+			list_add_tail(&req[k]->base.list, &reqs);
+		}
+
+		if (enc)
+			crypto_ablkcipher_encrypt_list(&reqs);
+		else
+			crypto_ablkcipher_decrypt_list(&reqs);
+
+		ret = wait_list_complete(tl->result, "skcipher", j, algo);
+		if (ret)
+			goto out;
+
+		for (k = 0; k < XBUFSIZE; k++) {
+			ret = tl->result[k].err;
+			if (ret) {
+				printk(KERN_ERR "alg: skcipher: %s failed on "
+				       "list test %d request %u for %s: "
+				       "ret=%d\n", e, j, k, algo, -ret);
+				goto out;
+			}
+
+			if (memcmp(xbuf[k], template[i].result,
+				   template[i].rlen)) {
+				printk(KERN_ERR "alg: skcipher: List test %d "
+				       "failed on %s request %u for %s\n", j,
+				       e, k, algo);
+				hexdump(xbuf[k], template[i].rlen);
+				ret = -EINVAL;
+				goto out;
+			}
+		}
+	}
+
+	ret = 0;
+
+out:
+	for (k = 0; k < XBUFSIZE; k++)
+		ablkcipher_request_free(req[k]);
+	kfree(tl);
+out_notl:
+	testmgr_free_buf(xbuf);
+out_nobuf:
+	return ret;
+}
+
 static int test_comp(struct crypto_comp *tfm, struct comp_testvec *ctemplate,
 		     struct comp_testvec *dtemplate, int ctcount, int dtcount)
 {
@@ -1318,13 +1812,22 @@ static int alg_test_aead(const struct alg_test_desc *desc, const char *driver,
 	if (desc->suite.aead.enc.vecs) {
 		err = test_aead(tfm, ENCRYPT, desc->suite.aead.enc.vecs,
 				desc->suite.aead.enc.count);
+		if (!err)
+			err = test_aead_list(tfm, ENCRYPT,
+					     desc->suite.aead.enc.vecs,
+					     desc->suite.aead.enc.count);
 		if (err)
 			goto out;
 	}
 
-	if (!err && desc->suite.aead.dec.vecs)
+	if (!err && desc->suite.aead.dec.vecs) {
 		err = test_aead(tfm, DECRYPT, desc->suite.aead.dec.vecs,
 				desc->suite.aead.dec.count);
+		if (!err)
+			err = test_aead_list(tfm, DECRYPT,
+					     desc->suite.aead.dec.vecs,
+					     desc->suite.aead.dec.count);
+	}
 
 out:
 	crypto_free_aead(tfm);
@@ -1376,13 +1879,22 @@ static int alg_test_skcipher(const struct alg_test_desc *desc,
 	if (desc->suite.cipher.enc.vecs) {
 		err = test_skcipher(tfm, ENCRYPT, desc->suite.cipher.enc.vecs,
 				    desc->suite.cipher.enc.count);
+		if (!err)
+			err = test_skcipher_list(tfm, ENCRYPT,
+						 desc->suite.cipher.enc.vecs,
+						 desc->suite.cipher.enc.count);
 		if (err)
 			goto out;
 	}
 
-	if (desc->suite.cipher.dec.vecs)
+	if (desc->suite.cipher.dec.vecs) {
 		err = test_skcipher(tfm, DECRYPT, desc->suite.cipher.dec.vecs,
 				    desc->suite.cipher.dec.count);
+		if (!err)
+			err = test_skcipher_list(tfm, DECRYPT,
+						 desc->suite.cipher.dec.vecs,
+						 desc->suite.cipher.dec.count);
+	}
 
 out:
 	crypto_free_ablkcipher(tfm);
@@ -1451,6 +1963,9 @@ static int alg_test_hash(const struct alg_test_desc *desc, const char *driver,
 	if (!err)
 		err = test_hash(tfm, desc->suite.hash.vecs,
 				desc->suite.hash.count, false);
+	if (!err)
+		err = test_hash_list(tfm, desc->suite.hash.vecs,
+				     desc->suite.hash.count);
 
 	crypto_free_ahash(tfm);
 	return err;
@@ -1563,6 +2078,21 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "__driver-xts-aes-aesni",
+		.test = alg_test_null,
+		.suite = {
+			.cipher = {
+				.enc = {
+					.vecs = NULL,
+					.count = 0
+				},
+				.dec = {
+					.vecs = NULL,
+					.count = 0
+				}
+			}
+		}
 	}, {
 		.alg = "__ghash-pclmulqdqni",
 		.test = alg_test_null,
@@ -1705,6 +2235,15 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "crc32",
+		.test = alg_test_hash,
+		.suite = {
+			.hash = {
+				.vecs = crc32_tv_template,
+				.count = CRC32_TEST_VECTORS
+			}
+		}
 	}, {
 		.alg = "crc32c",
 		.test = alg_test_crc32c,
@@ -1715,6 +2254,15 @@ static const struct alg_test_desc alg_test_descs[] = {
 				.count = CRC32C_TEST_VECTORS
 			}
 		}
+	}, {
+		.alg = "crct10dif",
+		.test = alg_test_hash,
+		.suite = {
+			.hash = {
+				.vecs = crct10dif_tv_template,
+				.count = CRCT10DIF_TEST_VECTORS
+			}
+		}
 	}, {
 		.alg = "cryptd(__driver-ecb-aes-aesni)",
 		.test = alg_test_null,
@@ -1730,6 +2278,21 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "cryptd(__driver-xts-aes-aesni)",
+		.test = alg_test_null,
+		.suite = {
+			.cipher = {
+				.enc = {
+					.vecs = NULL,
+					.count = 0
+				},
+				.dec = {
+					.vecs = NULL,
+					.count = 0
+				}
+			}
+		}
 	}, {
 		.alg = "cryptd(__ghash-pclmulqdqni)",
 		.test = alg_test_null,
@@ -2176,6 +2739,36 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "lz4",
+		.test = alg_test_comp,
+		.suite = {
+			.comp = {
+				.comp = {
+					.vecs = lz4_comp_tv_template,
+					.count = LZ4_COMP_TEST_VECTORS
+				},
+				.decomp = {
+					.vecs = lz4_decomp_tv_template,
+					.count = LZ4_DECOMP_TEST_VECTORS
+				}
+			}
+		}
+	}, {
+		.alg = "lz4hc",
+		.test = alg_test_comp,
+		.suite = {
+			.comp = {
+				.comp = {
+					.vecs = lz4hc_comp_tv_template,
+					.count = LZ4HC_COMP_TEST_VECTORS
+				},
+				.decomp = {
+					.vecs = lz4hc_decomp_tv_template,
+					.count = LZ4HC_DECOMP_TEST_VECTORS
+				}
+			}
+		}
 	}, {
 		.alg = "lzo",
 		.test = alg_test_comp,
@@ -41,7 +41,7 @@ struct hash_testvec {
 	char *plaintext;
 	char *digest;
 	unsigned char tap[MAX_TAP];
-	unsigned char psize;
+	unsigned short psize;
 	unsigned char np;
 	unsigned char ksize;
 };
@@ -2986,8 +2986,8 @@ static struct cipher_testvec cast6_dec_tv_template[] = {
 #define AES_CTR_3686_DEC_TEST_VECTORS 6
 #define AES_GCM_ENC_TEST_VECTORS 9
 #define AES_GCM_DEC_TEST_VECTORS 8
-#define AES_GCM_4106_ENC_TEST_VECTORS 7
-#define AES_GCM_4106_DEC_TEST_VECTORS 7
+#define AES_GCM_4106_ENC_TEST_VECTORS 8
+#define AES_GCM_4106_DEC_TEST_VECTORS 8
 #define AES_CCM_ENC_TEST_VECTORS 7
 #define AES_CCM_DEC_TEST_VECTORS 7
 #define AES_CCM_4309_ENC_TEST_VECTORS 7
@@ -6388,6 +6388,40 @@ static struct aead_testvec aes_gcm_rfc4106_enc_tv_template[] = {
 			  "\x37\x08\x1C\xCF\xBA\x5D\x71\x46"
 			  "\x80\x72\xB0\x4C\x82\x0D\x60\x3C",
 		.rlen	= 208,
+	}, { /* Generated using OpenSSL, 256-bit AES key */
+		.key	= "\x10\x13\x16\x19\x1c\x1f\x22\x25"
+			  "\x28\x2b\x2e\x31\x34\x37\x3a\x3d"
+			  "\x40\x43\x46\x49\x4c\x4f\x52\x55"
+			  "\x58\x5b\x5e\x61\x64\x67\x6a\x6d"
+			  "\xca\xfe\xba\xbe",
+		.klen	= 36,
+		.iv	= "\xc0\xc1\xc2\xc3\xc4\xc5\xc6\xc7",
+		.input	= "\x01\x06\x0b\x10\x15\x1a\x1f\x24"
+			  "\x29\x2e\x33\x38\x3d\x42\x47\x4c"
+			  "\x51\x56\x5b\x60\x65\x6a\x6f\x74"
+			  "\x79\x7e\x83\x88\x8d\x92\x97\x9c"
+			  "\xa1\xa6\xab\xb0\xb5\xba\xbf\xc4"
+			  "\xc9\xce\xd3\xd8\xdd\xe2\xe7\xec"
+			  "\xf1\xf6\xfb\x00\x05\x0a\x0f\x14"
+			  "\x19\x1e\x23\x28\x2d\x32\x37\x3c"
+			  "\x41\x46\x4b\x50\x55\x5a\x5f\x64"
+			  "\x69\x6e\x73\x78\x7d\x82\x87\x8c",
+		.ilen	= 80,
+		.assoc	= "\x00\x00\x43\x21\x00\x00\x00\x07",
+		.alen	= 8,
+		.result	= "\xe7\x6a\x3b\x92\x03\x9a\x49\x9e"
+			  "\x27\xac\x8e\x0d\x1e\x4d\xb7\xd6"
+			  "\x1c\x26\xa6\x05\x2d\x00\xa3\x84"
+			  "\x01\x92\x49\x6c\x1c\x94\x9a\x23"
+			  "\xd6\xe4\xc0\x6a\x4b\x4c\xd3\x66"
+			  "\xfc\x2f\x35\xc7\x4e\x00\x83\x11"
+			  "\x17\xbc\xf8\x40\x6a\xd7\xca\xc2"
+			  "\xb7\x18\x2d\x9d\xc9\x9e\xdc\x62"
+			  "\x93\xbf\x84\x98\xf1\x0b\x39\xe4"
+			  "\x00\x0e\x90\xfe\xde\xbe\x38\x39"
+			  "\x2b\x9f\xb3\x07\x8e\x67\xad\xc6"
+			  "\x26\x97\xe0\x0d\x16\xdd\xe8\xdd",
+		.rlen	= 96,
 	}
 };
 
@@ -6564,6 +6598,40 @@ static struct aead_testvec aes_gcm_rfc4106_dec_tv_template[] = {
                           "\xff\xff\xff\xff\xff\xff\xff\xff",
                 .rlen   = 192,
 
+	}, { /* Generated using OpenSSL, 256-bit AES key */
+		.key	= "\x10\x13\x16\x19\x1c\x1f\x22\x25"
+			  "\x28\x2b\x2e\x31\x34\x37\x3a\x3d"
+			  "\x40\x43\x46\x49\x4c\x4f\x52\x55"
+			  "\x58\x5b\x5e\x61\x64\x67\x6a\x6d"
+			  "\xca\xfe\xba\xbe",
+		.klen	= 36,
+		.iv	= "\xc0\xc1\xc2\xc3\xc4\xc5\xc6\xc7",
+		.input	= "\xe7\x6a\x3b\x92\x03\x9a\x49\x9e"
+			  "\x27\xac\x8e\x0d\x1e\x4d\xb7\xd6"
+			  "\x1c\x26\xa6\x05\x2d\x00\xa3\x84"
+			  "\x01\x92\x49\x6c\x1c\x94\x9a\x23"
+			  "\xd6\xe4\xc0\x6a\x4b\x4c\xd3\x66"
+			  "\xfc\x2f\x35\xc7\x4e\x00\x83\x11"
+			  "\x17\xbc\xf8\x40\x6a\xd7\xca\xc2"
+			  "\xb7\x18\x2d\x9d\xc9\x9e\xdc\x62"
+			  "\x93\xbf\x84\x98\xf1\x0b\x39\xe4"
+			  "\x00\x0e\x90\xfe\xde\xbe\x38\x39"
+			  "\x2b\x9f\xb3\x07\x8e\x67\xad\xc6"
+			  "\x26\x97\xe0\x0d\x16\xdd\xe8\xdd",
+		.ilen	= 96,
+		.assoc	= "\x00\x00\x43\x21\x00\x00\x00\x07",
+		.alen	= 8,
+		.result	= "\x01\x06\x0b\x10\x15\x1a\x1f\x24"
+			  "\x29\x2e\x33\x38\x3d\x42\x47\x4c"
+			  "\x51\x56\x5b\x60\x65\x6a\x6f\x74"
+			  "\x79\x7e\x83\x88\x8d\x92\x97\x9c"
+			  "\xa1\xa6\xab\xb0\xb5\xba\xbf\xc4"
+			  "\xc9\xce\xd3\xd8\xdd\xe2\xe7\xec"
+			  "\xf1\xf6\xfb\x00\x05\x0a\x0f\x14"
+			  "\x19\x1e\x23\x28\x2d\x32\x37\x3c"
+			  "\x41\x46\x4b\x50\x55\x5a\x5f\x64"
+			  "\x69\x6e\x73\x78\x7d\x82\x87\x8c",
+		.rlen	= 80,
 	}
 };
 
@@ -10037,6 +10105,166 @@ static struct pcomp_testvec zlib_decomp_tv_template[] = {
 	},
 };
 
+/*
+ * LZ4 test vectors (null-terminated strings).
+ */
+#define LZ4_COMP_TEST_VECTORS 2
+#define LZ4_DECOMP_TEST_VECTORS 2
+
+static struct comp_testvec lz4_comp_tv_template[] = {
+	{
+		.inlen	= 70,
+		.outlen	= 45,
+		.input	= "Join us now and share the software "
+			"Join us now and share the software ",
+		.output	= "\xf0\x10\x4a\x6f\x69\x6e\x20\x75"
+			  "\x73\x20\x6e\x6f\x77\x20\x61\x6e"
+			  "\x64\x20\x73\x68\x61\x72\x65\x20"
+			  "\x74\x68\x65\x20\x73\x6f\x66\x74"
+			  "\x77\x0d\x00\x0f\x23\x00\x0b\x50"
+			  "\x77\x61\x72\x65\x20",
+	}, {
+		.inlen	= 159,
+		.outlen	= 125,
+		.input	= "This document describes a compression method based on the LZ4 "
+			"compression algorithm.  This document defines the application of "
+			"the LZ4 algorithm used in UBIFS.",
+		.output	= "\xf9\x2e\x54\x68\x69\x73\x20\x64"
+			  "\x6f\x63\x75\x6d\x65\x6e\x74\x20"
+			  "\x64\x65\x73\x63\x72\x69\x62\x65"
+			  "\x73\x20\x61\x20\x63\x6f\x6d\x70"
+			  "\x72\x65\x73\x73\x69\x6f\x6e\x20"
+			  "\x6d\x65\x74\x68\x6f\x64\x20\x62"
+			  "\x61\x73\x65\x64\x20\x6f\x6e\x20"
+			  "\x74\x68\x65\x20\x4c\x5a\x34\x24"
+			  "\x00\xcc\x61\x6c\x67\x6f\x72\x69"
+			  "\x74\x68\x6d\x2e\x20\x20\x56\x00"
+			  "\x51\x66\x69\x6e\x65\x73\x36\x00"
+			  "\x80\x61\x70\x70\x6c\x69\x63\x61"
+			  "\x74\x56\x00\x21\x6f\x66\x13\x00"
+			  "\x00\x49\x00\x05\x3d\x00\x20\x20"
+			  "\x75\x63\x00\x90\x69\x6e\x20\x55"
+			  "\x42\x49\x46\x53\x2e",
+	},
+};
+
+static struct comp_testvec lz4_decomp_tv_template[] = {
+	{
+		.inlen	= 125,
+		.outlen	= 159,
+		.input	= "\xf9\x2e\x54\x68\x69\x73\x20\x64"
+			  "\x6f\x63\x75\x6d\x65\x6e\x74\x20"
+			  "\x64\x65\x73\x63\x72\x69\x62\x65"
+			  "\x73\x20\x61\x20\x63\x6f\x6d\x70"
+			  "\x72\x65\x73\x73\x69\x6f\x6e\x20"
+			  "\x6d\x65\x74\x68\x6f\x64\x20\x62"
+			  "\x61\x73\x65\x64\x20\x6f\x6e\x20"
+			  "\x74\x68\x65\x20\x4c\x5a\x34\x24"
+			  "\x00\xcc\x61\x6c\x67\x6f\x72\x69"
+			  "\x74\x68\x6d\x2e\x20\x20\x56\x00"
+			  "\x51\x66\x69\x6e\x65\x73\x36\x00"
+			  "\x80\x61\x70\x70\x6c\x69\x63\x61"
+			  "\x74\x56\x00\x21\x6f\x66\x13\x00"
+			  "\x00\x49\x00\x05\x3d\x00\x20\x20"
+			  "\x75\x63\x00\x90\x69\x6e\x20\x55"
+			  "\x42\x49\x46\x53\x2e",
+		.output	= "This document describes a compression method based on the LZ4 "
+			"compression algorithm.  This document defines the application of "
+			"the LZ4 algorithm used in UBIFS.",
+	}, {
+		.inlen	= 45,
+		.outlen	= 70,
+		.input	= "\xf0\x10\x4a\x6f\x69\x6e\x20\x75"
+			  "\x73\x20\x6e\x6f\x77\x20\x61\x6e"
+			  "\x64\x20\x73\x68\x61\x72\x65\x20"
+			  "\x74\x68\x65\x20\x73\x6f\x66\x74"
+			  "\x77\x0d\x00\x0f\x23\x00\x0b\x50"
+			  "\x77\x61\x72\x65\x20",
+		.output	= "Join us now and share the software "
+			"Join us now and share the software ",
+	},
+};
+
+/*
+ * LZ4HC test vectors (null-terminated strings).
+ */
+#define LZ4HC_COMP_TEST_VECTORS 2
+#define LZ4HC_DECOMP_TEST_VECTORS 2
+
+static struct comp_testvec lz4hc_comp_tv_template[] = {
+	{
+		.inlen	= 70,
+		.outlen	= 45,
+		.input	= "Join us now and share the software "
+			"Join us now and share the software ",
+		.output	= "\xf0\x10\x4a\x6f\x69\x6e\x20\x75"
+			  "\x73\x20\x6e\x6f\x77\x20\x61\x6e"
+			  "\x64\x20\x73\x68\x61\x72\x65\x20"
+			  "\x74\x68\x65\x20\x73\x6f\x66\x74"
+			  "\x77\x0d\x00\x0f\x23\x00\x0b\x50"
+			  "\x77\x61\x72\x65\x20",
+	}, {
+		.inlen	= 159,
+		.outlen	= 122,
+		.input	= "This document describes a compression method based on the LZ4 "
+			"compression algorithm.  This document defines the application of "
+			"the LZ4 algorithm used in UBIFS.",
+		.output	= "\xf9\x2e\x54\x68\x69\x73\x20\x64"
+			  "\x6f\x63\x75\x6d\x65\x6e\x74\x20"
+			  "\x64\x65\x73\x63\x72\x69\x62\x65"
+			  "\x73\x20\x61\x20\x63\x6f\x6d\x70"
+			  "\x72\x65\x73\x73\x69\x6f\x6e\x20"
+			  "\x6d\x65\x74\x68\x6f\x64\x20\x62"
+			  "\x61\x73\x65\x64\x20\x6f\x6e\x20"
+			  "\x74\x68\x65\x20\x4c\x5a\x34\x24"
+			  "\x00\xcc\x61\x6c\x67\x6f\x72\x69"
+			  "\x74\x68\x6d\x2e\x20\x20\x56\x00"
+			  "\x51\x66\x69\x6e\x65\x73\x36\x00"
+			  "\x80\x61\x70\x70\x6c\x69\x63\x61"
+			  "\x74\x32\x00\x25\x6f\x66\x49\x00"
+			  "\x05\x3d\x00\x20\x20\x75\x63\x00"
+			  "\x90\x69\x6e\x20\x55\x42\x49\x46"
+			  "\x53\x2e",
+	},
+};
+
+static struct comp_testvec lz4hc_decomp_tv_template[] = {
+	{
+		.inlen	= 122,
+		.outlen	= 159,
+		.input	= "\xf9\x2e\x54\x68\x69\x73\x20\x64"
+			  "\x6f\x63\x75\x6d\x65\x6e\x74\x20"
+			  "\x64\x65\x73\x63\x72\x69\x62\x65"
+			  "\x73\x20\x61\x20\x63\x6f\x6d\x70"
+			  "\x72\x65\x73\x73\x69\x6f\x6e\x20"
+			  "\x6d\x65\x74\x68\x6f\x64\x20\x62"
+			  "\x61\x73\x65\x64\x20\x6f\x6e\x20"
+			  "\x74\x68\x65\x20\x4c\x5a\x34\x24"
+			  "\x00\xcc\x61\x6c\x67\x6f\x72\x69"
+			  "\x74\x68\x6d\x2e\x20\x20\x56\x00"
+			  "\x51\x66\x69\x6e\x65\x73\x36\x00"
+			  "\x80\x61\x70\x70\x6c\x69\x63\x61"
+			  "\x74\x32\x00\x25\x6f\x66\x49\x00"
+			  "\x05\x3d\x00\x20\x20\x75\x63\x00"
+			  "\x90\x69\x6e\x20\x55\x42\x49\x46"
+			  "\x53\x2e",
+		.output	= "This document describes a compression method based on the LZ4 "
+			"compression algorithm.  This document defines the application of "
+			"the LZ4 algorithm used in UBIFS.",
+	}, {
+		.inlen	= 45,
+		.outlen	= 70,
+		.input	= "\xf0\x10\x4a\x6f\x69\x6e\x20\x75"
+			  "\x73\x20\x6e\x6f\x77\x20\x61\x6e"
+			  "\x64\x20\x73\x68\x61\x72\x65\x20"
+			  "\x74\x68\x65\x20\x73\x6f\x66\x74"
+			  "\x77\x0d\x00\x0f\x23\x00\x0b\x50"
+			  "\x77\x61\x72\x65\x20",
+		.output	= "Join us now and share the software "
+			"Join us now and share the software ",
+	},
+};
+
 /*
  * LZO test vectors (null-terminated strings).
  */
@@ -10172,7 +10400,7 @@ static struct hash_testvec michael_mic_tv_template[] = {
 /*
  * CRC32C test vectors
  */
-#define CRC32C_TEST_VECTORS 14
+#define CRC32C_TEST_VECTORS 15
 
 static struct hash_testvec crc32c_tv_template[] = {
 	{
@@ -10344,6 +10572,365 @@ static struct hash_testvec crc32c_tv_template[] = {
 		.np = 2,
 		.tap = { 31, 209 }
 	},
+	{
+		.key = "\xff\xff\xff\xff",
+		.ksize = 4,
+		.plaintext = "\x05\x12\x1f\x2c\x39\x46\x53\x60"
+			     "\x6d\x7a\x87\x94\xa1\xae\xbb\xc8"
+			     "\xd5\xe2\xef\xfc\x09\x16\x23\x30"
+			     "\x3d\x4a\x57\x64\x71\x7e\x8b\x98"
+			     "\xa5\xb2\xbf\xcc\xd9\xe6\xf3\x00"
+			     "\x0d\x1a\x27\x34\x41\x4e\x5b\x68"
+			     "\x75\x82\x8f\x9c\xa9\xb6\xc3\xd0"
+			     "\xdd\xea\xf7\x04\x11\x1e\x2b\x38"
+			     "\x45\x52\x5f\x6c\x79\x86\x93\xa0"
+			     "\xad\xba\xc7\xd4\xe1\xee\xfb\x08"
+			     "\x15\x22\x2f\x3c\x49\x56\x63\x70"
+			     "\x7d\x8a\x97\xa4\xb1\xbe\xcb\xd8"
+			     "\xe5\xf2\xff\x0c\x19\x26\x33\x40"
+			     "\x4d\x5a\x67\x74\x81\x8e\x9b\xa8"
+			     "\xb5\xc2\xcf\xdc\xe9\xf6\x03\x10"
+			     "\x1d\x2a\x37\x44\x51\x5e\x6b\x78"
+			     "\x85\x92\x9f\xac\xb9\xc6\xd3\xe0"
+			     "\xed\xfa\x07\x14\x21\x2e\x3b\x48"
+			     "\x55\x62\x6f\x7c\x89\x96\xa3\xb0"
+			     "\xbd\xca\xd7\xe4\xf1\xfe\x0b\x18"
+			     "\x25\x32\x3f\x4c\x59\x66\x73\x80"
+			     "\x8d\x9a\xa7\xb4\xc1\xce\xdb\xe8"
+			     "\xf5\x02\x0f\x1c\x29\x36\x43\x50"
+			     "\x5d\x6a\x77\x84\x91\x9e\xab\xb8"
+			     "\xc5\xd2\xdf\xec\xf9\x06\x13\x20"
+			     "\x2d\x3a\x47\x54\x61\x6e\x7b\x88"
+			     "\x95\xa2\xaf\xbc\xc9\xd6\xe3\xf0"
+			     "\xfd\x0a\x17\x24\x31\x3e\x4b\x58"
+			     "\x65\x72\x7f\x8c\x99\xa6\xb3\xc0"
+			     "\xcd\xda\xe7\xf4\x01\x0e\x1b\x28"
+			     "\x35\x42\x4f\x5c\x69\x76\x83\x90"
+			     "\x9d\xaa\xb7\xc4\xd1\xde\xeb\xf8"
+			     "\x05\x12\x1f\x2c\x39\x46\x53\x60"
+			     "\x6d\x7a\x87\x94\xa1\xae\xbb\xc8"
+			     "\xd5\xe2\xef\xfc\x09\x16\x23\x30"
+			     "\x3d\x4a\x57\x64\x71\x7e\x8b\x98"
+			     "\xa5\xb2\xbf\xcc\xd9\xe6\xf3\x00"
+			     "\x0d\x1a\x27\x34\x41\x4e\x5b\x68"
+			     "\x75\x82\x8f\x9c\xa9\xb6\xc3\xd0"
+			     "\xdd\xea\xf7\x04\x11\x1e\x2b\x38"
+			     "\x45\x52\x5f\x6c\x79\x86\x93\xa0"
+			     "\xad\xba\xc7\xd4\xe1\xee\xfb\x08"
+			     "\x15\x22\x2f\x3c\x49\x56\x63\x70"
+			     "\x7d\x8a\x97\xa4\xb1\xbe\xcb\xd8"
+			     "\xe5\xf2\xff\x0c\x19\x26\x33\x40"
+			     "\x4d\x5a\x67\x74\x81\x8e\x9b\xa8"
+			     "\xb5\xc2\xcf\xdc\xe9\xf6\x03\x10"
+			     "\x1d\x2a\x37\x44\x51\x5e\x6b\x78"
+			     "\x85\x92\x9f\xac\xb9\xc6\xd3\xe0"
+			     "\xed\xfa\x07\x14\x21\x2e\x3b\x48"
+			     "\x55\x62\x6f\x7c\x89\x96\xa3\xb0"
+			     "\xbd\xca\xd7\xe4\xf1\xfe\x0b\x18"
+			     "\x25\x32\x3f\x4c\x59\x66\x73\x80"
+			     "\x8d\x9a\xa7\xb4\xc1\xce\xdb\xe8"
+			     "\xf5\x02\x0f\x1c\x29\x36\x43\x50"
+			     "\x5d\x6a\x77\x84\x91\x9e\xab\xb8"
+			     "\xc5\xd2\xdf\xec\xf9\x06\x13\x20"
+			     "\x2d\x3a\x47\x54\x61\x6e\x7b\x88"
+			     "\x95\xa2\xaf\xbc\xc9\xd6\xe3\xf0"
+			     "\xfd\x0a\x17\x24\x31\x3e\x4b\x58"
+			     "\x65\x72\x7f\x8c\x99\xa6\xb3\xc0"
+			     "\xcd\xda\xe7\xf4\x01\x0e\x1b\x28"
+			     "\x35\x42\x4f\x5c\x69\x76\x83\x90"
+			     "\x9d\xaa\xb7\xc4\xd1\xde\xeb\xf8"
+			     "\x05\x12\x1f\x2c\x39\x46\x53\x60"
+			     "\x6d\x7a\x87\x94\xa1\xae\xbb\xc8"
+			     "\xd5\xe2\xef\xfc\x09\x16\x23\x30"
+			     "\x3d\x4a\x57\x64\x71\x7e\x8b\x98"
+			     "\xa5\xb2\xbf\xcc\xd9\xe6\xf3\x00"
+			     "\x0d\x1a\x27\x34\x41\x4e\x5b\x68"
+			     "\x75\x82\x8f\x9c\xa9\xb6\xc3\xd0"
+			     "\xdd\xea\xf7\x04\x11\x1e\x2b\x38"
+			     "\x45\x52\x5f\x6c\x79\x86\x93\xa0"
+			     "\xad\xba\xc7\xd4\xe1\xee\xfb\x08"
+			     "\x15\x22\x2f\x3c\x49\x56\x63\x70"
+			     "\x7d\x8a\x97\xa4\xb1\xbe\xcb\xd8"
+			     "\xe5\xf2\xff\x0c\x19\x26\x33\x40"
+			     "\x4d\x5a\x67\x74\x81\x8e\x9b\xa8"
+			     "\xb5\xc2\xcf\xdc\xe9\xf6\x03\x10"
+			     "\x1d\x2a\x37\x44\x51\x5e\x6b\x78"
+			     "\x85\x92\x9f\xac\xb9\xc6\xd3\xe0"
+			     "\xed\xfa\x07\x14\x21\x2e\x3b\x48"
+			     "\x55\x62\x6f\x7c\x89\x96\xa3\xb0"
+			     "\xbd\xca\xd7\xe4\xf1\xfe\x0b\x18"
+			     "\x25\x32\x3f\x4c\x59\x66\x73\x80"
+			     "\x8d\x9a\xa7\xb4\xc1\xce\xdb\xe8"
+			     "\xf5\x02\x0f\x1c\x29\x36\x43\x50"
+			     "\x5d\x6a\x77\x84\x91\x9e\xab\xb8"
+			     "\xc5\xd2\xdf\xec\xf9\x06\x13\x20"
+			     "\x2d\x3a\x47\x54\x61\x6e\x7b\x88"
+			     "\x95\xa2\xaf\xbc\xc9\xd6\xe3\xf0"
+			     "\xfd\x0a\x17\x24\x31\x3e\x4b\x58"
+			     "\x65\x72\x7f\x8c\x99\xa6\xb3\xc0"
+			     "\xcd\xda\xe7\xf4\x01\x0e\x1b\x28"
+			     "\x35\x42\x4f\x5c\x69\x76\x83\x90"
+			     "\x9d\xaa\xb7\xc4\xd1\xde\xeb\xf8"
+			     "\x05\x12\x1f\x2c\x39\x46\x53\x60"
+			     "\x6d\x7a\x87\x94\xa1\xae\xbb\xc8"
+			     "\xd5\xe2\xef\xfc\x09\x16\x23\x30"
+			     "\x3d\x4a\x57\x64\x71\x7e\x8b\x98"
+			     "\xa5\xb2\xbf\xcc\xd9\xe6\xf3\x00"
+			     "\x0d\x1a\x27\x34\x41\x4e\x5b\x68"
+			     "\x75\x82\x8f\x9c\xa9\xb6\xc3\xd0"
+			     "\xdd\xea\xf7\x04\x11\x1e\x2b\x38"
+			     "\x45\x52\x5f\x6c\x79\x86\x93\xa0"
+			     "\xad\xba\xc7\xd4\xe1\xee\xfb\x08"
+			     "\x15\x22\x2f\x3c\x49\x56\x63\x70"
+			     "\x7d\x8a\x97\xa4\xb1\xbe\xcb\xd8"
+			     "\xe5\xf2\xff\x0c\x19\x26\x33\x40"
+			     "\x4d\x5a\x67\x74\x81\x8e\x9b\xa8"
+			     "\xb5\xc2\xcf\xdc\xe9\xf6\x03\x10"
+			     "\x1d\x2a\x37\x44\x51\x5e\x6b\x78"
+			     "\x85\x92\x9f\xac\xb9\xc6\xd3\xe0"
+			     "\xed\xfa\x07\x14\x21\x2e\x3b\x48"
+			     "\x55\x62\x6f\x7c\x89\x96\xa3\xb0"
+			     "\xbd\xca\xd7\xe4\xf1\xfe\x0b\x18"
+			     "\x25\x32\x3f\x4c\x59\x66\x73\x80"
+			     "\x8d\x9a\xa7\xb4\xc1\xce\xdb\xe8"
+			     "\xf5\x02\x0f\x1c\x29\x36\x43\x50"
+			     "\x5d\x6a\x77\x84\x91\x9e\xab\xb8"
+			     "\xc5\xd2\xdf\xec\xf9\x06\x13\x20"
+			     "\x2d\x3a\x47\x54\x61\x6e\x7b\x88"
+			     "\x95\xa2\xaf\xbc\xc9\xd6\xe3\xf0"
+			     "\xfd\x0a\x17\x24\x31\x3e\x4b\x58"
+			     "\x65\x72\x7f\x8c\x99\xa6\xb3\xc0"
+			     "\xcd\xda\xe7\xf4\x01\x0e\x1b\x28"
+			     "\x35\x42\x4f\x5c\x69\x76\x83\x90"
+			     "\x9d\xaa\xb7\xc4\xd1\xde\xeb\xf8"
+			     "\x05\x12\x1f\x2c\x39\x46\x53\x60"
+			     "\x6d\x7a\x87\x94\xa1\xae\xbb\xc8"
+			     "\xd5\xe2\xef\xfc\x09\x16\x23\x30"
+			     "\x3d\x4a\x57\x64\x71\x7e\x8b\x98"
+			     "\xa5\xb2\xbf\xcc\xd9\xe6\xf3\x00"
+			     "\x0d\x1a\x27\x34\x41\x4e\x5b\x68"
+			     "\x75\x82\x8f\x9c\xa9\xb6\xc3\xd0"
+			     "\xdd\xea\xf7\x04\x11\x1e\x2b\x38"
+			     "\x45\x52\x5f\x6c\x79\x86\x93\xa0"
+			     "\xad\xba\xc7\xd4\xe1\xee\xfb\x08"
+			     "\x15\x22\x2f\x3c\x49\x56\x63\x70"
+			     "\x7d\x8a\x97\xa4\xb1\xbe\xcb\xd8"
+			     "\xe5\xf2\xff\x0c\x19\x26\x33\x40"
+			     "\x4d\x5a\x67\x74\x81\x8e\x9b\xa8"
+			     "\xb5\xc2\xcf\xdc\xe9\xf6\x03\x10"
+			     "\x1d\x2a\x37\x44\x51\x5e\x6b\x78"
+			     "\x85\x92\x9f\xac\xb9\xc6\xd3\xe0"
+			     "\xed\xfa\x07\x14\x21\x2e\x3b\x48"
+			     "\x55\x62\x6f\x7c\x89\x96\xa3\xb0"
+			     "\xbd\xca\xd7\xe4\xf1\xfe\x0b\x18"
+			     "\x25\x32\x3f\x4c\x59\x66\x73\x80"
+			     "\x8d\x9a\xa7\xb4\xc1\xce\xdb\xe8",
+		.psize = 1200,
+		.digest = "\xeb\xc8\x7a\x3b",
+	},
+};
+
+/*
+ * CRC32 test vectors
+ */
+#define CRC32_TEST_VECTORS 5
+
+static struct hash_testvec crc32_tv_template[] = {
+	{
+		.psize = 0,
+		.digest = "\x00\x00\x00\x00",
+	},
+	{
+		.key = "\x87\xa9\xcb\xed",
+		.ksize = 4,
+		.psize = 0,
+		.digest = "\x87\xa9\xcb\xed",
+	},
+	{
+		.key = "\xff\xff\xff\xff",
+		.ksize = 4,
+		.plaintext = "\x01\x02\x03\x04\x05\x06\x07\x08"
+			     "\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10"
+			     "\x11\x12\x13\x14\x15\x16\x17\x18"
+			     "\x19\x1a\x1b\x1c\x1d\x1e\x1f\x20"
+			     "\x21\x22\x23\x24\x25\x26\x27\x28",
+		.psize = 40,
+		.digest = "\x3a\xdf\x4b\xb0",
+	},
+	{
+		.key = "\xff\xff\xff\xff",
+		.ksize = 4,
+		.plaintext = "\x03\x0a\x11\x18\x1f\x26\x2d\x34"
+			     "\x3b\x42\x49\x50\x57\x5e\x65\x6c"
+			     "\x73\x7a\x81\x88\x8f\x96\x9d\xa4"
+			     "\xab\xb2\xb9\xc0\xc7\xce\xd5\xdc"
+			     "\xe3\xea\xf1\xf8\xff\x06\x0d\x14"
+			     "\x1b\x22\x29\x30\x37\x3e\x45\x4c"
+			     "\x53\x5a\x61\x68\x6f\x76\x7d\x84"
+			     "\x8b\x92\x99\xa0\xa7\xae\xb5\xbc"
+			     "\xc3\xca\xd1\xd8\xdf\xe6\xed\xf4"
+			     "\xfb\x02\x09\x10\x17\x1e\x25\x2c"
+			     "\x33\x3a\x41\x48\x4f\x56\x5d\x64"
+			     "\x6b\x72\x79\x80\x87\x8e\x95\x9c"
+			     "\xa3\xaa\xb1\xb8\xbf\xc6\xcd\xd4"
+			     "\xdb\xe2\xe9\xf0\xf7\xfe\x05\x0c"
+			     "\x13\x1a\x21\x28\x2f\x36\x3d\x44"
+			     "\x4b\x52\x59\x60\x67\x6e\x75\x7c"
+			     "\x83\x8a\x91\x98\x9f\xa6\xad\xb4"
+			     "\xbb\xc2\xc9\xd0\xd7\xde\xe5\xec"
+			     "\xf3\xfa\x01\x08\x0f\x16\x1d\x24"
+			     "\x2b\x32\x39\x40\x47\x4e\x55\x5c"
+			     "\x63\x6a\x71\x78\x7f\x86\x8d\x94"
+			     "\x9b\xa2\xa9\xb0\xb7\xbe\xc5\xcc"
+			     "\xd3\xda\xe1\xe8\xef\xf6\xfd\x04"
+			     "\x0b\x12\x19\x20\x27\x2e\x35\x3c"
+			     "\x43\x4a\x51\x58\x5f\x66\x6d\x74"
+			     "\x7b\x82\x89\x90\x97\x9e\xa5\xac"
+			     "\xb3\xba\xc1\xc8\xcf\xd6\xdd\xe4"
+			     "\xeb\xf2\xf9\x00\x07\x0e\x15\x1c"
+			     "\x23\x2a\x31\x38\x3f\x46\x4d\x54"
+			     "\x5b\x62\x69\x70\x77\x7e\x85\x8c",
+		.psize = 240,
+		.digest = "\xba\x56\xf3\x65",
+	},
+	{
+		.plaintext = "\x03\x0a\x11\x18\x1f\x26\x2d\x34"
+			     "\x3b\x42\x49\x50\x57\x5e\x65\x6c"
+			     "\x73\x7a\x81\x88\x8f\x96\x9d\xa4"
+			     "\xab\xb2\xb9\xc0\xc7\xce\xd5\xdc"
+			     "\xe3\xea\xf1\xf8\xff\x06\x0d\x14"
+			     "\x1b\x22\x29\x30\x37\x3e\x45\x4c"
+			     "\x53\x5a\x61\x68\x6f\x76\x7d\x84"
+			     "\x8b\x92\x99\xa0\xa7\xae\xb5\xbc"
+			     "\xc3\xca\xd1\xd8\xdf\xe6\xed\xf4"
+			     "\xfb\x02\x09\x10\x17\x1e\x25\x2c"
+			     "\x33\x3a\x41\x48\x4f\x56\x5d\x64"
+			     "\x6b\x72\x79\x80\x87\x8e\x95\x9c"
+			     "\xa3\xaa\xb1\xb8\xbf\xc6\xcd\xd4"
+			     "\xdb\xe2\xe9\xf0\xf7\xfe\x05\x0c"
+			     "\x13\x1a\x21\x28\x2f\x36\x3d\x44"
+			     "\x4b\x52\x59\x60\x67\x6e\x75\x7c"
+			     "\x83\x8a\x91\x98\x9f\xa6\xad\xb4"
+			     "\xbb\xc2\xc9\xd0\xd7\xde\xe5\xec"
+			     "\xf3\xfa\x01\x08\x0f\x16\x1d\x24"
+			     "\x2b\x32\x39\x40\x47\x4e\x55\x5c"
+			     "\x63\x6a\x71\x78\x7f\x86\x8d\x94"
+			     "\x9b\xa2\xa9\xb0\xb7\xbe\xc5\xcc"
+			     "\xd3\xda\xe1\xe8\xef\xf6\xfd\x04"
+			     "\x0b\x12\x19\x20\x27\x2e\x35\x3c"
+			     "\x43\x4a\x51\x58\x5f\x66\x6d\x74"
+			     "\x7b\x82\x89\x90\x97\x9e\xa5\xac"
+			     "\xb3\xba\xc1\xc8\xcf\xd6\xdd\xe4"
+			     "\xeb\xf2\xf9\x00\x07\x0e\x15\x1c"
+			     "\x23\x2a\x31\x38\x3f\x46\x4d\x54"
+			     "\x5b\x62\x69\x70\x77\x7e\x85\x8c",
+		.psize = 240,
+		.digest = "\x56\x8d\x6d\x26",
+		.np = 2,
+		.tap = { 17, 223 }
+	}
+};
+
+/*
+ * T10 DIF CRC test vectors (the digest is in CPU byte order)
+ */
+#define CRCT10DIF_TEST_VECTORS 6
+
+static struct hash_testvec crct10dif_tv_template[] = {
+	{
+		.psize = 0,
+		.digest = "\x00\x00",
+	},
+	{
+		.plaintext = "\x61\x62\x63",
+		.psize = 3,
+		.digest = "\x3b\x44",
+	},
+	{
+		.plaintext = "\x31\x32\x33\x34\x35\x36\x37\x38"
+			     "\x39",
+		.psize = 9,
+		.digest = "\xdb\xd0",
+	},
+	{
+		.plaintext = "\x00\x01\x02\x03\x04\x05\x06\x07"
+			     "\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f"
+			     "\x10\x11\x12\x13\x14\x15\x16\x17"
+			     "\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f"
+			     "\x20\x21\x22\x23\x24\x25\x26\x27",
+		.psize = 40,
+		.digest = "\x6a\x40",
+	},
+	{
+		.plaintext = "\x03\x0a\x11\x18\x1f\x26\x2d\x34"
+			     "\x3b\x42\x49\x50\x57\x5e\x65\x6c"
+			     "\x73\x7a\x81\x88\x8f\x96\x9d\xa4"
+			     "\xab\xb2\xb9\xc0\xc7\xce\xd5\xdc"
+			     "\xe3\xea\xf1\xf8\xff\x06\x0d\x14"
+			     "\x1b\x22\x29\x30\x37\x3e\x45\x4c"
+			     "\x53\x5a\x61\x68\x6f\x76\x7d\x84"
+			     "\x8b\x92\x99\xa0\xa7\xae\xb5\xbc"
+			     "\xc3\xca\xd1\xd8\xdf\xe6\xed\xf4"
+			     "\xfb\x02\x09\x10\x17\x1e\x25\x2c"
+			     "\x33\x3a\x41\x48\x4f\x56\x5d\x64"
+			     "\x6b\x72\x79\x80\x87\x8e\x95\x9c"
+			     "\xa3\xaa\xb1\xb8\xbf\xc6\xcd\xd4"
+			     "\xdb\xe2\xe9\xf0\xf7\xfe\x05\x0c"
+			     "\x13\x1a\x21\x28\x2f\x36\x3d\x44"
+			     "\x4b\x52\x59\x60\x67\x6e\x75\x7c"
+			     "\x83\x8a\x91\x98\x9f\xa6\xad\xb4"
+			     "\xbb\xc2\xc9\xd0\xd7\xde\xe5\xec"
+			     "\xf3\xfa\x01\x08\x0f\x16\x1d\x24"
+			     "\x2b\x32\x39\x40\x47\x4e\x55\x5c"
+			     "\x63\x6a\x71\x78\x7f\x86\x8d\x94"
+			     "\x9b\xa2\xa9\xb0\xb7\xbe\xc5\xcc"
+			     "\xd3\xda\xe1\xe8\xef\xf6\xfd\x04"
+			     "\x0b\x12\x19\x20\x27\x2e\x35\x3c"
+			     "\x43\x4a\x51\x58\x5f\x66\x6d\x74"
+			     "\x7b\x82\x89\x90\x97\x9e\xa5\xac"
+			     "\xb3\xba\xc1\xc8\xcf\xd6\xdd\xe4"
+			     "\xeb\xf2\xf9\x00\x07\x0e\x15\x1c"
+			     "\x23\x2a\x31\x38\x3f\x46\x4d\x54"
+			     "\x5b\x62\x69\x70\x77\x7e\x85\x8c",
+		.psize = 240,
+		.digest = "\x94\xa1",
+	},
+	{
+		.plaintext = "\x03\x0a\x11\x18\x1f\x26\x2d\x34"
+			     "\x3b\x42\x49\x50\x57\x5e\x65\x6c"
+			     "\x73\x7a\x81\x88\x8f\x96\x9d\xa4"
+			     "\xab\xb2\xb9\xc0\xc7\xce\xd5\xdc"
+			     "\xe3\xea\xf1\xf8\xff\x06\x0d\x14"
+			     "\x1b\x22\x29\x30\x37\x3e\x45\x4c"
+			     "\x53\x5a\x61\x68\x6f\x76\x7d\x84"
+			     "\x8b\x92\x99\xa0\xa7\xae\xb5\xbc"
+			     "\xc3\xca\xd1\xd8\xdf\xe6\xed\xf4"
+			     "\xfb\x02\x09\x10\x17\x1e\x25\x2c"
+			     "\x33\x3a\x41\x48\x4f\x56\x5d\x64"
+			     "\x6b\x72\x79\x80\x87\x8e\x95\x9c"
+			     "\xa3\xaa\xb1\xb8\xbf\xc6\xcd\xd4"
+			     "\xdb\xe2\xe9\xf0\xf7\xfe\x05\x0c"
+			     "\x13\x1a\x21\x28\x2f\x36\x3d\x44"
+			     "\x4b\x52\x59\x60\x67\x6e\x75\x7c"
+			     "\x83\x8a\x91\x98\x9f\xa6\xad\xb4"
+			     "\xbb\xc2\xc9\xd0\xd7\xde\xe5\xec"
+			     "\xf3\xfa\x01\x08\x0f\x16\x1d\x24"
+			     "\x2b\x32\x39\x40\x47\x4e\x55\x5c"
+			     "\x63\x6a\x71\x78\x7f\x86\x8d\x94"
+			     "\x9b\xa2\xa9\xb0\xb7\xbe\xc5\xcc"
+			     "\xd3\xda\xe1\xe8\xef\xf6\xfd\x04"
+			     "\x0b\x12\x19\x20\x27\x2e\x35\x3c"
+			     "\x43\x4a\x51\x58\x5f\x66\x6d\x74"
+			     "\x7b\x82\x89\x90\x97\x9e\xa5\xac"
+			     "\xb3\xba\xc1\xc8\xcf\xd6\xdd\xe4"
+			     "\xeb\xf2\xf9\x00\x07\x0e\x15\x1c"
+			     "\x23\x2a\x31\x38\x3f\x46\x4d\x54"
+			     "\x5b\x62\x69\x70\x77\x7e\x85\x8c",
+		.psize = 240,
+		.digest = "\x94\xa1",
+		.np = 2,
+		.tap = { 31, 209 }
+	}
 };
 
 #endif	/* _CRYPTO_TESTMGR_H */
@@ -35,6 +35,7 @@
 #include <linux/eventfd.h>
 #include <linux/blkdev.h>
 #include <linux/compat.h>
+#include <linux/cred.h>
 
 #include <asm/kmap_types.h>
 #include <asm/uaccess.h>
@@ -49,12 +50,14 @@
 static DEFINE_SPINLOCK(aio_nr_lock);
 unsigned long aio_nr;		/* current system wide number of aio requests */
 unsigned long aio_max_nr = 0x10000; /* system wide maximum number of aio requests */
+int aio_offload_workers = 4;	/* per context buffered write/fsync workers */
 /*----end sysctl variables---*/
 
 static struct kmem_cache	*kiocb_cachep;
 static struct kmem_cache	*kioctx_cachep;
 
 static struct workqueue_struct *aio_wq;
+static struct workqueue_struct *aio_offload_wq;
 
 /* Used for rare fput completion. */
 static void aio_fput_routine(struct work_struct *);
@@ -64,6 +67,7 @@ static DEFINE_SPINLOCK(fput_lock);
 static LIST_HEAD(fput_head);
 
 static void aio_kick_handler(struct work_struct *);
+static void aio_offload_handler(struct work_struct *);
 static void aio_queue_work(struct kioctx *);
 
 /* aio_setup
@@ -77,6 +81,9 @@ static int __init aio_setup(void)
 
 	aio_wq = alloc_workqueue("aio", 0, 1);	/* used to limit concurrency */
 	BUG_ON(!aio_wq);
+	/* concurrency is bounded per context by ctx->nr_offload_workers */
+	aio_offload_wq = alloc_workqueue("aio_offload", WQ_UNBOUND, 0);
+	BUG_ON(!aio_offload_wq);
 
 	pr_debug("aio_setup: sizeof(struct page) = %d\n", (int)sizeof(struct page));
 
@@ -217,10 +224,16 @@ static void ctx_rcu_free(struct rcu_head *head)
  */
 static void __put_ioctx(struct kioctx *ctx)
 {
+	unsigned i;
+
 	BUG_ON(ctx->reqs_active);
 
 	cancel_delayed_work(&ctx->wq);
 	cancel_work_sync(&ctx->wq.work);
+	/* an offload worker may still be on its way out after its last iocb */
+	for (i = 0; i < ctx->nr_offload_workers; i++)
+		cancel_work_sync(&ctx->offload_workers[i].work);
+	kfree(ctx->offload_workers);
 	aio_free_ring(ctx);
 	mmdrop(ctx->mm);
 	ctx->mm = NULL;
@@ -254,6 +267,7 @@ static struct kioctx *ioctx_alloc(unsigned nr_events)
 	struct mm_struct *mm;
 	struct kioctx *ctx;
 	int did_sync = 0;
+	unsigned i;
 
 	/* Prevent overflows */
 	if ((nr_events > (0x10000000U / sizeof(struct io_event))) ||
@@ -282,6 +296,21 @@ static struct kioctx *ioctx_alloc(unsigned nr_events)
 	INIT_LIST_HEAD(&ctx->run_list);
 	INIT_DELAYED_WORK(&ctx->wq, aio_kick_handler);
 
+	INIT_LIST_HEAD(&ctx->offload_list);
+	ctx->nr_offload_workers = min(aio_offload_workers, AIO_MAX_OFFLOAD_WORKERS);
+	if (ctx->nr_offload_workers) {
+		ctx->offload_workers = kcalloc(ctx->nr_offload_workers,
+					       sizeof(struct aio_offload_worker),
+					       GFP_KERNEL);
+		if (!ctx->offload_workers)
+			goto out_freectx;
+		for (i = 0; i < ctx->nr_offload_workers; i++) {
+			INIT_WORK(&ctx->offload_workers[i].work,
+				  aio_offload_handler);
+			ctx->offload_workers[i].ctx = ctx;
+		}
+	}
+
 	if (aio_setup_ring(ctx) < 0)
 		goto out_freectx;
 
@@ -321,6 +350,7 @@ out_cleanup:
 
 out_freectx:
 	mmdrop(mm);
+	kfree(ctx->offload_workers);
 	kmem_cache_free(kioctx_cachep, ctx);
 	ctx = ERR_PTR(-ENOMEM);
 
@@ -454,10 +484,13 @@ static struct kiocb *__aio_get_req(struct kioctx *ctx)
 	req->ki_cancel = NULL;
 	req->ki_retry = NULL;
 	req->ki_dtor = NULL;
+	req->ki_complete = NULL;
 	req->private = NULL;
 	req->ki_iovec = NULL;
 	INIT_LIST_HEAD(&req->ki_run_list);
 	req->ki_eventfd = NULL;
+	req->ki_cred = NULL;
+	req->ki_wait.key.flags = NULL;
 
 	/* Check if the completion queue has enough free space to
 	 * accept an event from this io.
@@ -501,6 +534,8 @@ static inline void really_put_req(struct kioctx *ctx, struct kiocb *req)
 
 	if (req->ki_eventfd != NULL)
 		eventfd_ctx_put(req->ki_eventfd);
+	if (req->ki_cred != NULL)
+		put_cred(req->ki_cred);
 	if (req->ki_dtor)
 		req->ki_dtor(req);
 	if (req->ki_iovec != &req->ki_inline_vec)
@@ -846,6 +881,139 @@ static void aio_kick_handler(struct work_struct *work)
 		queue_delayed_work(aio_wq, &ctx->wq, 0);
 }
 
+/*
+ * aio_offload_handler:
+ *	Work queue handler for one of the context's offload workers.
+ *	Runs buffered writes and fsyncs, which have no way to wait for
+ *	i/o without blocking, in the issuer's mm and with the issuer's
+ *	credentials, so that io_submit() itself never has to block on
+ *	them.  Keeps going until the context's offload list is empty.
+ */
+static void aio_offload_handler(struct work_struct *work)
+{
+	struct aio_offload_worker *worker =
+		container_of(work, struct aio_offload_worker, work);
+	struct kioctx *ctx = worker->ctx;
+	struct mm_struct *mm = ctx->mm;
+	mm_segment_t oldfs = get_fs();
+	const struct cred *old_cred;
+	struct kiocb *iocb;
+
+	set_fs(USER_DS);
+	use_mm(mm);
+	spin_lock_irq(&ctx->ctx_lock);
+	while (!list_empty(&ctx->offload_list)) {
+		iocb = list_entry(ctx->offload_list.next, struct kiocb,
+				  ki_run_list);
+		list_del_init(&iocb->ki_run_list);
+		iocb->ki_users++;	/* grab extra reference */
+		old_cred = override_creds(iocb->ki_cred);
+		aio_run_iocb(iocb);
+		revert_creds(old_cred);
+		__aio_put_req(ctx, iocb);
+	}
+	worker->busy = 0;
+	spin_unlock_irq(&ctx->ctx_lock);
+	unuse_mm(mm);
+	set_fs(oldfs);
+}
+
+/*
+ * Hand a submitted iocb over to the context's offload workers, starting
+ * an idle one if there is one left.  Busy workers drain the whole list,
+ * so once all of them are running new iocbs simply wait their turn.
+ */
+static void aio_queue_offload(struct kiocb *iocb)
+{
+	struct kioctx *ctx = iocb->ki_ctx;
+	unsigned i;
+
+	assert_spin_locked(&ctx->ctx_lock);
+
+	list_add_tail(&iocb->ki_run_list, &ctx->offload_list);
+	for (i = 0; i < ctx->nr_offload_workers; i++) {
+		struct aio_offload_worker *worker = &ctx->offload_workers[i];
+
+		if (!worker->busy) {
+			worker->busy = 1;
+			queue_work(aio_offload_wq, &worker->work);
+			break;
+		}
+	}
+}
+
+/*
+ * Buffered writes and fsyncs of regular files and block devices block in
+ * the page cache or the journal with no hook for a retry, so they go to
+ * the offload workers, unless the administrator disabled them.
+ */
+static int aio_should_offload(struct kiocb *iocb)
+{
+	struct file *file = iocb->ki_filp;
+	umode_t mode = file->f_path.dentry->d_inode->i_mode;
+
+	if (!iocb->ki_ctx->nr_offload_workers)
+		return 0;
+	if (!S_ISREG(mode) && !S_ISBLK(mode))
+		return 0;
+
+	switch (iocb->ki_opcode) {
+	case IOCB_CMD_PWRITE:
+	case IOCB_CMD_PWRITEV:
+		return !(file->f_flags & O_DIRECT);
+	case IOCB_CMD_FSYNC:
+	case IOCB_CMD_FDSYNC:
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * An offloaded write runs in a kworker, where generic_write_checks()
+ * sees the kworker's RLIMIT_FSIZE rather than the submitter's.  Apply the
+ * submitter's limit here instead, like generic_write_checks() would:
+ * fail with -EFBIG and SIGXFSZ at or beyond the limit, and otherwise cut
+ * the write short at the limit.  For O_APPEND the file size at submit
+ * time stands in for the position.
+ */
+static int aio_offload_write_checks(struct kiocb *iocb)
+{
+	struct inode *inode = iocb->ki_filp->f_mapping->host;
+	unsigned long limit = rlimit(RLIMIT_FSIZE);
+	loff_t pos = iocb->ki_pos;
+	unsigned long seg;
+	size_t left;
+
+	if (iocb->ki_opcode != IOCB_CMD_PWRITE &&
+	    iocb->ki_opcode != IOCB_CMD_PWRITEV)
+		return 0;
+	if (limit == RLIM_INFINITY || S_ISBLK(inode->i_mode))
+		return 0;
+
+	if (iocb->ki_filp->f_flags & O_APPEND)
+		pos = i_size_read(inode);
+	if (pos < 0)
+		return 0;	/* rejected by aio_rw_vect_retry() */
+	if (pos >= limit) {
+		send_sig(SIGXFSZ, current, 0);
+		return -EFBIG;
+	}
+	if (iocb->ki_left <= limit - (unsigned long)pos)
+		return 0;
+
+	left = limit - (unsigned long)pos;
+	iocb->ki_nbytes = iocb->ki_left = left;
+	for (seg = 0; seg < iocb->ki_nr_segs; seg++) {
+		if (iocb->ki_iovec[seg].iov_len >= left) {
+			iocb->ki_iovec[seg].iov_len = left;
+			break;
+		}
+		left -= iocb->ki_iovec[seg].iov_len;
+	}
+	iocb->ki_nr_segs = seg + 1;
+	return 0;
+}
+
 
 /*
  * Called by kick_iocb to queue the kiocb for retry
@@ -919,6 +1087,15 @@ int aio_complete(struct kiocb *iocb, long res, long res2)
 		return 1;
 	}
 
+	/*
+	 * iocbs submitted through io_uring have no aio context and post
+	 * their completion to the ring themselves.
+	 */
+	if (iocb->ki_complete) {
+		iocb->ki_complete(iocb, res, res2);
+		return 1;
+	}
+
 	info = &ctx->ring_info;
 
 	/* add a completion event to the ring buffer.
@@ -1358,6 +1535,11 @@ static ssize_t aio_rw_vect_retry(struct kiocb *iocb)
 	return ret;
 }
 
+/*
+ * Files without an ->aio_fsync method are synced with plain ->fsync,
+ * which is only reasonable because such requests run on an offload
+ * worker rather than in io_submit().
+ */
 static ssize_t aio_fdsync(struct kiocb *iocb)
 {
 	struct file *file = iocb->ki_filp;
@@ -1365,6 +1547,8 @@ static ssize_t aio_fdsync(struct kiocb *iocb)
 
 	if (file->f_op->aio_fsync)
 		ret = file->f_op->aio_fsync(iocb, 1);
+	else if (file->f_op->fsync)
+		ret = vfs_fsync(file, 1);
 	return ret;
 }
 
@@ -1375,6 +1559,8 @@ static ssize_t aio_fsync(struct kiocb *iocb)
 
 	if (file->f_op->aio_fsync)
 		ret = file->f_op->aio_fsync(iocb, 0);
+	else if (file->f_op->fsync)
+		ret = vfs_fsync(file, 0);
 	return ret;
 }
 
@@ -1446,6 +1632,7 @@ static ssize_t aio_setup_iocb(struct kiocb *kiocb, bool compat)
 		ret = -EINVAL;
 		if (file->f_op->aio_read)
 			kiocb->ki_retry = aio_rw_vect_retry;
+		kiocbSetAsyncBuffered(kiocb);
 		break;
 	case IOCB_CMD_PWRITE:
 		ret = -EBADF;
@@ -1478,6 +1665,7 @@ static ssize_t aio_setup_iocb(struct kiocb *kiocb, bool compat)
 		ret = -EINVAL;
 		if (file->f_op->aio_read)
 			kiocb->ki_retry = aio_rw_vect_retry;
+		kiocbSetAsyncBuffered(kiocb);
 		break;
 	case IOCB_CMD_PWRITEV:
 		ret = -EBADF;
@@ -1495,12 +1683,14 @@ static ssize_t aio_setup_iocb(struct kiocb *kiocb, bool compat)
 		break;
 	case IOCB_CMD_FDSYNC:
 		ret = -EINVAL;
-		if (file->f_op->aio_fsync)
+		if (file->f_op->aio_fsync ||
+		    (file->f_op->fsync && aio_should_offload(kiocb)))
 			kiocb->ki_retry = aio_fdsync;
 		break;
 	case IOCB_CMD_FSYNC:
 		ret = -EINVAL;
-		if (file->f_op->aio_fsync)
+		if (file->f_op->aio_fsync ||
+		    (file->f_op->fsync && aio_should_offload(kiocb)))
 			kiocb->ki_retry = aio_fsync;
 		break;
 	default:
@@ -1581,6 +1771,13 @@ static int io_submit_one(struct kioctx *ctx, struct iocb __user *user_iocb,
 	if (ret)
 		goto out_put_req;
 
+	if (aio_should_offload(req)) {
+		ret = aio_offload_write_checks(req);
+		if (ret)
+			goto out_put_req;
+		req->ki_cred = get_current_cred();
+	}
+
 	spin_lock_irq(&ctx->ctx_lock);
 	/*
 	 * We could have raced with io_destroy() and are currently holding a
@@ -1599,7 +1796,10 @@ static int io_submit_one(struct kioctx *ctx, struct iocb __user *user_iocb,
 		ret = -EINVAL;
 		goto out_put_req;
 	}
-	aio_run_iocb(req);
+	if (req->ki_cred)
+		aio_queue_offload(req);
+	else
+		aio_run_iocb(req);
 	if (!list_empty(&ctx->run_list)) {
 		/* drain the run list */
 		while (__aio_run_iocbs(ctx))
@@ -2599,6 +2599,22 @@ cache_acl:
 	}
 
 	btrfs_update_iflags(inode);
+
+#ifdef CONFIG_BTRFS_FS_POSIX_ACL
+	/*
+	 * Directories that may have ACLs get the access ACL cached now, so
+	 * that RCU path walk through them can check it without dropping to
+	 * ref-walk.  The xattr items sit next to the inode item, usually in
+	 * the leaf we just read.
+	 */
+	if (maybe_acls && S_ISDIR(inode->i_mode)) {
+		struct posix_acl *acl;
+
+		acl = btrfs_get_acl(inode, ACL_TYPE_ACCESS);
+		if (!IS_ERR_OR_NULL(acl))
+			posix_acl_release(acl);
+	}
+#endif
 	return;
 
 make_bad:
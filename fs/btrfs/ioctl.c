@@ -2130,12 +2130,17 @@ out:
 	return ret;
 }
 
-static noinline long btrfs_ioctl_clone(struct file *file, unsigned long srcfd,
+/*
+ * Share the extents of [off, off + olen) of src_file at destoff in file.
+ * The caller holds write access to the mount and has checked that file is
+ * open for writing.
+ */
+static noinline long btrfs_clone_files(struct file *file,
+				       struct file *src_file,
 				       u64 off, u64 olen, u64 destoff)
 {
 	struct inode *inode = fdentry(file)->d_inode;
 	struct btrfs_root *root = BTRFS_I(inode)->root;
-	struct file *src_file;
 	struct inode *src;
 	struct btrfs_trans_handle *trans;
 	struct btrfs_path *path;
@@ -2159,55 +2164,34 @@ static noinline long btrfs_ioctl_clone(struct file *file, unsigned long srcfd,
 	 *   they don't overlap)?
 	 */
 
-	/* the destination must be opened for writing */
-	if (!(file->f_mode & FMODE_WRITE) || (file->f_flags & O_APPEND))
-		return -EINVAL;
-
-	if (btrfs_root_readonly(root))
-		return -EROFS;
-
-	ret = mnt_want_write(file->f_path.mnt);
-	if (ret)
-		return ret;
-
-	src_file = fget(srcfd);
-	if (!src_file) {
-		ret = -EBADF;
-		goto out_drop_write;
-	}
-
 	src = src_file->f_dentry->d_inode;
 
-	ret = -EINVAL;
 	if (src == inode)
-		goto out_fput;
+		return -EINVAL;
 
 	/* the src must be open for reading */
 	if (!(src_file->f_mode & FMODE_READ))
-		goto out_fput;
+		return -EINVAL;
 
 	/* don't make the dst file partly checksummed */
 	if ((BTRFS_I(src)->flags & BTRFS_INODE_NODATASUM) !=
 	    (BTRFS_I(inode)->flags & BTRFS_INODE_NODATASUM))
-		goto out_fput;
+		return -EINVAL;
 
-	ret = -EISDIR;
 	if (S_ISDIR(src->i_mode) || S_ISDIR(inode->i_mode))
-		goto out_fput;
+		return -EISDIR;
 
-	ret = -EXDEV;
 	if (src->i_sb != inode->i_sb || BTRFS_I(src)->root != root)
-		goto out_fput;
+		return -EXDEV;
 
-	ret = -ENOMEM;
 	buf = vmalloc(btrfs_level_size(root, 0));
 	if (!buf)
-		goto out_fput;
+		return -ENOMEM;
 
 	path = btrfs_alloc_path();
 	if (!path) {
 		vfree(buf);
-		goto out_fput;
+		return -ENOMEM;
 	}
 	path->reada = 2;
 
@@ -2478,13 +2462,90 @@ out_unlock:
 	mutex_unlock(&inode->i_mutex);
 	vfree(buf);
 	btrfs_free_path(path);
-out_fput:
+	return ret;
+}
+
+static noinline long btrfs_ioctl_clone(struct file *file, unsigned long srcfd,
+				       u64 off, u64 olen, u64 destoff)
+{
+	struct btrfs_root *root = BTRFS_I(fdentry(file)->d_inode)->root;
+	struct file *src_file;
+	int ret;
+
+	/* the destination must be opened for writing */
+	if (!(file->f_mode & FMODE_WRITE) || (file->f_flags & O_APPEND))
+		return -EINVAL;
+
+	if (btrfs_root_readonly(root))
+		return -EROFS;
+
+	ret = mnt_want_write(file->f_path.mnt);
+	if (ret)
+		return ret;
+
+	src_file = fget(srcfd);
+	if (!src_file) {
+		ret = -EBADF;
+		goto out_drop_write;
+	}
+
+	ret = btrfs_clone_files(file, src_file, off, olen, destoff);
+
 	fput(src_file);
 out_drop_write:
 	mnt_drop_write(file->f_path.mnt);
 	return ret;
 }
 
+/*
+ * copy_file_range() is done by sharing extents where that is possible.
+ * Ranges the clone code cannot handle -- unaligned ones, copies within a
+ * file, between subvolumes or between files with different checksumming
+ * -- are handed back to the VFS to copy through the page cache.
+ */
+ssize_t btrfs_copy_file_range(struct file *file_in, loff_t pos_in,
+			      struct file *file_out, loff_t pos_out,
+			      size_t len, unsigned int flags)
+{
+	struct inode *inode_in = fdentry(file_in)->d_inode;
+	struct inode *inode_out = fdentry(file_out)->d_inode;
+	struct btrfs_root *root = BTRFS_I(inode_out)->root;
+	u64 bs = root->fs_info->sb->s_blocksize;
+	u64 isize = i_size_read(inode_in);
+	long ret;
+
+	if (inode_in == inode_out || BTRFS_I(inode_in)->root != root ||
+	    (BTRFS_I(inode_in)->flags & BTRFS_INODE_NODATASUM) !=
+	    (BTRFS_I(inode_out)->flags & BTRFS_INODE_NODATASUM))
+		return -EOPNOTSUPP;
+
+	if (pos_in >= isize)
+		return 0;
+	if (pos_in + len > isize)
+		len = isize - pos_in;
+
+	/* a range running to EOF is rounded up to a block by the clone */
+	if (!IS_ALIGNED(pos_in, bs) || !IS_ALIGNED(pos_out, bs) ||
+	    (!IS_ALIGNED(len, bs) && pos_in + len != isize))
+		return -EOPNOTSUPP;
+
+	if (btrfs_root_readonly(root))
+		return -EROFS;
+
+	ret = btrfs_clone_files(file_out, file_in, pos_in, len, pos_out);
+	/*
+	 * The checks above used i_size without i_mutex.  The clone repeats
+	 * them under the lock and fails with -EINVAL if a racing truncate or
+	 * extend made the range invalid or unaligned; the VFS copy copes
+	 * with that, so fall back to it.
+	 */
+	if (ret == -EINVAL)
+		return -EOPNOTSUPP;
+	if (ret < 0)
+		return ret;
+	return len;
+}
+
 static long btrfs_ioctl_clone_range(struct file *file, void __user *argp)
 {
 	struct btrfs_ioctl_clone_range_args args;
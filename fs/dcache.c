@@ -46,8 +46,10 @@
  *   - the dcache hash table
  * s_anon bl list spinlock protects:
  *   - the s_anon list (see __d_drop)
- * dcache_lru_lock protects:
- *   - the dcache lru lists and counters
+ * sb->s_dentry_lru per-node locks protect:
+ *   - the dcache lru lists and per-node counters
+ * dcache_shrink_lock protects:
+ *   - private lists of dentries being disposed of (DCACHE_SHRINK_LIST)
  * d_lock protects:
  *   - d_flags
  *   - d_name
@@ -61,7 +63,8 @@
  * Ordering:
  * dentry->d_inode->i_lock
  *   dentry->d_lock
- *     dcache_lru_lock
+ *     s_dentry_lru node lock
+ *       dcache_shrink_lock
  *     dcache_hash_bucket lock
  *     s_anon lock
  *
@@ -79,7 +82,7 @@
 int sysctl_vfs_cache_pressure __read_mostly = 100;
 EXPORT_SYMBOL_GPL(sysctl_vfs_cache_pressure);
 
-static __cacheline_aligned_in_smp DEFINE_SPINLOCK(dcache_lru_lock);
+static __cacheline_aligned_in_smp DEFINE_SPINLOCK(dcache_shrink_lock);
 __cacheline_aligned_in_smp DEFINE_SEQLOCK(rename_lock);
 
 EXPORT_SYMBOL(rename_lock);
@@ -116,6 +119,7 @@ struct dentry_stat_t dentry_stat = {
 };
 
 static DEFINE_PER_CPU(unsigned int, nr_dentry);
+static DEFINE_PER_CPU(unsigned int, nr_dentry_unused);
 
 #if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
 static int get_nr_dentry(void)
@@ -127,10 +131,20 @@ static int get_nr_dentry(void)
 	return sum < 0 ? 0 : sum;
 }
 
+static int get_nr_dentry_unused(void)
+{
+	int i;
+	int sum = 0;
+	for_each_possible_cpu(i)
+		sum += per_cpu(nr_dentry_unused, i);
+	return sum < 0 ? 0 : sum;
+}
+
 int proc_nr_dentry(ctl_table *table, int write, void __user *buffer,
 		   size_t *lenp, loff_t *ppos)
 {
 	dentry_stat.nr_dentry = get_nr_dentry();
+	dentry_stat.nr_unused = get_nr_dentry_unused();
 	return proc_dointvec(table, write, buffer, lenp, ppos);
 }
 #endif
@@ -225,46 +239,42 @@ static void dentry_unlink_inode(struct dentry * dentry)
 }
 
 /*
- * dentry_lru_(add|del|move_tail) must be called with d_lock held.
+ * A dentry's d_lru is either on the per-node LRU of its superblock, on a
+ * private dispose list (DCACHE_SHRINK_LIST set) while it is being pruned,
+ * or empty.  Dispose lists are only ever walked by their owner, but other
+ * CPUs may take a dentry off one when it is killed or reused, so all
+ * manipulation of them is serialised by dcache_shrink_lock.
+ *
+ * All of these must be called with d_lock held.
  */
-static void dentry_lru_add(struct dentry *dentry)
+static void d_shrink_add(struct dentry *dentry, struct list_head *list)
 {
-	if (list_empty(&dentry->d_lru)) {
-		spin_lock(&dcache_lru_lock);
-		list_add(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
-		dentry->d_sb->s_nr_dentry_unused++;
-		dentry_stat.nr_unused++;
-		spin_unlock(&dcache_lru_lock);
-	}
+	spin_lock(&dcache_shrink_lock);
+	list_add(&dentry->d_lru, list);
+	dentry->d_flags |= DCACHE_SHRINK_LIST;
+	spin_unlock(&dcache_shrink_lock);
 }
 
-static void __dentry_lru_del(struct dentry *dentry)
+static void d_shrink_del(struct dentry *dentry)
 {
+	spin_lock(&dcache_shrink_lock);
 	list_del_init(&dentry->d_lru);
-	dentry->d_sb->s_nr_dentry_unused--;
-	dentry_stat.nr_unused--;
+	dentry->d_flags &= ~DCACHE_SHRINK_LIST;
+	spin_unlock(&dcache_shrink_lock);
 }
 
-static void dentry_lru_del(struct dentry *dentry)
+static void dentry_lru_add(struct dentry *dentry)
 {
-	if (!list_empty(&dentry->d_lru)) {
-		spin_lock(&dcache_lru_lock);
-		__dentry_lru_del(dentry);
-		spin_unlock(&dcache_lru_lock);
-	}
+	if (list_lru_add(&dentry->d_sb->s_dentry_lru, &dentry->d_lru))
+		this_cpu_inc(nr_dentry_unused);
 }
 
-static void dentry_lru_move_tail(struct dentry *dentry)
+static void dentry_lru_del(struct dentry *dentry)
 {
-	spin_lock(&dcache_lru_lock);
-	if (list_empty(&dentry->d_lru)) {
-		list_add_tail(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
-		dentry->d_sb->s_nr_dentry_unused++;
-		dentry_stat.nr_unused++;
-	} else {
-		list_move_tail(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
-	}
-	spin_unlock(&dcache_lru_lock);
+	if (dentry->d_flags & DCACHE_SHRINK_LIST)
+		d_shrink_del(dentry);
+	else if (list_lru_del(&dentry->d_sb->s_dentry_lru, &dentry->d_lru))
+		this_cpu_dec(nr_dentry_unused);
 }
 
 /**
@@ -741,73 +751,87 @@ static void shrink_dentry_list(struct list_head *list)
 	rcu_read_unlock();
 }
 
-/**
- * __shrink_dcache_sb - shrink the dentry LRU on a given superblock
- * @sb:		superblock to shrink dentry LRU.
- * @count:	number of entries to prune
- * @flags:	flags to control the dentry processing
- *
- * If flags contains DCACHE_REFERENCED reference dentries will not be pruned.
+/*
+ * Called from list_lru_walk_node() with the node's LRU lock held.  We are
+ * inverting the usual d_lock -> LRU lock order here, so only trylock the
+ * dentry and skip it if that fails.
  */
-static void __shrink_dcache_sb(struct super_block *sb, int count, int flags)
+static enum lru_status dentry_lru_isolate(struct list_head *item,
+					  spinlock_t *lru_lock, void *arg)
 {
-	struct dentry *dentry;
-	LIST_HEAD(referenced);
-	LIST_HEAD(tmp);
+	struct list_head *dispose = arg;
+	struct dentry *dentry = container_of(item, struct dentry, d_lru);
 
-relock:
-	spin_lock(&dcache_lru_lock);
-	while (!list_empty(&sb->s_dentry_lru)) {
-		dentry = list_entry(sb->s_dentry_lru.prev,
-				struct dentry, d_lru);
-		BUG_ON(dentry->d_sb != sb);
-
-		if (!spin_trylock(&dentry->d_lock)) {
-			spin_unlock(&dcache_lru_lock);
-			cpu_relax();
-			goto relock;
-		}
+	if (!spin_trylock(&dentry->d_lock))
+		return LRU_SKIP;
 
-		/*
-		 * If we are honouring the DCACHE_REFERENCED flag and the
-		 * dentry has this flag set, don't free it.  Clear the flag
-		 * and put it back on the LRU.
-		 */
-		if (flags & DCACHE_REFERENCED &&
-				dentry->d_flags & DCACHE_REFERENCED) {
-			dentry->d_flags &= ~DCACHE_REFERENCED;
-			list_move(&dentry->d_lru, &referenced);
-			spin_unlock(&dentry->d_lock);
-		} else {
-			list_move_tail(&dentry->d_lru, &tmp);
-			spin_unlock(&dentry->d_lock);
-			if (!--count)
-				break;
-		}
-		cond_resched_lock(&dcache_lru_lock);
+	/*
+	 * We found an inuse dentry which was not removed from the LRU
+	 * because of laziness during lookup.  Do not free it - just keep
+	 * it off the LRU list.
+	 */
+	if (dentry->d_count) {
+		list_del_init(&dentry->d_lru);
+		this_cpu_dec(nr_dentry_unused);
+		spin_unlock(&dentry->d_lock);
+		return LRU_REMOVED;
+	}
+
+	/*
+	 * Recently used: clear the flag and give it another trip around
+	 * the LRU.
+	 */
+	if (dentry->d_flags & DCACHE_REFERENCED) {
+		dentry->d_flags &= ~DCACHE_REFERENCED;
+		spin_unlock(&dentry->d_lock);
+		return LRU_ROTATE;
 	}
-	if (!list_empty(&referenced))
-		list_splice(&referenced, &sb->s_dentry_lru);
-	spin_unlock(&dcache_lru_lock);
 
-	shrink_dentry_list(&tmp);
+	list_del_init(&dentry->d_lru);
+	this_cpu_dec(nr_dentry_unused);
+	d_shrink_add(dentry, dispose);
+	spin_unlock(&dentry->d_lock);
+	return LRU_REMOVED;
 }
 
 /**
  * prune_dcache_sb - shrink the dcache
  * @sb: superblock
  * @nr_to_scan: number of entries to try to free
+ * @nid: which node to scan for freeable entities
  *
  * Attempt to shrink the superblock dcache LRU by @nr_to_scan entries. This is
  * done when we need more memory an called from the superblock shrinker
- * function.
+ * function.  Only dentries whose memory lives on node @nid are considered.
  *
  * This function may fail to free any resources if all the dentries are in
  * use.
  */
-void prune_dcache_sb(struct super_block *sb, int nr_to_scan)
+void prune_dcache_sb(struct super_block *sb, int nr_to_scan, int nid)
 {
-	__shrink_dcache_sb(sb, nr_to_scan, DCACHE_REFERENCED);
+	LIST_HEAD(dispose);
+	unsigned long nr = nr_to_scan;
+
+	list_lru_walk_node(&sb->s_dentry_lru, nid, dentry_lru_isolate,
+			   &dispose, &nr);
+	shrink_dentry_list(&dispose);
+}
+
+static enum lru_status dentry_lru_isolate_shrink(struct list_head *item,
+						 spinlock_t *lru_lock, void *arg)
+{
+	struct list_head *dispose = arg;
+	struct dentry *dentry = container_of(item, struct dentry, d_lru);
+
+	/* see dentry_lru_isolate() for why this is a trylock */
+	if (!spin_trylock(&dentry->d_lock))
+		return LRU_SKIP;
+
+	list_del_init(&dentry->d_lru);
+	this_cpu_dec(nr_dentry_unused);
+	d_shrink_add(dentry, dispose);
+	spin_unlock(&dentry->d_lock);
+	return LRU_REMOVED;
 }
 
 /**
@@ -819,16 +843,14 @@ void prune_dcache_sb(struct super_block *sb, int nr_to_scan)
  */
 void shrink_dcache_sb(struct super_block *sb)
 {
-	LIST_HEAD(tmp);
+	while (list_lru_count(&sb->s_dentry_lru)) {
+		LIST_HEAD(dispose);
 
-	spin_lock(&dcache_lru_lock);
-	while (!list_empty(&sb->s_dentry_lru)) {
-		list_splice_init(&sb->s_dentry_lru, &tmp);
-		spin_unlock(&dcache_lru_lock);
-		shrink_dentry_list(&tmp);
-		spin_lock(&dcache_lru_lock);
+		list_lru_walk(&sb->s_dentry_lru, dentry_lru_isolate_shrink,
+			      &dispose, UINT_MAX);
+		shrink_dentry_list(&dispose);
+		cond_resched();
 	}
-	spin_unlock(&dcache_lru_lock);
 }
 EXPORT_SYMBOL(shrink_dcache_sb);
 
@@ -1048,19 +1070,19 @@ EXPORT_SYMBOL(have_submounts);
 
 /*
  * Search the dentry child list for the specified parent,
- * and move any unused dentries to the end of the unused
- * list for prune_dcache(). We descend to the next level
+ * and move any unused dentries to the @dispose list for
+ * shrink_dentry_list(). We descend to the next level
  * whenever the d_subdirs list is non-empty and continue
  * searching.
  *
  * It returns zero iff there are no unused children,
  * otherwise  it returns the number of children moved to
- * the end of the unused list. This may not be the total
+ * the dispose list. This may not be the total
  * number of unused children, because select_parent can
  * drop the lock and return early due to latency
  * constraints.
  */
-static int select_parent(struct dentry * parent)
+static int select_parent(struct dentry *parent, struct list_head *dispose)
 {
 	struct dentry *this_parent;
 	struct list_head *next;
@@ -1082,15 +1104,16 @@ resume:
 
 		spin_lock_nested(&dentry->d_lock, DENTRY_D_LOCK_NESTED);
 
-		/* 
-		 * move only zero ref count dentries to the end 
-		 * of the unused list for prune_dcache
+		/*
+		 * move only zero ref count dentries to the dispose list;
+		 * ones already on another shrinker's list are left to it.
 		 */
-		if (!dentry->d_count) {
-			dentry_lru_move_tail(dentry);
-			found++;
-		} else {
+		if (dentry->d_count) {
 			dentry_lru_del(dentry);
+		} else if (!(dentry->d_flags & DCACHE_SHRINK_LIST)) {
+			dentry_lru_del(dentry);
+			d_shrink_add(dentry, dispose);
+			found++;
 		}
 
 		/*
@@ -1152,11 +1175,13 @@ rename_retry:
  
 void shrink_dcache_parent(struct dentry * parent)
 {
-	struct super_block *sb = parent->d_sb;
-	int found;
+	for (;;) {
+		LIST_HEAD(dispose);
 
-	while ((found = select_parent(parent)) != 0)
-		__shrink_dcache_sb(sb, found, 0);
+		if (!select_parent(parent, &dispose))
+			break;
+		shrink_dentry_list(&dispose);
+	}
 }
 EXPORT_SYMBOL(shrink_dcache_parent);
 
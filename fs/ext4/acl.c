@@ -177,6 +177,35 @@ ext4_get_acl(struct inode *inode, int type)
 	return acl;
 }
 
+/*
+ * Called by ext4_iget() so that RCU path walk finds the access ACL of
+ * the inode cached and need not fall back to ref-walk to load it.  An
+ * inode without extended attributes has no ACL.  A directory whose
+ * attributes all live in the inode body has its ACL loaded now, which
+ * costs no I/O since the inode table block is already in memory.
+ */
+void
+ext4_precache_acl(struct inode *inode)
+{
+	struct posix_acl *acl;
+
+	if (!test_opt(inode->i_sb, POSIX_ACL))
+		return;
+
+	if (EXT4_I(inode)->i_file_acl)
+		return;
+	if (!ext4_test_inode_state(inode, EXT4_STATE_XATTR)) {
+		cache_no_acl(inode);
+		return;
+	}
+	if (!S_ISDIR(inode->i_mode))
+		return;
+
+	acl = ext4_get_acl(inode, ACL_TYPE_ACCESS);
+	if (!IS_ERR_OR_NULL(acl))
+		posix_acl_release(acl);
+}
+
 /*
  * Set the access or default ACL of an inode.
  *
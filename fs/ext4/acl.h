@@ -57,6 +57,7 @@ static inline int ext4_acl_count(size_t size)
 struct posix_acl *ext4_get_acl(struct inode *inode, int type);
 extern int ext4_acl_chmod(struct inode *);
 extern int ext4_init_acl(handle_t *, struct inode *, struct inode *);
+extern void ext4_precache_acl(struct inode *);
 
 #else  /* CONFIG_EXT4_FS_POSIX_ACL */
 #include <linux/sched.h>
@@ -73,5 +74,10 @@ ext4_init_acl(handle_t *handle, struct inode *inode, struct inode *dir)
 {
 	return 0;
 }
+
+static inline void
+ext4_precache_acl(struct inode *inode)
+{
+}
 #endif  /* CONFIG_EXT4_FS_POSIX_ACL */
 
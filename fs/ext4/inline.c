@@ -0,0 +1,1209 @@
+/*
+ * linux/fs/ext4/inline.c
+ *
+ * Small files and directories stored inside the inode.
+ *
+ * The first EXT4_MIN_INLINE_DATA_SIZE bytes live in i_block, the rest
+ * in the value of the "system.data" in-inode extended attribute.  The
+ * data is moved out to ordinary blocks as soon as it stops fitting.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/fs.h>
+#include <linux/pagemap.h>
+#include <linux/highmem.h>
+#include <linux/fiemap.h>
+#include <linux/slab.h>
+
+#include "ext4_jbd2.h"
+#include "ext4.h"
+#include "xattr.h"
+
+/*
+ * Inline data is protected by xattr_sem.  Like ext4_xattr_set_handle(),
+ * keep ext4_mark_inode_dirty() from trying to expand i_extra_isize
+ * while we hold it, since that would take xattr_sem again.
+ */
+static void ext4_inline_lock(struct inode *inode, int *no_expand)
+{
+	down_write(&EXT4_I(inode)->xattr_sem);
+	*no_expand = ext4_test_inode_state(inode, EXT4_STATE_NO_EXPAND);
+	ext4_set_inode_state(inode, EXT4_STATE_NO_EXPAND);
+}
+
+static void ext4_inline_unlock(struct inode *inode, int no_expand)
+{
+	if (!no_expand)
+		ext4_clear_inode_state(inode, EXT4_STATE_NO_EXPAND);
+	up_write(&EXT4_I(inode)->xattr_sem);
+}
+
+/*
+ * Look up "system.data" in the inode body.  @is->iloc must already be
+ * filled in; on return @is->s.not_found tells whether it exists.
+ */
+static int ext4_inline_find(struct inode *inode,
+			    struct ext4_xattr_ibody_find *is)
+{
+	struct ext4_xattr_info i = {
+		.name_index = EXT4_XATTR_INDEX_SYSTEM_DATA,
+		.name = EXT4_XATTR_SYSTEM_DATA,
+	};
+
+	is->s.base = NULL;
+	is->s.not_found = -ENODATA;
+	return ext4_xattr_ibody_find(inode, &i, is);
+}
+
+static unsigned int ext4_inline_value_size(struct ext4_xattr_ibody_find *is)
+{
+	if (is->s.not_found)
+		return 0;
+	return le32_to_cpu(is->s.here->e_value_size);
+}
+
+static void *ext4_inline_value(struct ext4_xattr_ibody_find *is)
+{
+	return is->s.base + le16_to_cpu(is->s.here->e_value_offs);
+}
+
+/* Room the "system.data" value could grow to in the inode body. */
+static int ext4_max_inline_value_size(struct inode *inode,
+				      struct ext4_xattr_ibody_find *is)
+{
+	struct ext4_xattr_entry *entry;
+	size_t min_offs;
+	int free;
+
+	if (!is->s.base)
+		return 0;
+
+	min_offs = is->s.end - is->s.base;
+	entry = is->s.first;
+	if (ext4_test_inode_state(inode, EXT4_STATE_XATTR)) {
+		for (; !IS_LAST_ENTRY(entry); entry = EXT4_XATTR_NEXT(entry)) {
+			if (!entry->e_value_block && entry->e_value_size) {
+				size_t offs = le16_to_cpu(entry->e_value_offs);
+				if (offs < min_offs)
+					min_offs = offs;
+			}
+		}
+	}
+	free = min_offs - ((void *)entry - is->s.base) - sizeof(__u32);
+	if (!is->s.not_found)
+		free += EXT4_XATTR_SIZE(ext4_inline_value_size(is));
+	else
+		free -= EXT4_XATTR_LEN(strlen(EXT4_XATTR_SYSTEM_DATA));
+
+	if (free < 0)
+		return 0;
+	return free & ~EXT4_XATTR_ROUND;
+}
+
+/*
+ * Largest file that can be kept inline right now, or 0 if this inode
+ * has no room for in-inode xattrs at all.
+ */
+int ext4_get_max_inline_size(struct inode *inode)
+{
+	struct ext4_xattr_ibody_find is;
+	int max = 0;
+
+	if (!EXT4_I(inode)->i_extra_isize)
+		return 0;
+	if (ext4_get_inode_loc(inode, &is.iloc))
+		return 0;
+
+	down_read(&EXT4_I(inode)->xattr_sem);
+	if (!ext4_inline_find(inode, &is))
+		max = EXT4_MIN_INLINE_DATA_SIZE +
+			ext4_max_inline_value_size(inode, &is);
+	up_read(&EXT4_I(inode)->xattr_sem);
+
+	brelse(is.iloc.bh);
+	return max;
+}
+
+static int ext4_read_inline_data(struct inode *inode, void *buffer,
+				 unsigned int len,
+				 struct ext4_xattr_ibody_find *is)
+{
+	struct ext4_inode *raw_inode = ext4_raw_inode(&is->iloc);
+	unsigned int cp_len, copied;
+
+	cp_len = min_t(unsigned int, len, EXT4_MIN_INLINE_DATA_SIZE);
+	memcpy(buffer, (void *)raw_inode->i_block, cp_len);
+	copied = cp_len;
+	len -= cp_len;
+
+	if (len) {
+		cp_len = min(len, ext4_inline_value_size(is));
+		if (cp_len)
+			memcpy(buffer + copied, ext4_inline_value(is), cp_len);
+		copied += cp_len;
+	}
+	return copied;
+}
+
+/* The caller has made sure [pos, pos + len) is within the inline space. */
+static void ext4_write_inline_data(struct ext4_xattr_ibody_find *is,
+				   const void *buffer, loff_t pos,
+				   unsigned int len)
+{
+	struct ext4_inode *raw_inode = ext4_raw_inode(&is->iloc);
+	unsigned int cp_len;
+
+	if (pos < EXT4_MIN_INLINE_DATA_SIZE) {
+		cp_len = min_t(unsigned int, len,
+			       EXT4_MIN_INLINE_DATA_SIZE - pos);
+		memcpy((void *)raw_inode->i_block + pos, buffer, cp_len);
+		buffer += cp_len;
+		pos += cp_len;
+		len -= cp_len;
+	}
+	if (len)
+		memcpy(ext4_inline_value(is) + pos - EXT4_MIN_INLINE_DATA_SIZE,
+		       buffer, len);
+}
+
+/*
+ * Resize (or create) the "system.data" value to @len bytes, keeping
+ * its current contents and zero-filling anything new.
+ */
+static int ext4_set_inline_value(handle_t *handle, struct inode *inode,
+				 struct ext4_xattr_ibody_find *is, size_t len)
+{
+	struct ext4_xattr_info i = {
+		.name_index = EXT4_XATTR_INDEX_SYSTEM_DATA,
+		.name = EXT4_XATTR_SYSTEM_DATA,
+		.value = "",
+		.value_len = len,
+	};
+	size_t old_len = ext4_inline_value_size(is);
+	void *value = NULL;
+	int error;
+
+	if (len) {
+		value = kzalloc(len, GFP_NOFS);
+		if (!value)
+			return -ENOMEM;
+		if (old_len)
+			memcpy(value, ext4_inline_value(is),
+			       min(old_len, len));
+		i.value = value;
+	}
+
+	error = ext4_xattr_ibody_set(handle, inode, &i, is);
+	kfree(value);
+	if (error)
+		return error;
+
+	/* Values may have been shuffled, look ours up again */
+	return ext4_inline_find(inode, is);
+}
+
+static int ext4_create_inline_data(handle_t *handle, struct inode *inode,
+				   struct ext4_xattr_ibody_find *is,
+				   unsigned int len)
+{
+	size_t value_len = 0;
+	int error;
+
+	if (len > EXT4_MIN_INLINE_DATA_SIZE)
+		value_len = len - EXT4_MIN_INLINE_DATA_SIZE;
+
+	error = ext4_set_inline_value(handle, inode, is, value_len);
+	if (error)
+		return error;
+
+	memset((void *)ext4_raw_inode(&is->iloc)->i_block, 0,
+	       EXT4_MIN_INLINE_DATA_SIZE);
+	ext4_clear_inode_flag(inode, EXT4_INODE_EXTENTS);
+	ext4_set_inode_flag(inode, EXT4_INODE_INLINE_DATA);
+	return 0;
+}
+
+/*
+ * Drop the inline data and leave an empty block-mapped inode behind.
+ * The caller has write access to @is->iloc.bh and marks it dirty.
+ */
+static int ext4_destroy_inline_data_nolock(handle_t *handle,
+					   struct inode *inode,
+					   struct ext4_xattr_ibody_find *is)
+{
+	struct ext4_xattr_info i = {
+		.name_index = EXT4_XATTR_INDEX_SYSTEM_DATA,
+		.name = EXT4_XATTR_SYSTEM_DATA,
+	};
+	int error;
+
+	if (!is->s.not_found) {
+		error = ext4_xattr_ibody_set(handle, inode, &i, is);
+		if (error)
+			return error;
+	}
+
+	memset((void *)ext4_raw_inode(&is->iloc)->i_block, 0,
+	       EXT4_MIN_INLINE_DATA_SIZE);
+	memset(EXT4_I(inode)->i_data, 0, EXT4_MIN_INLINE_DATA_SIZE);
+	ext4_clear_inode_flag(inode, EXT4_INODE_INLINE_DATA);
+	ext4_clear_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA);
+
+	if (EXT4_HAS_INCOMPAT_FEATURE(inode->i_sb,
+				      EXT4_FEATURE_INCOMPAT_EXTENTS)) {
+		ext4_set_inode_flag(inode, EXT4_INODE_EXTENTS);
+		ext4_ext_tree_init(handle, inode);
+	}
+	return 0;
+}
+
+/*
+ * Moving the inline data out failed after it had been dropped: put the
+ * @len bytes saved in @buf back into the inode.  Block allocation either
+ * maps the block holding them or fails without leaving anything behind,
+ * only an aborted journal can fail after that.
+ */
+static void ext4_restore_inline_data(handle_t *handle, struct inode *inode,
+				     void *buf, unsigned int len)
+{
+	struct ext4_xattr_ibody_find is;
+	int err, no_expand;
+
+	err = ext4_get_inode_loc(inode, &is.iloc);
+	if (err)
+		return;
+
+	err = ext4_journal_get_write_access(handle, is.iloc.bh);
+	ext4_inline_lock(inode, &no_expand);
+	if (!err)
+		err = ext4_inline_find(inode, &is);
+	if (!err)
+		err = ext4_create_inline_data(handle, inode, &is, len);
+	if (!err) {
+		ext4_write_inline_data(&is, buf, 0, len);
+		ext4_set_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA);
+	}
+	ext4_inline_unlock(inode, no_expand);
+	if (!err)
+		ext4_mark_iloc_dirty(handle, inode, &is.iloc);
+	else
+		brelse(is.iloc.bh);
+}
+
+/*
+ * Returns -EAGAIN if the inode lost its inline data before we got to
+ * it, in which case the caller reads the page the usual way.
+ */
+int ext4_readpage_inline(struct inode *inode, struct page *page)
+{
+	struct ext4_xattr_ibody_find is;
+	void *kaddr;
+	int len, ret = 0;
+
+	down_read(&EXT4_I(inode)->xattr_sem);
+	if (!ext4_has_inline_data(inode)) {
+		up_read(&EXT4_I(inode)->xattr_sem);
+		return -EAGAIN;
+	}
+
+	if (page->index) {
+		zero_user(page, 0, PAGE_CACHE_SIZE);
+		goto out_uptodate;
+	}
+
+	ret = ext4_get_inode_loc(inode, &is.iloc);
+	if (ret)
+		goto out;
+	ret = ext4_inline_find(inode, &is);
+	if (!ret) {
+		len = min_t(loff_t, PAGE_CACHE_SIZE, i_size_read(inode));
+		kaddr = kmap_atomic(page, KM_USER0);
+		len = ext4_read_inline_data(inode, kaddr, len, &is);
+		memset(kaddr + len, 0, PAGE_CACHE_SIZE - len);
+		flush_dcache_page(page);
+		kunmap_atomic(kaddr, KM_USER0);
+	}
+	brelse(is.iloc.bh);
+	if (ret)
+		goto out;
+out_uptodate:
+	SetPageUptodate(page);
+out:
+	up_read(&EXT4_I(inode)->xattr_sem);
+	unlock_page(page);
+	return ret;
+}
+
+/*
+ * Move the inline data of a regular file out to a block, through page
+ * 0 of the page cache.  Also used to just drop EXT4_STATE_MAY_INLINE_DATA
+ * from a file which never got inline data.
+ */
+int ext4_convert_inline_data(struct inode *inode)
+{
+	struct ext4_xattr_ibody_find is;
+	struct page *page;
+	handle_t *handle;
+	void *kaddr, *buf = NULL;
+	unsigned int size = 0;
+	int ret, no_expand;
+
+	if (!ext4_has_inline_data(inode)) {
+		ext4_clear_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA);
+		return 0;
+	}
+
+	handle = ext4_journal_start(inode, ext4_writepage_trans_blocks(inode));
+	if (IS_ERR(handle))
+		return PTR_ERR(handle);
+
+	page = grab_cache_page_write_begin(inode->i_mapping, 0, AOP_FLAG_NOFS);
+	if (!page) {
+		ret = -ENOMEM;
+		goto out_stop;
+	}
+
+	ret = ext4_get_inode_loc(inode, &is.iloc);
+	if (ret)
+		goto out_page;
+
+	ext4_inline_lock(inode, &no_expand);
+	if (!ext4_has_inline_data(inode)) {
+		/* Somebody beat us to it */
+		brelse(is.iloc.bh);
+		goto out_unlock;
+	}
+	ret = ext4_inline_find(inode, &is);
+	if (!ret)
+		ret = ext4_journal_get_write_access(handle, is.iloc.bh);
+	if (ret) {
+		brelse(is.iloc.bh);
+		goto out_unlock;
+	}
+
+	size = min_t(loff_t, i_size_read(inode),
+		     EXT4_MIN_INLINE_DATA_SIZE + ext4_inline_value_size(&is));
+	if (!PageUptodate(page)) {
+		kaddr = kmap_atomic(page, KM_USER0);
+		size = ext4_read_inline_data(inode, kaddr, size, &is);
+		memset(kaddr + size, 0, PAGE_CACHE_SIZE - size);
+		flush_dcache_page(page);
+		kunmap_atomic(kaddr, KM_USER0);
+		SetPageUptodate(page);
+	}
+
+	/* Keep a copy in case we cannot get a block for it */
+	if (size) {
+		buf = kmalloc(size, GFP_NOFS);
+		if (!buf) {
+			ret = -ENOMEM;
+			brelse(is.iloc.bh);
+			goto out_unlock;
+		}
+		kaddr = kmap_atomic(page, KM_USER0);
+		memcpy(buf, kaddr, size);
+		kunmap_atomic(kaddr, KM_USER0);
+	}
+
+	ret = ext4_destroy_inline_data_nolock(handle, inode, &is);
+	if (ret)
+		brelse(is.iloc.bh);
+	else
+		ret = ext4_mark_iloc_dirty(handle, inode, &is.iloc);
+out_unlock:
+	ext4_inline_unlock(inode, no_expand);
+
+	if (!ret && size) {
+		ret = ext4_block_write_page(handle, inode, page, size);
+		if (ret) {
+			/*
+			 * ENOSPC or EDQUOT: the page may have been zeroed
+			 * under the failed buffers, so refill it as well.
+			 */
+			kaddr = kmap_atomic(page, KM_USER0);
+			memcpy(kaddr, buf, size);
+			flush_dcache_page(page);
+			kunmap_atomic(kaddr, KM_USER0);
+			ext4_restore_inline_data(handle, inode, buf, size);
+		}
+	}
+	kfree(buf);
+out_page:
+	unlock_page(page);
+	page_cache_release(page);
+out_stop:
+	ext4_journal_stop(handle);
+	return ret;
+}
+
+/*
+ * Called from ->write_begin.  Returns 1 with the page locked and the
+ * handle still running if the write can go into the inode, 0 if the
+ * caller should do an ordinary block write (any inline data has been
+ * moved out by then), or a negative error.
+ */
+int ext4_try_to_write_inline_data(struct address_space *mapping,
+				  struct inode *inode, loff_t pos,
+				  unsigned len, unsigned flags,
+				  struct page **pagep)
+{
+	struct ext4_xattr_ibody_find is;
+	struct page *page;
+	handle_t *handle;
+	void *kaddr;
+	unsigned int size;
+	int ret, no_expand;
+
+	if (!ext4_has_inline_data(inode) && inode->i_size)
+		return ext4_convert_inline_data(inode);
+
+	handle = ext4_journal_start(inode, 1);
+	if (IS_ERR(handle))
+		return PTR_ERR(handle);
+
+	page = grab_cache_page_write_begin(mapping, 0, flags | AOP_FLAG_NOFS);
+	if (!page) {
+		ret = -ENOMEM;
+		goto out_stop;
+	}
+
+	ret = ext4_get_inode_loc(inode, &is.iloc);
+	if (ret)
+		goto out_page;
+
+	ext4_inline_lock(inode, &no_expand);
+	ret = ext4_inline_find(inode, &is);
+	if (ret)
+		goto out_unlock;
+
+	if (pos + len > EXT4_MIN_INLINE_DATA_SIZE +
+			ext4_max_inline_value_size(inode, &is) ||
+	    (!ext4_has_inline_data(inode) && inode->i_size)) {
+		ret = -ENOSPC;
+		goto out_unlock;
+	}
+
+	ret = ext4_journal_get_write_access(handle, is.iloc.bh);
+	if (ret)
+		goto out_unlock;
+
+	if (!ext4_has_inline_data(inode))
+		ret = ext4_create_inline_data(handle, inode, &is, pos + len);
+	else if (pos + len > EXT4_MIN_INLINE_DATA_SIZE +
+			     ext4_inline_value_size(&is))
+		ret = ext4_set_inline_value(handle, inode, &is, pos + len -
+					    EXT4_MIN_INLINE_DATA_SIZE);
+	if (ret)
+		goto out_unlock;
+
+	if (!PageUptodate(page)) {
+		size = min_t(loff_t, PAGE_CACHE_SIZE, i_size_read(inode));
+		kaddr = kmap_atomic(page, KM_USER0);
+		size = ext4_read_inline_data(inode, kaddr, size, &is);
+		memset(kaddr + size, 0, PAGE_CACHE_SIZE - size);
+		flush_dcache_page(page);
+		kunmap_atomic(kaddr, KM_USER0);
+		SetPageUptodate(page);
+	}
+
+	ret = ext4_mark_iloc_dirty(handle, inode, &is.iloc);
+	ext4_inline_unlock(inode, no_expand);
+	if (ret)
+		goto out_page;
+
+	*pagep = page;
+	return 1;
+
+out_unlock:
+	ext4_inline_unlock(inode, no_expand);
+	brelse(is.iloc.bh);
+out_page:
+	unlock_page(page);
+	page_cache_release(page);
+out_stop:
+	ext4_journal_stop(handle);
+
+	if (ret == -ENOSPC)
+		return ext4_convert_inline_data(inode);
+	return ret;
+}
+
+/*
+ * ->write_end for a write set up by ext4_try_to_write_inline_data().
+ * The page itself stays clean; the inode block carries the data.
+ */
+int ext4_write_inline_data_end(struct inode *inode, loff_t pos, unsigned len,
+			       unsigned copied, struct page *page)
+{
+	handle_t *handle = ext4_journal_current_handle();
+	struct ext4_xattr_ibody_find is;
+	void *kaddr;
+	int ret, ret2, no_expand;
+
+	if (unlikely(copied < len) && !PageUptodate(page))
+		copied = 0;
+
+	ret = ext4_get_inode_loc(inode, &is.iloc);
+	if (ret)
+		goto out_page;
+	ret = ext4_journal_get_write_access(handle, is.iloc.bh);
+	if (ret) {
+		brelse(is.iloc.bh);
+		goto out_page;
+	}
+
+	ext4_inline_lock(inode, &no_expand);
+	ret = ext4_inline_find(inode, &is);
+	if (!ret) {
+		kaddr = kmap_atomic(page, KM_USER0);
+		ext4_write_inline_data(&is, kaddr + pos, pos, copied);
+		kunmap_atomic(kaddr, KM_USER0);
+	}
+	ext4_inline_unlock(inode, no_expand);
+
+	if (!ret && pos + copied > inode->i_size) {
+		i_size_write(inode, pos + copied);
+		ext4_update_i_disksize(inode, pos + copied);
+	}
+	if (ret)
+		brelse(is.iloc.bh);
+	else
+		ret = ext4_mark_iloc_dirty(handle, inode, &is.iloc);
+out_page:
+	unlock_page(page);
+	page_cache_release(page);
+
+	ret2 = ext4_journal_stop(handle);
+	if (!ret)
+		ret = ret2;
+	return ret ? ret : copied;
+}
+
+/*
+ * Shrink the inline data to i_size.  Returns 1 if the inode was dealt
+ * with, 0 if it turned out not to have inline data after all.
+ */
+int ext4_inline_data_truncate(struct inode *inode)
+{
+	struct ext4_xattr_ibody_find is;
+	struct ext4_inode *raw_inode;
+	handle_t *handle;
+	loff_t i_size = inode->i_size;
+	size_t value_len = 0;
+	int err, no_expand, done = 1;
+
+	handle = ext4_journal_start(inode, 3);
+	if (IS_ERR(handle)) {
+		ext4_std_error(inode->i_sb, PTR_ERR(handle));
+		return 1;
+	}
+
+	err = ext4_get_inode_loc(inode, &is.iloc);
+	if (err)
+		goto out_stop;
+
+	ext4_inline_lock(inode, &no_expand);
+	if (!ext4_has_inline_data(inode)) {
+		ext4_inline_unlock(inode, no_expand);
+		brelse(is.iloc.bh);
+		done = 0;
+		goto out_stop;
+	}
+
+	err = ext4_inline_find(inode, &is);
+	if (!err)
+		err = ext4_journal_get_write_access(handle, is.iloc.bh);
+	if (err)
+		goto out_unlock;
+
+	raw_inode = ext4_raw_inode(&is.iloc);
+	if (i_size < EXT4_MIN_INLINE_DATA_SIZE)
+		memset((void *)raw_inode->i_block + i_size, 0,
+		       EXT4_MIN_INLINE_DATA_SIZE - i_size);
+	else
+		value_len = i_size - EXT4_MIN_INLINE_DATA_SIZE;
+	if (!is.s.not_found && value_len < ext4_inline_value_size(&is))
+		err = ext4_set_inline_value(handle, inode, &is, value_len);
+out_unlock:
+	ext4_inline_unlock(inode, no_expand);
+
+	if (err) {
+		brelse(is.iloc.bh);
+		goto out_stop;
+	}
+	EXT4_I(inode)->i_disksize = i_size;
+	inode->i_mtime = inode->i_ctime = ext4_current_time(inode);
+	err = ext4_mark_iloc_dirty(handle, inode, &is.iloc);
+	if (inode->i_nlink)
+		ext4_orphan_del(handle, inode);
+out_stop:
+	if (err)
+		ext4_std_error(inode->i_sb, err);
+	ext4_journal_stop(handle);
+	return done;
+}
+
+int ext4_inline_data_fiemap(struct inode *inode,
+			    struct fiemap_extent_info *fieinfo)
+{
+	__u64 physical;
+	__u32 flags = FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_NOT_ALIGNED |
+		      FIEMAP_EXTENT_LAST;
+	struct ext4_iloc iloc;
+	int error;
+
+	error = ext4_get_inode_loc(inode, &iloc);
+	if (error)
+		return error;
+
+	physical = (__u64)iloc.bh->b_blocknr << inode->i_sb->s_blocksize_bits;
+	physical += iloc.offset + offsetof(struct ext4_inode, i_block);
+	brelse(iloc.bh);
+
+	error = fiemap_fill_next_extent(fieinfo, 0, physical,
+					i_size_read(inode), flags);
+	return error < 0 ? error : 0;
+}
+
+/*
+ * Inline directories.  The parent's inode number takes the first
+ * EXT4_INLINE_DOTDOT_SIZE bytes of i_block and the rest of i_block is
+ * one run of directory entries, the xattr value another.
+ */
+int ext4_try_create_inline_dir(handle_t *handle, struct inode *parent,
+			       struct inode *inode)
+{
+	struct ext4_xattr_ibody_find is;
+	struct ext4_dir_entry_2 *de;
+	struct ext4_inode *raw_inode;
+	int err, no_expand;
+
+	err = ext4_get_inode_loc(inode, &is.iloc);
+	if (err)
+		return err;
+	err = ext4_journal_get_write_access(handle, is.iloc.bh);
+	if (err) {
+		brelse(is.iloc.bh);
+		return err;
+	}
+
+	ext4_inline_lock(inode, &no_expand);
+	err = ext4_inline_find(inode, &is);
+	if (!err)
+		err = ext4_create_inline_data(handle, inode, &is,
+					      EXT4_MIN_INLINE_DATA_SIZE);
+	if (err) {
+		ext4_inline_unlock(inode, no_expand);
+		brelse(is.iloc.bh);
+		if (err == -ENOSPC)
+			ext4_clear_inode_state(inode,
+					       EXT4_STATE_MAY_INLINE_DATA);
+		return err;
+	}
+
+	raw_inode = ext4_raw_inode(&is.iloc);
+	*(__le32 *)raw_inode->i_block = cpu_to_le32(parent->i_ino);
+	de = (void *)raw_inode->i_block + EXT4_INLINE_DOTDOT_SIZE;
+	de->inode = 0;
+	de->rec_len = ext4_rec_len_to_disk(EXT4_MIN_INLINE_DATA_SIZE -
+					   EXT4_INLINE_DOTDOT_SIZE,
+					   inode->i_sb->s_blocksize);
+	inode->i_size = EXT4_I(inode)->i_disksize = EXT4_MIN_INLINE_DATA_SIZE;
+	ext4_inline_unlock(inode, no_expand);
+
+	return ext4_mark_iloc_dirty(handle, inode, &is.iloc);
+}
+
+/*
+ * Returns the inode table block holding the directory, with *res_dir
+ * pointing into it, or NULL if the name isn't there.
+ */
+struct buffer_head *ext4_find_inline_entry(struct inode *dir,
+					   const struct qstr *d_name,
+					   struct ext4_dir_entry_2 **res_dir)
+{
+	struct ext4_xattr_ibody_find is;
+	unsigned int value_len;
+	void *inline_start;
+	int ret;
+
+	if (ext4_get_inode_loc(dir, &is.iloc))
+		return NULL;
+
+	down_read(&EXT4_I(dir)->xattr_sem);
+	ret = ext4_inline_find(dir, &is);
+	if (ret)
+		goto out;
+
+	inline_start = (void *)ext4_raw_inode(&is.iloc)->i_block +
+		       EXT4_INLINE_DOTDOT_SIZE;
+	ret = ext4_search_dir(is.iloc.bh, inline_start,
+			      EXT4_MIN_INLINE_DATA_SIZE -
+			      EXT4_INLINE_DOTDOT_SIZE,
+			      dir, d_name, 0, res_dir);
+	if (ret)
+		goto out;
+
+	value_len = ext4_inline_value_size(&is);
+	if (value_len)
+		ret = ext4_search_dir(is.iloc.bh, ext4_inline_value(&is),
+				      value_len, dir, d_name, 0, res_dir);
+out:
+	up_read(&EXT4_I(dir)->xattr_sem);
+	if (ret == 1)
+		return is.iloc.bh;
+	brelse(is.iloc.bh);
+	return NULL;
+}
+
+static int ext4_add_dirent_to_inline(struct dentry *dentry,
+				     struct inode *inode,
+				     struct buffer_head *bh,
+				     void *inline_start, int inline_size)
+{
+	struct inode *dir = dentry->d_parent->d_inode;
+	struct ext4_dir_entry_2 *de;
+	int err;
+
+	err = ext4_find_dest_de(dir, inode, bh, inline_start, inline_size,
+				dentry->d_name.name, dentry->d_name.len, &de);
+	if (err)
+		return err;
+
+	ext4_insert_dentry(dir, inode, de, dentry->d_name.name,
+			   dentry->d_name.len);
+	return 0;
+}
+
+/*
+ * Returns -ENOSPC if the entry doesn't fit in the inode even after
+ * growing the xattr part; the caller then converts the directory.
+ */
+int ext4_try_add_inline_entry(handle_t *handle, struct dentry *dentry,
+			      struct inode *inode)
+{
+	struct inode *dir = dentry->d_parent->d_inode;
+	unsigned int blocksize = dir->i_sb->s_blocksize;
+	struct ext4_xattr_ibody_find is;
+	struct ext4_dir_entry_2 *de;
+	unsigned int old_len, new_len, rlen;
+	void *inline_start, *limit;
+	int err, no_expand;
+
+	err = ext4_get_inode_loc(dir, &is.iloc);
+	if (err)
+		return err;
+	err = ext4_journal_get_write_access(handle, is.iloc.bh);
+	if (err) {
+		brelse(is.iloc.bh);
+		return err;
+	}
+
+	ext4_inline_lock(dir, &no_expand);
+	err = ext4_inline_find(dir, &is);
+	if (err)
+		goto out;
+
+	inline_start = (void *)ext4_raw_inode(&is.iloc)->i_block +
+		       EXT4_INLINE_DOTDOT_SIZE;
+	err = ext4_add_dirent_to_inline(dentry, inode, is.iloc.bh,
+					inline_start,
+					EXT4_MIN_INLINE_DATA_SIZE -
+					EXT4_INLINE_DOTDOT_SIZE);
+	if (err != -ENOSPC)
+		goto out;
+
+	old_len = ext4_inline_value_size(&is);
+	if (old_len) {
+		err = ext4_add_dirent_to_inline(dentry, inode, is.iloc.bh,
+						ext4_inline_value(&is),
+						old_len);
+		if (err != -ENOSPC)
+			goto out;
+	}
+
+	/* Grow the xattr part by enough to hold the new entry */
+	new_len = old_len + EXT4_DIR_REC_LEN(dentry->d_name.len);
+	if (new_len > ext4_max_inline_value_size(dir, &is))
+		goto out;
+	err = ext4_set_inline_value(handle, dir, &is, new_len);
+	if (err)
+		goto out;
+
+	inline_start = ext4_inline_value(&is);
+	limit = inline_start + old_len;
+	if (!old_len) {
+		de = inline_start;
+		de->inode = 0;
+		de->rec_len = ext4_rec_len_to_disk(new_len, blocksize);
+	} else {
+		/* Stretch the last entry over the new space */
+		de = inline_start;
+		for (;;) {
+			if (ext4_check_dir_entry(dir, NULL, de, is.iloc.bh,
+						 inline_start, old_len,
+						 (void *)de - inline_start)) {
+				err = -EIO;
+				goto out;
+			}
+			rlen = ext4_rec_len_from_disk(de->rec_len, blocksize);
+			if ((void *)de + rlen >= limit)
+				break;
+			de = (void *)de + rlen;
+		}
+		de->rec_len = ext4_rec_len_to_disk(rlen + new_len - old_len,
+						   blocksize);
+	}
+	dir->i_size = EXT4_I(dir)->i_disksize =
+		EXT4_MIN_INLINE_DATA_SIZE + new_len;
+
+	err = ext4_add_dirent_to_inline(dentry, inode, is.iloc.bh,
+					inline_start, new_len);
+out:
+	ext4_inline_unlock(dir, no_expand);
+	if (err) {
+		if (err != -ENOSPC)
+			ext4_std_error(dir->i_sb, err);
+		brelse(is.iloc.bh);
+		return err;
+	}
+
+	dir->i_mtime = dir->i_ctime = ext4_current_time(dir);
+	dir->i_version++;
+	return ext4_mark_iloc_dirty(handle, dir, &is.iloc);
+}
+
+/*
+ * Move an inline directory into a freshly allocated block, putting
+ * real "." and ".." entries in front of the inline ones.
+ */
+int ext4_convert_inline_dir(handle_t *handle, struct inode *dir)
+{
+	unsigned int blocksize = dir->i_sb->s_blocksize;
+	struct ext4_xattr_ibody_find is;
+	struct ext4_dir_entry_2 *de, *last = NULL;
+	struct buffer_head *bh;
+	unsigned int inline_size, offset;
+	void *buf, *limit;
+	int err, no_expand;
+
+	err = ext4_get_inode_loc(dir, &is.iloc);
+	if (err)
+		return err;
+	err = ext4_journal_get_write_access(handle, is.iloc.bh);
+	if (err) {
+		brelse(is.iloc.bh);
+		return err;
+	}
+
+	ext4_inline_lock(dir, &no_expand);
+	err = ext4_inline_find(dir, &is);
+	if (err)
+		goto out_unlock;
+
+	inline_size = EXT4_MIN_INLINE_DATA_SIZE + ext4_inline_value_size(&is);
+	buf = kmalloc(inline_size, GFP_NOFS);
+	if (!buf) {
+		err = -ENOMEM;
+		goto out_unlock;
+	}
+	ext4_read_inline_data(dir, buf, inline_size, &is);
+
+	err = ext4_destroy_inline_data_nolock(handle, dir, &is);
+	if (err)
+		goto out_free;
+	ext4_inline_unlock(dir, no_expand);
+	err = ext4_mark_iloc_dirty(handle, dir, &is.iloc);
+	if (err)
+		goto out_restore;
+
+	dir->i_size = EXT4_I(dir)->i_disksize = 0;
+	bh = ext4_bread(handle, dir, 0, 1, &err);
+	if (!bh)
+		goto out_restore;
+	BUFFER_TRACE(bh, "get_write_access");
+	err = ext4_journal_get_write_access(handle, bh);
+	if (err) {
+		brelse(bh);
+		goto out_restore;
+	}
+
+	de = ext4_init_dot_dotdot(dir, (struct ext4_dir_entry_2 *)bh->b_data,
+				  blocksize, le32_to_cpu(*(__le32 *)buf), 1);
+	limit = (void *)de + inline_size - EXT4_INLINE_DOTDOT_SIZE;
+	memcpy(de, buf + EXT4_INLINE_DOTDOT_SIZE,
+	       inline_size - EXT4_INLINE_DOTDOT_SIZE);
+	while ((void *)de < limit) {
+		offset = (void *)de - (void *)bh->b_data;
+		if (ext4_check_dir_entry(dir, NULL, de, bh, bh->b_data,
+					 blocksize, offset)) {
+			err = -EIO;
+			break;
+		}
+		last = de;
+		de = (void *)de + ext4_rec_len_from_disk(de->rec_len,
+							 blocksize);
+	}
+	if (!err && last)
+		last->rec_len = ext4_rec_len_to_disk(blocksize -
+				((void *)last - (void *)bh->b_data), blocksize);
+	if (!err) {
+		dir->i_size = EXT4_I(dir)->i_disksize = blocksize;
+		BUFFER_TRACE(bh, "call ext4_handle_dirty_metadata");
+		err = ext4_handle_dirty_metadata(handle, dir, bh);
+		if (!err)
+			err = ext4_mark_inode_dirty(handle, dir);
+	}
+	brelse(bh);
+	kfree(buf);
+	return err;
+
+out_restore:
+	/*
+	 * Couldn't get a block: put the entries back where they were so
+	 * the directory stays intact.
+	 */
+	dir->i_size = EXT4_I(dir)->i_disksize = inline_size;
+	ext4_restore_inline_data(handle, dir, buf, inline_size);
+	kfree(buf);
+	return err;
+
+out_free:
+	kfree(buf);
+out_unlock:
+	ext4_inline_unlock(dir, no_expand);
+	brelse(is.iloc.bh);
+	return err;
+}
+
+int ext4_delete_inline_entry(handle_t *handle, struct inode *dir,
+			     struct ext4_dir_entry_2 *de_del,
+			     struct buffer_head *bh)
+{
+	struct ext4_xattr_ibody_find is;
+	void *inline_start;
+	int inline_size, err, no_expand;
+
+	err = ext4_get_inode_loc(dir, &is.iloc);
+	if (err)
+		return err;
+	BUFFER_TRACE(is.iloc.bh, "get_write_access");
+	err = ext4_journal_get_write_access(handle, is.iloc.bh);
+	if (err)
+		goto out;
+
+	ext4_inline_lock(dir, &no_expand);
+	err = ext4_inline_find(dir, &is);
+	if (!err) {
+		inline_start = (void *)ext4_raw_inode(&is.iloc)->i_block;
+		if ((void *)de_del >= inline_start &&
+		    (void *)de_del < inline_start + EXT4_MIN_INLINE_DATA_SIZE) {
+			inline_start += EXT4_INLINE_DOTDOT_SIZE;
+			inline_size = EXT4_MIN_INLINE_DATA_SIZE -
+				      EXT4_INLINE_DOTDOT_SIZE;
+		} else {
+			inline_start = ext4_inline_value(&is);
+			inline_size = ext4_inline_value_size(&is);
+		}
+		err = ext4_generic_delete_entry(handle, dir, de_del,
+						is.iloc.bh, inline_start,
+						inline_size);
+	}
+	ext4_inline_unlock(dir, no_expand);
+	if (err)
+		goto out;
+
+	BUFFER_TRACE(is.iloc.bh, "call ext4_mark_iloc_dirty");
+	err = ext4_mark_iloc_dirty(handle, dir, &is.iloc);
+	if (unlikely(err))
+		ext4_std_error(dir->i_sb, err);
+	return err;
+out:
+	brelse(is.iloc.bh);
+	if (err != -ENOENT && err != -EIO)
+		ext4_std_error(dir->i_sb, err);
+	return err;
+}
+
+static int ext4_inline_run_empty(struct inode *dir, struct buffer_head *bh,
+				 void *start, int size)
+{
+	struct ext4_dir_entry_2 *de;
+	int offset;
+
+	for (offset = 0; offset < size;
+	     offset += ext4_rec_len_from_disk(de->rec_len,
+					      dir->i_sb->s_blocksize)) {
+		de = start + offset;
+		if (ext4_check_dir_entry(dir, NULL, de, bh, start, size,
+					 offset))
+			return 1;
+		if (le32_to_cpu(de->inode))
+			return 0;
+	}
+	return 1;
+}
+
+/* Returns 1 if the directory is empty, 0 otherwise; see empty_dir(). */
+int empty_inline_dir(struct inode *dir)
+{
+	struct ext4_xattr_ibody_find is;
+	void *inline_start;
+	int ret = 1;
+
+	if (ext4_get_inode_loc(dir, &is.iloc)) {
+		EXT4_ERROR_INODE(dir, "error reading inline directory");
+		return 1;
+	}
+
+	down_read(&EXT4_I(dir)->xattr_sem);
+	if (ext4_inline_find(dir, &is))
+		goto out;
+
+	inline_start = (void *)ext4_raw_inode(&is.iloc)->i_block;
+	if (!le32_to_cpu(*(__le32 *)inline_start)) {
+		ext4_warning(dir->i_sb,
+			     "bad inline directory (dir #%lu) - no `..'",
+			     dir->i_ino);
+		goto out;
+	}
+	ret = ext4_inline_run_empty(dir, is.iloc.bh,
+				    inline_start + EXT4_INLINE_DOTDOT_SIZE,
+				    EXT4_MIN_INLINE_DATA_SIZE -
+				    EXT4_INLINE_DOTDOT_SIZE);
+	if (ret && ext4_inline_value_size(&is))
+		ret = ext4_inline_run_empty(dir, is.iloc.bh,
+					    ext4_inline_value(&is),
+					    ext4_inline_value_size(&is));
+out:
+	up_read(&EXT4_I(dir)->xattr_sem);
+	brelse(is.iloc.bh);
+	return ret;
+}
+
+/*
+ * readdir for inline directories.  f_pos follows the layout the
+ * directory would have as a block: "." at 0, ".." right after it and
+ * the inline entries after that, so positions stay valid if the
+ * directory is converted between calls.
+ */
+int ext4_read_inline_dir(struct file *filp, void *dirent, filldir_t filldir)
+{
+	struct inode *inode = filp->f_path.dentry->d_inode;
+	struct super_block *sb = inode->i_sb;
+	struct ext4_xattr_ibody_find is;
+	struct ext4_dir_entry_2 *de;
+	unsigned int dotdot_offset, dotdot_size, extra_offset, extra_size;
+	unsigned int inline_size, i;
+	void *buf;
+	int error;
+
+	error = ext4_get_inode_loc(inode, &is.iloc);
+	if (error)
+		return error;
+
+	down_read(&EXT4_I(inode)->xattr_sem);
+	error = ext4_inline_find(inode, &is);
+	if (error) {
+		up_read(&EXT4_I(inode)->xattr_sem);
+		brelse(is.iloc.bh);
+		return error;
+	}
+	inline_size = EXT4_MIN_INLINE_DATA_SIZE + ext4_inline_value_size(&is);
+	buf = kmalloc(inline_size, GFP_NOFS);
+	if (buf)
+		ext4_read_inline_data(inode, buf, inline_size, &is);
+	up_read(&EXT4_I(inode)->xattr_sem);
+	if (!buf) {
+		brelse(is.iloc.bh);
+		return -ENOMEM;
+	}
+
+	dotdot_offset = EXT4_DIR_REC_LEN(1);
+	dotdot_size = dotdot_offset + EXT4_DIR_REC_LEN(2);
+	extra_offset = dotdot_size - EXT4_INLINE_DOTDOT_SIZE;
+	extra_size = extra_offset + inline_size;
+
+	/*
+	 * If the directory changed since the last call, walk forward to
+	 * the first entry boundary at or after f_pos.
+	 */
+	if (filp->f_version != inode->i_version) {
+		for (i = 0; i < extra_size && i < filp->f_pos;) {
+			if (!i) {
+				i = dotdot_offset;
+				continue;
+			} else if (i == dotdot_offset) {
+				i = dotdot_size;
+				continue;
+			}
+			de = buf + i - extra_offset;
+			if (ext4_rec_len_from_disk(de->rec_len,
+					sb->s_blocksize) < EXT4_DIR_REC_LEN(1))
+				break;
+			i += ext4_rec_len_from_disk(de->rec_len,
+						    sb->s_blocksize);
+		}
+		filp->f_pos = i;
+		filp->f_version = inode->i_version;
+	}
+
+	error = 0;
+	while (!error && filp->f_pos < extra_size) {
+		if (filp->f_pos == 0) {
+			error = filldir(dirent, ".", 1, 0, inode->i_ino,
+					DT_DIR);
+			if (error)
+				break;
+			filp->f_pos = dotdot_offset;
+			continue;
+		}
+		if (filp->f_pos == dotdot_offset) {
+			error = filldir(dirent, "..", 2, dotdot_offset,
+					le32_to_cpu(*(__le32 *)buf), DT_DIR);
+			if (error)
+				break;
+			filp->f_pos = dotdot_size;
+			continue;
+		}
+
+		de = buf + filp->f_pos - extra_offset;
+		if (ext4_check_dir_entry(inode, filp, de, is.iloc.bh, buf,
+					 inline_size,
+					 filp->f_pos - extra_offset))
+			break;
+		if (le32_to_cpu(de->inode)) {
+			error = filldir(dirent, de->name, de->name_len,
+					filp->f_pos, le32_to_cpu(de->inode),
+					get_dtype(sb, de->file_type));
+			if (error)
+				break;
+		}
+		filp->f_pos += ext4_rec_len_from_disk(de->rec_len,
+						      sb->s_blocksize);
+	}
+
+	kfree(buf);
+	brelse(is.iloc.bh);
+	return 0;
+}
+
+/*
+ * Returns the inode table block of an inline directory with *parent
+ * pointing at its ".." inode number, for rename and NFS.
+ */
+struct buffer_head *ext4_get_inline_dotdot(struct inode *dir,
+					   __le32 **parent, int *err)
+{
+	struct ext4_iloc iloc;
+
+	*err = ext4_get_inode_loc(dir, &iloc);
+	if (*err)
+		return NULL;
+
+	*parent = (__le32 *)ext4_raw_inode(&iloc)->i_block;
+	return iloc.bh;
+}
@@ -760,6 +760,15 @@ static int ext4_write_begin(struct file *file, struct address_space *mapping,
 	from = pos & (PAGE_CACHE_SIZE - 1);
 	to = from + len;
 
+	if (ext4_test_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA)) {
+		ret = ext4_try_to_write_inline_data(mapping, inode, pos, len,
+						    flags, pagep);
+		if (ret < 0)
+			goto out;
+		if (ret == 1)
+			return 0;
+	}
+
 retry:
 	handle = ext4_journal_start(inode, needed_blocks);
 	if (IS_ERR(handle)) {
@@ -895,7 +904,11 @@ static int ext4_ordered_write_end(struct file *file,
 	int ret = 0, ret2;
 
 	trace_ext4_ordered_write_end(inode, pos, len, copied);
-	ret = ext4_jbd2_file_inode(handle, inode);
+	if (ext4_has_inline_data(inode))
+		return ext4_write_inline_data_end(inode, pos, len, copied,
+						  page);
+
+	ret = ext4_jbd2_inode_add_write(handle, inode, pos, copied);
 
 	if (ret == 0) {
 		ret2 = ext4_generic_write_end(file, mapping, pos, len, copied,
@@ -939,6 +952,10 @@ static int ext4_writeback_write_end(struct file *file,
 	int ret = 0, ret2;
 
 	trace_ext4_writeback_write_end(inode, pos, len, copied);
+	if (ext4_has_inline_data(inode))
+		return ext4_write_inline_data_end(inode, pos, len, copied,
+						  page);
+
 	ret2 = ext4_generic_write_end(file, mapping, pos, len, copied,
 							page, fsdata);
 	copied = ret2;
@@ -983,6 +1000,10 @@ static int ext4_journalled_write_end(struct file *file,
 	loff_t new_i_size;
 
 	trace_ext4_journalled_write_end(inode, pos, len, copied);
+	if (ext4_has_inline_data(inode))
+		return ext4_write_inline_data_end(inode, pos, len, copied,
+						  page);
+
 	from = pos & (PAGE_CACHE_SIZE - 1);
 	to = from + len;
 
@@ -1474,7 +1495,9 @@ static void mpage_da_map_and_submit(struct mpage_da_data *mpd)
 	}
 
 	if (ext4_should_order_data(mpd->inode)) {
-		err = ext4_jbd2_file_inode(handle, mpd->inode);
+		err = ext4_jbd2_inode_add_write(handle, mpd->inode,
+				(loff_t)next << mpd->inode->i_blkbits,
+				(loff_t)blks << mpd->inode->i_blkbits);
 		if (err)
 			/* This only happens if the journal is aborted */
 			return;
@@ -2246,6 +2269,44 @@ static int ext4_nonda_switch(struct super_block *sb)
 	return 0;
 }
 
+/*
+ * Give the first @len bytes of a locked, uptodate page blocks and dirty
+ * them as a buffered write would.  Used when inline data is moved out
+ * of the inode.
+ */
+int ext4_block_write_page(handle_t *handle, struct inode *inode,
+			  struct page *page, unsigned len)
+{
+	int ret;
+
+	if (ext4_should_journal_data(inode)) {
+		ret = __block_write_begin(page, 0, len, ext4_get_block);
+		if (!ret)
+			ret = walk_page_buffers(handle, page_buffers(page), 0,
+					len, NULL, do_journal_get_write_access);
+		if (!ret)
+			ret = walk_page_buffers(handle, page_buffers(page), 0,
+					len, NULL, write_end_fn);
+		if (!ret)
+			ext4_set_inode_state(inode, EXT4_STATE_JDATA);
+		return ret;
+	}
+
+	if (test_opt(inode->i_sb, DELALLOC))
+		ret = __block_write_begin(page, 0, len,
+					  ext4_da_get_block_prep);
+	else
+		ret = __block_write_begin(page, 0, len, ext4_get_block);
+	if (ret)
+		return ret;
+
+	block_commit_write(page, 0, len);
+	if (ext4_should_order_data(inode) && !test_opt(inode->i_sb, DELALLOC))
+		ret = ext4_jbd2_inode_add_write(handle, inode,
+						page_offset(page), len);
+	return ret;
+}
+
 static int ext4_da_write_begin(struct file *file, struct address_space *mapping,
 			       loff_t pos, unsigned len, unsigned flags,
 			       struct page **pagep, void **fsdata)
@@ -2258,6 +2319,17 @@ static int ext4_da_write_begin(struct file *file, struct address_space *mapping,
 
 	index = pos >> PAGE_CACHE_SHIFT;
 
+	if (ext4_test_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA)) {
+		ret = ext4_try_to_write_inline_data(mapping, inode, pos, len,
+						    flags, pagep);
+		if (ret < 0)
+			return ret;
+		if (ret == 1) {
+			*fsdata = (void *)0;
+			return 0;
+		}
+	}
+
 	if (ext4_nonda_switch(inode->i_sb)) {
 		*fsdata = (void *)FALL_BACK_TO_NONDELALLOC;
 		return ext4_write_begin(file, mapping, pos,
@@ -2344,6 +2416,10 @@ static int ext4_da_write_end(struct file *file,
 	unsigned long start, end;
 	int write_mode = (int)(unsigned long)fsdata;
 
+	if (ext4_has_inline_data(inode))
+		return ext4_write_inline_data_end(inode, pos, len, copied,
+						  page);
+
 	if (write_mode == FALL_BACK_TO_NONDELALLOC) {
 		if (ext4_should_order_data(inode)) {
 			return ext4_ordered_write_end(file, mapping, pos,
@@ -2376,8 +2452,8 @@ static int ext4_da_write_end(struct file *file,
 				 * without needing block allocation
 				 */
 				if (ext4_should_order_data(inode))
-					ret = ext4_jbd2_file_inode(handle,
-								   inode);
+					ret = ext4_jbd2_inode_add_write(handle,
+							inode, pos, copied);
 
 				EXT4_I(inode)->i_disksize = new_i_size;
 			}
@@ -2483,6 +2559,10 @@ static sector_t ext4_bmap(struct address_space *mapping, sector_t block)
 	journal_t *journal;
 	int err;
 
+	/* Inline data has no block to map */
+	if (ext4_has_inline_data(inode))
+		return 0;
+
 	if (mapping_tagged(mapping, PAGECACHE_TAG_DIRTY) &&
 			test_opt(inode->i_sb, DELALLOC)) {
 		/*
@@ -2528,14 +2608,28 @@ static sector_t ext4_bmap(struct address_space *mapping, sector_t block)
 
 static int ext4_readpage(struct file *file, struct page *page)
 {
+	struct inode *inode = page->mapping->host;
+	int ret = -EAGAIN;
+
 	trace_ext4_readpage(page);
-	return mpage_readpage(page, ext4_get_block);
+
+	if (ext4_has_inline_data(inode))
+		ret = ext4_readpage_inline(inode, page);
+
+	if (ret == -EAGAIN)
+		return mpage_readpage(page, ext4_get_block);
+
+	return ret;
 }
 
 static int
 ext4_readpages(struct file *file, struct address_space *mapping,
 		struct list_head *pages, unsigned nr_pages)
 {
+	/* Leave inline data to ->readpage */
+	if (ext4_has_inline_data(mapping->host))
+		return 0;
+
 	return mpage_readpages(mapping, pages, nr_pages, ext4_get_block);
 }
 
@@ -2854,6 +2948,12 @@ static ssize_t ext4_direct_IO(int rw, struct kiocb *iocb,
 	struct inode *inode = file->f_mapping->host;
 	ssize_t ret;
 
+	/* Let buffered I/O deal with inline data */
+	if (ext4_has_inline_data(inode))
+		return 0;
+	if (rw == WRITE)
+		ext4_clear_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA);
+
 	trace_ext4_direct_IO_enter(inode, offset, iov_length(iov, nr_segs), rw);
 	if (ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS))
 		ret = ext4_ext_direct_IO(rw, iocb, iov, offset, nr_segs);
@@ -3072,7 +3172,8 @@ int ext4_block_zero_page_range(handle_t *handle,
 		err = ext4_handle_dirty_metadata(handle, inode, bh);
 	} else {
 		if (ext4_should_order_data(inode) && EXT4_I(inode)->jinode)
-			err = ext4_jbd2_file_inode(handle, inode);
+			err = ext4_jbd2_inode_add_write(handle, inode,
+							from, length);
 		mark_buffer_dirty(bh);
 	}
 
@@ -3158,6 +3259,11 @@ void ext4_truncate(struct inode *inode)
 	if (inode->i_size == 0 && !test_opt(inode->i_sb, NO_AUTO_DA_ALLOC))
 		ext4_set_inode_state(inode, EXT4_STATE_DA_ALLOC_CLOSE);
 
+	if (ext4_has_inline_data(inode) && ext4_inline_data_truncate(inode)) {
+		trace_ext4_truncate_exit(inode);
+		return;
+	}
+
 	if (ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS))
 		ext4_ext_truncate(inode);
 	else
@@ -3523,6 +3629,16 @@ struct inode *ext4_iget(struct super_block *sb, unsigned long ino)
 				 ei->i_file_acl);
 		ret = -EIO;
 		goto bad_inode;
+	} else if (ext4_has_inline_data(inode)) {
+		if (!EXT4_HAS_INCOMPAT_FEATURE(sb,
+				EXT4_FEATURE_INCOMPAT_INLINE_DATA)) {
+			EXT4_ERROR_INODE(inode, "inline data without "
+					 "inline_data feature");
+			ret = -EIO;
+			goto bad_inode;
+		}
+		/* i_block holds data, there are no block references */
+		ext4_set_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA);
 	} else if (ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS)) {
 		if (S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode) ||
 		    (S_ISLNK(inode->i_mode) &&
@@ -3570,6 +3686,7 @@ struct inode *ext4_iget(struct super_block *sb, unsigned long ino)
 	}
 	brelse(iloc.bh);
 	ext4_set_inode_flags(inode);
+	ext4_precache_acl(inode);
 	unlock_new_inode(inode);
 	return inode;
 
@@ -3716,9 +3833,11 @@ static int ext4_do_update_inode(handle_t *handle,
 				cpu_to_le32(new_encode_dev(inode->i_rdev));
 			raw_inode->i_block[2] = 0;
 		}
-	} else
+	} else if (!ext4_has_inline_data(inode)) {
+		/* Inline data is written to the raw inode directly */
 		for (block = 0; block < EXT4_N_BLOCKS; block++)
 			raw_inode->i_block[block] = ei->i_data[block];
+	}
 
 	raw_inode->i_disk_version = cpu_to_le32(inode->i_version);
 	if (ei->i_extra_isize) {
@@ -3885,6 +4004,14 @@ int ext4_setattr(struct dentry *dentry, struct iattr *attr)
 			if (attr->ia_size > sbi->s_bitmap_maxbytes)
 				return -EFBIG;
 		}
+
+		/* Extending a file moves its inline data out to a block */
+		if (ext4_has_inline_data(inode) &&
+		    attr->ia_size > inode->i_size) {
+			error = ext4_convert_inline_data(inode);
+			if (error)
+				goto err_out;
+		}
 	}
 
 	if (S_ISREG(inode->i_mode) &&
@@ -4360,6 +4487,14 @@ int ext4_page_mkwrite(struct vm_area_struct *vma, struct vm_fault *vmf)
 	 * __block_page_mkwrite() to do a reliable check.
 	 */
 	vfs_check_frozen(inode->i_sb, SB_FREEZE_WRITE);
+
+	/* Inline data cannot be mapped, move it out to a block first */
+	if (ext4_has_inline_data(inode)) {
+		ret = ext4_convert_inline_data(inode);
+		if (ret)
+			goto out_ret;
+	}
+
 	/* Delalloc case is easy... */
 	if (test_opt(inode->i_sb, DELALLOC) &&
 	    !ext4_should_journal_data(inode) &&
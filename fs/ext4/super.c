@@ -2659,6 +2659,15 @@ static int ext4_feature_set_ok(struct super_block *sb, int readonly)
 		return 0;
 	}
 
+#ifndef CONFIG_EXT4_FS_XATTR
+	if (EXT4_HAS_INCOMPAT_FEATURE(sb, EXT4_FEATURE_INCOMPAT_INLINE_DATA)) {
+		ext4_msg(sb, KERN_ERR,
+			 "Couldn't mount with inline_data feature "
+			 "without CONFIG_EXT4_FS_XATTR");
+		return 0;
+	}
+#endif
+
 	if (readonly)
 		return 1;
 
@@ -25,43 +25,71 @@ MODULE_ALIAS("devname:fuse");
 
 static struct kmem_cache *fuse_req_cachep;
 
-static struct fuse_conn *fuse_get_conn(struct file *file)
+static struct fuse_chan *fuse_get_chan(struct file *file)
 {
 	/*
 	 * Lockless access is OK, because file->private data is set
-	 * once during mount and is valid until the file is released.
+	 * once during mount or clone and is valid until the file is
+	 * released.
 	 */
 	return file->private_data;
 }
 
-static void fuse_request_init(struct fuse_req *req)
+static void fuse_request_init(struct fuse_req *req, struct page **pages,
+			      unsigned npages)
 {
 	memset(req, 0, sizeof(*req));
 	INIT_LIST_HEAD(&req->list);
 	INIT_LIST_HEAD(&req->intr_entry);
 	init_waitqueue_head(&req->waitq);
 	atomic_set(&req->count, 1);
+	req->pages = pages;
+	req->max_pages = npages;
 }
 
-struct fuse_req *fuse_request_alloc(void)
+static struct fuse_req *__fuse_request_alloc(unsigned npages, gfp_t flags)
 {
-	struct fuse_req *req = kmem_cache_alloc(fuse_req_cachep, GFP_KERNEL);
-	if (req)
-		fuse_request_init(req);
+	struct fuse_req *req = kmem_cache_alloc(fuse_req_cachep, flags);
+	if (req) {
+		struct page **pages;
+
+		if (npages <= FUSE_REQ_INLINE_PAGES)
+			pages = req->inline_pages;
+		else
+			pages = kmalloc(sizeof(struct page *) * npages, flags);
+
+		if (!pages) {
+			kmem_cache_free(fuse_req_cachep, req);
+			return NULL;
+		}
+
+		fuse_request_init(req, pages,
+				  max_t(unsigned, npages,
+					FUSE_REQ_INLINE_PAGES));
+	}
 	return req;
 }
+
+struct fuse_req *fuse_request_alloc(void)
+{
+	return __fuse_request_alloc(FUSE_REQ_INLINE_PAGES, GFP_KERNEL);
+}
 EXPORT_SYMBOL_GPL(fuse_request_alloc);
 
-struct fuse_req *fuse_request_alloc_nofs(void)
+struct fuse_req *fuse_request_alloc_pages(unsigned npages)
 {
-	struct fuse_req *req = kmem_cache_alloc(fuse_req_cachep, GFP_NOFS);
-	if (req)
-		fuse_request_init(req);
-	return req;
+	return __fuse_request_alloc(npages, GFP_KERNEL);
+}
+
+struct fuse_req *fuse_request_alloc_nofs(unsigned npages)
+{
+	return __fuse_request_alloc(npages, GFP_NOFS);
 }
 
 void fuse_request_free(struct fuse_req *req)
 {
+	if (req->pages != req->inline_pages)
+		kfree(req->pages);
 	kmem_cache_free(fuse_req_cachep, req);
 }
 
@@ -97,7 +125,7 @@ static void fuse_req_init_context(struct fuse_req *req)
 	req->in.h.pid = current->pid;
 }
 
-struct fuse_req *fuse_get_req(struct fuse_conn *fc)
+struct fuse_req *fuse_get_req_pages(struct fuse_conn *fc, unsigned npages)
 {
 	struct fuse_req *req;
 	sigset_t oldset;
@@ -116,7 +144,7 @@ struct fuse_req *fuse_get_req(struct fuse_conn *fc)
 	if (!fc->connected)
 		goto out;
 
-	req = fuse_request_alloc();
+	req = fuse_request_alloc_pages(npages);
 	err = -ENOMEM;
 	if (!req)
 		goto out;
@@ -129,6 +157,11 @@ struct fuse_req *fuse_get_req(struct fuse_conn *fc)
 	atomic_dec(&fc->num_waiting);
 	return ERR_PTR(err);
 }
+
+struct fuse_req *fuse_get_req(struct fuse_conn *fc)
+{
+	return fuse_get_req_pages(fc, FUSE_REQ_INLINE_PAGES);
+}
 EXPORT_SYMBOL_GPL(fuse_get_req);
 
 /*
@@ -166,7 +199,7 @@ static void put_reserved_req(struct fuse_conn *fc, struct fuse_req *req)
 	struct fuse_file *ff = file->private_data;
 
 	spin_lock(&fc->lock);
-	fuse_request_init(req);
+	fuse_request_init(req, req->inline_pages, FUSE_REQ_INLINE_PAGES);
 	BUG_ON(ff->reserved_req);
 	ff->reserved_req = req;
 	wake_up_all(&fc->reserved_req_waitq);
@@ -229,79 +262,118 @@ static unsigned len_args(unsigned numargs, struct fuse_arg *args)
 
 static u64 fuse_get_unique(struct fuse_conn *fc)
 {
-	fc->reqctr++;
+	u64 unique;
+
 	/* zero is special */
-	if (fc->reqctr == 0)
-		fc->reqctr = 1;
+	do {
+		unique = atomic64_inc_return(&fc->reqctr);
+	} while (unlikely(!unique));
+
+	return unique;
+}
+
+/*
+ * Lock the channel requests from this CPU are queued on.  That is the
+ * channel bound to the CPU with FUSE_DEV_IOC_BIND_CPU or, if there is
+ * none, the main channel.  A channel that is being released has been
+ * unbound already, but may still be seen here: use the main channel
+ * instead in that case.  RCU keeps a released channel from being freed
+ * under us until we have found that out.
+ */
+static struct fuse_chan *fuse_lock_chan(struct fuse_conn *fc)
+{
+	struct fuse_chan **cpu_chan = ACCESS_ONCE(fc->cpu_chan);
+	struct fuse_chan *chan = NULL;
 
-	return fc->reqctr;
+	rcu_read_lock();
+	if (cpu_chan) {
+		smp_read_barrier_depends();
+		chan = ACCESS_ONCE(cpu_chan[raw_smp_processor_id()]);
+	}
+	if (!chan)
+		chan = &fc->chan;
+
+	spin_lock(&chan->lock);
+	if (unlikely(!chan->connected) && chan != &fc->chan) {
+		spin_unlock(&chan->lock);
+		chan = &fc->chan;
+		spin_lock(&chan->lock);
+	}
+	rcu_read_unlock();
+	return chan;
 }
 
-static void queue_request(struct fuse_conn *fc, struct fuse_req *req)
+/* Drop a reference to a cloned channel, freeing it with the last one */
+static void fuse_chan_put(struct fuse_chan *chan)
+{
+	if (chan != &chan->fc->chan && atomic_dec_and_test(&chan->count))
+		kfree_rcu(chan, rcu);
+}
+
+/* Called with chan->lock */
+static void queue_request(struct fuse_chan *chan, struct fuse_req *req)
 {
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		len_args(req->in.numargs, (struct fuse_arg *) req->in.args);
-	list_add_tail(&req->list, &fc->pending);
+	req->chan = chan;
+	list_add_tail(&req->list, &chan->pending);
 	req->state = FUSE_REQ_PENDING;
 	if (!req->waiting) {
 		req->waiting = 1;
-		atomic_inc(&fc->num_waiting);
+		atomic_inc(&chan->fc->num_waiting);
 	}
-	wake_up(&fc->waitq);
-	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+	wake_up(&chan->waitq);
+	kill_fasync(&chan->fasync, SIGIO, POLL_IN);
 }
 
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 		       u64 nodeid, u64 nlookup)
 {
+	struct fuse_chan *chan;
+
 	forget->forget_one.nodeid = nodeid;
 	forget->forget_one.nlookup = nlookup;
 
-	spin_lock(&fc->lock);
-	if (fc->connected) {
-		fc->forget_list_tail->next = forget;
-		fc->forget_list_tail = forget;
-		wake_up(&fc->waitq);
-		kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+	chan = fuse_lock_chan(fc);
+	if (fc->connected && chan->connected) {
+		chan->forget_list_tail->next = forget;
+		chan->forget_list_tail = forget;
+		wake_up(&chan->waitq);
+		kill_fasync(&chan->fasync, SIGIO, POLL_IN);
 	} else {
 		kfree(forget);
 	}
-	spin_unlock(&fc->lock);
+	spin_unlock(&chan->lock);
 }
 
+/* Called with fc->lock */
 static void flush_bg_queue(struct fuse_conn *fc)
 {
 	while (fc->active_background < fc->max_background &&
 	       !list_empty(&fc->bg_queue)) {
+		struct fuse_chan *chan;
 		struct fuse_req *req;
 
 		req = list_entry(fc->bg_queue.next, struct fuse_req, list);
 		list_del(&req->list);
 		fc->active_background++;
 		req->in.h.unique = fuse_get_unique(fc);
-		queue_request(fc, req);
+		chan = fuse_lock_chan(fc);
+		queue_request(chan, req);
+		spin_unlock(&chan->lock);
 	}
 }
 
 /*
- * This function is called when a request is finished.  Either a reply
- * has arrived or it was aborted (and not yet sent) or some error
- * occurred during communication with userspace, or the device file
- * was closed.  The requester thread is woken up (if still waiting),
- * the 'end' callback is called if given, else the reference to the
- * request is released
- *
- * Called with fc->lock, unlocks it
+ * Second half of request_end(), called without any locks held.  The
+ * background accounting is done under fc->lock, so that completing
+ * foreground requests never touches the connection lock.
  */
-static void request_end(struct fuse_conn *fc, struct fuse_req *req)
-__releases(fc->lock)
+static void request_complete(struct fuse_conn *fc, struct fuse_req *req,
+			     void (*end)(struct fuse_conn *, struct fuse_req *))
 {
-	void (*end) (struct fuse_conn *, struct fuse_req *) = req->end;
-	req->end = NULL;
-	list_del(&req->list);
-	list_del(&req->intr_entry);
-	req->state = FUSE_REQ_FINISHED;
 	if (req->background) {
+		spin_lock(&fc->lock);
 		if (fc->num_background == fc->max_background) {
 			fc->blocked = 0;
 			wake_up_all(&fc->blocked_waitq);
@@ -314,41 +386,63 @@ __releases(fc->lock)
 		fc->num_background--;
 		fc->active_background--;
 		flush_bg_queue(fc);
+		spin_unlock(&fc->lock);
 	}
-	spin_unlock(&fc->lock);
 	wake_up(&req->waitq);
 	if (end)
 		end(fc, req);
 	fuse_put_request(fc, req);
 }
 
-static void wait_answer_interruptible(struct fuse_conn *fc,
+/*
+ * This function is called when a request is finished.  Either a reply
+ * has arrived or it was aborted (and not yet sent) or some error
+ * occurred during communication with userspace, or the device file
+ * was closed.  The requester thread is woken up (if still waiting),
+ * the 'end' callback is called if given, else the reference to the
+ * request is released
+ *
+ * Called with req->chan->lock, unlocks it
+ */
+static void request_end(struct fuse_conn *fc, struct fuse_req *req)
+__releases(req->chan->lock)
+{
+	void (*end) (struct fuse_conn *, struct fuse_req *) = req->end;
+	req->end = NULL;
+	list_del(&req->list);
+	list_del(&req->intr_entry);
+	req->state = FUSE_REQ_FINISHED;
+	spin_unlock(&req->chan->lock);
+	request_complete(fc, req, end);
+}
+
+static void wait_answer_interruptible(struct fuse_chan *chan,
 				      struct fuse_req *req)
-__releases(fc->lock)
-__acquires(fc->lock)
+__releases(chan->lock)
+__acquires(chan->lock)
 {
 	if (signal_pending(current))
 		return;
 
-	spin_unlock(&fc->lock);
+	spin_unlock(&chan->lock);
 	wait_event_interruptible(req->waitq, req->state == FUSE_REQ_FINISHED);
-	spin_lock(&fc->lock);
+	spin_lock(&chan->lock);
 }
 
-static void queue_interrupt(struct fuse_conn *fc, struct fuse_req *req)
+static void queue_interrupt(struct fuse_chan *chan, struct fuse_req *req)
 {
-	list_add_tail(&req->intr_entry, &fc->interrupts);
-	wake_up(&fc->waitq);
-	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+	list_add_tail(&req->intr_entry, &chan->interrupts);
+	wake_up(&chan->waitq);
+	kill_fasync(&chan->fasync, SIGIO, POLL_IN);
 }
 
-static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
-__releases(fc->lock)
-__acquires(fc->lock)
+static void request_wait_answer(struct fuse_chan *chan, struct fuse_req *req)
+__releases(chan->lock)
+__acquires(chan->lock)
 {
-	if (!fc->no_interrupt) {
+	if (!chan->fc->no_interrupt) {
 		/* Any signal may interrupt this */
-		wait_answer_interruptible(fc, req);
+		wait_answer_interruptible(chan, req);
 
 		if (req->aborted)
 			goto aborted;
@@ -357,7 +451,7 @@ __acquires(fc->lock)
 
 		req->interrupted = 1;
 		if (req->state == FUSE_REQ_SENT)
-			queue_interrupt(fc, req);
+			queue_interrupt(chan, req);
 	}
 
 	if (!req->force) {
@@ -365,7 +459,7 @@ __acquires(fc->lock)
 
 		/* Only fatal signals may interrupt this */
 		block_sigs(&oldset);
-		wait_answer_interruptible(fc, req);
+		wait_answer_interruptible(chan, req);
 		restore_sigs(&oldset);
 
 		if (req->aborted)
@@ -386,9 +480,9 @@ __acquires(fc->lock)
 	 * Either request is already in userspace, or it was forced.
 	 * Wait it out.
 	 */
-	spin_unlock(&fc->lock);
+	spin_unlock(&chan->lock);
 	wait_event(req->waitq, req->state == FUSE_REQ_FINISHED);
-	spin_lock(&fc->lock);
+	spin_lock(&chan->lock);
 
 	if (!req->aborted)
 		return;
@@ -401,30 +495,37 @@ __acquires(fc->lock)
 		   locked state, there mustn't be any filesystem
 		   operation (e.g. page fault), since that could lead
 		   to deadlock */
-		spin_unlock(&fc->lock);
+		spin_unlock(&chan->lock);
 		wait_event(req->waitq, !req->locked);
-		spin_lock(&fc->lock);
+		spin_lock(&chan->lock);
 	}
 }
 
 void fuse_request_send(struct fuse_conn *fc, struct fuse_req *req)
 {
+	struct fuse_chan *chan;
+
 	req->isreply = 1;
-	spin_lock(&fc->lock);
-	if (!fc->connected)
+	chan = fuse_lock_chan(fc);
+	if (!fc->connected || !chan->connected)
 		req->out.h.error = -ENOTCONN;
 	else if (fc->conn_error)
 		req->out.h.error = -ECONNREFUSED;
 	else {
 		req->in.h.unique = fuse_get_unique(fc);
-		queue_request(fc, req);
+		queue_request(chan, req);
 		/* acquire extra reference, since request is still needed
 		   after request_end() */
 		__fuse_get_request(req);
+		/* and keep the channel if it is released meanwhile */
+		atomic_inc(&chan->count);
 
-		request_wait_answer(fc, req);
+		request_wait_answer(chan, req);
+		spin_unlock(&chan->lock);
+		fuse_chan_put(chan);
+		return;
 	}
-	spin_unlock(&fc->lock);
+	spin_unlock(&chan->lock);
 }
 EXPORT_SYMBOL_GPL(fuse_request_send);
 
@@ -451,8 +552,13 @@ static void fuse_request_send_nowait(struct fuse_conn *fc, struct fuse_req *req)
 		fuse_request_send_nowait_locked(fc, req);
 		spin_unlock(&fc->lock);
 	} else {
+		void (*end) (struct fuse_conn *, struct fuse_req *) = req->end;
+
+		spin_unlock(&fc->lock);
+		req->end = NULL;
 		req->out.h.error = -ENOTCONN;
-		request_end(fc, req);
+		req->state = FUSE_REQ_FINISHED;
+		request_complete(fc, req, end);
 	}
 }
 
@@ -466,16 +572,17 @@ EXPORT_SYMBOL_GPL(fuse_request_send_background);
 static int fuse_request_send_notify_reply(struct fuse_conn *fc,
 					  struct fuse_req *req, u64 unique)
 {
+	struct fuse_chan *chan;
 	int err = -ENODEV;
 
 	req->isreply = 0;
 	req->in.h.unique = unique;
-	spin_lock(&fc->lock);
-	if (fc->connected) {
-		queue_request(fc, req);
+	chan = fuse_lock_chan(fc);
+	if (fc->connected && chan->connected) {
+		queue_request(chan, req);
 		err = 0;
 	}
-	spin_unlock(&fc->lock);
+	spin_unlock(&chan->lock);
 
 	return err;
 }
@@ -497,16 +604,16 @@ void fuse_request_send_background_locked(struct fuse_conn *fc,
  * anything that could cause a page-fault.  If the request was already
  * aborted bail out.
  */
-static int lock_request(struct fuse_conn *fc, struct fuse_req *req)
+static int lock_request(struct fuse_req *req)
 {
 	int err = 0;
 	if (req) {
-		spin_lock(&fc->lock);
+		spin_lock(&req->chan->lock);
 		if (req->aborted)
 			err = -ENOENT;
 		else
 			req->locked = 1;
-		spin_unlock(&fc->lock);
+		spin_unlock(&req->chan->lock);
 	}
 	return err;
 }
@@ -516,14 +623,14 @@ static int lock_request(struct fuse_conn *fc, struct fuse_req *req)
  * requester thread is currently waiting for it to be unlocked, so
  * wake it up.
  */
-static void unlock_request(struct fuse_conn *fc, struct fuse_req *req)
+static void unlock_request(struct fuse_req *req)
 {
 	if (req) {
-		spin_lock(&fc->lock);
+		spin_lock(&req->chan->lock);
 		req->locked = 0;
 		if (req->aborted)
 			wake_up(&req->waitq);
-		spin_unlock(&fc->lock);
+		spin_unlock(&req->chan->lock);
 	}
 }
 
@@ -590,7 +697,7 @@ static int fuse_copy_fill(struct fuse_copy_state *cs)
 	unsigned long offset;
 	int err;
 
-	unlock_request(cs->fc, cs->req);
+	unlock_request(cs->req);
 	fuse_copy_finish(cs);
 	if (cs->pipebufs) {
 		struct pipe_buffer *buf = cs->pipebufs;
@@ -648,7 +755,7 @@ static int fuse_copy_fill(struct fuse_copy_state *cs)
 		cs->addr += cs->len;
 	}
 
-	return lock_request(cs->fc, cs->req);
+	return lock_request(cs->req);
 }
 
 /* Do as much copy to/from userspace buffer as we can */
@@ -696,7 +803,7 @@ static int fuse_try_move_page(struct fuse_copy_state *cs, struct page **pagep)
 	struct address_space *mapping;
 	pgoff_t index;
 
-	unlock_request(cs->fc, cs->req);
+	unlock_request(cs->req);
 	fuse_copy_finish(cs);
 
 	err = buf->ops->confirm(cs->pipe, buf);
@@ -753,12 +860,12 @@ static int fuse_try_move_page(struct fuse_copy_state *cs, struct page **pagep)
 		lru_cache_add_file(newpage);
 
 	err = 0;
-	spin_lock(&cs->fc->lock);
+	spin_lock(&cs->req->chan->lock);
 	if (cs->req->aborted)
 		err = -ENOENT;
 	else
 		*pagep = newpage;
-	spin_unlock(&cs->fc->lock);
+	spin_unlock(&cs->req->chan->lock);
 
 	if (err) {
 		unlock_page(newpage);
@@ -778,7 +885,7 @@ out_fallback:
 	cs->mapaddr = buf->ops->map(cs->pipe, buf, 1);
 	cs->buf = cs->mapaddr + buf->offset;
 
-	err = lock_request(cs->fc, cs->req);
+	err = lock_request(cs->req);
 	if (err)
 		return err;
 
@@ -793,7 +900,7 @@ static int fuse_ref_page(struct fuse_copy_state *cs, struct page *page,
 	if (cs->nr_segs == cs->pipe->buffers)
 		return -EIO;
 
-	unlock_request(cs->fc, cs->req);
+	unlock_request(cs->req);
 	fuse_copy_finish(cs);
 
 	buf = cs->pipebufs;
@@ -906,36 +1013,41 @@ static int fuse_copy_args(struct fuse_copy_state *cs, unsigned numargs,
 	return err;
 }
 
-static int forget_pending(struct fuse_conn *fc)
+static int forget_pending(struct fuse_chan *chan)
 {
-	return fc->forget_list_head.next != NULL;
+	return chan->forget_list_head.next != NULL;
 }
 
-static int request_pending(struct fuse_conn *fc)
+static int request_pending(struct fuse_chan *chan)
 {
-	return !list_empty(&fc->pending) || !list_empty(&fc->interrupts) ||
-		forget_pending(fc);
+	return !list_empty(&chan->pending) || !list_empty(&chan->interrupts) ||
+		forget_pending(chan);
+}
+
+static int chan_connected(struct fuse_chan *chan)
+{
+	return chan->connected && chan->fc->connected;
 }
 
 /* Wait until a request is available on the pending list */
-static void request_wait(struct fuse_conn *fc)
-__releases(fc->lock)
-__acquires(fc->lock)
+static void request_wait(struct fuse_chan *chan)
+__releases(chan->lock)
+__acquires(chan->lock)
 {
 	DECLARE_WAITQUEUE(wait, current);
 
-	add_wait_queue_exclusive(&fc->waitq, &wait);
-	while (fc->connected && !request_pending(fc)) {
+	add_wait_queue_exclusive(&chan->waitq, &wait);
+	while (chan_connected(chan) && !request_pending(chan)) {
 		set_current_state(TASK_INTERRUPTIBLE);
 		if (signal_pending(current))
 			break;
 
-		spin_unlock(&fc->lock);
+		spin_unlock(&chan->lock);
 		schedule();
-		spin_lock(&fc->lock);
+		spin_lock(&chan->lock);
 	}
 	set_current_state(TASK_RUNNING);
-	remove_wait_queue(&fc->waitq, &wait);
+	remove_wait_queue(&chan->waitq, &wait);
 }
 
 /*
@@ -944,11 +1056,12 @@ __acquires(fc->lock)
  * Unlike other requests this is assembled on demand, without a need
  * to allocate a separate fuse_req structure.
  *
- * Called with fc->lock held, releases it
+ * Called with chan->lock held, releases it
  */
-static int fuse_read_interrupt(struct fuse_conn *fc, struct fuse_copy_state *cs,
+static int fuse_read_interrupt(struct fuse_chan *chan,
+			       struct fuse_copy_state *cs,
 			       size_t nbytes, struct fuse_req *req)
-__releases(fc->lock)
+__releases(chan->lock)
 {
 	struct fuse_in_header ih;
 	struct fuse_interrupt_in arg;
@@ -956,7 +1069,7 @@ __releases(fc->lock)
 	int err;
 
 	list_del_init(&req->intr_entry);
-	req->intr_unique = fuse_get_unique(fc);
+	req->intr_unique = fuse_get_unique(chan->fc);
 	memset(&ih, 0, sizeof(ih));
 	memset(&arg, 0, sizeof(arg));
 	ih.len = reqsize;
@@ -964,7 +1077,7 @@ __releases(fc->lock)
 	ih.unique = req->intr_unique;
 	arg.unique = req->in.h.unique;
 
-	spin_unlock(&fc->lock);
+	spin_unlock(&chan->lock);
 	if (nbytes < reqsize)
 		return -EINVAL;
 
@@ -976,21 +1089,21 @@ __releases(fc->lock)
 	return err ? err : reqsize;
 }
 
-static struct fuse_forget_link *dequeue_forget(struct fuse_conn *fc,
+static struct fuse_forget_link *dequeue_forget(struct fuse_chan *chan,
 					       unsigned max,
 					       unsigned *countp)
 {
-	struct fuse_forget_link *head = fc->forget_list_head.next;
+	struct fuse_forget_link *head = chan->forget_list_head.next;
 	struct fuse_forget_link **newhead = &head;
 	unsigned count;
 
 	for (count = 0; *newhead != NULL && count < max; count++)
 		newhead = &(*newhead)->next;
 
-	fc->forget_list_head.next = *newhead;
+	chan->forget_list_head.next = *newhead;
 	*newhead = NULL;
-	if (fc->forget_list_head.next == NULL)
-		fc->forget_list_tail = &fc->forget_list_head;
+	if (chan->forget_list_head.next == NULL)
+		chan->forget_list_tail = &chan->forget_list_head;
 
 	if (countp != NULL)
 		*countp = count;
@@ -998,24 +1111,24 @@ static struct fuse_forget_link *dequeue_forget(struct fuse_conn *fc,
 	return head;
 }
 
-static int fuse_read_single_forget(struct fuse_conn *fc,
+static int fuse_read_single_forget(struct fuse_chan *chan,
 				   struct fuse_copy_state *cs,
 				   size_t nbytes)
-__releases(fc->lock)
+__releases(chan->lock)
 {
 	int err;
-	struct fuse_forget_link *forget = dequeue_forget(fc, 1, NULL);
+	struct fuse_forget_link *forget = dequeue_forget(chan, 1, NULL);
 	struct fuse_forget_in arg = {
 		.nlookup = forget->forget_one.nlookup,
 	};
 	struct fuse_in_header ih = {
 		.opcode = FUSE_FORGET,
 		.nodeid = forget->forget_one.nodeid,
-		.unique = fuse_get_unique(fc),
+		.unique = fuse_get_unique(chan->fc),
 		.len = sizeof(ih) + sizeof(arg),
 	};
 
-	spin_unlock(&fc->lock);
+	spin_unlock(&chan->lock);
 	kfree(forget);
 	if (nbytes < ih.len)
 		return -EINVAL;
@@ -1031,9 +1144,9 @@ __releases(fc->lock)
 	return ih.len;
 }
 
-static int fuse_read_batch_forget(struct fuse_conn *fc,
+static int fuse_read_batch_forget(struct fuse_chan *chan,
 				   struct fuse_copy_state *cs, size_t nbytes)
-__releases(fc->lock)
+__releases(chan->lock)
 {
 	int err;
 	unsigned max_forgets;
@@ -1042,18 +1155,18 @@ __releases(fc->lock)
 	struct fuse_batch_forget_in arg = { .count = 0 };
 	struct fuse_in_header ih = {
 		.opcode = FUSE_BATCH_FORGET,
-		.unique = fuse_get_unique(fc),
+		.unique = fuse_get_unique(chan->fc),
 		.len = sizeof(ih) + sizeof(arg),
 	};
 
 	if (nbytes < ih.len) {
-		spin_unlock(&fc->lock);
+		spin_unlock(&chan->lock);
 		return -EINVAL;
 	}
 
 	max_forgets = (nbytes - ih.len) / sizeof(struct fuse_forget_one);
-	head = dequeue_forget(fc, max_forgets, &count);
-	spin_unlock(&fc->lock);
+	head = dequeue_forget(chan, max_forgets, &count);
+	spin_unlock(&chan->lock);
 
 	arg.count = count;
 	ih.len += count * sizeof(struct fuse_forget_one);
@@ -1080,14 +1193,14 @@ __releases(fc->lock)
 	return ih.len;
 }
 
-static int fuse_read_forget(struct fuse_conn *fc, struct fuse_copy_state *cs,
+static int fuse_read_forget(struct fuse_chan *chan, struct fuse_copy_state *cs,
 			    size_t nbytes)
-__releases(fc->lock)
+__releases(chan->lock)
 {
-	if (fc->minor < 16 || fc->forget_list_head.next->next == NULL)
-		return fuse_read_single_forget(fc, cs, nbytes);
+	if (chan->fc->minor < 16 || chan->forget_list_head.next->next == NULL)
+		return fuse_read_single_forget(chan, cs, nbytes);
 	else
-		return fuse_read_batch_forget(fc, cs, nbytes);
+		return fuse_read_batch_forget(chan, cs, nbytes);
 }
 
 /*
@@ -1099,46 +1212,47 @@ __releases(fc->lock)
  * request_end().  Otherwise add it to the processing list, and set
  * the 'sent' flag.
  */
-static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
+static ssize_t fuse_dev_do_read(struct fuse_chan *chan, struct file *file,
 				struct fuse_copy_state *cs, size_t nbytes)
 {
+	struct fuse_conn *fc = chan->fc;
 	int err;
 	struct fuse_req *req;
 	struct fuse_in *in;
 	unsigned reqsize;
 
  restart:
-	spin_lock(&fc->lock);
+	spin_lock(&chan->lock);
 	err = -EAGAIN;
-	if ((file->f_flags & O_NONBLOCK) && fc->connected &&
-	    !request_pending(fc))
+	if ((file->f_flags & O_NONBLOCK) && chan_connected(chan) &&
+	    !request_pending(chan))
 		goto err_unlock;
 
-	request_wait(fc);
+	request_wait(chan);
 	err = -ENODEV;
-	if (!fc->connected)
+	if (!chan_connected(chan))
 		goto err_unlock;
 	err = -ERESTARTSYS;
-	if (!request_pending(fc))
+	if (!request_pending(chan))
 		goto err_unlock;
 
-	if (!list_empty(&fc->interrupts)) {
-		req = list_entry(fc->interrupts.next, struct fuse_req,
+	if (!list_empty(&chan->interrupts)) {
+		req = list_entry(chan->interrupts.next, struct fuse_req,
 				 intr_entry);
-		return fuse_read_interrupt(fc, cs, nbytes, req);
+		return fuse_read_interrupt(chan, cs, nbytes, req);
 	}
 
-	if (forget_pending(fc)) {
-		if (list_empty(&fc->pending) || fc->forget_batch-- > 0)
-			return fuse_read_forget(fc, cs, nbytes);
+	if (forget_pending(chan)) {
+		if (list_empty(&chan->pending) || chan->forget_batch-- > 0)
+			return fuse_read_forget(chan, cs, nbytes);
 
-		if (fc->forget_batch <= -8)
-			fc->forget_batch = 16;
+		if (chan->forget_batch <= -8)
+			chan->forget_batch = 16;
 	}
 
-	req = list_entry(fc->pending.next, struct fuse_req, list);
+	req = list_entry(chan->pending.next, struct fuse_req, list);
 	req->state = FUSE_REQ_READING;
-	list_move(&req->list, &fc->io);
+	list_move(&req->list, &chan->io);
 
 	in = &req->in;
 	reqsize = in->h.len;
@@ -1151,14 +1265,14 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 		request_end(fc, req);
 		goto restart;
 	}
-	spin_unlock(&fc->lock);
+	spin_unlock(&chan->lock);
 	cs->req = req;
 	err = fuse_copy_one(cs, &in->h, sizeof(in->h));
 	if (!err)
 		err = fuse_copy_args(cs, in->numargs, in->argpages,
 				     (struct fuse_arg *) in->args, 0);
 	fuse_copy_finish(cs);
-	spin_lock(&fc->lock);
+	spin_lock(&chan->lock);
 	req->locked = 0;
 	if (req->aborted) {
 		request_end(fc, req);
@@ -1173,15 +1287,15 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 		request_end(fc, req);
 	else {
 		req->state = FUSE_REQ_SENT;
-		list_move_tail(&req->list, &fc->processing);
+		list_move_tail(&req->list, &chan->processing);
 		if (req->interrupted)
-			queue_interrupt(fc, req);
-		spin_unlock(&fc->lock);
+			queue_interrupt(chan, req);
+		spin_unlock(&chan->lock);
 	}
 	return reqsize;
 
  err_unlock:
-	spin_unlock(&fc->lock);
+	spin_unlock(&chan->lock);
 	return err;
 }
 
@@ -1190,13 +1304,13 @@ static ssize_t fuse_dev_read(struct kiocb *iocb, const struct iovec *iov,
 {
 	struct fuse_copy_state cs;
 	struct file *file = iocb->ki_filp;
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (!fc)
+	struct fuse_chan *chan = fuse_get_chan(file);
+	if (!chan)
 		return -EPERM;
 
-	fuse_copy_init(&cs, fc, 1, iov, nr_segs);
+	fuse_copy_init(&cs, chan->fc, 1, iov, nr_segs);
 
-	return fuse_dev_do_read(fc, file, &cs, iov_length(iov, nr_segs));
+	return fuse_dev_do_read(chan, file, &cs, iov_length(iov, nr_segs));
 }
 
 static int fuse_dev_pipe_buf_steal(struct pipe_inode_info *pipe,
@@ -1224,18 +1338,18 @@ static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
 	int do_wakeup = 0;
 	struct pipe_buffer *bufs;
 	struct fuse_copy_state cs;
-	struct fuse_conn *fc = fuse_get_conn(in);
-	if (!fc)
+	struct fuse_chan *chan = fuse_get_chan(in);
+	if (!chan)
 		return -EPERM;
 
 	bufs = kmalloc(pipe->buffers * sizeof(struct pipe_buffer), GFP_KERNEL);
 	if (!bufs)
 		return -ENOMEM;
 
-	fuse_copy_init(&cs, fc, 1, NULL, 0);
+	fuse_copy_init(&cs, chan->fc, 1, NULL, 0);
 	cs.pipebufs = bufs;
 	cs.pipe = pipe;
-	ret = fuse_dev_do_read(fc, in, &cs, len);
+	ret = fuse_dev_do_read(chan, in, &cs, len);
 	if (ret < 0)
 		goto out;
 
@@ -1489,14 +1603,25 @@ static int fuse_retrieve(struct fuse_conn *fc, struct inode *inode,
 	loff_t file_size;
 	unsigned int num;
 	unsigned int offset;
+	unsigned int num_pages;
 	size_t total_len = 0;
 
-	req = fuse_get_req(fc);
+	offset = outarg->offset & ~PAGE_CACHE_MASK;
+	file_size = i_size_read(inode);
+
+	num = outarg->size;
+	if (outarg->offset > file_size)
+		num = 0;
+	else if (outarg->offset + num > file_size)
+		num = file_size - outarg->offset;
+
+	num_pages = (num + offset + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	num_pages = min(num_pages, fc->max_pages);
+
+	req = fuse_get_req_pages(fc, num_pages);
 	if (IS_ERR(req))
 		return PTR_ERR(req);
 
-	offset = outarg->offset & ~PAGE_CACHE_MASK;
-
 	req->in.h.opcode = FUSE_NOTIFY_REPLY;
 	req->in.h.nodeid = outarg->nodeid;
 	req->in.numargs = 2;
@@ -1505,14 +1630,8 @@ static int fuse_retrieve(struct fuse_conn *fc, struct inode *inode,
 	req->end = fuse_retrieve_end;
 
 	index = outarg->offset >> PAGE_CACHE_SHIFT;
-	file_size = i_size_read(inode);
-	num = outarg->size;
-	if (outarg->offset > file_size)
-		num = 0;
-	else if (outarg->offset + num > file_size)
-		num = file_size - outarg->offset;
 
-	while (num) {
+	while (num && req->num_pages < req->max_pages) {
 		struct page *page;
 		unsigned int this_num;
 
@@ -1524,6 +1643,9 @@ static int fuse_retrieve(struct fuse_conn *fc, struct inode *inode,
 		req->pages[req->num_pages] = page;
 		req->num_pages++;
 
+		offset = 0;
+		index++;
+
 		num -= this_num;
 		total_len += this_num;
 	}
@@ -1603,11 +1725,11 @@ static int fuse_notify(struct fuse_conn *fc, enum fuse_notify_code code,
 }
 
 /* Look up request on processing list by unique ID */
-static struct fuse_req *request_find(struct fuse_conn *fc, u64 unique)
+static struct fuse_req *request_find(struct fuse_chan *chan, u64 unique)
 {
 	struct list_head *entry;
 
-	list_for_each(entry, &fc->processing) {
+	list_for_each(entry, &chan->processing) {
 		struct fuse_req *req;
 		req = list_entry(entry, struct fuse_req, list);
 		if (req->in.h.unique == unique || req->intr_unique == unique)
@@ -1642,13 +1764,14 @@ static int copy_out_args(struct fuse_copy_state *cs, struct fuse_out *out,
 /*
  * Write a single reply to a request.  First the header is copied from
  * the write buffer.  The request is then searched on the processing
- * list by the unique ID found in the header.  If found, then remove
- * it from the list and copy the rest of the buffer to the request.
- * The request is finished by calling request_end()
+ * list of the channel by the unique ID found in the header.  If found,
+ * then remove it from the list and copy the rest of the buffer to the
+ * request.  The request is finished by calling request_end()
  */
-static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
+static ssize_t fuse_dev_do_write(struct fuse_chan *chan,
 				 struct fuse_copy_state *cs, size_t nbytes)
 {
+	struct fuse_conn *fc = chan->fc;
 	int err;
 	struct fuse_req *req;
 	struct fuse_out_header oh;
@@ -1677,19 +1800,19 @@ static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
 	if (oh.error <= -1000 || oh.error > 0)
 		goto err_finish;
 
-	spin_lock(&fc->lock);
+	spin_lock(&chan->lock);
 	err = -ENOENT;
-	if (!fc->connected)
+	if (!chan_connected(chan))
 		goto err_unlock;
 
-	req = request_find(fc, oh.unique);
+	req = request_find(chan, oh.unique);
 	if (!req)
 		goto err_unlock;
 
 	if (req->aborted) {
-		spin_unlock(&fc->lock);
+		spin_unlock(&chan->lock);
 		fuse_copy_finish(cs);
-		spin_lock(&fc->lock);
+		spin_lock(&chan->lock);
 		request_end(fc, req);
 		return -ENOENT;
 	}
@@ -1702,26 +1825,26 @@ static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
 		if (oh.error == -ENOSYS)
 			fc->no_interrupt = 1;
 		else if (oh.error == -EAGAIN)
-			queue_interrupt(fc, req);
+			queue_interrupt(chan, req);
 
-		spin_unlock(&fc->lock);
+		spin_unlock(&chan->lock);
 		fuse_copy_finish(cs);
 		return nbytes;
 	}
 
 	req->state = FUSE_REQ_WRITING;
-	list_move(&req->list, &fc->io);
+	list_move(&req->list, &chan->io);
 	req->out.h = oh;
 	req->locked = 1;
 	cs->req = req;
 	if (!req->out.page_replace)
 		cs->move_pages = 0;
-	spin_unlock(&fc->lock);
+	spin_unlock(&chan->lock);
 
 	err = copy_out_args(cs, &req->out, nbytes);
 	fuse_copy_finish(cs);
 
-	spin_lock(&fc->lock);
+	spin_lock(&chan->lock);
 	req->locked = 0;
 	if (!err) {
 		if (req->aborted)
@@ -1733,7 +1856,7 @@ static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
 	return err ? err : nbytes;
 
  err_unlock:
-	spin_unlock(&fc->lock);
+	spin_unlock(&chan->lock);
  err_finish:
 	fuse_copy_finish(cs);
 	return err;
@@ -1743,13 +1866,13 @@ static ssize_t fuse_dev_write(struct kiocb *iocb, const struct iovec *iov,
 			      unsigned long nr_segs, loff_t pos)
 {
 	struct fuse_copy_state cs;
-	struct fuse_conn *fc = fuse_get_conn(iocb->ki_filp);
-	if (!fc)
+	struct fuse_chan *chan = fuse_get_chan(iocb->ki_filp);
+	if (!chan)
 		return -EPERM;
 
-	fuse_copy_init(&cs, fc, 0, iov, nr_segs);
+	fuse_copy_init(&cs, chan->fc, 0, iov, nr_segs);
 
-	return fuse_dev_do_write(fc, &cs, iov_length(iov, nr_segs));
+	return fuse_dev_do_write(chan, &cs, iov_length(iov, nr_segs));
 }
 
 static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
@@ -1760,12 +1883,12 @@ static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
 	unsigned idx;
 	struct pipe_buffer *bufs;
 	struct fuse_copy_state cs;
-	struct fuse_conn *fc;
+	struct fuse_chan *chan;
 	size_t rem;
 	ssize_t ret;
 
-	fc = fuse_get_conn(out);
-	if (!fc)
+	chan = fuse_get_chan(out);
+	if (!chan)
 		return -EPERM;
 
 	bufs = kmalloc(pipe->buffers * sizeof(struct pipe_buffer), GFP_KERNEL);
@@ -1812,14 +1935,14 @@ static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
 	}
 	pipe_unlock(pipe);
 
-	fuse_copy_init(&cs, fc, 0, NULL, nbuf);
+	fuse_copy_init(&cs, chan->fc, 0, NULL, nbuf);
 	cs.pipebufs = bufs;
 	cs.pipe = pipe;
 
 	if (flags & SPLICE_F_MOVE)
 		cs.move_pages = 1;
 
-	ret = fuse_dev_do_write(fc, &cs, len);
+	ret = fuse_dev_do_write(chan, &cs, len);
 
 	for (idx = 0; idx < nbuf; idx++) {
 		struct pipe_buffer *buf = &bufs[idx];
@@ -1833,18 +1956,18 @@ out:
 static unsigned fuse_dev_poll(struct file *file, poll_table *wait)
 {
 	unsigned mask = POLLOUT | POLLWRNORM;
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (!fc)
+	struct fuse_chan *chan = fuse_get_chan(file);
+	if (!chan)
 		return POLLERR;
 
-	poll_wait(file, &fc->waitq, wait);
+	poll_wait(file, &chan->waitq, wait);
 
-	spin_lock(&fc->lock);
-	if (!fc->connected)
+	spin_lock(&chan->lock);
+	if (!chan_connected(chan))
 		mask = POLLERR;
-	else if (request_pending(fc))
+	else if (request_pending(chan))
 		mask |= POLLIN | POLLRDNORM;
-	spin_unlock(&fc->lock);
+	spin_unlock(&chan->lock);
 
 	return mask;
 }
@@ -1852,18 +1975,18 @@ static unsigned fuse_dev_poll(struct file *file, poll_table *wait)
 /*
  * Abort all requests on the given list (pending or processing)
  *
- * This function releases and reacquires fc->lock
+ * This function releases and reacquires chan->lock
  */
-static void end_requests(struct fuse_conn *fc, struct list_head *head)
-__releases(fc->lock)
-__acquires(fc->lock)
+static void end_requests(struct fuse_chan *chan, struct list_head *head)
+__releases(chan->lock)
+__acquires(chan->lock)
 {
 	while (!list_empty(head)) {
 		struct fuse_req *req;
 		req = list_entry(head->next, struct fuse_req, list);
 		req->out.h.error = -ECONNABORTED;
-		request_end(fc, req);
-		spin_lock(&fc->lock);
+		request_end(chan->fc, req);
+		spin_lock(&chan->lock);
 	}
 }
 
@@ -1878,13 +2001,13 @@ __acquires(fc->lock)
  * called after waiting for the request to be unlocked (if it was
  * locked).
  */
-static void end_io_requests(struct fuse_conn *fc)
-__releases(fc->lock)
-__acquires(fc->lock)
+static void end_io_requests(struct fuse_chan *chan)
+__releases(chan->lock)
+__acquires(chan->lock)
 {
-	while (!list_empty(&fc->io)) {
+	while (!list_empty(&chan->io)) {
 		struct fuse_req *req =
-			list_entry(fc->io.next, struct fuse_req, list);
+			list_entry(chan->io.next, struct fuse_req, list);
 		void (*end) (struct fuse_conn *, struct fuse_req *) = req->end;
 
 		req->aborted = 1;
@@ -1895,25 +2018,41 @@ __acquires(fc->lock)
 		if (end) {
 			req->end = NULL;
 			__fuse_get_request(req);
-			spin_unlock(&fc->lock);
+			spin_unlock(&chan->lock);
 			wait_event(req->waitq, !req->locked);
-			end(fc, req);
-			fuse_put_request(fc, req);
-			spin_lock(&fc->lock);
+			end(chan->fc, req);
+			fuse_put_request(chan->fc, req);
+			spin_lock(&chan->lock);
 		}
 	}
 }
 
-static void end_queued_requests(struct fuse_conn *fc)
-__releases(fc->lock)
-__acquires(fc->lock)
+/*
+ * Abort all requests and forgets queued on a channel and stop it from
+ * accepting new ones.
+ *
+ * Progression of requests from the pending and processing lists onto
+ * the io list, and progression of new requests onto the pending list
+ * is prevented by chan->connected being false.
+ *
+ * Progression of requests under I/O to the processing list is
+ * prevented by the req->aborted flag being true for these requests.
+ * For this reason requests on the io list must be aborted first.
+ *
+ * Called with chan->lock held
+ */
+static void fuse_chan_abort(struct fuse_chan *chan)
+__releases(chan->lock)
+__acquires(chan->lock)
 {
-	fc->max_background = UINT_MAX;
-	flush_bg_queue(fc);
-	end_requests(fc, &fc->pending);
-	end_requests(fc, &fc->processing);
-	while (forget_pending(fc))
-		kfree(dequeue_forget(fc, 1, NULL));
+	chan->connected = 0;
+	end_io_requests(chan);
+	end_requests(chan, &chan->pending);
+	end_requests(chan, &chan->processing);
+	while (forget_pending(chan))
+		kfree(dequeue_forget(chan, 1, NULL));
+	wake_up_all(&chan->waitq);
+	kill_fasync(&chan->fasync, SIGIO, POLL_IN);
 }
 
 static void end_polls(struct fuse_conn *fc)
@@ -1931,6 +2070,33 @@ static void end_polls(struct fuse_conn *fc)
 	}
 }
 
+/*
+ * Disconnect the connection and abort the requests on all channels.
+ * Background requests are queued first, so that they get aborted too.
+ *
+ * Called with fc->lock held, releases it
+ */
+static void fuse_disconnect(struct fuse_conn *fc)
+__releases(fc->lock)
+{
+	struct fuse_chan *chan;
+
+	fc->connected = 0;
+	fc->blocked = 0;
+	fc->max_background = UINT_MAX;
+	flush_bg_queue(fc);
+	end_polls(fc);
+	spin_unlock(&fc->lock);
+
+	/* No channels are added once the connection is disconnected */
+	list_for_each_entry(chan, &fc->chans, entry) {
+		spin_lock(&chan->lock);
+		fuse_chan_abort(chan);
+		spin_unlock(&chan->lock);
+	}
+	wake_up_all(&fc->blocked_waitq);
+}
+
 /*
  * Abort all requests.
  *
@@ -1941,43 +2107,106 @@ static void end_polls(struct fuse_conn *fc)
  * filesystem daemon and all users of the filesystem.  The exception
  * is the combination of an asynchronous request and the tricky
  * deadlock (see Documentation/filesystems/fuse.txt).
- *
- * During the aborting, progression of requests from the pending and
- * processing lists onto the io list, and progression of new requests
- * onto the pending list is prevented by req->connected being false.
- *
- * Progression of requests under I/O to the processing list is
- * prevented by the req->aborted flag being true for these requests.
- * For this reason requests on the io list must be aborted first.
  */
 void fuse_abort_conn(struct fuse_conn *fc)
 {
 	spin_lock(&fc->lock);
-	if (fc->connected) {
-		fc->connected = 0;
-		fc->blocked = 0;
-		end_io_requests(fc);
-		end_queued_requests(fc);
-		end_polls(fc);
-		wake_up_all(&fc->waitq);
-		wake_up_all(&fc->blocked_waitq);
-		kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+	if (fc->connected)
+		fuse_disconnect(fc);
+	else
+		spin_unlock(&fc->lock);
+}
+EXPORT_SYMBOL_GPL(fuse_abort_conn);
+
+/*
+ * Wake up the readers of all channels, after the connection has been
+ * disconnected
+ */
+void fuse_dev_wake_all(struct fuse_conn *fc)
+{
+	struct fuse_chan *chan;
+
+	list_for_each_entry(chan, &fc->chans, entry) {
+		kill_fasync(&chan->fasync, SIGIO, POLL_IN);
+		wake_up_all(&chan->waitq);
 	}
+}
+
+/*
+ * Release a cloned channel.  Its CPUs go back to the main channel, and
+ * the requests still queued on it are aborted.  Forgets don't need a
+ * reply on the same channel, so they are handed over to the main
+ * channel.
+ *
+ * The channel is taken off fc->chans and freed once requesters waiting
+ * on it are done.  After a disconnect fuse_disconnect() may be walking
+ * the list without fc->lock, so it is left to fuse_conn_put() then;
+ * no more channels can be cloned at that point.
+ */
+static void fuse_chan_release(struct fuse_chan *chan)
+{
+	struct fuse_conn *fc = chan->fc;
+	struct fuse_chan *main_chan = &fc->chan;
+	struct fuse_forget_link *head;
+	struct fuse_forget_link *tail;
+	bool unlinked;
+	int cpu;
+
+	spin_lock(&fc->lock);
+	if (fc->cpu_chan) {
+		for_each_possible_cpu(cpu) {
+			if (fc->cpu_chan[cpu] == chan)
+				fc->cpu_chan[cpu] = NULL;
+		}
+	}
+	unlinked = fc->connected;
+	if (unlinked)
+		list_del(&chan->entry);
 	spin_unlock(&fc->lock);
+
+	spin_lock(&chan->lock);
+	head = chan->forget_list_head.next;
+	tail = chan->forget_list_tail;
+	chan->forget_list_head.next = NULL;
+	chan->forget_list_tail = &chan->forget_list_head;
+	fuse_chan_abort(chan);
+	spin_unlock(&chan->lock);
+
+	if (head) {
+		spin_lock(&main_chan->lock);
+		if (chan_connected(main_chan)) {
+			main_chan->forget_list_tail->next = head;
+			main_chan->forget_list_tail = tail;
+			head = NULL;
+			wake_up(&main_chan->waitq);
+			kill_fasync(&main_chan->fasync, SIGIO, POLL_IN);
+		}
+		spin_unlock(&main_chan->lock);
+	}
+
+	while (head) {
+		struct fuse_forget_link *forget = head;
+
+		head = forget->next;
+		kfree(forget);
+	}
+
+	if (unlinked)
+		fuse_chan_put(chan);
 }
-EXPORT_SYMBOL_GPL(fuse_abort_conn);
 
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (fc) {
-		spin_lock(&fc->lock);
-		fc->connected = 0;
-		fc->blocked = 0;
-		end_queued_requests(fc);
-		end_polls(fc);
-		wake_up_all(&fc->blocked_waitq);
-		spin_unlock(&fc->lock);
+	struct fuse_chan *chan = fuse_get_chan(file);
+	if (chan) {
+		struct fuse_conn *fc = chan->fc;
+
+		if (chan == &fc->chan) {
+			spin_lock(&fc->lock);
+			fuse_disconnect(fc);
+		} else {
+			fuse_chan_release(chan);
+		}
 		fuse_conn_put(fc);
 	}
 
@@ -1987,12 +2216,139 @@ EXPORT_SYMBOL_GPL(fuse_dev_release);
 
 static int fuse_dev_fasync(int fd, struct file *file, int on)
 {
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (!fc)
+	struct fuse_chan *chan = fuse_get_chan(file);
+	if (!chan)
 		return -EPERM;
 
 	/* No locking - fasync_helper does its own locking */
-	return fasync_helper(fd, file, on, &fc->fasync);
+	return fasync_helper(fd, file, on, &chan->fasync);
+}
+
+void fuse_chan_init(struct fuse_chan *chan, struct fuse_conn *fc)
+{
+	memset(chan, 0, sizeof(*chan));
+	spin_lock_init(&chan->lock);
+	chan->fc = fc;
+	chan->connected = 1;
+	init_waitqueue_head(&chan->waitq);
+	INIT_LIST_HEAD(&chan->pending);
+	INIT_LIST_HEAD(&chan->processing);
+	INIT_LIST_HEAD(&chan->io);
+	INIT_LIST_HEAD(&chan->interrupts);
+	chan->forget_list_tail = &chan->forget_list_head;
+	INIT_LIST_HEAD(&chan->entry);
+	atomic_set(&chan->count, 1);
+}
+
+/*
+ * Attach @file as a new channel of the connection that @oldfd, another
+ * /dev/fuse file, belongs to.
+ */
+static long fuse_dev_clone(struct file *file, int oldfd)
+{
+	struct fuse_chan *chan;
+	struct fuse_conn *fc;
+	struct file *old;
+	int err;
+
+	chan = kmalloc(sizeof(*chan), GFP_KERNEL);
+	if (!chan)
+		return -ENOMEM;
+
+	err = -EBADF;
+	old = fget(oldfd);
+	if (!old)
+		goto out_free;
+
+	mutex_lock(&fuse_mutex);
+	err = -EINVAL;
+	if (old->f_op != &fuse_dev_operations || !old->private_data ||
+	    file->private_data)
+		goto out_unlock;
+
+	fc = fuse_get_chan(old)->fc;
+	fuse_chan_init(chan, fc);
+
+	spin_lock(&fc->lock);
+	err = -ENODEV;
+	if (fc->connected) {
+		list_add_tail(&chan->entry, &fc->chans);
+		file->private_data = chan;
+		fuse_conn_get(fc);
+		err = 0;
+	}
+	spin_unlock(&fc->lock);
+
+ out_unlock:
+	mutex_unlock(&fuse_mutex);
+	fput(old);
+ out_free:
+	if (err)
+		kfree(chan);
+	return err;
+}
+
+/* Queue the requests submitted on @cpu on this channel */
+static long fuse_dev_bind_cpu(struct fuse_chan *chan, unsigned cpu)
+{
+	struct fuse_conn *fc = chan->fc;
+	struct fuse_chan **cpu_chan = NULL;
+	int err;
+
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	if (!fc->cpu_chan) {
+		cpu_chan = kcalloc(nr_cpu_ids, sizeof(cpu_chan[0]),
+				   GFP_KERNEL);
+		if (!cpu_chan)
+			return -ENOMEM;
+	}
+
+	spin_lock(&fc->lock);
+	err = -ENODEV;
+	if (fc->connected) {
+		if (!fc->cpu_chan) {
+			smp_wmb();
+			fc->cpu_chan = cpu_chan;
+			cpu_chan = NULL;
+		}
+		smp_wmb();
+		fc->cpu_chan[cpu] = chan == &fc->chan ? NULL : chan;
+		err = 0;
+	}
+	spin_unlock(&fc->lock);
+	kfree(cpu_chan);
+
+	return err;
+}
+
+static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
+			   unsigned long arg)
+{
+	struct fuse_chan *chan;
+	u32 val;
+
+	switch (cmd) {
+	case FUSE_DEV_IOC_CLONE:
+		if (get_user(val, (u32 __user *) arg))
+			return -EFAULT;
+
+		return fuse_dev_clone(file, val);
+
+	case FUSE_DEV_IOC_BIND_CPU:
+		chan = fuse_get_chan(file);
+		if (!chan)
+			return -EPERM;
+
+		if (get_user(val, (u32 __user *) arg))
+			return -EFAULT;
+
+		return fuse_dev_bind_cpu(chan, val);
+
+	default:
+		return -ENOTTY;
+	}
 }
 
 const struct file_operations fuse_dev_operations = {
@@ -2007,6 +2363,8 @@ const struct file_operations fuse_dev_operations = {
 	.poll		= fuse_dev_poll,
 	.release	= fuse_dev_release,
 	.fasync		= fuse_dev_fasync,
+	.unlocked_ioctl	= fuse_dev_ioctl,
+	.compat_ioctl	= fuse_dev_ioctl,
 };
 EXPORT_SYMBOL_GPL(fuse_dev_operations);
 
@@ -23,8 +23,14 @@
 #include <linux/poll.h>
 #include <linux/workqueue.h>
 
-/** Max number of pages that can be used in a single read request */
-#define FUSE_MAX_PAGES_PER_REQ 32
+/** Default max number of pages that can be used in a single read request */
+#define FUSE_DEFAULT_MAX_PAGES_PER_REQ 32
+
+/** Maximum of max_pages received in init_out */
+#define FUSE_MAX_MAX_PAGES 256
+
+/** Number of page pointers embedded in struct fuse_req */
+#define FUSE_REQ_INLINE_PAGES FUSE_DEFAULT_MAX_PAGES_PER_REQ
 
 /** Bias for fi->writectr, meaning new writepages must not be sent */
 #define FUSE_NOWRITE INT_MIN
@@ -103,6 +109,7 @@ struct fuse_inode {
 };
 
 struct fuse_conn;
+struct fuse_chan;
 
 /** FUSE specific file data */
 struct fuse_file {
@@ -212,7 +219,7 @@ enum fuse_req_state {
  */
 struct fuse_req {
 	/** This can be on either pending processing or io lists in
-	    fuse_conn */
+	    fuse_chan, or on the background queue of fuse_conn */
 	struct list_head list;
 
 	/** Entry on the interrupts list  */
@@ -227,7 +234,7 @@ struct fuse_req {
 	/*
 	 * The following bitfields are either set once before the
 	 * request is queued or setting/clearing them is protected by
-	 * fuse_conn->lock
+	 * the lock of the channel the request was queued on
 	 */
 
 	/** True if the request has reply */
@@ -288,7 +295,13 @@ struct fuse_req {
 	} misc;
 
 	/** page vector */
-	struct page *pages[FUSE_MAX_PAGES_PER_REQ];
+	struct page **pages;
+
+	/** size of the 'pages' array */
+	unsigned max_pages;
+
+	/** inline page vector */
+	struct page *inline_pages[FUSE_REQ_INLINE_PAGES];
 
 	/** number of pages in vector */
 	unsigned num_pages;
@@ -310,6 +323,66 @@ struct fuse_req {
 
 	/** Request is stolen from fuse_file->reserved_req */
 	struct file *stolen_file;
+
+	/** Channel the request was queued on */
+	struct fuse_chan *chan;
+};
+
+/**
+ * A request channel.
+ *
+ * Every /dev/fuse file attached to a connection is a channel with its
+ * own queues and lock.  The file used for mounting is the connection's
+ * main channel, further ones are created with FUSE_DEV_IOC_CLONE.
+ * Requests are queued on the channel bound to the submitting CPU with
+ * FUSE_DEV_IOC_BIND_CPU, or on the main channel, and the reply must be
+ * written to the channel the request was read from.
+ */
+struct fuse_chan {
+	/** Lock protecting the queues and the state of queued requests */
+	spinlock_t lock;
+
+	/** The connection this channel belongs to */
+	struct fuse_conn *fc;
+
+	/** Channel accepts requests, cleared on abort and release */
+	unsigned connected;
+
+	/** Readers of the channel are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** The list of pending requests */
+	struct list_head pending;
+
+	/** The list of requests being processed */
+	struct list_head processing;
+
+	/** The list of requests under I/O */
+	struct list_head io;
+
+	/** Pending interrupts */
+	struct list_head interrupts;
+
+	/** Queue of pending forgets */
+	struct fuse_forget_link forget_list_head;
+	struct fuse_forget_link *forget_list_tail;
+
+	/** Batching of FORGET requests (positive indicates FORGET batch) */
+	int forget_batch;
+
+	/** O_ASYNC requests */
+	struct fasync_struct *fasync;
+
+	/** Entry on fuse_conn->chans */
+	struct list_head entry;
+
+	/** References to a cloned channel: its file, and requesters
+	    waiting for an answer on it */
+	atomic_t count;
+
+	/** A released channel is freed after an RCU grace period, for
+	    fuse_lock_chan() */
+	struct rcu_head rcu;
 };
 
 /**
@@ -344,17 +417,20 @@ struct fuse_conn {
 	/** Maximum write size */
 	unsigned max_write;
 
-	/** Readers of the connection are waiting on this */
-	wait_queue_head_t waitq;
+	/** Maximum number of pages that can be used in a single request */
+	unsigned max_pages;
 
-	/** The list of pending requests */
-	struct list_head pending;
+	/** The main channel */
+	struct fuse_chan chan;
 
-	/** The list of requests being processed */
-	struct list_head processing;
+	/** All channels of the connection.  Cloned channels are removed
+	    when released while the connection is still connected, none
+	    are added or removed after the connection is disconnected */
+	struct list_head chans;
 
-	/** The list of requests under I/O */
-	struct list_head io;
+	/** Channel each CPU queues its requests on, NULL for the main
+	    channel.  Allocated on the first FUSE_DEV_IOC_BIND_CPU */
+	struct fuse_chan **cpu_chan;
 
 	/** The next unique kernel file handle */
 	u64 khctr;
@@ -377,16 +453,6 @@ struct fuse_conn {
 	/** The list of background requests set aside for later queuing */
 	struct list_head bg_queue;
 
-	/** Pending interrupts */
-	struct list_head interrupts;
-
-	/** Queue of pending forgets */
-	struct fuse_forget_link forget_list_head;
-	struct fuse_forget_link *forget_list_tail;
-
-	/** Batching of FORGET requests (positive indicates FORGET batch) */
-	int forget_batch;
-
 	/** Flag indicating if connection is blocked.  This will be
 	    the case before the INIT reply is received, and if there
 	    are too many outstading backgrounds requests */
@@ -399,7 +465,7 @@ struct fuse_conn {
 	wait_queue_head_t reserved_req_waitq;
 
 	/** The next unique request id */
-	u64 reqctr;
+	atomic64_t reqctr;
 
 	/** Connection established, cleared on umount, connection
 	    abort and device release */
@@ -472,6 +538,9 @@ struct fuse_conn {
 	/** Do multi-page cached writes */
 	unsigned big_writes:1;
 
+	/** Use the page cache as a writeback cache.  Only set in INIT */
+	unsigned writeback_cache:1;
+
 	/** Don't apply umask to creation modes */
 	unsigned dont_mask:1;
 
@@ -499,9 +568,6 @@ struct fuse_conn {
 	/** number of dentries used in the above array */
 	int ctl_ndents;
 
-	/** O_ASYNC requests */
-	struct fasync_struct *fasync;
-
 	/** Key for lock owner ID scrambling */
 	u32 scramble_key[4];
 
@@ -651,7 +717,12 @@ void fuse_ctl_cleanup(void);
  */
 struct fuse_req *fuse_request_alloc(void);
 
-struct fuse_req *fuse_request_alloc_nofs(void);
+/**
+ * Allocate a request with room for at least @npages pages
+ */
+struct fuse_req *fuse_request_alloc_pages(unsigned npages);
+
+struct fuse_req *fuse_request_alloc_nofs(unsigned npages);
 
 /**
  * Free a request
@@ -663,6 +734,11 @@ void fuse_request_free(struct fuse_req *req);
  */
 struct fuse_req *fuse_get_req(struct fuse_conn *fc);
 
+/**
+ * Get a request with room for at least @npages pages, may fail with -ENOMEM
+ */
+struct fuse_req *fuse_get_req_pages(struct fuse_conn *fc, unsigned npages);
+
 /**
  * Gets a requests for a file operation, always succeeds
  */
@@ -768,6 +844,23 @@ long fuse_do_ioctl(struct file *file, unsigned int cmd, unsigned long arg,
 unsigned fuse_file_poll(struct file *file, poll_table *wait);
 int fuse_dev_release(struct inode *inode, struct file *file);
 
+/**
+ * Initialize a request channel of the connection
+ */
+void fuse_chan_init(struct fuse_chan *chan, struct fuse_conn *fc);
+
+/**
+ * Wake up all readers of the connection's channels
+ */
+void fuse_dev_wake_all(struct fuse_conn *fc);
+
 void fuse_write_update_size(struct inode *inode, loff_t pos);
 
+/**
+ * Send the locally maintained mtime and ctime to the filesystem
+ */
+int fuse_flush_times(struct inode *inode, struct fuse_file *ff);
+
+int fuse_write_inode(struct inode *inode, struct writeback_control *wbc);
+
 #endif /* _FS_FUSE_I_H */
@@ -216,7 +216,7 @@ static struct dentry *hfsplus_file_lookup(struct inode *dir,
 	 * appear hashed, but do not put on any lists.  hlist_del()
 	 * will work fine and require no locking.
 	 */
-	hlist_add_fake(&inode->i_hash);
+	hlist_bl_add_fake(&inode->i_hash);
 
 	mark_inode_dirty(inode);
 out:
@@ -0,0 +1,1924 @@
+/*
+ * Shared application/kernel submission and completion ring pairs, for
+ * supporting fast/efficient IO.
+ *
+ * A note on the read/write ordering memory barriers that are matched between
+ * the application and kernel side.  When the application reads the CQ ring
+ * tail, it must use an appropriate smp_rmb() to order with the smp_wmb()
+ * the kernel uses after writing the tail.  Failure to do so could cause a
+ * delay in when the application notices that completion events available.
+ * This isn't a fatal condition.  Likewise, the application must use an
+ * appropriate smp_wmb() both before writing the SQ tail, and after writing
+ * the SQ tail.  The first one orders the sqe writes with the tail write, and
+ * the latter is paired with the smp_rmb() the kernel will issue before
+ * reading the SQ tail on submission.
+ *
+ * Also see the examples in tools/io_uring/ for how to use the interface
+ * from an application.
+ *
+ * Requests are issued from the submitting task when they can be expected
+ * not to block: O_DIRECT reads and writes, which complete asynchronously
+ * through ->ki_complete, and buffered reads of ranges that are already in
+ * the page cache.  Everything else is handed to a bounded per-ring
+ * workqueue that runs it in the submitter's mm and with its credentials.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/errno.h>
+#include <linux/syscalls.h>
+#include <linux/compat.h>
+#include <linux/aio.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/mm.h>
+#include <linux/mman.h>
+#include <linux/mmu_context.h>
+#include <linux/pagemap.h>
+#include <linux/hugetlb.h>
+#include <linux/vmalloc.h>
+#include <linux/slab.h>
+#include <linux/poll.h>
+#include <linux/kthread.h>
+#include <linux/workqueue.h>
+#include <linux/blkdev.h>
+#include <linux/security.h>
+#include <linux/anon_inodes.h>
+#include <linux/cred.h>
+#include <linux/sched.h>
+#include <linux/uio.h>
+#include <linux/io_uring.h>
+
+#include <asm/uaccess.h>
+
+#define IORING_MAX_ENTRIES	4096
+#define IORING_MAX_FIXED_FILES	1024
+#define IORING_MAX_BUF_SIZE	(1UL << 30)
+
+/* buffered reads of at most this many cached pages are issued inline */
+#define IO_CACHED_READ_PAGES	16
+
+/* start a block plug when submitting more than this many sqes */
+#define IO_PLUG_THRESHOLD	2
+
+struct io_uring {
+	u32 head ____cacheline_aligned_in_smp;
+	u32 tail ____cacheline_aligned_in_smp;
+};
+
+struct io_sq_ring {
+	struct io_uring		r;
+	u32			ring_mask;
+	u32			ring_entries;
+	u32			dropped;
+	u32			flags;
+	u32			array[];
+};
+
+struct io_cq_ring {
+	struct io_uring		r;
+	u32			ring_mask;
+	u32			ring_entries;
+	u32			overflow;
+	struct io_uring_cqe	cqes[] ____cacheline_aligned_in_smp;
+};
+
+struct io_mapped_ubuf {
+	u64			ubuf;
+	size_t			len;
+	unsigned int		nr_pages;
+	struct page		**pages;
+	void			*vmap;		/* kernel mapping of pages */
+	void			*kaddr;		/* kernel address of ubuf */
+};
+
+struct io_ring_ctx {
+	/* one for the ring file plus one per request in flight */
+	atomic_t		refs;
+	struct completion	ctx_done;
+
+	unsigned int		flags;
+	bool			compat;
+
+	/* SQ ring */
+	struct {
+		struct io_sq_ring	*sq_ring;
+		unsigned		cached_sq_head;
+		unsigned		sq_entries;
+		unsigned		sq_mask;
+		unsigned		sq_thread_idle;
+		struct io_uring_sqe	*sq_sqes;
+	} ____cacheline_aligned_in_smp;
+
+	struct workqueue_struct	*sqo_wq;
+	struct task_struct	*sqo_thread;	/* if using sq thread polling */
+	struct mm_struct	*sqo_mm;
+	wait_queue_head_t	sqo_wait;
+	const struct cred	*creds;
+
+	/* CQ ring */
+	struct {
+		struct io_cq_ring	*cq_ring;
+		unsigned		cached_cq_tail;
+		unsigned		cq_entries;
+		unsigned		cq_mask;
+		wait_queue_head_t	wait;
+		wait_queue_head_t	cq_wait;
+	} ____cacheline_aligned_in_smp;
+
+	/*
+	 * Registered files and buffers.  Only changed with uring_lock held
+	 * and no requests in flight.
+	 */
+	struct file		**user_files;
+	unsigned		nr_user_files;
+	unsigned		nr_user_bufs;
+	struct io_mapped_ubuf	*user_bufs;
+
+	struct mutex		uring_lock;
+
+	struct {
+		spinlock_t		completion_lock;
+		struct list_head	cancel_list;	/* pending poll requests */
+		bool			cancel_polls;	/* ring is going away */
+	} ____cacheline_aligned_in_smp;
+};
+
+struct io_poll_iocb {
+	wait_queue_head_t	*head;
+	unsigned int		events;
+	bool			canceled;
+	bool			armed;		/* wakeups may queue the work */
+	wait_queue_t		wait;
+};
+
+struct io_kiocb {
+	union {
+		struct kiocb		rw;
+		struct io_poll_iocb	poll;
+	};
+
+	struct io_ring_ctx	*ctx;
+	struct file		*file;
+	struct list_head	list;
+	struct work_struct	work;
+	u64			user_data;
+	u8			opcode;
+	unsigned int		flags;
+#define REQ_F_FIXED_FILE	1	/* ctx owns file */
+#define REQ_F_KERNEL_BUF	2	/* iov points at a fixed buffer mapping */
+
+	/* fsync */
+	loff_t			fsync_start;
+	loff_t			fsync_end;
+	int			fsync_datasync;
+
+	/* read/write */
+	struct iovec		*iov;
+	unsigned long		nr_segs;
+	struct iovec		fast_iov[UIO_FASTIOV];
+};
+
+static struct kmem_cache *req_cachep;
+
+static const struct file_operations io_uring_fops;
+
+/* Deferred final fputs of requests completed from interrupt context */
+static void io_fput_routine(struct work_struct *);
+static DECLARE_WORK(io_fput_work, io_fput_routine);
+static DEFINE_SPINLOCK(io_fput_lock);
+static LIST_HEAD(io_fput_head);
+
+static void io_ring_ctx_ref_free(struct io_ring_ctx *ctx)
+{
+	if (atomic_dec_and_test(&ctx->refs))
+		complete(&ctx->ctx_done);
+}
+
+static struct io_kiocb *io_get_req(struct io_ring_ctx *ctx)
+{
+	struct io_kiocb *req;
+
+	req = kmem_cache_alloc(req_cachep, GFP_KERNEL);
+	if (unlikely(!req))
+		return NULL;
+
+	atomic_inc(&ctx->refs);
+	req->ctx = ctx;
+	req->file = NULL;
+	req->flags = 0;
+	req->iov = req->fast_iov;
+	INIT_LIST_HEAD(&req->list);
+	return req;
+}
+
+static void __io_free_req(struct io_kiocb *req)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+
+	kmem_cache_free(req_cachep, req);
+	io_ring_ctx_ref_free(ctx);
+}
+
+static void io_fput_routine(struct work_struct *work)
+{
+	spin_lock_irq(&io_fput_lock);
+	while (!list_empty(&io_fput_head)) {
+		struct io_kiocb *req = list_first_entry(&io_fput_head,
+						struct io_kiocb, list);
+
+		list_del(&req->list);
+		spin_unlock_irq(&io_fput_lock);
+
+		fput(req->file);
+		__io_free_req(req);
+
+		spin_lock_irq(&io_fput_lock);
+	}
+	spin_unlock_irq(&io_fput_lock);
+}
+
+/*
+ * Release a request.  May be called from interrupt context when the
+ * request was completed by the block layer, so a final fput() of a
+ * file that was closed meanwhile is deferred to process context.
+ */
+static void io_free_req(struct io_kiocb *req)
+{
+	unsigned long flags;
+
+	if (req->iov != req->fast_iov)
+		kfree(req->iov);
+	if (req->file && !(req->flags & REQ_F_FIXED_FILE)) {
+		if (unlikely(!fput_atomic(req->file))) {
+			spin_lock_irqsave(&io_fput_lock, flags);
+			list_add(&req->list, &io_fput_head);
+			spin_unlock_irqrestore(&io_fput_lock, flags);
+			schedule_work(&io_fput_work);
+			return;
+		}
+	}
+	__io_free_req(req);
+}
+
+static struct io_uring_cqe *io_get_cqring(struct io_ring_ctx *ctx)
+{
+	struct io_cq_ring *ring = ctx->cq_ring;
+	unsigned tail;
+
+	tail = ctx->cached_cq_tail;
+	/* See comment at the top of the file */
+	smp_rmb();
+	if (tail - ACCESS_ONCE(ring->r.head) == ctx->cq_entries)
+		return NULL;
+
+	ctx->cached_cq_tail++;
+	return &ring->cqes[tail & ctx->cq_mask];
+}
+
+static void io_cqring_fill_event(struct io_ring_ctx *ctx, u64 ki_user_data,
+				 long res)
+{
+	struct io_uring_cqe *cqe;
+
+	/*
+	 * If we can't get a cq entry, userspace overflowed the
+	 * submission (by quite a lot).  Increment the overflow count in
+	 * the ring.
+	 */
+	cqe = io_get_cqring(ctx);
+	if (cqe) {
+		ACCESS_ONCE(cqe->user_data) = ki_user_data;
+		ACCESS_ONCE(cqe->res) = res;
+		ACCESS_ONCE(cqe->flags) = 0;
+	} else {
+		unsigned overflow = ACCESS_ONCE(ctx->cq_ring->overflow);
+
+		ACCESS_ONCE(ctx->cq_ring->overflow) = overflow + 1;
+	}
+}
+
+static void io_commit_cqring(struct io_ring_ctx *ctx)
+{
+	struct io_cq_ring *ring = ctx->cq_ring;
+
+	if (ctx->cached_cq_tail != ACCESS_ONCE(ring->r.tail)) {
+		/* order cqe stores with ring update */
+		smp_wmb();
+		ACCESS_ONCE(ring->r.tail) = ctx->cached_cq_tail;
+	}
+}
+
+static void io_cqring_ev_posted(struct io_ring_ctx *ctx)
+{
+	/* order the tail update with the waitqueue checks */
+	smp_mb();
+	if (waitqueue_active(&ctx->wait))
+		wake_up(&ctx->wait);
+	if (waitqueue_active(&ctx->cq_wait))
+		wake_up_interruptible(&ctx->cq_wait);
+}
+
+static void io_cqring_add_event(struct io_ring_ctx *ctx, u64 user_data,
+				long res)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctx->completion_lock, flags);
+	io_cqring_fill_event(ctx, user_data, res);
+	io_commit_cqring(ctx);
+	spin_unlock_irqrestore(&ctx->completion_lock, flags);
+
+	io_cqring_ev_posted(ctx);
+}
+
+static unsigned io_cqring_events(struct io_cq_ring *ring)
+{
+	/* See comment at the top of this file */
+	smp_rmb();
+	return ACCESS_ONCE(ring->r.tail) - ACCESS_ONCE(ring->r.head);
+}
+
+static void io_complete_rw(struct kiocb *kiocb, long res, long res2)
+{
+	struct io_kiocb *req = container_of(kiocb, struct io_kiocb, rw);
+
+	if (kiocb->ki_dtor)
+		kiocb->ki_dtor(kiocb);
+	io_cqring_add_event(req->ctx, req->user_data, res);
+	io_free_req(req);
+}
+
+/*
+ * Requests that ran to completion without -EIOCBQUEUED finish here, like
+ * aio_run_iocb() does for the retry methods.
+ */
+static void io_rw_done(struct kiocb *kiocb, ssize_t ret)
+{
+	switch (ret) {
+	case -EIOCBQUEUED:
+		break;
+	case -ERESTARTSYS:
+	case -ERESTARTNOINTR:
+	case -ERESTARTNOHAND:
+	case -ERESTART_RESTARTBLOCK:
+		/*
+		 * We can't just restart the syscall, since previously
+		 * submitted sqes may already be in progress. Just fail this
+		 * IO with EINTR.
+		 */
+		ret = -EINTR;
+		/* fall through */
+	default:
+		kiocb->ki_complete(kiocb, ret, 0);
+	}
+}
+
+static void io_init_kiocb(struct io_kiocb *req, loff_t pos)
+{
+	struct kiocb *kiocb = &req->rw;
+
+	memset(kiocb, 0, sizeof(*kiocb));
+	kiocb->ki_users = 1;
+	kiocb->ki_filp = req->file;
+	kiocb->ki_pos = pos;
+	kiocb->ki_opcode = req->opcode;
+	kiocb->ki_complete = io_complete_rw;
+	INIT_LIST_HEAD(&kiocb->ki_run_list);
+	INIT_LIST_HEAD(&kiocb->ki_list);
+}
+
+static int io_import_iovec(struct io_ring_ctx *ctx, int rw,
+			   struct io_kiocb *req, u64 addr, u32 nr_segs)
+{
+	ssize_t ret;
+
+#ifdef CONFIG_COMPAT
+	if (ctx->compat)
+		ret = compat_rw_copy_check_uvector(rw,
+				(struct compat_iovec __user *)(unsigned long)addr,
+				nr_segs, UIO_FASTIOV, req->fast_iov, &req->iov);
+	else
+#endif
+		ret = rw_copy_check_uvector(rw,
+				(struct iovec __user *)(unsigned long)addr,
+				nr_segs, UIO_FASTIOV, req->fast_iov, &req->iov);
+	if (ret < 0)
+		return ret;
+
+	req->nr_segs = nr_segs;
+	req->rw.ki_nbytes = req->rw.ki_left = ret;
+	return 0;
+}
+
+static bool io_file_page_cache_copy(struct file *file)
+{
+	umode_t mode = file->f_path.dentry->d_inode->i_mode;
+
+	return S_ISREG(mode) || S_ISBLK(mode);
+}
+
+static int io_import_fixed(struct io_ring_ctx *ctx, struct io_kiocb *req,
+			   u64 buf_addr, u32 len, u16 buf_index)
+{
+	struct io_mapped_ubuf *imu;
+
+	if (unlikely(buf_index >= ctx->nr_user_bufs))
+		return -EFAULT;
+
+	imu = &ctx->user_bufs[buf_index];
+	/* overflow */
+	if (buf_addr + len < buf_addr)
+		return -EFAULT;
+	/* not inside the mapped region */
+	if (buf_addr < imu->ubuf || buf_addr + len > imu->ubuf + imu->len)
+		return -EFAULT;
+
+	/*
+	 * The pages are pinned and mapped in the kernel for the life of the
+	 * registration, so buffered I/O copies straight to that mapping.
+	 * That is only done for regular files and block devices, whose
+	 * buffered I/O just copies data through the page cache: other
+	 * ->aio_read/->aio_write methods may interpret the buffer and copy
+	 * through user pointers found in it, which must not be run under
+	 * KERNEL_DS.  O_DIRECT needs the user address to build its bios,
+	 * but the pinned pages keep get_user_pages_fast() on its lockless
+	 * path.
+	 */
+	if ((req->file->f_flags & O_DIRECT) ||
+	    !io_file_page_cache_copy(req->file)) {
+		req->fast_iov[0].iov_base = (void __user *)(unsigned long)buf_addr;
+	} else {
+		req->fast_iov[0].iov_base = (void __user *)
+			(imu->kaddr + (buf_addr - imu->ubuf));
+		req->flags |= REQ_F_KERNEL_BUF;
+	}
+	req->fast_iov[0].iov_len = len;
+	req->nr_segs = 1;
+	req->rw.ki_nbytes = req->rw.ki_left = len;
+	return 0;
+}
+
+static int io_prep_rw(struct io_ring_ctx *ctx, struct io_kiocb *req,
+		      const struct io_uring_sqe *sqe, bool has_user)
+{
+	struct file *file = req->file;
+	bool read = req->opcode == IORING_OP_READV ||
+		    req->opcode == IORING_OP_READ_FIXED;
+	u64 addr = ACCESS_ONCE(sqe->addr);
+	u32 len = ACCESS_ONCE(sqe->len);
+	int ret;
+
+	if (ACCESS_ONCE(sqe->ioprio) || ACCESS_ONCE(sqe->rw_flags))
+		return -EINVAL;
+
+	if (read) {
+		if (unlikely(!(file->f_mode & FMODE_READ)))
+			return -EBADF;
+		if (unlikely(!file->f_op->aio_read))
+			return -EINVAL;
+		ret = security_file_permission(file, MAY_READ);
+	} else {
+		if (unlikely(!(file->f_mode & FMODE_WRITE)))
+			return -EBADF;
+		if (unlikely(!file->f_op->aio_write))
+			return -EINVAL;
+		ret = security_file_permission(file, MAY_WRITE);
+	}
+	if (unlikely(ret))
+		return ret;
+
+	io_init_kiocb(req, ACCESS_ONCE(sqe->off));
+	/* This matches the pread()/pwrite() logic */
+	if (req->rw.ki_pos < 0)
+		return -EINVAL;
+
+	if (req->opcode == IORING_OP_READ_FIXED ||
+	    req->opcode == IORING_OP_WRITE_FIXED) {
+		ret = io_import_fixed(ctx, req, addr, len,
+				      ACCESS_ONCE(sqe->buf_index));
+		if (ret || (req->flags & REQ_F_KERNEL_BUF))
+			return ret;
+	}
+
+	/* the sq thread may have lost the mm of its creator */
+	if (!has_user)
+		return -EFAULT;
+	if (req->opcode == IORING_OP_READ_FIXED ||
+	    req->opcode == IORING_OP_WRITE_FIXED)
+		return 0;
+	return io_import_iovec(ctx, read ? READ : WRITE, req, addr, len);
+}
+
+static ssize_t io_issue_rw(struct io_kiocb *req)
+{
+	struct kiocb *kiocb = &req->rw;
+	struct file *file = req->file;
+
+	if (req->opcode == IORING_OP_READV ||
+	    req->opcode == IORING_OP_READ_FIXED)
+		return file->f_op->aio_read(kiocb, req->iov, req->nr_segs,
+					    kiocb->ki_pos);
+	return file->f_op->aio_write(kiocb, req->iov, req->nr_segs,
+				     kiocb->ki_pos);
+}
+
+static ssize_t io_issue_fsync(struct io_kiocb *req)
+{
+	return vfs_fsync_range(req->file, req->fsync_start, req->fsync_end,
+			       req->fsync_datasync);
+}
+
+/*
+ * Whether every page of a buffered read is uptodate in the page cache,
+ * in which case the read can run in the submitting task without waiting
+ * for I/O.  The answer may be stale by the time the read runs, which
+ * only costs a short synchronous read.
+ */
+static bool io_file_range_cached(struct file *file, loff_t pos, size_t len)
+{
+	struct address_space *mapping = file->f_mapping;
+	pgoff_t index, end;
+
+	if (!len)
+		return true;
+
+	index = pos >> PAGE_CACHE_SHIFT;
+	end = (pos + len - 1) >> PAGE_CACHE_SHIFT;
+	if (end - index >= IO_CACHED_READ_PAGES)
+		return false;
+
+	for (; index <= end; index++) {
+		struct page *page = find_get_page(mapping, index);
+		bool uptodate = page && PageUptodate(page);
+
+		if (page)
+			page_cache_release(page);
+		if (!uptodate)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Decide whether a prepared request would block the submitter, and so has
+ * to go to the ring's workqueue instead.
+ */
+static bool io_should_punt(struct io_kiocb *req)
+{
+	struct file *file = req->file;
+	umode_t mode = file->f_path.dentry->d_inode->i_mode;
+	bool seekable = S_ISREG(mode) || S_ISBLK(mode);
+
+	switch (req->opcode) {
+	case IORING_OP_READV:
+	case IORING_OP_READ_FIXED:
+		if (!seekable)
+			return true;
+		if (file->f_flags & O_DIRECT)
+			return false;
+		return !io_file_range_cached(file, req->rw.ki_pos,
+					     req->rw.ki_left);
+	case IORING_OP_WRITEV:
+	case IORING_OP_WRITE_FIXED:
+		return !seekable || !(file->f_flags & O_DIRECT);
+	}
+	return true;
+}
+
+static bool io_op_needs_mm(struct io_kiocb *req)
+{
+	switch (req->opcode) {
+	case IORING_OP_READV:
+	case IORING_OP_WRITEV:
+	case IORING_OP_READ_FIXED:
+	case IORING_OP_WRITE_FIXED:
+		return !(req->flags & REQ_F_KERNEL_BUF);
+	}
+	return false;
+}
+
+static ssize_t __io_issue(struct io_kiocb *req)
+{
+	mm_segment_t old_fs;
+	ssize_t ret;
+
+	if (req->opcode == IORING_OP_FSYNC)
+		return io_issue_fsync(req);
+
+	if (!(req->flags & REQ_F_KERNEL_BUF))
+		return io_issue_rw(req);
+
+	old_fs = get_fs();
+	set_fs(KERNEL_DS);
+	ret = io_issue_rw(req);
+	set_fs(old_fs);
+	return ret;
+}
+
+/*
+ * Workqueue handler for requests that may block.  Runs them in the mm of
+ * the task that set up the ring, with its credentials.
+ */
+static void io_sq_wq_submit_work(struct work_struct *work)
+{
+	struct io_kiocb *req = container_of(work, struct io_kiocb, work);
+	struct io_ring_ctx *ctx = req->ctx;
+	struct mm_struct *cur_mm = NULL;
+	mm_segment_t old_fs = get_fs();
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	old_cred = override_creds(ctx->creds);
+	set_fs(USER_DS);
+	if (io_op_needs_mm(req)) {
+		if (!atomic_inc_not_zero(&ctx->sqo_mm->mm_users)) {
+			ret = -EFAULT;
+			goto out;
+		}
+		cur_mm = ctx->sqo_mm;
+		use_mm(cur_mm);
+	}
+
+	ret = __io_issue(req);
+
+	if (cur_mm) {
+		unuse_mm(cur_mm);
+		mmput(cur_mm);
+	}
+out:
+	set_fs(old_fs);
+	revert_creds(old_cred);
+
+	if (req->opcode == IORING_OP_FSYNC) {
+		io_cqring_add_event(ctx, req->user_data, ret);
+		io_free_req(req);
+	} else {
+		io_rw_done(&req->rw, ret);
+	}
+}
+
+static void io_issue_sqe(struct io_kiocb *req)
+{
+	if (io_should_punt(req)) {
+		INIT_WORK(&req->work, io_sq_wq_submit_work);
+		queue_work(req->ctx->sqo_wq, &req->work);
+		return;
+	}
+	io_rw_done(&req->rw, __io_issue(req));
+}
+
+static int io_prep_fsync(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	u32 fsync_flags = ACCESS_ONCE(sqe->fsync_flags);
+	loff_t off = ACCESS_ONCE(sqe->off);
+	u32 len = ACCESS_ONCE(sqe->len);
+
+	if (unlikely(ACCESS_ONCE(sqe->addr) || ACCESS_ONCE(sqe->ioprio) ||
+		     ACCESS_ONCE(sqe->buf_index)))
+		return -EINVAL;
+	if (unlikely(fsync_flags & ~IORING_FSYNC_DATASYNC))
+		return -EINVAL;
+	if (off < 0)
+		return -EINVAL;
+
+	req->fsync_start = off;
+	req->fsync_end = len ? off + len - 1 : LLONG_MAX;
+	req->fsync_datasync = !!(fsync_flags & IORING_FSYNC_DATASYNC);
+	return 0;
+}
+
+/*
+ * Poll support.  A poll request sits on the file's wait queue until an
+ * event arrives; the wake function only dequeues it and kicks the
+ * request's work, which is the one place that completes it, so the
+ * request can't go away under a concurrent wakeup or cancellation.
+ * Until io_poll_add() has finished arming the request, a wakeup only
+ * dequeues it and io_poll_add() kicks the work itself, so that the work
+ * never runs, and frees the request, while io_poll_add() still uses it.
+ */
+struct io_poll_table {
+	poll_table		pt;
+	struct io_kiocb		*req;
+	int			error;
+};
+
+static unsigned int io_poll_mask(struct file *file, poll_table *pt)
+{
+	if (!file->f_op->poll)
+		return DEFAULT_POLLMASK;
+	return file->f_op->poll(file, pt);
+}
+
+/* called with ctx->completion_lock held */
+static void io_poll_remove_one(struct io_kiocb *req)
+{
+	struct io_poll_iocb *poll = &req->poll;
+
+	spin_lock(&poll->head->lock);
+	poll->canceled = true;
+	if (!list_empty(&poll->wait.task_list)) {
+		list_del_init(&poll->wait.task_list);
+		queue_work(req->ctx->sqo_wq, &req->work);
+	}
+	spin_unlock(&poll->head->lock);
+
+	list_del_init(&req->list);
+}
+
+/*
+ * Cancel all pending poll requests for good: the ones whose work is
+ * already queued see cancel_polls and complete instead of waiting again.
+ */
+static void io_poll_remove_all(struct io_ring_ctx *ctx)
+{
+	struct io_kiocb *req;
+
+	spin_lock_irq(&ctx->completion_lock);
+	ctx->cancel_polls = true;
+	while (!list_empty(&ctx->cancel_list)) {
+		req = list_first_entry(&ctx->cancel_list, struct io_kiocb, list);
+		io_poll_remove_one(req);
+	}
+	spin_unlock_irq(&ctx->completion_lock);
+}
+
+static void io_poll_remove(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	u64 target = ACCESS_ONCE(sqe->addr);
+	struct io_kiocb *poll_req, *next;
+	int ret = -ENOENT;
+
+	spin_lock_irq(&ctx->completion_lock);
+	list_for_each_entry_safe(poll_req, next, &ctx->cancel_list, list) {
+		if (target == poll_req->user_data) {
+			io_poll_remove_one(poll_req);
+			ret = 0;
+			break;
+		}
+	}
+	spin_unlock_irq(&ctx->completion_lock);
+
+	io_cqring_add_event(ctx, req->user_data, ret);
+	io_free_req(req);
+}
+
+static void io_poll_complete_work(struct work_struct *work)
+{
+	struct io_kiocb *req = container_of(work, struct io_kiocb, work);
+	struct io_poll_iocb *poll = &req->poll;
+	struct io_ring_ctx *ctx = req->ctx;
+	unsigned int mask = 0;
+	long res;
+
+	if (!ACCESS_ONCE(poll->canceled))
+		mask = io_poll_mask(req->file, NULL) & poll->events;
+
+	spin_lock_irq(&ctx->completion_lock);
+	if (ctx->cancel_polls)
+		poll->canceled = true;
+	if (!mask && !poll->canceled) {
+		/* spurious wakeup, or the event was consumed: wait again */
+		add_wait_queue(poll->head, &poll->wait);
+		if (list_empty(&req->list))
+			list_add_tail(&req->list, &ctx->cancel_list);
+		spin_unlock_irq(&ctx->completion_lock);
+
+		/* an event may have arrived before we were back on the queue */
+		mask = io_poll_mask(req->file, NULL) & poll->events;
+		if (!mask)
+			return;
+
+		spin_lock_irq(&ctx->completion_lock);
+		spin_lock(&poll->head->lock);
+		if (list_empty(&poll->wait.task_list)) {
+			/* woken or cancelled meanwhile, work is requeued */
+			spin_unlock(&poll->head->lock);
+			spin_unlock_irq(&ctx->completion_lock);
+			return;
+		}
+		list_del_init(&poll->wait.task_list);
+		spin_unlock(&poll->head->lock);
+	}
+	list_del_init(&req->list);
+	res = poll->canceled ? -ECANCELED : mask;
+	io_cqring_fill_event(ctx, req->user_data, res);
+	io_commit_cqring(ctx);
+	spin_unlock_irq(&ctx->completion_lock);
+
+	io_cqring_ev_posted(ctx);
+	io_free_req(req);
+}
+
+static int io_poll_wake(wait_queue_t *wait, unsigned mode, int sync,
+			void *key)
+{
+	struct io_poll_iocb *poll = wait->private;
+	struct io_kiocb *req = container_of(poll, struct io_kiocb, poll);
+	unsigned long mask = (unsigned long)key;
+
+	/* for instances that support it check for an event match first: */
+	if (mask && !(mask & poll->events))
+		return 0;
+
+	list_del_init(&poll->wait.task_list);
+	if (poll->armed)
+		queue_work(req->ctx->sqo_wq, &req->work);
+	return 1;
+}
+
+static void io_poll_queue_proc(struct file *file, wait_queue_head_t *head,
+			       poll_table *p)
+{
+	struct io_poll_table *pt = container_of(p, struct io_poll_table, pt);
+
+	if (unlikely(pt->req->poll.head)) {
+		/* only one wait queue per request is supported */
+		pt->error = -EINVAL;
+		return;
+	}
+
+	pt->error = 0;
+	pt->req->poll.head = head;
+	add_wait_queue(head, &pt->req->poll.wait);
+}
+
+static int io_poll_add(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_poll_iocb *poll = &req->poll;
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_poll_table ipt;
+	bool woken = false;
+	unsigned int mask;
+
+	if (ACCESS_ONCE(sqe->addr) || ACCESS_ONCE(sqe->ioprio) ||
+	    ACCESS_ONCE(sqe->off) || ACCESS_ONCE(sqe->len) ||
+	    ACCESS_ONCE(sqe->buf_index))
+		return -EINVAL;
+
+	INIT_WORK(&req->work, io_poll_complete_work);
+	poll->events = ACCESS_ONCE(sqe->poll_events) | POLLERR | POLLHUP;
+	poll->head = NULL;
+	poll->canceled = false;
+	poll->armed = false;
+	init_waitqueue_func_entry(&poll->wait, io_poll_wake);
+	poll->wait.private = poll;
+
+	init_poll_funcptr(&ipt.pt, io_poll_queue_proc);
+	ipt.pt.key = poll->events;
+	ipt.req = req;
+	ipt.error = -EINVAL;	/* same as no support for polling */
+
+	mask = io_poll_mask(req->file, &ipt.pt) & poll->events;
+	if (mask)
+		ipt.error = 0;
+
+	spin_lock_irq(&ctx->completion_lock);
+	if (poll->head) {
+		spin_lock(&poll->head->lock);
+		if (mask || ipt.error) {
+			list_del_init(&poll->wait.task_list);
+		} else if (list_empty(&poll->wait.task_list)) {
+			/* woken before it was armed: the work looks again */
+			woken = true;
+		} else {
+			poll->armed = true;
+			list_add_tail(&req->list, &ctx->cancel_list);
+		}
+		spin_unlock(&poll->head->lock);
+	}
+	if (mask) {
+		io_cqring_fill_event(ctx, req->user_data, mask);
+		io_commit_cqring(ctx);
+	}
+	spin_unlock_irq(&ctx->completion_lock);
+
+	if (mask) {
+		io_cqring_ev_posted(ctx);
+		io_free_req(req);
+	} else if (woken) {
+		poll->armed = true;
+		queue_work(ctx->sqo_wq, &req->work);
+	}
+	return ipt.error;
+}
+
+static int io_submit_sqe(struct io_ring_ctx *ctx,
+			 const struct io_uring_sqe *sqe, u64 user_data,
+			 bool has_user)
+{
+	u8 flags = ACCESS_ONCE(sqe->flags);
+	u8 opcode = ACCESS_ONCE(sqe->opcode);
+	struct io_kiocb *req;
+	int fd, ret;
+
+	/* enforce forwards compatibility on users */
+	if (unlikely(flags & ~IOSQE_FIXED_FILE))
+		return -EINVAL;
+	if (unlikely(opcode > IORING_OP_POLL_REMOVE))
+		return -EINVAL;
+
+	if (opcode == IORING_OP_NOP) {
+		io_cqring_add_event(ctx, user_data, 0);
+		return 0;
+	}
+
+	req = io_get_req(ctx);
+	if (unlikely(!req))
+		return -EAGAIN;
+	req->user_data = user_data;
+	req->opcode = opcode;
+
+	if (opcode == IORING_OP_POLL_REMOVE) {
+		io_poll_remove(req, sqe);
+		return 0;
+	}
+
+	fd = ACCESS_ONCE(sqe->fd);
+	if (flags & IOSQE_FIXED_FILE) {
+		ret = -EBADF;
+		if (unlikely(!ctx->user_files ||
+			     (unsigned) fd >= ctx->nr_user_files))
+			goto err;
+		req->file = ctx->user_files[fd];
+		req->flags |= REQ_F_FIXED_FILE;
+	} else {
+		/* the sq thread has no file table of its own */
+		ret = -EBADF;
+		if (ctx->flags & IORING_SETUP_SQPOLL)
+			goto err;
+		req->file = fget(fd);
+		if (unlikely(!req->file))
+			goto err;
+	}
+
+	switch (opcode) {
+	case IORING_OP_POLL_ADD:
+		ret = io_poll_add(req, sqe);
+		if (ret)
+			goto err;
+		return 0;
+	case IORING_OP_FSYNC:
+		ret = io_prep_fsync(req, sqe);
+		break;
+	default:
+		ret = io_prep_rw(ctx, req, sqe, has_user);
+		break;
+	}
+	if (ret)
+		goto err;
+
+	io_issue_sqe(req);
+	return 0;
+
+err:
+	io_free_req(req);
+	return ret;
+}
+
+static void io_commit_sqring(struct io_ring_ctx *ctx)
+{
+	struct io_sq_ring *ring = ctx->sq_ring;
+
+	if (ctx->cached_sq_head != ACCESS_ONCE(ring->r.head)) {
+		/*
+		 * Ensure any loads from the SQEs are done at this point,
+		 * since once we write the new head, the application could
+		 * write new data to them.
+		 */
+		smp_mb();
+		ACCESS_ONCE(ring->r.head) = ctx->cached_sq_head;
+	}
+}
+
+/*
+ * Fetch the next sqe, if any.  The application updates the SQ tail after
+ * filling in the sqe and the array slot, see comment at the top.
+ */
+static const struct io_uring_sqe *io_get_sqring(struct io_ring_ctx *ctx)
+{
+	struct io_sq_ring *ring = ctx->sq_ring;
+	unsigned head;
+
+	while (ctx->cached_sq_head != ACCESS_ONCE(ring->r.tail)) {
+		smp_rmb();
+
+		head = ACCESS_ONCE(ring->array[ctx->cached_sq_head &
+					       ctx->sq_mask]);
+		ctx->cached_sq_head++;
+		if (likely(head < ctx->sq_entries))
+			return &ctx->sq_sqes[head];
+
+		/* drop invalid entries */
+		ACCESS_ONCE(ring->dropped) = ring->dropped + 1;
+	}
+	return NULL;
+}
+
+static unsigned io_sqring_entries(struct io_ring_ctx *ctx)
+{
+	/* See comment at the top of this file */
+	smp_rmb();
+	return ACCESS_ONCE(ctx->sq_ring->r.tail) - ctx->cached_sq_head;
+}
+
+/*
+ * Submit up to @to_submit sqes.  An sqe that fails before it could be
+ * issued is consumed and completed with the error, except when we ran out
+ * of memory for the request, in which case it is left on the ring.
+ */
+static int io_submit_sqes(struct io_ring_ctx *ctx, unsigned int to_submit,
+			  bool has_user)
+{
+	struct blk_plug plug;
+	int i, submitted = 0;
+
+	if (to_submit > IO_PLUG_THRESHOLD)
+		blk_start_plug(&plug);
+
+	for (i = 0; i < to_submit; i++) {
+		const struct io_uring_sqe *sqe;
+		unsigned head = ctx->cached_sq_head;
+		u64 user_data;
+		int ret;
+
+		sqe = io_get_sqring(ctx);
+		if (!sqe)
+			break;
+
+		user_data = ACCESS_ONCE(sqe->user_data);
+		ret = io_submit_sqe(ctx, sqe, user_data, has_user);
+		if (ret == -EAGAIN) {
+			ctx->cached_sq_head = head;
+			if (!submitted)
+				submitted = ret;
+			break;
+		}
+		if (ret)
+			io_cqring_add_event(ctx, user_data, ret);
+		submitted++;
+	}
+	io_commit_sqring(ctx);
+
+	if (to_submit > IO_PLUG_THRESHOLD)
+		blk_finish_plug(&plug);
+
+	return submitted;
+}
+
+static int io_sq_thread(void *data)
+{
+	struct io_ring_ctx *ctx = data;
+	struct mm_struct *cur_mm = NULL;
+	const struct cred *old_cred;
+	mm_segment_t old_fs;
+	unsigned long timeout;
+	DEFINE_WAIT(wait);
+
+	old_fs = get_fs();
+	set_fs(USER_DS);
+	old_cred = override_creds(ctx->creds);
+
+	timeout = jiffies + ctx->sq_thread_idle;
+	while (!kthread_should_stop()) {
+		unsigned int to_submit;
+
+		to_submit = io_sqring_entries(ctx);
+		if (!to_submit) {
+			/*
+			 * Drop the mm we were using while we idle, it may
+			 * well go away before there is more to do.
+			 */
+			if (cur_mm) {
+				unuse_mm(cur_mm);
+				mmput(cur_mm);
+				cur_mm = NULL;
+			}
+
+			/* keep spinning until the idle period expires */
+			if (time_before(jiffies, timeout)) {
+				cond_resched();
+				continue;
+			}
+
+			prepare_to_wait(&ctx->sqo_wait, &wait,
+					TASK_INTERRUPTIBLE);
+
+			/* tell the application we need a wakeup */
+			ctx->sq_ring->flags |= IORING_SQ_NEED_WAKEUP;
+			smp_mb();
+
+			if (!io_sqring_entries(ctx) && !kthread_should_stop()) {
+				schedule();
+				if (signal_pending(current))
+					flush_signals(current);
+			}
+			finish_wait(&ctx->sqo_wait, &wait);
+
+			ctx->sq_ring->flags &= ~IORING_SQ_NEED_WAKEUP;
+			smp_mb();
+			timeout = jiffies + ctx->sq_thread_idle;
+			continue;
+		}
+
+		if (!cur_mm && atomic_inc_not_zero(&ctx->sqo_mm->mm_users)) {
+			cur_mm = ctx->sqo_mm;
+			use_mm(cur_mm);
+		}
+
+		mutex_lock(&ctx->uring_lock);
+		io_submit_sqes(ctx, to_submit, cur_mm != NULL);
+		mutex_unlock(&ctx->uring_lock);
+
+		timeout = jiffies + ctx->sq_thread_idle;
+	}
+
+	if (cur_mm) {
+		unuse_mm(cur_mm);
+		mmput(cur_mm);
+	}
+	revert_creds(old_cred);
+	set_fs(old_fs);
+	return 0;
+}
+
+/*
+ * Wait until events become available, if we don't already have some. The
+ * application must reap them itself, as they reside on the shared cq ring.
+ */
+static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
+			  const sigset_t __user *sig, size_t sigsz)
+{
+	struct io_cq_ring *ring = ctx->cq_ring;
+	sigset_t ksigmask, sigsaved;
+	int ret;
+
+	if (io_cqring_events(ring) >= min_events)
+		return 0;
+
+	if (sig) {
+		if (sigsz != sizeof(sigset_t))
+			return -EINVAL;
+		if (copy_from_user(&ksigmask, sig, sizeof(ksigmask)))
+			return -EFAULT;
+		sigdelsetmask(&ksigmask, sigmask(SIGKILL) | sigmask(SIGSTOP));
+		sigprocmask(SIG_SETMASK, &ksigmask, &sigsaved);
+	}
+
+	ret = wait_event_interruptible(ctx->wait,
+				io_cqring_events(ring) >= min_events);
+	if (ret == -ERESTARTSYS)
+		ret = -EINTR;
+
+	if (sig) {
+		/*
+		 * If we got interrupted, restore the original mask after
+		 * the signal handler ran, like epoll_pwait() does.
+		 */
+		if (ret == -EINTR) {
+			memcpy(&current->saved_sigmask, &sigsaved,
+			       sizeof(sigsaved));
+			set_restore_sigmask();
+		} else
+			sigprocmask(SIG_SETMASK, &sigsaved, NULL);
+	}
+
+	return ACCESS_ONCE(ring->r.head) == ACCESS_ONCE(ring->r.tail) ? ret : 0;
+}
+
+static void io_sqe_files_unregister(struct io_ring_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < ctx->nr_user_files; i++)
+		fput(ctx->user_files[i]);
+
+	kfree(ctx->user_files);
+	ctx->user_files = NULL;
+	ctx->nr_user_files = 0;
+}
+
+static int io_sqe_files_register(struct io_ring_ctx *ctx, void __user *arg,
+				 unsigned nr_args)
+{
+	__s32 __user *fds = (__s32 __user *) arg;
+	int fd, ret = 0;
+	unsigned i;
+
+	if (ctx->user_files)
+		return -EBUSY;
+	if (!nr_args)
+		return -EINVAL;
+	if (nr_args > IORING_MAX_FIXED_FILES)
+		return -EMFILE;
+
+	ctx->user_files = kcalloc(nr_args, sizeof(struct file *), GFP_KERNEL);
+	if (!ctx->user_files)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_args; i++) {
+		ret = -EFAULT;
+		if (get_user(fd, &fds[i]))
+			break;
+
+		ret = -EBADF;
+		ctx->user_files[i] = fget(fd);
+		if (!ctx->user_files[i])
+			break;
+		/*
+		 * Don't allow io_uring instances to be registered. If UNIX
+		 * isn't enabled, then this causes a reference cycle and this
+		 * instance can never get freed.
+		 */
+		if (ctx->user_files[i]->f_op == &io_uring_fops) {
+			fput(ctx->user_files[i]);
+			break;
+		}
+		ctx->nr_user_files++;
+		ret = 0;
+	}
+
+	if (ret)
+		io_sqe_files_unregister(ctx);
+
+	return ret;
+}
+
+static int io_account_mem(struct mm_struct *mm, unsigned long nr_pages)
+{
+	unsigned long locked, lock_limit;
+	int ret = 0;
+
+	down_write(&mm->mmap_sem);
+	locked = mm->locked_vm + nr_pages;
+	lock_limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
+	if (locked > lock_limit && !capable(CAP_IPC_LOCK))
+		ret = -ENOMEM;
+	else
+		mm->locked_vm = locked;
+	up_write(&mm->mmap_sem);
+	return ret;
+}
+
+static void io_unaccount_mem(struct mm_struct *mm, unsigned long nr_pages)
+{
+	down_write(&mm->mmap_sem);
+	mm->locked_vm -= nr_pages;
+	up_write(&mm->mmap_sem);
+}
+
+static void io_unmap_ubuf(struct io_ring_ctx *ctx, struct io_mapped_ubuf *imu)
+{
+	unsigned int i;
+
+	if (imu->vmap)
+		vunmap(imu->vmap);
+	/* buffered reads stored through the kernel mapping */
+	for (i = 0; i < imu->nr_pages; i++) {
+		set_page_dirty_lock(imu->pages[i]);
+		put_page(imu->pages[i]);
+	}
+	io_unaccount_mem(ctx->sqo_mm, imu->nr_pages);
+	kfree(imu->pages);
+}
+
+static int io_sqe_buffer_unregister(struct io_ring_ctx *ctx)
+{
+	int i;
+
+	if (!ctx->user_bufs)
+		return -ENXIO;
+
+	for (i = 0; i < ctx->nr_user_bufs; i++)
+		io_unmap_ubuf(ctx, &ctx->user_bufs[i]);
+
+	kfree(ctx->user_bufs);
+	ctx->user_bufs = NULL;
+	ctx->nr_user_bufs = 0;
+	return 0;
+}
+
+static int io_copy_iov(struct io_ring_ctx *ctx, struct iovec *dst,
+		       void __user *arg, unsigned index)
+{
+	struct iovec __user *src;
+
+#ifdef CONFIG_COMPAT
+	if (ctx->compat) {
+		struct compat_iovec __user *ciovs;
+		struct compat_iovec ciov;
+
+		ciovs = (struct compat_iovec __user *) arg;
+		if (copy_from_user(&ciov, &ciovs[index], sizeof(ciov)))
+			return -EFAULT;
+
+		dst->iov_base = compat_ptr(ciov.iov_base);
+		dst->iov_len = ciov.iov_len;
+		return 0;
+	}
+#endif
+	src = (struct iovec __user *) arg;
+	if (copy_from_user(dst, &src[index], sizeof(*dst)))
+		return -EFAULT;
+	return 0;
+}
+
+static int io_map_ubuf(struct io_ring_ctx *ctx, struct io_mapped_ubuf *imu,
+		       struct iovec *iov)
+{
+	unsigned long ubuf = (unsigned long) iov->iov_base;
+	unsigned long start = ubuf >> PAGE_SHIFT;
+	unsigned long end = (ubuf + iov->iov_len + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	unsigned int nr_pages = end - start;
+	struct vm_area_struct **vmas;
+	int ret, pret, i;
+
+	ret = io_account_mem(ctx->sqo_mm, nr_pages);
+	if (ret)
+		return ret;
+
+	ret = -ENOMEM;
+	imu->pages = kcalloc(nr_pages, sizeof(struct page *), GFP_KERNEL);
+	vmas = kcalloc(nr_pages, sizeof(struct vm_area_struct *), GFP_KERNEL);
+	if (!imu->pages || !vmas)
+		goto err;
+
+	ret = 0;
+	down_read(&current->mm->mmap_sem);
+	pret = get_user_pages(current, current->mm, ubuf & PAGE_MASK, nr_pages,
+			      1, 0, imu->pages, vmas);
+	if (pret == nr_pages) {
+		/* don't support file backed memory */
+		for (i = 0; i < nr_pages; i++) {
+			struct vm_area_struct *vma = vmas[i];
+
+			if (vma->vm_file && !is_file_hugepages(vma->vm_file)) {
+				ret = -EOPNOTSUPP;
+				break;
+			}
+		}
+	} else {
+		ret = pret < 0 ? pret : -EFAULT;
+	}
+	up_read(&current->mm->mmap_sem);
+	if (ret) {
+		/* release any pages we did get */
+		for (i = 0; i < pret; i++)
+			put_page(imu->pages[i]);
+		goto err;
+	}
+
+	imu->vmap = vmap(imu->pages, nr_pages, VM_MAP, PAGE_KERNEL);
+	if (!imu->vmap) {
+		for (i = 0; i < nr_pages; i++)
+			put_page(imu->pages[i]);
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	imu->ubuf = ubuf;
+	imu->len = iov->iov_len;
+	imu->nr_pages = nr_pages;
+	imu->kaddr = imu->vmap + (ubuf & ~PAGE_MASK);
+	kfree(vmas);
+	return 0;
+
+err:
+	kfree(imu->pages);
+	imu->pages = NULL;
+	kfree(vmas);
+	io_unaccount_mem(ctx->sqo_mm, nr_pages);
+	return ret;
+}
+
+static int io_sqe_buffer_register(struct io_ring_ctx *ctx, void __user *arg,
+				  unsigned nr_args)
+{
+	int i, ret;
+
+	if (ctx->user_bufs)
+		return -EBUSY;
+	if (!nr_args || nr_args > UIO_MAXIOV)
+		return -EINVAL;
+
+	ctx->user_bufs = kcalloc(nr_args, sizeof(struct io_mapped_ubuf),
+				 GFP_KERNEL);
+	if (!ctx->user_bufs)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_args; i++) {
+		struct io_mapped_ubuf *imu = &ctx->user_bufs[i];
+		struct iovec iov;
+
+		ret = io_copy_iov(ctx, &iov, arg, i);
+		if (ret)
+			break;
+
+		/*
+		 * Don't impose further limits on the size and buffer
+		 * constraints here, we'll -EINVAL later when IO is
+		 * submitted if they are wrong.
+		 */
+		ret = -EFAULT;
+		if (!iov.iov_base || !iov.iov_len)
+			break;
+
+		/* arbitrary limit, but we need something */
+		if (iov.iov_len > IORING_MAX_BUF_SIZE)
+			break;
+
+		ret = io_map_ubuf(ctx, imu, &iov);
+		if (ret)
+			break;
+		ctx->nr_user_bufs++;
+	}
+
+	if (ret)
+		io_sqe_buffer_unregister(ctx);
+
+	return ret;
+}
+
+static void *io_mem_alloc(size_t size)
+{
+	gfp_t gfp_flags = GFP_KERNEL | __GFP_ZERO | __GFP_NOWARN | __GFP_COMP;
+
+	return (void *) __get_free_pages(gfp_flags, get_order(size));
+}
+
+static void io_mem_free(void *ptr, size_t size)
+{
+	if (ptr)
+		free_pages((unsigned long) ptr, get_order(size));
+}
+
+static size_t io_sq_ring_size(unsigned entries)
+{
+	return sizeof(struct io_sq_ring) + entries * sizeof(u32);
+}
+
+static size_t io_cq_ring_size(unsigned entries)
+{
+	return sizeof(struct io_cq_ring) + entries * sizeof(struct io_uring_cqe);
+}
+
+static size_t io_sqes_size(unsigned entries)
+{
+	return entries * sizeof(struct io_uring_sqe);
+}
+
+static int io_allocate_scq_urings(struct io_ring_ctx *ctx,
+				  struct io_uring_params *p)
+{
+	struct io_sq_ring *sq_ring;
+	struct io_cq_ring *cq_ring;
+
+	sq_ring = io_mem_alloc(io_sq_ring_size(p->sq_entries));
+	if (!sq_ring)
+		return -ENOMEM;
+	ctx->sq_ring = sq_ring;
+	sq_ring->ring_mask = p->sq_entries - 1;
+	sq_ring->ring_entries = p->sq_entries;
+	ctx->sq_mask = sq_ring->ring_mask;
+	ctx->sq_entries = sq_ring->ring_entries;
+
+	ctx->sq_sqes = io_mem_alloc(io_sqes_size(p->sq_entries));
+	if (!ctx->sq_sqes)
+		return -ENOMEM;
+
+	cq_ring = io_mem_alloc(io_cq_ring_size(p->cq_entries));
+	if (!cq_ring)
+		return -ENOMEM;
+	ctx->cq_ring = cq_ring;
+	cq_ring->ring_mask = p->cq_entries - 1;
+	cq_ring->ring_entries = p->cq_entries;
+	ctx->cq_mask = cq_ring->ring_mask;
+	ctx->cq_entries = cq_ring->ring_entries;
+	return 0;
+}
+
+static int io_sq_offload_start(struct io_ring_ctx *ctx,
+			       struct io_uring_params *p)
+{
+	int ret;
+
+	ctx->sqo_mm = current->mm;
+	atomic_inc(&ctx->sqo_mm->mm_count);
+	ctx->creds = get_current_cred();
+
+	/* Do QD, or 2 * CPUS, whatever is smallest */
+	ctx->sqo_wq = alloc_workqueue("io_ring-wq", WQ_UNBOUND | WQ_FREEZABLE,
+			min(ctx->sq_entries - 1, 2 * num_online_cpus()));
+	if (!ctx->sqo_wq)
+		return -ENOMEM;
+
+	if (ctx->flags & IORING_SETUP_SQPOLL) {
+		ret = -EPERM;
+		if (!capable(CAP_SYS_ADMIN))
+			return ret;
+
+		ctx->sq_thread_idle = msecs_to_jiffies(p->sq_thread_idle);
+		if (!ctx->sq_thread_idle)
+			ctx->sq_thread_idle = HZ;
+
+		if (p->flags & IORING_SETUP_SQ_AFF) {
+			int cpu = p->sq_thread_cpu;
+
+			ret = -EINVAL;
+			if (cpu >= nr_cpu_ids || !cpu_online(cpu))
+				return ret;
+
+			ctx->sqo_thread = kthread_create(io_sq_thread, ctx,
+							 "io_uring-sq/%d", cpu);
+			if (!IS_ERR(ctx->sqo_thread))
+				kthread_bind(ctx->sqo_thread, cpu);
+		} else {
+			ctx->sqo_thread = kthread_create(io_sq_thread, ctx,
+							 "io_uring-sq");
+		}
+		if (IS_ERR(ctx->sqo_thread)) {
+			ret = PTR_ERR(ctx->sqo_thread);
+			ctx->sqo_thread = NULL;
+			return ret;
+		}
+		wake_up_process(ctx->sqo_thread);
+	} else if (p->flags & IORING_SETUP_SQ_AFF) {
+		/* Can't have SQ_AFF without SQPOLL */
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void io_ring_ctx_free(struct io_ring_ctx *ctx)
+{
+	if (ctx->sqo_thread)
+		kthread_stop(ctx->sqo_thread);
+	if (ctx->sqo_wq)
+		destroy_workqueue(ctx->sqo_wq);
+
+	io_sqe_buffer_unregister(ctx);
+	io_sqe_files_unregister(ctx);
+
+	if (ctx->sqo_mm)
+		mmdrop(ctx->sqo_mm);
+	if (ctx->creds)
+		put_cred(ctx->creds);
+
+	io_mem_free(ctx->sq_ring, io_sq_ring_size(ctx->sq_entries));
+	io_mem_free(ctx->sq_sqes, io_sqes_size(ctx->sq_entries));
+	io_mem_free(ctx->cq_ring, io_cq_ring_size(ctx->cq_entries));
+	kfree(ctx);
+}
+
+/*
+ * Drop the ring file's reference and wait for every request still in
+ * flight.  Pending polls are cancelled, everything else completes on
+ * its own.
+ */
+static void io_ring_ctx_quiesce(struct io_ring_ctx *ctx)
+{
+	io_ring_ctx_ref_free(ctx);
+	wait_for_completion(&ctx->ctx_done);
+}
+
+/*
+ * As io_ring_ctx_quiesce(), but a pending poll request may never finish,
+ * so let a signal interrupt the wait.  The ring's reference is given
+ * back on failure.
+ */
+static int io_ring_ctx_quiesce_interruptible(struct io_ring_ctx *ctx)
+{
+	int ret;
+
+	io_ring_ctx_ref_free(ctx);
+	ret = wait_for_completion_interruptible(&ctx->ctx_done);
+	if (!ret)
+		return 0;
+
+	if (atomic_inc_return(&ctx->refs) == 1) {
+		/* the last request went away meanwhile */
+		wait_for_completion(&ctx->ctx_done);
+		INIT_COMPLETION(ctx->ctx_done);
+	}
+	return ret;
+}
+
+static void io_ring_ctx_wait_and_kill(struct io_ring_ctx *ctx)
+{
+	if (ctx->sqo_thread) {
+		kthread_stop(ctx->sqo_thread);
+		ctx->sqo_thread = NULL;
+	}
+
+	io_poll_remove_all(ctx);
+	io_ring_ctx_quiesce(ctx);
+	io_ring_ctx_free(ctx);
+}
+
+static int io_uring_release(struct inode *inode, struct file *file)
+{
+	struct io_ring_ctx *ctx = file->private_data;
+
+	file->private_data = NULL;
+	io_ring_ctx_wait_and_kill(ctx);
+	return 0;
+}
+
+static unsigned int io_uring_poll(struct file *file, poll_table *wait)
+{
+	struct io_ring_ctx *ctx = file->private_data;
+	unsigned int mask = 0;
+
+	poll_wait(file, &ctx->cq_wait, wait);
+	/* See comment at the top of this file */
+	smp_rmb();
+	if (ACCESS_ONCE(ctx->sq_ring->r.tail) - ctx->cached_sq_head !=
+	    ctx->sq_entries)
+		mask |= POLLOUT | POLLWRNORM;
+	if (ACCESS_ONCE(ctx->cq_ring->r.head) != ctx->cached_cq_tail)
+		mask |= POLLIN | POLLRDNORM;
+
+	return mask;
+}
+
+static int io_uring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	loff_t offset = (loff_t) vma->vm_pgoff << PAGE_SHIFT;
+	unsigned long sz = vma->vm_end - vma->vm_start;
+	struct io_ring_ctx *ctx = file->private_data;
+	unsigned long pfn;
+	size_t size;
+	void *ptr;
+
+	switch (offset) {
+	case IORING_OFF_SQ_RING:
+		ptr = ctx->sq_ring;
+		size = io_sq_ring_size(ctx->sq_entries);
+		break;
+	case IORING_OFF_SQES:
+		ptr = ctx->sq_sqes;
+		size = io_sqes_size(ctx->sq_entries);
+		break;
+	case IORING_OFF_CQ_RING:
+		ptr = ctx->cq_ring;
+		size = io_cq_ring_size(ctx->cq_entries);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (sz > PAGE_ALIGN(size))
+		return -EINVAL;
+
+	pfn = virt_to_phys(ptr) >> PAGE_SHIFT;
+	return remap_pfn_range(vma, vma->vm_start, pfn, sz, vma->vm_page_prot);
+}
+
+SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
+		u32, min_complete, u32, flags, const sigset_t __user *, sig,
+		size_t, sigsz)
+{
+	struct io_ring_ctx *ctx;
+	long ret = -EBADF;
+	int submitted = 0;
+	struct file *file;
+
+	if (flags & ~(IORING_ENTER_GETEVENTS | IORING_ENTER_SQ_WAKEUP))
+		return -EINVAL;
+
+	file = fget(fd);
+	if (!file)
+		return -EBADF;
+
+	ret = -EOPNOTSUPP;
+	if (file->f_op != &io_uring_fops)
+		goto out_fput;
+
+	ret = -ENXIO;
+	ctx = file->private_data;
+	if (!ctx)
+		goto out_fput;
+
+	/*
+	 * For SQ polling, the thread will do all submissions and completions.
+	 * Just return the requested submit count, and wake the thread if
+	 * we were asked to.
+	 */
+	ret = 0;
+	if (ctx->flags & IORING_SETUP_SQPOLL) {
+		if (flags & IORING_ENTER_SQ_WAKEUP)
+			wake_up(&ctx->sqo_wait);
+		submitted = to_submit;
+	} else if (to_submit) {
+		to_submit = min(to_submit, ctx->sq_entries);
+
+		mutex_lock(&ctx->uring_lock);
+		submitted = io_submit_sqes(ctx, to_submit, true);
+		mutex_unlock(&ctx->uring_lock);
+	}
+	if (flags & IORING_ENTER_GETEVENTS) {
+		min_complete = min(min_complete, ctx->cq_entries);
+		ret = io_cqring_wait(ctx, min_complete, sig, sigsz);
+	}
+
+out_fput:
+	fput(file);
+	return submitted ? submitted : ret;
+}
+
+static const struct file_operations io_uring_fops = {
+	.release	= io_uring_release,
+	.mmap		= io_uring_mmap,
+	.poll		= io_uring_poll,
+	.llseek		= noop_llseek,
+};
+
+static int io_uring_get_fd(struct io_ring_ctx *ctx)
+{
+	return anon_inode_getfd("[io_uring]", &io_uring_fops, ctx,
+				O_RDWR | O_CLOEXEC);
+}
+
+static void io_fill_offsets(struct io_uring_params *p)
+{
+	memset(&p->sq_off, 0, sizeof(p->sq_off));
+	p->sq_off.head = offsetof(struct io_sq_ring, r.head);
+	p->sq_off.tail = offsetof(struct io_sq_ring, r.tail);
+	p->sq_off.ring_mask = offsetof(struct io_sq_ring, ring_mask);
+	p->sq_off.ring_entries = offsetof(struct io_sq_ring, ring_entries);
+	p->sq_off.flags = offsetof(struct io_sq_ring, flags);
+	p->sq_off.dropped = offsetof(struct io_sq_ring, dropped);
+	p->sq_off.array = offsetof(struct io_sq_ring, array);
+
+	memset(&p->cq_off, 0, sizeof(p->cq_off));
+	p->cq_off.head = offsetof(struct io_cq_ring, r.head);
+	p->cq_off.tail = offsetof(struct io_cq_ring, r.tail);
+	p->cq_off.ring_mask = offsetof(struct io_cq_ring, ring_mask);
+	p->cq_off.ring_entries = offsetof(struct io_cq_ring, ring_entries);
+	p->cq_off.overflow = offsetof(struct io_cq_ring, overflow);
+	p->cq_off.cqes = offsetof(struct io_cq_ring, cqes);
+}
+
+static int io_uring_create(unsigned entries, struct io_uring_params *p)
+{
+	struct io_ring_ctx *ctx;
+	int ret;
+
+	if (!entries || entries > IORING_MAX_ENTRIES)
+		return -EINVAL;
+
+	/*
+	 * Use twice as many entries for the CQ ring. It's possible for the
+	 * application to drive a higher depth than the size of the SQ ring,
+	 * since the sqes are only used at submission time. This allows for
+	 * some flexibility in overcommitting a bit.
+	 */
+	p->sq_entries = roundup_pow_of_two(entries);
+	p->cq_entries = 2 * p->sq_entries;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	atomic_set(&ctx->refs, 1);
+	init_completion(&ctx->ctx_done);
+	ctx->flags = p->flags;
+	ctx->compat = is_compat_task();
+	init_waitqueue_head(&ctx->sqo_wait);
+	init_waitqueue_head(&ctx->wait);
+	init_waitqueue_head(&ctx->cq_wait);
+	mutex_init(&ctx->uring_lock);
+	spin_lock_init(&ctx->completion_lock);
+	INIT_LIST_HEAD(&ctx->cancel_list);
+
+	ret = io_allocate_scq_urings(ctx, p);
+	if (ret)
+		goto err;
+
+	ret = io_sq_offload_start(ctx, p);
+	if (ret)
+		goto err;
+
+	ret = io_uring_get_fd(ctx);
+	if (ret < 0)
+		goto err;
+
+	io_fill_offsets(p);
+	return ret;
+err:
+	io_ring_ctx_free(ctx);
+	return ret;
+}
+
+/*
+ * Sets up an aio uring context, and returns the fd. Applications asks for a
+ * ring size, we return the actual sq/cq ring sizes (among other things) in the
+ * params structure passed in.
+ */
+SYSCALL_DEFINE2(io_uring_setup, u32, entries,
+		struct io_uring_params __user *, params)
+{
+	struct io_uring_params p;
+	long ret;
+	int i, fd;
+
+	if (copy_from_user(&p, params, sizeof(p)))
+		return -EFAULT;
+	for (i = 0; i < ARRAY_SIZE(p.resv); i++) {
+		if (p.resv[i])
+			return -EINVAL;
+	}
+
+	if (p.flags & ~(IORING_SETUP_SQPOLL | IORING_SETUP_SQ_AFF))
+		return -EINVAL;
+
+	fd = io_uring_create(entries, &p);
+	if (fd < 0)
+		return fd;
+
+	/* the fd is live, so a failed copy leaves it to the application */
+	ret = fd;
+	if (copy_to_user(params, &p, sizeof(p)))
+		ret = -EFAULT;
+	return ret;
+}
+
+static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
+			       void __user *arg, unsigned nr_args)
+{
+	int ret;
+
+	/*
+	 * Registered files and buffers are used by requests without taking
+	 * references of their own, so wait for all of them to finish.
+	 */
+	ret = io_ring_ctx_quiesce_interruptible(ctx);
+	if (ret)
+		return ret;
+
+	switch (opcode) {
+	case IORING_REGISTER_BUFFERS:
+		ret = io_sqe_buffer_register(ctx, arg, nr_args);
+		break;
+	case IORING_UNREGISTER_BUFFERS:
+		ret = -EINVAL;
+		if (arg || nr_args)
+			break;
+		ret = io_sqe_buffer_unregister(ctx);
+		break;
+	case IORING_REGISTER_FILES:
+		ret = io_sqe_files_register(ctx, arg, nr_args);
+		break;
+	case IORING_UNREGISTER_FILES:
+		ret = -EINVAL;
+		if (arg || nr_args)
+			break;
+		ret = -ENXIO;
+		if (!ctx->user_files)
+			break;
+		io_sqe_files_unregister(ctx);
+		ret = 0;
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	/* bring the ring back to life */
+	atomic_set(&ctx->refs, 1);
+	INIT_COMPLETION(ctx->ctx_done);
+	return ret;
+}
+
+SYSCALL_DEFINE4(io_uring_register, unsigned int, fd, unsigned int, opcode,
+		void __user *, arg, unsigned int, nr_args)
+{
+	struct io_ring_ctx *ctx;
+	long ret = -EBADF;
+	struct file *file;
+
+	file = fget(fd);
+	if (!file)
+		return -EBADF;
+
+	ret = -EOPNOTSUPP;
+	if (file->f_op != &io_uring_fops)
+		goto out_fput;
+
+	ctx = file->private_data;
+
+	mutex_lock(&ctx->uring_lock);
+	ret = __io_uring_register(ctx, opcode, arg, nr_args);
+	mutex_unlock(&ctx->uring_lock);
+out_fput:
+	fput(file);
+	return ret;
+}
+
+static int __init io_uring_init(void)
+{
+	req_cachep = KMEM_CACHE(io_kiocb, SLAB_HWCACHE_ALIGN | SLAB_PANIC);
+	return 0;
+};
+__initcall(io_uring_init);
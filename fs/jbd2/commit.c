@@ -167,22 +167,41 @@ static int journal_wait_on_commit_record(journal_t *journal,
 	return ret;
 }
 
+/*
+ * Byte range covered by the pages dirtied against @jinode.  Must be
+ * called under j_list_lock.
+ */
+static void jbd2_inode_dirty_range(struct jbd2_inode *jinode,
+				   loff_t *start, loff_t *end)
+{
+	pgoff_t last = jinode->i_dirty_end;
+
+	*start = (loff_t)jinode->i_dirty_start << PAGE_CACHE_SHIFT;
+	if (!last || last > (LLONG_MAX >> PAGE_CACHE_SHIFT))
+		*end = LLONG_MAX;
+	else
+		*end = ((loff_t)last << PAGE_CACHE_SHIFT) - 1;
+}
+
 /*
  * write the filemap data using writepage() address_space_operations.
  * We don't do block allocation here even for delalloc. We don't
  * use writepages() because with dealyed allocation we may be doing
  * block allocation in writepages().
  */
-static int journal_submit_inode_data_buffers(struct address_space *mapping)
+static int journal_submit_inode_data_buffers(struct address_space *mapping,
+					     loff_t start, loff_t end)
 {
 	int ret;
 	struct writeback_control wbc = {
 		.sync_mode =  WB_SYNC_ALL,
 		.nr_to_write = mapping->nrpages * 2,
-		.range_start = 0,
-		.range_end = i_size_read(mapping->host),
+		.range_start = start,
+		.range_end = min_t(loff_t, end, i_size_read(mapping->host)),
 	};
 
+	if (wbc.range_start > wbc.range_end)
+		return 0;
 	ret = generic_writepages(mapping, &wbc);
 	return ret;
 }
@@ -201,10 +220,12 @@ static int journal_submit_data_buffers(journal_t *journal,
 	struct jbd2_inode *jinode;
 	int err, ret = 0;
 	struct address_space *mapping;
+	loff_t start, end;
 
 	spin_lock(&journal->j_list_lock);
 	list_for_each_entry(jinode, &commit_transaction->t_inode_list, i_list) {
 		mapping = jinode->i_vfs_inode->i_mapping;
+		jbd2_inode_dirty_range(jinode, &start, &end);
 		set_bit(__JI_COMMIT_RUNNING, &jinode->i_flags);
 		spin_unlock(&journal->j_list_lock);
 		/*
@@ -214,7 +235,7 @@ static int journal_submit_data_buffers(journal_t *journal,
 		 * only allocated blocks here.
 		 */
 		trace_jbd2_submit_inode_data(jinode->i_vfs_inode);
-		err = journal_submit_inode_data_buffers(mapping);
+		err = journal_submit_inode_data_buffers(mapping, start, end);
 		if (!ret)
 			ret = err;
 		spin_lock(&journal->j_list_lock);
@@ -237,13 +258,16 @@ static int journal_finish_inode_data_buffers(journal_t *journal,
 {
 	struct jbd2_inode *jinode, *next_i;
 	int err, ret = 0;
+	loff_t start, end;
 
 	/* For locking, see the comment in journal_submit_data_buffers() */
 	spin_lock(&journal->j_list_lock);
 	list_for_each_entry(jinode, &commit_transaction->t_inode_list, i_list) {
+		jbd2_inode_dirty_range(jinode, &start, &end);
 		set_bit(__JI_COMMIT_RUNNING, &jinode->i_flags);
 		spin_unlock(&journal->j_list_lock);
-		err = filemap_fdatawait(jinode->i_vfs_inode->i_mapping);
+		err = filemap_fdatawait_range(jinode->i_vfs_inode->i_mapping,
+					      start, end);
 		if (err) {
 			/*
 			 * Because AS_EIO is cleared by
@@ -273,6 +297,8 @@ static int journal_finish_inode_data_buffers(journal_t *journal,
 				&jinode->i_transaction->t_inode_list);
 		} else {
 			jinode->i_transaction = NULL;
+			jinode->i_dirty_start = 0;
+			jinode->i_dirty_end = 0;
 		}
 	}
 	spin_unlock(&journal->j_list_lock);
@@ -302,6 +328,16 @@ static void write_tag_block(int tag_bytes, journal_block_tag_t *tag,
 		tag->t_blocknr_high = cpu_to_be32((block >> 31) >> 1);
 }
 
+/*
+ * Histogram bucket for a commit that took @commit_time nanoseconds.
+ */
+static int jbd2_commit_hist_bucket(u64 commit_time)
+{
+	int bucket = fls64(div_u64(commit_time, NSEC_PER_USEC));
+
+	return min(bucket, JBD2_COMMIT_HIST_BUCKETS - 1);
+}
+
 /*
  * jbd2_journal_commit_transaction
  *
@@ -451,13 +487,15 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 
 	/*
 	 * Now start flushing things to disk, in the order they appear
-	 * on the transaction lists.  Data blocks go first.
+	 * on the transaction lists.  Data blocks go first.  Keep a single
+	 * plug across all the inodes and the revoke records so that the
+	 * block layer sees the whole batch and can merge it.
 	 */
+	blk_start_plug(&plug);
 	err = journal_submit_data_buffers(journal, commit_transaction);
 	if (err)
 		jbd2_journal_abort(journal, err);
 
-	blk_start_plug(&plug);
 	jbd2_journal_write_revoke_records(journal, commit_transaction,
 					  WRITE_SYNC);
 	blk_finish_plug(&plug);
@@ -981,11 +1019,14 @@ restart_loop:
 	trace_jbd2_run_stats(journal->j_fs_dev->bd_dev,
 			     commit_transaction->t_tid, &stats.run);
 
+	commit_time = ktime_to_ns(ktime_sub(ktime_get(), start_time));
+
 	/*
 	 * Calculate overall stats
 	 */
 	spin_lock(&journal->j_history_lock);
 	journal->j_stats.ts_tid++;
+	journal->j_stats.ts_commit_hist[jbd2_commit_hist_bucket(commit_time)]++;
 	journal->j_stats.run.rs_wait += stats.run.rs_wait;
 	journal->j_stats.run.rs_running += stats.run.rs_running;
 	journal->j_stats.run.rs_locked += stats.run.rs_locked;
@@ -1000,7 +1041,6 @@ restart_loop:
 	J_ASSERT(commit_transaction == journal->j_committing_transaction);
 	journal->j_commit_sequence = commit_transaction->t_tid;
 	journal->j_committing_transaction = NULL;
-	commit_time = ktime_to_ns(ktime_sub(ktime_get(), start_time));
 
 	/*
 	 * weight the commit time higher than the average time so we don't
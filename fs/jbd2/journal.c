@@ -91,6 +91,7 @@ EXPORT_SYMBOL(jbd2_journal_invalidatepage);
 EXPORT_SYMBOL(jbd2_journal_try_to_free_buffers);
 EXPORT_SYMBOL(jbd2_journal_force_commit);
 EXPORT_SYMBOL(jbd2_journal_file_inode);
+EXPORT_SYMBOL(jbd2_journal_inode_add_write);
 EXPORT_SYMBOL(jbd2_journal_init_jbd_inode);
 EXPORT_SYMBOL(jbd2_journal_release_jbd_inode);
 EXPORT_SYMBOL(jbd2_journal_begin_ordered_truncate);
@@ -764,6 +765,7 @@ static void *jbd2_seq_info_next(struct seq_file *seq, void *v, loff_t *pos)
 static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 {
 	struct jbd2_stats_proc_session *s = seq->private;
+	int i;
 
 	if (v != SEQ_START_TOKEN)
 		return 0;
@@ -790,6 +792,15 @@ static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 	    s->stats->run.rs_blocks / s->stats->ts_tid);
 	seq_printf(seq, "  %lu logged blocks per transaction\n",
 	    s->stats->run.rs_blocks_logged / s->stats->ts_tid);
+	seq_printf(seq, "commit time histogram:\n");
+	for (i = 0; i < JBD2_COMMIT_HIST_BUCKETS - 1; i++) {
+		if (s->stats->ts_commit_hist[i])
+			seq_printf(seq, "  < %8luus: %lu\n", 1UL << i,
+				   s->stats->ts_commit_hist[i]);
+	}
+	if (s->stats->ts_commit_hist[i])
+		seq_printf(seq, "  >= %7luus: %lu\n", 1UL << (i - 1),
+			   s->stats->ts_commit_hist[i]);
 	return 0;
 }
 
@@ -2215,6 +2226,8 @@ void jbd2_journal_init_jbd_inode(struct jbd2_inode *jinode, struct inode *inode)
 	jinode->i_next_transaction = NULL;
 	jinode->i_vfs_inode = inode;
 	jinode->i_flags = 0;
+	jinode->i_dirty_start = 0;
+	jinode->i_dirty_end = 0;
 	INIT_LIST_HEAD(&jinode->i_list);
 }
 
@@ -2246,6 +2259,8 @@ restart:
 		list_del(&jinode->i_list);
 		jinode->i_transaction = NULL;
 	}
+	jinode->i_dirty_start = 0;
+	jinode->i_dirty_end = 0;
 	spin_unlock(&journal->j_list_lock);
 }
 
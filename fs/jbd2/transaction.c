@@ -2113,9 +2113,12 @@ void jbd2_journal_refile_buffer(journal_t *journal, struct journal_head *jh)
 }
 
 /*
- * File inode in the inode list of the handle's transaction
+ * File inode in the inode list of the handle's transaction and record
+ * the page range [start, end) it dirtied.
  */
-int jbd2_journal_file_inode(handle_t *handle, struct jbd2_inode *jinode)
+static int jbd2_journal_file_inode_range(handle_t *handle,
+					 struct jbd2_inode *jinode,
+					 pgoff_t start, pgoff_t end)
 {
 	transaction_t *transaction = handle->h_transaction;
 	journal_t *journal = transaction->t_journal;
@@ -2128,23 +2131,35 @@ int jbd2_journal_file_inode(handle_t *handle, struct jbd2_inode *jinode)
 
 	/*
 	 * First check whether inode isn't already on the transaction's
-	 * lists without taking the lock. Note that this check is safe
-	 * without the lock as we cannot race with somebody removing inode
-	 * from the transaction. The reason is that we remove inode from the
-	 * transaction only in journal_release_jbd_inode() and when we commit
-	 * the transaction. We are guarded from the first case by holding
-	 * a reference to the inode. We are safe against the second case
-	 * because if jinode->i_transaction == transaction, commit code
-	 * cannot touch the transaction because we hold reference to it,
-	 * and if jinode->i_next_transaction == transaction, commit code
-	 * will only file the inode where we want it.
+	 * lists with the range covered, without taking the lock. Note that
+	 * this check is safe without the lock as we cannot race with
+	 * somebody removing inode from the transaction. The reason is that
+	 * we remove inode from the transaction only in
+	 * journal_release_jbd_inode() and when we commit the transaction.
+	 * We are guarded from the first case by holding a reference to the
+	 * inode. We are safe against the second case because if
+	 * jinode->i_transaction == transaction, commit code cannot touch
+	 * the transaction because we hold reference to it, and if
+	 * jinode->i_next_transaction == transaction, commit code will only
+	 * file the inode where we want it. The dirty range is only ever
+	 * widened while the inode stays filed, so a stale read can only
+	 * send us to the slow path.
 	 */
-	if (jinode->i_transaction == transaction ||
-	    jinode->i_next_transaction == transaction)
+	if ((jinode->i_transaction == transaction ||
+	     jinode->i_next_transaction == transaction) &&
+	    jinode->i_dirty_start <= start && jinode->i_dirty_end >= end)
 		return 0;
 
 	spin_lock(&journal->j_list_lock);
 
+	if (jinode->i_dirty_end) {
+		jinode->i_dirty_start = min(jinode->i_dirty_start, start);
+		jinode->i_dirty_end = max(jinode->i_dirty_end, end);
+	} else {
+		jinode->i_dirty_start = start;
+		jinode->i_dirty_end = end;
+	}
+
 	if (jinode->i_transaction == transaction ||
 	    jinode->i_next_transaction == transaction)
 		goto done;
@@ -2175,6 +2190,31 @@ done:
 	return 0;
 }
 
+/*
+ * File inode in the inode list of the handle's transaction; all of its
+ * data will be written out before the transaction commits.
+ */
+int jbd2_journal_file_inode(handle_t *handle, struct jbd2_inode *jinode)
+{
+	return jbd2_journal_file_inode_range(handle, jinode, 0, ULONG_MAX);
+}
+
+/*
+ * File inode in the inode list of the handle's transaction; only the
+ * pages covering [start_byte, start_byte + length) need to be written
+ * out before the transaction commits, which keeps fsync of a large
+ * file from flushing data dirtied outside the transaction.
+ */
+int jbd2_journal_inode_add_write(handle_t *handle, struct jbd2_inode *jinode,
+				 loff_t start_byte, loff_t length)
+{
+	pgoff_t start = start_byte >> PAGE_CACHE_SHIFT;
+	pgoff_t end = (start_byte + max_t(loff_t, length, 1) - 1) >>
+			PAGE_CACHE_SHIFT;
+
+	return jbd2_journal_file_inode_range(handle, jinode, start, end + 1);
+}
+
 /*
  * File truncate and transaction commit interact with each other in a
  * non-trivial way.  If a transaction writing data block A is
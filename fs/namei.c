@@ -174,6 +174,46 @@ void putname(const char *name)
 EXPORT_SYMBOL(putname);
 #endif
 
+/*
+ * Path walk statistics, reported in /proc/sys/fs/pathwalk-state: the
+ * number of walks started in rcu-walk mode, the reasons they had to
+ * continue in ref-walk mode, and the number that had to be redone from
+ * the start in ref-walk mode.
+ */
+enum pathwalk_stat_item {
+	PATHWALK_RCU,		/* walks started in rcu-walk mode */
+	PATHWALK_PERMISSION,	/* permission, ACL or LSM check would block */
+	PATHWALK_LOOKUP,	/* dcache miss, revalidate, automount */
+	PATHWALK_LINK,		/* symlink to follow */
+	PATHWALK_RESTART,	/* walk restarted in ref-walk mode */
+	NR_PATHWALK_STAT_ITEMS
+};
+
+static DEFINE_PER_CPU(unsigned long, pathwalk_stat[NR_PATHWALK_STAT_ITEMS]);
+
+static inline void pathwalk_stat_inc(enum pathwalk_stat_item item)
+{
+	this_cpu_inc(pathwalk_stat[item]);
+}
+
+#if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
+int proc_pathwalk_stat(ctl_table *table, int write, void __user *buffer,
+		       size_t *lenp, loff_t *ppos)
+{
+	unsigned long sum[NR_PATHWALK_STAT_ITEMS] = { 0, };
+	ctl_table t = *table;
+	int cpu, i;
+
+	for_each_possible_cpu(cpu)
+		for (i = 0; i < NR_PATHWALK_STAT_ITEMS; i++)
+			sum[i] += per_cpu(pathwalk_stat[i], cpu);
+
+	t.data = sum;
+	t.maxlen = sizeof(sum);
+	return proc_doulongvec_minmax(&t, write, buffer, lenp, ppos);
+}
+#endif
+
 static int check_acl(struct inode *inode, int mask)
 {
 #ifdef CONFIG_FS_POSIX_ACL
@@ -1151,6 +1191,7 @@ static int do_lookup(struct nameidata *nd, struct qstr *name,
 			goto unlazy;
 		return 0;
 unlazy:
+		pathwalk_stat_inc(PATHWALK_LOOKUP);
 		if (unlazy_walk(nd, dentry))
 			return -ECHILD;
 	} else {
@@ -1221,6 +1262,7 @@ static inline int may_lookup(struct nameidata *nd)
 		int err = inode_permission(nd->inode, MAY_EXEC|MAY_NOT_BLOCK);
 		if (err != -ECHILD)
 			return err;
+		pathwalk_stat_inc(PATHWALK_PERMISSION);
 		if (unlazy_walk(nd, NULL))
 			return -ECHILD;
 	}
@@ -1296,6 +1338,7 @@ static inline int walk_component(struct nameidata *nd, struct path *path,
 	}
 	if (should_follow_link(inode, follow)) {
 		if (nd->flags & LOOKUP_RCU) {
+			pathwalk_stat_inc(PATHWALK_LINK);
 			if (unlikely(unlazy_walk(nd, path->dentry))) {
 				terminate_walk(nd);
 				return -ECHILD;
@@ -1637,9 +1680,14 @@ static int path_lookupat(int dfd, const char *name,
 static int do_path_lookup(int dfd, const char *name,
 				unsigned int flags, struct nameidata *nd)
 {
-	int retval = path_lookupat(dfd, name, flags | LOOKUP_RCU, nd);
-	if (unlikely(retval == -ECHILD))
+	int retval;
+
+	pathwalk_stat_inc(PATHWALK_RCU);
+	retval = path_lookupat(dfd, name, flags | LOOKUP_RCU, nd);
+	if (unlikely(retval == -ECHILD)) {
+		pathwalk_stat_inc(PATHWALK_RESTART);
 		retval = path_lookupat(dfd, name, flags, nd);
+	}
 	if (unlikely(retval == -ESTALE))
 		retval = path_lookupat(dfd, name, flags | LOOKUP_REVAL, nd);
 
@@ -2331,9 +2379,12 @@ struct file *do_filp_open(int dfd, const char *pathname,
 	struct nameidata nd;
 	struct file *filp;
 
+	pathwalk_stat_inc(PATHWALK_RCU);
 	filp = path_openat(dfd, pathname, &nd, op, flags | LOOKUP_RCU);
-	if (unlikely(filp == ERR_PTR(-ECHILD)))
+	if (unlikely(filp == ERR_PTR(-ECHILD))) {
+		pathwalk_stat_inc(PATHWALK_RESTART);
 		filp = path_openat(dfd, pathname, &nd, op, flags);
+	}
 	if (unlikely(filp == ERR_PTR(-ESTALE)))
 		filp = path_openat(dfd, pathname, &nd, op, flags | LOOKUP_REVAL);
 	return filp;
@@ -2353,9 +2404,12 @@ struct file *do_file_open_root(struct dentry *dentry, struct vfsmount *mnt,
 	if (dentry->d_inode->i_op->follow_link && op->intent & LOOKUP_OPEN)
 		return ERR_PTR(-ELOOP);
 
+	pathwalk_stat_inc(PATHWALK_RCU);
 	file = path_openat(-1, name, &nd, op, flags | LOOKUP_RCU);
-	if (unlikely(file == ERR_PTR(-ECHILD)))
+	if (unlikely(file == ERR_PTR(-ECHILD))) {
+		pathwalk_stat_inc(PATHWALK_RESTART);
 		file = path_openat(-1, name, &nd, op, flags);
+	}
 	if (unlikely(file == ERR_PTR(-ESTALE)))
 		file = path_openat(-1, name, &nd, op, flags | LOOKUP_REVAL);
 	return file;
@@ -933,7 +933,8 @@ static ssize_t do_sendfile(int out_fd, int in_fd, loff_t *ppos,
 	if (in_file->f_flags & O_NONBLOCK)
 		fl = SPLICE_F_NONBLOCK;
 #endif
-	retval = do_splice_direct(in_file, ppos, out_file, count, fl);
+	retval = do_splice_direct(in_file, ppos, out_file, &out_file->f_pos,
+				  count, fl);
 
 	if (retval > 0) {
 		add_rchar(current, retval);
@@ -988,3 +989,141 @@ SYSCALL_DEFINE4(sendfile64, int, out_fd, int, in_fd, loff_t __user *, offset, si
 
 	return do_sendfile(out_fd, in_fd, NULL, count, 0);
 }
+
+/**
+ * vfs_copy_file_range - copy a range of one file into another
+ * @file_in:	file to copy from
+ * @pos_in:	offset in @file_in
+ * @file_out:	file to copy to
+ * @pos_out:	offset in @file_out
+ * @len:	number of bytes to copy
+ * @flags:	must be zero
+ *
+ * If both files share a ->copy_file_range method, the filesystem gets to
+ * copy the data itself, e.g. by sharing extents or having a server do the
+ * copy.  Otherwise, or when the filesystem declines, the data is spliced
+ * through the page cache without a round trip to user space.
+ *
+ * Returns the number of bytes copied, which may be less than @len.
+ */
+ssize_t vfs_copy_file_range(struct file *file_in, loff_t pos_in,
+			    struct file *file_out, loff_t pos_out,
+			    size_t len, unsigned int flags)
+{
+	struct inode *inode_in = file_in->f_path.dentry->d_inode;
+	struct inode *inode_out = file_out->f_path.dentry->d_inode;
+	ssize_t ret;
+
+	if (flags != 0)
+		return -EINVAL;
+
+	if (S_ISDIR(inode_in->i_mode) || S_ISDIR(inode_out->i_mode))
+		return -EISDIR;
+	if (!S_ISREG(inode_in->i_mode) || !S_ISREG(inode_out->i_mode))
+		return -EINVAL;
+
+	if (!(file_in->f_mode & FMODE_READ) ||
+	    !(file_out->f_mode & FMODE_WRITE) ||
+	    (file_out->f_flags & O_APPEND))
+		return -EBADF;
+
+	ret = rw_verify_area(READ, file_in, &pos_in, len);
+	if (ret < 0)
+		return ret;
+	len = ret;
+
+	ret = rw_verify_area(WRITE, file_out, &pos_out, len);
+	if (ret < 0)
+		return ret;
+	len = ret;
+
+	if (len == 0)
+		return 0;
+
+	/* copying a range onto an overlapping range of itself is undefined */
+	if (inode_in == inode_out &&
+	    pos_in + len > pos_out && pos_out + len > pos_in)
+		return -EINVAL;
+
+	ret = -EOPNOTSUPP;
+	if (file_out->f_op && file_out->f_op->copy_file_range &&
+	    file_in->f_op &&
+	    file_out->f_op->copy_file_range == file_in->f_op->copy_file_range)
+		ret = file_out->f_op->copy_file_range(file_in, pos_in,
+						      file_out, pos_out,
+						      len, flags);
+	if (ret == -EOPNOTSUPP || ret == -EXDEV)
+		ret = do_splice_direct(file_in, &pos_in, file_out, &pos_out,
+				       len, 0);
+
+	if (ret > 0) {
+		fsnotify_access(file_in);
+		add_rchar(current, ret);
+		fsnotify_modify(file_out);
+		add_wchar(current, ret);
+	}
+	inc_syscr(current);
+	inc_syscw(current);
+
+	return ret;
+}
+EXPORT_SYMBOL(vfs_copy_file_range);
+
+SYSCALL_DEFINE6(copy_file_range, int, fd_in, loff_t __user *, off_in,
+		int, fd_out, loff_t __user *, off_out,
+		size_t, len, unsigned int, flags)
+{
+	struct file *file_in, *file_out;
+	int fput_needed_in, fput_needed_out;
+	loff_t pos_in, pos_out;
+	ssize_t ret;
+
+	ret = -EBADF;
+	file_in = fget_light(fd_in, &fput_needed_in);
+	if (!file_in)
+		goto out;
+	file_out = fget_light(fd_out, &fput_needed_out);
+	if (!file_out)
+		goto fput_in;
+
+	ret = -EFAULT;
+	if (off_in) {
+		if (copy_from_user(&pos_in, off_in, sizeof(loff_t)))
+			goto fput_out;
+	} else {
+		pos_in = file_in->f_pos;
+	}
+	if (off_out) {
+		if (copy_from_user(&pos_out, off_out, sizeof(loff_t)))
+			goto fput_out;
+	} else {
+		pos_out = file_out->f_pos;
+	}
+
+	ret = vfs_copy_file_range(file_in, pos_in, file_out, pos_out, len,
+				  flags);
+	if (ret > 0) {
+		pos_in += ret;
+		pos_out += ret;
+
+		if (off_in) {
+			if (copy_to_user(off_in, &pos_in, sizeof(loff_t)))
+				ret = -EFAULT;
+		} else {
+			file_in->f_pos = pos_in;
+		}
+		if (off_out) {
+			if (copy_to_user(off_out, &pos_out, sizeof(loff_t)))
+				ret = -EFAULT;
+		} else {
+			file_out->f_pos = pos_out;
+		}
+	}
+
+fput_out:
+	fput_light(file_out, fput_needed_out);
+fput_in:
+	fput_light(file_in, fput_needed_in);
+out:
+	return ret;
+}
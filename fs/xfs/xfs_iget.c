@@ -40,6 +40,7 @@
 #include "xfs_bmap.h"
 #include "xfs_trace.h"
 
+#include <linux/posix_acl.h>
 
 /*
  * Define xfs inode iolock lockdep classes. We need to ensure that all active
@@ -459,8 +460,25 @@ again:
 	 * If we have a real type for an on-disk inode, we can set ops(&unlock)
 	 * now.	 If it's a new inode being created, xfs_ialloc will handle it.
 	 */
-	if (xfs_iflags_test(ip, XFS_INEW) && ip->i_d.di_mode != 0)
+	if (xfs_iflags_test(ip, XFS_INEW) && ip->i_d.di_mode != 0) {
 		xfs_setup_inode(ip);
+
+		/*
+		 * A directory with a shortform attribute fork has its ACL in
+		 * the inode core we just read, so cache it now for RCU path
+		 * walk.  Only do this when the caller holds no inode locks
+		 * and no transaction, as reading the ACL takes the ilock.
+		 */
+		if (!tp && !lock_flags && S_ISDIR(ip->i_d.di_mode) &&
+		    XFS_IFORK_Q(ip) &&
+		    ip->i_d.di_aformat == XFS_DINODE_FMT_LOCAL) {
+			struct posix_acl *acl;
+
+			acl = xfs_get_acl(VFS_I(ip), ACL_TYPE_ACCESS);
+			if (!IS_ERR_OR_NULL(acl))
+				posix_acl_release(acl);
+		}
+	}
 	return 0;
 
 out_error_or_again:
@@ -1461,15 +1461,25 @@ xfs_fs_mount(
 
 static int
 xfs_fs_nr_cached_objects(
-	struct super_block	*sb)
+	struct super_block	*sb,
+	int			nid)
 {
-	return xfs_reclaim_inodes_count(XFS_M(sb));
+	/*
+	 * Reclaimable inodes are tracked per AG, not per node, so XFS is not
+	 * NUMA aware here.  Report an even share of them on each node, so
+	 * that a pass of the per-node sb shrinker over all nodes counts them
+	 * once rather than once per node.
+	 */
+	return DIV_ROUND_UP(xfs_reclaim_inodes_count(XFS_M(sb)),
+			    num_online_nodes());
 }
 
+/* Not NUMA aware either: reclaims from all AGs whatever @nid is. */
 static void
 xfs_fs_free_cached_objects(
 	struct super_block	*sb,
-	int			nr_to_scan)
+	int			nr_to_scan,
+	int			nid)
 {
 	xfs_reclaim_inodes_nr(XFS_M(sb), nr_to_scan);
 }
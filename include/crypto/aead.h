@@ -48,6 +48,17 @@ static inline int crypto_aead_givdecrypt(struct aead_givcrypt_request *req)
 	return crt->givdecrypt(req);
 };
 
+static inline void crypto_aead_givencrypt_list(struct list_head *reqs)
+{
+	struct aead_givcrypt_request *req;
+
+	if (list_empty(reqs))
+		return;
+	req = list_first_entry(reqs, struct aead_givcrypt_request,
+			       areq.base.list);
+	crypto_aead_crt(aead_givcrypt_reqtfm(req))->givencrypt_list(reqs);
+}
+
 static inline void aead_givcrypt_set_tfm(struct aead_givcrypt_request *req,
 					 struct crypto_aead *tfm)
 {
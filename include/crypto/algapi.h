@@ -330,6 +330,19 @@ static inline struct crypto_async_request *crypto_get_backlog(
 	       container_of(queue->backlog, struct crypto_async_request, list);
 }
 
+/*
+ * Finish a request taken off a request list once its operation returned
+ * @err.  Unless the request is still in flight, its callback is run here.
+ */
+static inline void crypto_list_request_done(struct crypto_async_request *req,
+					    int err)
+{
+	if (err == -EINPROGRESS ||
+	    (err == -EBUSY && (req->flags & CRYPTO_TFM_REQ_MAY_BACKLOG)))
+		return;
+	req->complete(req, err);
+}
+
 static inline int ablkcipher_enqueue_request(struct crypto_queue *queue,
 					     struct ablkcipher_request *request)
 {
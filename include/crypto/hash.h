@@ -47,6 +47,7 @@ struct ahash_alg {
 	int (*import)(struct ahash_request *req, const void *in);
 	int (*setkey)(struct crypto_ahash *tfm, const u8 *key,
 		      unsigned int keylen);
+	void (*digest_list)(struct list_head *reqs);
 
 	struct hash_alg_common halg;
 };
@@ -92,6 +93,7 @@ struct crypto_ahash {
 	int (*import)(struct ahash_request *req, const void *in);
 	int (*setkey)(struct crypto_ahash *tfm, const u8 *key,
 		      unsigned int keylen);
+	void (*digest_list)(struct list_head *reqs);
 
 	unsigned int reqsize;
 	struct crypto_tfm base;
@@ -185,6 +187,20 @@ int crypto_ahash_finup(struct ahash_request *req);
 int crypto_ahash_final(struct ahash_request *req);
 int crypto_ahash_digest(struct ahash_request *req);
 
+/*
+ * Digest a list of requests for one tfm linked through req->base.list,
+ * see crypto_ablkcipher_encrypt_list().
+ */
+static inline void crypto_ahash_digest_list(struct list_head *reqs)
+{
+	struct ahash_request *req;
+
+	if (list_empty(reqs))
+		return;
+	req = list_first_entry(reqs, struct ahash_request, base.list);
+	crypto_ahash_reqtfm(req)->digest_list(reqs);
+}
+
 static inline int crypto_ahash_export(struct ahash_request *req, void *out)
 {
 	return crypto_ahash_reqtfm(req)->export(req, out);
@@ -60,6 +60,10 @@ void aead_geniv_free(struct crypto_instance *inst);
 int aead_geniv_init(struct crypto_tfm *tfm);
 void aead_geniv_exit(struct crypto_tfm *tfm);
 
+void aead_default_encrypt_list(struct list_head *reqs);
+void aead_default_decrypt_list(struct list_head *reqs);
+void aead_default_givencrypt_list(struct list_head *reqs);
+
 static inline struct crypto_aead *aead_geniv_base(struct crypto_aead *geniv)
 {
 	return crypto_aead_crt(geniv)->base;
@@ -55,6 +55,8 @@ static inline struct crypto_ablkcipher *crypto_spawn_skcipher(
 
 int skcipher_null_givencrypt(struct skcipher_givcrypt_request *req);
 int skcipher_null_givdecrypt(struct skcipher_givcrypt_request *req);
+void skcipher_default_encrypt_list(struct list_head *reqs);
+void skcipher_default_decrypt_list(struct list_head *reqs);
 const char *crypto_default_geniv(const struct crypto_alg *alg);
 
 struct crypto_instance *skcipher_geniv_alloc(struct crypto_template *tmpl,
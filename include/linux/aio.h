@@ -2,6 +2,7 @@
 #define __LINUX__AIO_H
 
 #include <linux/list.h>
+#include <linux/wait.h>
 #include <linux/workqueue.h>
 #include <linux/aio_abi.h>
 #include <linux/uio.h>
@@ -11,8 +12,10 @@
 
 #define AIO_MAXSEGS		4
 #define AIO_KIOGRP_NR_ATOMIC	8
+#define AIO_MAX_OFFLOAD_WORKERS	64
 
 struct kioctx;
+struct cred;
 
 /* Notes on cancelling a kiocb:
  *	If a kiocb is cancelled, aio_complete may return 0 to indicate 
@@ -34,6 +37,7 @@ struct kioctx;
 /* #define KIF_LOCKED		0 */
 #define KIF_KICKED		1
 #define KIF_CANCELLED		2
+#define KIF_ASYNC_BUFFERED	3	/* buffered read may retry on page unlock */
 
 #define kiocbTryLock(iocb)	test_and_set_bit(KIF_LOCKED, &(iocb)->ki_flags)
 #define kiocbTryKick(iocb)	test_and_set_bit(KIF_KICKED, &(iocb)->ki_flags)
@@ -41,6 +45,7 @@ struct kioctx;
 #define kiocbSetLocked(iocb)	set_bit(KIF_LOCKED, &(iocb)->ki_flags)
 #define kiocbSetKicked(iocb)	set_bit(KIF_KICKED, &(iocb)->ki_flags)
 #define kiocbSetCancelled(iocb)	set_bit(KIF_CANCELLED, &(iocb)->ki_flags)
+#define kiocbSetAsyncBuffered(iocb)	set_bit(KIF_ASYNC_BUFFERED, &(iocb)->ki_flags)
 
 #define kiocbClearLocked(iocb)	clear_bit(KIF_LOCKED, &(iocb)->ki_flags)
 #define kiocbClearKicked(iocb)	clear_bit(KIF_KICKED, &(iocb)->ki_flags)
@@ -49,6 +54,7 @@ struct kioctx;
 #define kiocbIsLocked(iocb)	test_bit(KIF_LOCKED, &(iocb)->ki_flags)
 #define kiocbIsKicked(iocb)	test_bit(KIF_KICKED, &(iocb)->ki_flags)
 #define kiocbIsCancelled(iocb)	test_bit(KIF_CANCELLED, &(iocb)->ki_flags)
+#define kiocbIsAsyncBuffered(iocb)	test_bit(KIF_ASYNC_BUFFERED, &(iocb)->ki_flags)
 
 /* is there a better place to document function pointer methods? */
 /**
@@ -77,10 +83,10 @@ struct kioctx;
  *
  * If ki_retry returns -EIOCBRETRY it has made a promise that kick_iocb()
  * will be called on the kiocb pointer in the future.  This may happen
- * through generic helpers that associate kiocb->ki_wait with a wait
- * queue head that ki_retry uses via current->io_wait.  It can also happen
- * with custom tracking and manual calls to kick_iocb(), though that is
- * discouraged.  In either case, kick_iocb() must be called once and only
+ * through generic helpers that queue kiocb->ki_wait on a wait queue head,
+ * as the page cache does for KIF_ASYNC_BUFFERED reads which find a page
+ * locked for I/O.  It can also happen with custom tracking and manual
+ * calls to kick_iocb(), though that is discouraged.  In either case, kick_iocb() must be called once and only
  * once.  ki_retry must ensure forward progress, the AIO core will wait
  * indefinitely for kick_iocb() to be called.
  */
@@ -95,6 +101,8 @@ struct kiocb {
 	int			(*ki_cancel)(struct kiocb *, struct io_event *);
 	ssize_t			(*ki_retry)(struct kiocb *);
 	void			(*ki_dtor)(struct kiocb *);
+	/* completion for iocbs that don't belong to an aio context */
+	void			(*ki_complete)(struct kiocb *, long, long);
 
 	union {
 		void __user		*user;
@@ -118,6 +126,12 @@ struct kiocb {
 	struct list_head	ki_list;	/* the aio core uses this
 						 * for cancellation */
 
+	/* page unlock wait entry for KIF_ASYNC_BUFFERED retries */
+	struct wait_bit_queue	ki_wait;
+
+	/* submitter's credentials, held while queued for an offload worker */
+	const struct cred	*ki_cred;
+
 	/*
 	 * If the aio_resfd field of the userspace iocb is not zero,
 	 * this is the underlying eventfd context to deliver events to.
@@ -137,6 +151,7 @@ struct kiocb {
 		(x)->ki_cancel = NULL;			\
 		(x)->ki_retry = NULL;			\
 		(x)->ki_dtor = NULL;			\
+		(x)->ki_complete = NULL;		\
 		(x)->ki_obj.tsk = tsk;			\
 		(x)->ki_user_data = 0;                  \
 	} while (0)
@@ -175,6 +190,12 @@ struct aio_ring_info {
 	struct page		*internal_pages[AIO_RING_PAGES];
 };
 
+struct aio_offload_worker {
+	struct work_struct	work;
+	struct kioctx		*ctx;
+	int			busy;
+};
+
 struct kioctx {
 	atomic_t		users;
 	int			dead;
@@ -199,6 +220,11 @@ struct kioctx {
 
 	struct delayed_work	wq;
 
+	/* buffered writes and fsyncs waiting for an offload worker */
+	struct list_head	offload_list;
+	unsigned		nr_offload_workers;
+	struct aio_offload_worker *offload_workers;
+
 	struct rcu_head		rcu_head;
 };
 
@@ -234,5 +260,6 @@ static inline struct kiocb *list_kiocb(struct list_head *h)
 /* for sysctl: */
 extern unsigned long aio_nr;
 extern unsigned long aio_max_nr;
+extern int aio_offload_workers;
 
 #endif /* __LINUX__AIO_H */
@@ -195,6 +195,8 @@ struct ablkcipher_alg {
 	int (*decrypt)(struct ablkcipher_request *req);
 	int (*givencrypt)(struct skcipher_givcrypt_request *req);
 	int (*givdecrypt)(struct skcipher_givcrypt_request *req);
+	void (*encrypt_list)(struct list_head *reqs);
+	void (*decrypt_list)(struct list_head *reqs);
 
 	const char *geniv;
 
@@ -211,6 +213,9 @@ struct aead_alg {
 	int (*decrypt)(struct aead_request *req);
 	int (*givencrypt)(struct aead_givcrypt_request *req);
 	int (*givdecrypt)(struct aead_givcrypt_request *req);
+	void (*encrypt_list)(struct list_head *reqs);
+	void (*decrypt_list)(struct list_head *reqs);
+	void (*givencrypt_list)(struct list_head *reqs);
 
 	const char *geniv;
 
@@ -311,6 +316,29 @@ int crypto_unregister_alg(struct crypto_alg *alg);
  */
 int crypto_has_alg(const char *name, u32 type, u32 mask);
 
+/*
+ * Request plugging: while a plug is active on this CPU, callers that can
+ * wait for their callback may hand requests to crypto_plug_request()
+ * instead of submitting them.  They are collected and submitted as one
+ * request list when the plug is finished, or earlier when the plug fills
+ * up or a request for another tfm or operation comes along.  Plugs are per
+ * CPU, so BH must stay disabled from crypto_start_plug() until
+ * crypto_finish_plug().  Nested plugs are ignored.
+ */
+#define CRYPTO_PLUG_MAX		64
+
+struct crypto_plug {
+	struct list_head list;
+	void (*submit)(struct list_head *reqs);
+	struct crypto_tfm *tfm;
+	unsigned int count;
+};
+
+void crypto_start_plug(struct crypto_plug *plug);
+void crypto_finish_plug(struct crypto_plug *plug);
+bool crypto_plug_request(struct crypto_async_request *req,
+			 void (*submit)(struct list_head *reqs));
+
 /*
  * Transforms: user-instantiated objects which encapsulate algorithms
  * and core processing logic.  Managed via crypto_alloc_*() and
@@ -324,6 +352,8 @@ struct ablkcipher_tfm {
 	int (*decrypt)(struct ablkcipher_request *req);
 	int (*givencrypt)(struct skcipher_givcrypt_request *req);
 	int (*givdecrypt)(struct skcipher_givcrypt_request *req);
+	void (*encrypt_list)(struct list_head *reqs);
+	void (*decrypt_list)(struct list_head *reqs);
 
 	struct crypto_ablkcipher *base;
 
@@ -338,6 +368,9 @@ struct aead_tfm {
 	int (*decrypt)(struct aead_request *req);
 	int (*givencrypt)(struct aead_givcrypt_request *req);
 	int (*givdecrypt)(struct aead_givcrypt_request *req);
+	void (*encrypt_list)(struct list_head *reqs);
+	void (*decrypt_list)(struct list_head *reqs);
+	void (*givencrypt_list)(struct list_head *reqs);
 
 	struct crypto_aead *base;
 
@@ -664,6 +697,33 @@ static inline int crypto_ablkcipher_decrypt(struct ablkcipher_request *req)
 	return crt->decrypt(req);
 }
 
+/*
+ * Request lists: several requests for the same tfm, linked through
+ * req->base.list, are handed over in one call so that the implementation
+ * can process them as a batch.  Unlike single requests, every request on
+ * a list is completed through its callback, including those finished
+ * before the call returns.  The list is left empty.
+ */
+static inline void crypto_ablkcipher_encrypt_list(struct list_head *reqs)
+{
+	struct ablkcipher_request *req;
+
+	if (list_empty(reqs))
+		return;
+	req = list_first_entry(reqs, struct ablkcipher_request, base.list);
+	crypto_ablkcipher_crt(crypto_ablkcipher_reqtfm(req))->encrypt_list(reqs);
+}
+
+static inline void crypto_ablkcipher_decrypt_list(struct list_head *reqs)
+{
+	struct ablkcipher_request *req;
+
+	if (list_empty(reqs))
+		return;
+	req = list_first_entry(reqs, struct ablkcipher_request, base.list);
+	crypto_ablkcipher_crt(crypto_ablkcipher_reqtfm(req))->decrypt_list(reqs);
+}
+
 static inline unsigned int crypto_ablkcipher_reqsize(
 	struct crypto_ablkcipher *tfm)
 {
@@ -803,6 +863,26 @@ static inline int crypto_aead_decrypt(struct aead_request *req)
 	return crypto_aead_crt(crypto_aead_reqtfm(req))->decrypt(req);
 }
 
+static inline void crypto_aead_encrypt_list(struct list_head *reqs)
+{
+	struct aead_request *req;
+
+	if (list_empty(reqs))
+		return;
+	req = list_first_entry(reqs, struct aead_request, base.list);
+	crypto_aead_crt(crypto_aead_reqtfm(req))->encrypt_list(reqs);
+}
+
+static inline void crypto_aead_decrypt_list(struct list_head *reqs)
+{
+	struct aead_request *req;
+
+	if (list_empty(reqs))
+		return;
+	req = list_first_entry(reqs, struct aead_request, base.list);
+	crypto_aead_crt(crypto_aead_reqtfm(req))->decrypt_list(reqs);
+}
+
 static inline unsigned int crypto_aead_reqsize(struct crypto_aead *tfm)
 {
 	return crypto_aead_crt(tfm)->reqsize;
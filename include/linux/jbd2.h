@@ -396,6 +396,16 @@ struct jbd2_inode {
 
 	/* Flags of inode [j_list_lock] */
 	unsigned long i_flags;
+
+	/*
+	 * Page range of the inode's data dirtied by the transactions the
+	 * inode is filed against.  i_dirty_end is exclusive; zero means no
+	 * range has been recorded.  Only ever widened while the inode sits
+	 * on a transaction, so it may be read without the lock.
+	 * [j_list_lock]
+	 */
+	pgoff_t i_dirty_start;
+	pgoff_t i_dirty_end;
 };
 
 struct jbd2_revoke_table_s;
@@ -682,9 +692,17 @@ struct transaction_run_stats_s {
 	__u32			rs_blocks_logged;
 };
 
+/*
+ * Commit latency histogram: bucket i counts commits that took less than
+ * 2^i microseconds (and at least 2^(i-1)); the last bucket collects
+ * everything slower.
+ */
+#define JBD2_COMMIT_HIST_BUCKETS	24
+
 struct transaction_stats_s {
 	unsigned long		ts_tid;
 	struct transaction_run_stats_s run;
+	unsigned long		ts_commit_hist[JBD2_COMMIT_HIST_BUCKETS];
 };
 
 static inline unsigned long
@@ -1154,6 +1172,9 @@ extern int	   jbd2_journal_clear_err  (journal_t *);
 extern int	   jbd2_journal_bmap(journal_t *, unsigned long, unsigned long long *);
 extern int	   jbd2_journal_force_commit(journal_t *);
 extern int	   jbd2_journal_file_inode(handle_t *handle, struct jbd2_inode *inode);
+extern int	   jbd2_journal_inode_add_write(handle_t *handle,
+					struct jbd2_inode *inode,
+					loff_t start_byte, loff_t length);
 extern int	   jbd2_journal_begin_ordered_truncate(journal_t *journal,
 				struct jbd2_inode *inode, loff_t new_size);
 extern void	   jbd2_journal_init_jbd_inode(struct jbd2_inode *jinode, struct inode *inode);
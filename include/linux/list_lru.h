@@ -0,0 +1,131 @@
+/*
+ * Generic LRU list infrastructure with per-node lists, so that reclaim
+ * of a cache can be targeted at the node that is short of memory.
+ *
+ * This file is released under the GPLv2.
+ */
+#ifndef _LINUX_LIST_LRU_H
+#define _LINUX_LIST_LRU_H
+
+#include <linux/list.h>
+#include <linux/nodemask.h>
+#include <linux/spinlock.h>
+
+/* list_lru_walk_cb has to always return one of those */
+enum lru_status {
+	LRU_REMOVED,		/* item removed from list */
+	LRU_ROTATE,		/* item referenced, give another pass */
+	LRU_SKIP,		/* item cannot be locked, skip */
+	LRU_RETRY,		/* item not freeable. May drop the lock
+				   internally, but has to return locked. */
+};
+
+struct list_lru_node {
+	spinlock_t		lock;
+	struct list_head	list;
+	/* kept as signed so we can catch imbalance bugs */
+	long			nr_items;
+} ____cacheline_aligned_in_smp;
+
+struct list_lru {
+	struct list_lru_node	*node;
+	nodemask_t		active_nodes;
+};
+
+int list_lru_init(struct list_lru *lru);
+void list_lru_destroy(struct list_lru *lru);
+
+/**
+ * list_lru_add: add an element to the lru list's tail
+ * @lru: the lru pointer
+ * @item: the item to be added.
+ *
+ * The item is filed on the list of the node its memory lives on, so it
+ * must be embedded in memory from the kernel's linear mapping.  If the
+ * element is already part of a list, this function returns doing nothing.
+ * Therefore the caller does not need to keep state about whether or not
+ * the element already belongs in the list and is allowed to lazy update
+ * it.  Note however that this is valid for *a* list, not *this* list.
+ *
+ * Return value: true if the list was updated, false otherwise
+ */
+bool list_lru_add(struct list_lru *lru, struct list_head *item);
+
+/**
+ * list_lru_del: delete an element from the lru list
+ * @lru: the lru pointer
+ * @item: the item to be deleted.
+ *
+ * This function works analogously to list_lru_add in terms of list
+ * manipulation.
+ *
+ * Return value: true if the list was updated, false otherwise
+ */
+bool list_lru_del(struct list_lru *lru, struct list_head *item);
+
+/**
+ * list_lru_count_node: return the number of objects currently held by @lru
+ * @lru: the lru pointer.
+ * @nid: the node id to count from.
+ *
+ * Always return a non-negative number, 0 for empty lists.  There is no
+ * guarantee that the list is not updated while the count is being
+ * computed.
+ */
+unsigned long list_lru_count_node(struct list_lru *lru, int nid);
+
+static inline unsigned long list_lru_count(struct list_lru *lru)
+{
+	unsigned long count = 0;
+	int nid;
+
+	for_each_node_mask(nid, lru->active_nodes)
+		count += list_lru_count_node(lru, nid);
+
+	return count;
+}
+
+typedef enum lru_status
+(*list_lru_walk_cb)(struct list_head *item, spinlock_t *lock, void *cb_arg);
+
+/**
+ * list_lru_walk_node: walk a list_lru, isolating and disposing freeable items.
+ * @lru: the lru pointer.
+ * @nid: the node id to scan from.
+ * @isolate: callback function that is responsible for deciding what to do
+ *  with the item currently being scanned
+ * @cb_arg: opaque type that will be passed to @isolate
+ * @nr_to_walk: how many items to scan.
+ *
+ * This function will scan all elements in a particular list_lru, calling
+ * the @isolate callback for each of those items, along with the current
+ * list spinlock and a caller-provided opaque.  The @isolate callback can
+ * choose to drop the lock internally, but *must* return with the lock
+ * held.  The callback will return an enum lru_status telling the
+ * list_lru infrastructure what to do with the object being scanned.
+ *
+ * Please note that nr_to_walk does not mean how many objects will be
+ * freed, just how many objects will be scanned.
+ *
+ * Return value: the number of objects effectively removed from the LRU.
+ */
+unsigned long list_lru_walk_node(struct list_lru *lru, int nid,
+				 list_lru_walk_cb isolate, void *cb_arg,
+				 unsigned long *nr_to_walk);
+
+static inline unsigned long
+list_lru_walk(struct list_lru *lru, list_lru_walk_cb isolate,
+	      void *cb_arg, unsigned long nr_to_walk)
+{
+	unsigned long isolated = 0;
+	int nid;
+
+	for_each_node_mask(nid, lru->active_nodes) {
+		isolated += list_lru_walk_node(lru, nid, isolate,
+					       cb_arg, &nr_to_walk);
+		if (!nr_to_walk)
+			break;
+	}
+	return isolated;
+}
+#endif /* _LINUX_LIST_LRU_H */
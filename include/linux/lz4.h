@@ -0,0 +1,88 @@
+#ifndef __LZ4_H__
+#define __LZ4_H__
+/*
+ * LZ4 Kernel Interface
+ *
+ * LZ4 is a byte oriented LZ77 compressor producing the "LZ4 block format":
+ * a sequence of (literal run, match) pairs with 16 bit match offsets and no
+ * entropy coding.  lz4_compress() is a fast greedy single-probe compressor,
+ * lz4hc_compress() searches hash chains for longer matches and produces
+ * output that is typically 10-20% smaller at a fraction of the speed.  Both
+ * are decoded by the same decompressor.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <linux/types.h>
+
+#define LZ4_HASHLOG		12
+#define LZ4HC_HASHLOG		15
+#define LZ4HC_CHAINSIZE		(1 << 16)
+
+#define LZ4_MEM_COMPRESS	((1 << LZ4_HASHLOG) * sizeof(u32))
+#define LZ4HC_MEM_COMPRESS	((1 << LZ4HC_HASHLOG) * sizeof(u32) + \
+				 LZ4HC_CHAINSIZE * sizeof(u16) + \
+				 2 * sizeof(unsigned char *))
+
+/* Largest input a single lz4_compress()/lz4hc_compress() call accepts */
+#define LZ4_MAX_INPUT_SIZE	0x7E000000
+
+/*
+ * lz4_compressbound()
+ *	Provides the maximum size that LZ4 may output in a "worst case"
+ *	scenario (input data not compressible).
+ */
+static inline size_t lz4_compressbound(size_t isize)
+{
+	return isize + (isize / 255) + 16;
+}
+
+/*
+ * lz4_compress()
+ *	src     : source address of the original data
+ *	src_len : size of the original data
+ *	dst     : output buffer address of the compressed data
+ *	dst_len : in: size of the output buffer, out: size of the compressed
+ *		  data.  Compression always succeeds when the buffer is at
+ *		  least lz4_compressbound(src_len) bytes.
+ *	wrkmem  : address of the working memory, LZ4_MEM_COMPRESS bytes
+ *	return  : 0 on success, < 0 if the output does not fit
+ */
+int lz4_compress(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len, void *wrkmem);
+
+/*
+ * lz4hc_compress()
+ *	As lz4_compress(), but wrkmem must be LZ4HC_MEM_COMPRESS bytes.
+ */
+int lz4hc_compress(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len, void *wrkmem);
+
+/*
+ * lz4_decompress()
+ *	src     : source address of the compressed data
+ *	src_len : in: bytes available at src, out: bytes actually consumed
+ *	dest    : output buffer address of the decompressed data
+ *	actual_dest_len : exact size of the original data
+ *	return  : 0 on success, < 0 if the input is malformed or does not
+ *		  decode to exactly actual_dest_len bytes
+ *
+ *	Decoding stops as soon as actual_dest_len bytes have been produced,
+ *	so the input may be followed by unrelated data.
+ */
+int lz4_decompress(const unsigned char *src, size_t *src_len,
+		unsigned char *dest, size_t actual_dest_len);
+
+/*
+ * lz4_decompress_unknownoutputsize()
+ *	src     : source address of the compressed data
+ *	src_len : exact size of the compressed data
+ *	dest    : output buffer address of the decompressed data
+ *	dest_len: in: size of the output buffer, out: decompressed size
+ *	return  : 0 on success, < 0 if the input is malformed or does not
+ *		  fit in the output buffer
+ */
+int lz4_decompress_unknownoutputsize(const unsigned char *src, size_t src_len,
+		unsigned char *dest, size_t *dest_len);
+
+#endif
@@ -229,6 +229,24 @@ extern void set_timer_slack(struct timer_list *time, int slack_hz);
  */
 extern unsigned long get_next_timer_interrupt(unsigned long now);
 
+/*
+ * Per-CPU timer wheel summary, as shown in /proc/timer_list:
+ */
+#define TIMER_WHEEL_MAX_LEVELS	9
+
+struct timer_wheel_info {
+	unsigned long	clk;
+	unsigned long	next_timer;
+	unsigned long	nr_pending;
+	unsigned long	nr_expired;
+	unsigned int	levels;
+	unsigned int	level_size;
+	unsigned long	level_granularity[TIMER_WHEEL_MAX_LEVELS];
+	unsigned int	level_buckets[TIMER_WHEEL_MAX_LEVELS];
+};
+
+extern void timer_wheel_get_info(int cpu, struct timer_wheel_info *info);
+
 /*
  * Timer-statistics info:
  */
@@ -56,8 +56,9 @@
 /* Data structures. */
 
 static struct lock_class_key rcu_node_class[NUM_RCU_LVLS];
+static struct lock_class_key rcu_exp_class[NUM_RCU_LVLS];
 
-#define RCU_STATE_INITIALIZER(structname) { \
+#define RCU_STATE_INITIALIZER(structname, sabbr) { \
 	.level = { &structname.node[0] }, \
 	.levelcnt = { \
 		NUM_RCU_LVL_0,  /* root of hierarchy. */ \
@@ -73,13 +74,15 @@ static struct lock_class_key rcu_node_class[NUM_RCU_LVLS];
 	.fqslock = __RAW_SPIN_LOCK_UNLOCKED(&structname.fqslock), \
 	.n_force_qs = 0, \
 	.n_force_qs_ngp = 0, \
+	.expedited_wq = __WAIT_QUEUE_HEAD_INITIALIZER(structname.expedited_wq), \
 	.name = #structname, \
+	.abbr = sabbr, \
 }
 
-struct rcu_state rcu_sched_state = RCU_STATE_INITIALIZER(rcu_sched_state);
+struct rcu_state rcu_sched_state = RCU_STATE_INITIALIZER(rcu_sched_state, 's');
 DEFINE_PER_CPU(struct rcu_data, rcu_sched_data);
 
-struct rcu_state rcu_bh_state = RCU_STATE_INITIALIZER(rcu_bh_state);
+struct rcu_state rcu_bh_state = RCU_STATE_INITIALIZER(rcu_bh_state, 'b');
 DEFINE_PER_CPU(struct rcu_data, rcu_bh_data);
 
 static struct rcu_state *rcu_state;
@@ -164,6 +167,7 @@ void rcu_sched_qs(int cpu)
 	rdp->passed_quiesc_completed = rdp->gpnum - 1;
 	barrier();
 	rdp->passed_quiesc = 1;
+	rcu_report_exp_rdp(&rcu_sched_state, rdp);
 }
 
 void rcu_bh_qs(int cpu)
@@ -1297,6 +1301,7 @@ void rcu_check_callbacks(int cpu, int user)
 		rcu_bh_qs(cpu);
 	}
 	rcu_preempt_check_callbacks(cpu);
+	do_nocb_deferred_wakeup(cpu);
 	if (rcu_pending(cpu))
 		invoke_rcu_core();
 }
@@ -1503,9 +1508,15 @@ static void invoke_rcu_core(void)
 	raise_softirq(RCU_SOFTIRQ);
 }
 
+/*
+ * Queue a callback for the specified flavor of RCU.  Callbacks queued
+ * on a no-CBs CPU are handed to that CPU's rcuo kthread unless
+ * @no_offload is set, which the rcuo kthreads themselves use to queue
+ * the callback that tells them a grace period has elapsed.
+ */
 static void
 __call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *rcu),
-	   struct rcu_state *rsp)
+	   struct rcu_state *rsp, bool no_offload)
 {
 	unsigned long flags;
 	struct rcu_data *rdp;
@@ -1525,6 +1536,12 @@ __call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *rcu),
 	local_irq_save(flags);
 	rdp = this_cpu_ptr(rsp->rda);
 
+	/* No-CBs CPUs leave callback handling to their rcuo kthread. */
+	if (!no_offload && __call_rcu_nocb(rdp, head, flags)) {
+		local_irq_restore(flags);
+		return;
+	}
+
 	/* Add the callback to our list. */
 	*rdp->nxttail[RCU_NEXT_TAIL] = head;
 	rdp->nxttail[RCU_NEXT_TAIL] = &head->next;
@@ -1575,7 +1592,7 @@ __call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *rcu),
  */
 void call_rcu_sched(struct rcu_head *head, void (*func)(struct rcu_head *rcu))
 {
-	__call_rcu(head, func, &rcu_sched_state);
+	__call_rcu(head, func, &rcu_sched_state, false);
 }
 EXPORT_SYMBOL_GPL(call_rcu_sched);
 
@@ -1584,7 +1601,7 @@ EXPORT_SYMBOL_GPL(call_rcu_sched);
  */
 void call_rcu_bh(struct rcu_head *head, void (*func)(struct rcu_head *rcu))
 {
-	__call_rcu(head, func, &rcu_bh_state);
+	__call_rcu(head, func, &rcu_bh_state, false);
 }
 EXPORT_SYMBOL_GPL(call_rcu_bh);
 
@@ -1746,7 +1763,8 @@ static int rcu_needs_cpu_quick_check(int cpu)
 	/* RCU callbacks either ready or pending? */
 	return per_cpu(rcu_sched_data, cpu).nxtlist ||
 	       per_cpu(rcu_bh_data, cpu).nxtlist ||
-	       rcu_preempt_needs_cpu(cpu);
+	       rcu_preempt_needs_cpu(cpu) ||
+	       rcu_nocb_needs_cpu(cpu);
 }
 
 static DEFINE_PER_CPU(struct rcu_head, rcu_barrier_head) = {NULL};
@@ -1799,7 +1817,10 @@ static void _rcu_barrier(struct rcu_state *rsp,
 	 * CPU has queued its RCU-barrier callback.
 	 */
 	atomic_set(&rcu_barrier_cpu_count, 1);
+	get_online_cpus();
 	on_each_cpu(rcu_barrier_func, (void *)call_rcu_func, 1);
+	rcu_nocb_barrier_offline(rsp, rcu_barrier_callback);
+	put_online_cpus();
 	if (atomic_dec_and_test(&rcu_barrier_cpu_count))
 		complete(&rcu_barrier_completion);
 	wait_for_completion(&rcu_barrier_completion);
@@ -1846,6 +1867,7 @@ rcu_boot_init_percpu_data(int cpu, struct rcu_state *rsp)
 	rdp->dynticks = &per_cpu(rcu_dynticks, cpu);
 #endif /* #ifdef CONFIG_NO_HZ */
 	rdp->cpu = cpu;
+	rcu_boot_init_nocb_percpu_data(rdp, rsp);
 	raw_spin_unlock_irqrestore(&rnp->lock, flags);
 }
 
@@ -2011,12 +2033,17 @@ static void __init rcu_init_one(struct rcu_state *rsp,
 			       "rcu_node_level_1",
 			       "rcu_node_level_2",
 			       "rcu_node_level_3" };  /* Match MAX_RCU_LVLS */
+	static char *exp[] = { "rcu_node_exp_0",
+			       "rcu_node_exp_1",
+			       "rcu_node_exp_2",
+			       "rcu_node_exp_3" };  /* Match MAX_RCU_LVLS */
 	int cpustride = 1;
 	int i;
 	int j;
 	struct rcu_node *rnp;
 
 	BUILD_BUG_ON(MAX_RCU_LVLS > ARRAY_SIZE(buf));  /* Fix buf[] init! */
+	BUILD_BUG_ON(MAX_RCU_LVLS > ARRAY_SIZE(exp));  /* Fix exp[] init! */
 
 	/* Initialize the level-tracking arrays. */
 
@@ -2033,6 +2060,9 @@ static void __init rcu_init_one(struct rcu_state *rsp,
 			raw_spin_lock_init(&rnp->lock);
 			lockdep_set_class_and_name(&rnp->lock,
 						   &rcu_node_class[i], buf[i]);
+			mutex_init(&rnp->exp_funnel_mutex);
+			lockdep_set_class_and_name(&rnp->exp_funnel_mutex,
+						   &rcu_exp_class[i], exp[i]);
 			rnp->gpnum = 0;
 			rnp->qsmask = 0;
 			rnp->qsmaskinit = 0;
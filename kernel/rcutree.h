@@ -27,6 +27,8 @@
 #include <linux/threads.h>
 #include <linux/cpumask.h>
 #include <linux/seqlock.h>
+#include <linux/wait.h>
+#include <linux/mutex.h>
 
 /*
  * Define shape of hierarchy based on NR_CPUS and CONFIG_RCU_FANOUT.
@@ -187,6 +189,10 @@ struct rcu_node {
 				/*  per-CPU kthreads as needed. */
 	unsigned int node_kthread_status;
 				/* State of node_kthread_task for tracing. */
+	struct mutex exp_funnel_mutex;
+				/* Funnel expedited grace-period requests */
+				/*  towards the root, so that concurrent */
+				/*  requests share a single grace period. */
 } ____cacheline_internodealigned_in_smp;
 
 /*
@@ -298,6 +304,24 @@ struct rcu_data {
 	unsigned long n_rp_need_fqs;
 	unsigned long n_rp_need_nothing;
 
+	/* 6) Expedited grace periods. */
+	int exp_need_qs;		/* Current expedited GP awaits this */
+					/*  CPU's quiescent state. */
+	unsigned long n_exp_ipis;	/* Expedited-GP IPIs sent to this CPU. */
+
+#ifdef CONFIG_RCU_NOCB_CPU
+	/* 7) Callback offloading. */
+	struct rcu_head *nocb_head;	/* CBs waiting for kthread. */
+	struct rcu_head **nocb_tail;
+	atomic_long_t nocb_q_count;	/* # CBs waiting for kthread. */
+	long nocb_p_count;		/* # CBs being invoked by kthread. */
+	bool nocb_defer_wakeup;		/* Wake kthread from next tick. */
+	wait_queue_head_t nocb_wq;	/* For nocb kthreads to sleep on. */
+	struct task_struct *nocb_kthread;
+	unsigned long n_nocbs_invoked;	/* count of no-CBs RCU cbs invoked. */
+	struct rcu_state *rsp;		/* Flavor, for the nocb kthread. */
+#endif /* #ifdef CONFIG_RCU_NOCB_CPU */
+
 	int cpu;
 };
 
@@ -393,7 +417,19 @@ struct rcu_state {
 						/*  for CPU stalls. */
 	unsigned long gp_max;			/* Maximum GP duration in */
 						/*  jiffies. */
+
+	unsigned long expedited_sequence;	/* Take a ticket, odd while */
+						/*  an expedited GP runs. */
+	atomic_t expedited_need_qs;		/* # CPUs left to check in. */
+	wait_queue_head_t expedited_wq;		/* Wait for check-ins. */
+	atomic_long_t expedited_workdone1;	/* # done by others #1. */
+	atomic_long_t expedited_workdone2;	/* # done by others #2. */
+	atomic_long_t expedited_workdone3;	/* # done by others #3. */
+	unsigned long expedited_ipis;		/* # IPIs sent. */
+	unsigned long expedited_idle;		/* # CPUs found idle. */
+
 	char *name;				/* Name of structure. */
+	char abbr;				/* Abbreviated name. */
 };
 
 /* Return values for rcu_preempt_offline_tasks(). */
@@ -417,6 +453,10 @@ extern struct rcu_state rcu_preempt_state;
 DECLARE_PER_CPU(struct rcu_data, rcu_preempt_data);
 #endif /* #ifdef CONFIG_TREE_PREEMPT_RCU */
 
+#ifdef CONFIG_RCU_NOCB_CPU
+bool is_nocb_cpu(int cpu);
+#endif /* #ifdef CONFIG_RCU_NOCB_CPU */
+
 #ifndef RCU_TREE_NONCORE
 
 /* Forward declarations for rcutree_plugin.h */
@@ -466,5 +506,14 @@ static void rcu_yield(void (*f)(unsigned long), unsigned long arg);
 #endif /* #ifdef CONFIG_RCU_BOOST */
 static void rcu_cpu_kthread_setrt(int cpu, int to_rt);
 static void __cpuinit rcu_prepare_kthreads(int cpu);
+static bool __call_rcu_nocb(struct rcu_data *rdp, struct rcu_head *rhp,
+			    unsigned long flags);
+static void do_nocb_deferred_wakeup(int cpu);
+static bool rcu_nocb_needs_cpu(int cpu);
+static void rcu_nocb_barrier_offline(struct rcu_state *rsp,
+				     void (*func)(struct rcu_head *head));
+static void __init rcu_boot_init_nocb_percpu_data(struct rcu_data *rdp,
+						  struct rcu_state *rsp);
+static void rcu_report_exp_rdp(struct rcu_state *rsp, struct rcu_data *rdp);
 
 #endif /* #ifndef RCU_TREE_NONCORE */
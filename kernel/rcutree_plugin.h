@@ -25,7 +25,6 @@
  */
 
 #include <linux/delay.h>
-#include <linux/stop_machine.h>
 
 /*
  * Check the RCU kernel configuration parameters and print informative
@@ -64,7 +63,7 @@ static void __init rcu_bootup_announce_oddness(void)
 
 #ifdef CONFIG_TREE_PREEMPT_RCU
 
-struct rcu_state rcu_preempt_state = RCU_STATE_INITIALIZER(rcu_preempt_state);
+struct rcu_state rcu_preempt_state = RCU_STATE_INITIALIZER(rcu_preempt_state, 'p');
 DEFINE_PER_CPU(struct rcu_data, rcu_preempt_data);
 static struct rcu_state *rcu_state = &rcu_preempt_state;
 
@@ -639,7 +638,7 @@ static void rcu_preempt_do_callbacks(void)
  */
 void call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *rcu))
 {
-	__call_rcu(head, func, &rcu_preempt_state);
+	__call_rcu(head, func, &rcu_preempt_state, false);
 }
 EXPORT_SYMBOL_GPL(call_rcu);
 
@@ -1772,119 +1771,268 @@ void synchronize_sched_expedited(void)
 }
 EXPORT_SYMBOL_GPL(synchronize_sched_expedited);
 
+static void rcu_report_exp_rdp(struct rcu_state *rsp, struct rcu_data *rdp)
+{
+}
+
 #else /* #ifndef CONFIG_SMP */
 
-static atomic_t sync_sched_expedited_started = ATOMIC_INIT(0);
-static atomic_t sync_sched_expedited_done = ATOMIC_INIT(0);
+/*
+ * Expedited grace periods are numbered by ->expedited_sequence, which is
+ * odd while one is in progress.  A requester snapshots the number that
+ * the counter will have once a full expedited grace period has elapsed
+ * after its request, and is done as soon as the counter reaches it.
+ */
+static void rcu_exp_gp_seq_start(struct rcu_state *rsp)
+{
+	ACCESS_ONCE(rsp->expedited_sequence)++;
+	smp_mb(); /* Ensure counter update seen before grace-period work. */
+	WARN_ON_ONCE(!(rsp->expedited_sequence & 0x1));
+}
+
+static void rcu_exp_gp_seq_end(struct rcu_state *rsp)
+{
+	smp_mb(); /* Ensure grace-period work seen before counter update. */
+	ACCESS_ONCE(rsp->expedited_sequence)++;
+	WARN_ON_ONCE(rsp->expedited_sequence & 0x1);
+}
 
-static int synchronize_sched_expedited_cpu_stop(void *data)
+static unsigned long rcu_exp_gp_seq_snap(struct rcu_state *rsp)
 {
-	/*
-	 * There must be a full memory barrier on each affected CPU
-	 * between the time that try_stop_cpus() is called and the
-	 * time that it returns.
-	 *
-	 * In the current initial implementation of cpu_stop, the
-	 * above condition is already met when the control reaches
-	 * this point and the following smp_mb() is not strictly
-	 * necessary.  Do smp_mb() anyway for documentation and
-	 * robustness against future implementation changes.
-	 */
-	smp_mb(); /* See above comment block. */
-	return 0;
+	unsigned long s;
+
+	smp_mb(); /* Caller's modifications seen first by other CPUs. */
+	s = (ACCESS_ONCE(rsp->expedited_sequence) + 3) & ~0x1UL;
+	smp_mb(); /* Above access must not bleed into critical section. */
+	return s;
+}
+
+static bool rcu_exp_gp_seq_done(struct rcu_state *rsp, unsigned long s)
+{
+	return ULONG_CMP_GE(ACCESS_ONCE(rsp->expedited_sequence), s);
 }
 
 /*
- * Wait for an rcu-sched grace period to elapse, but use "big hammer"
- * approach to force grace period to end quickly.  This consumes
- * significant time on all CPUs, and is thus not recommended for
- * any sort of common-case code.
- *
- * Note that it is illegal to call this function while holding any
- * lock that is acquired by a CPU-hotplug notifier.  Failing to
- * observe this restriction will result in deadlock.
- *
- * This implementation can be thought of as an application of ticket
- * locking to RCU, with sync_sched_expedited_started and
- * sync_sched_expedited_done taking on the roles of the halves
- * of the ticket-lock word.  Each task atomically increments
- * sync_sched_expedited_started upon entry, snapshotting the old value,
- * then attempts to stop all the CPUs.  If this succeeds, then each
- * CPU will have executed a context switch, resulting in an RCU-sched
- * grace period.  We are then done, so we use atomic_cmpxchg() to
- * update sync_sched_expedited_done to match our snapshot -- but
- * only if someone else has not already advanced past our snapshot.
- *
- * On the other hand, if try_stop_cpus() fails, we check the value
- * of sync_sched_expedited_done.  If it has advanced past our
- * initial snapshot, then someone else must have forced a grace period
- * some time after we took our snapshot.  In this case, our work is
- * done for us, and we can simply return.  Otherwise, we try again,
- * but keep our initial snapshot for purposes of checking for someone
- * doing our work for us.
- *
- * If we fail too many times in a row, we fall back to synchronize_sched().
+ * Check to see if some other task's expedited grace period already did
+ * our work.  If so, release the specified rcu_node funnel mutex (if any),
+ * count the event, and return true.
  */
-void synchronize_sched_expedited(void)
+static bool sync_exp_work_done(struct rcu_state *rsp, struct rcu_node *rnp,
+			       atomic_long_t *stat, unsigned long s)
 {
-	int firstsnap, s, snap, trycount = 0;
+	if (rcu_exp_gp_seq_done(rsp, s)) {
+		if (rnp)
+			mutex_unlock(&rnp->exp_funnel_mutex);
+		/* Ensure test happens before caller kfree(). */
+		smp_mb__before_atomic_inc(); /* ^^^ */
+		atomic_long_inc(stat);
+		return true;
+	}
+	return false;
+}
 
-	/* Note that atomic_inc_return() implies full memory barrier. */
-	firstsnap = snap = atomic_inc_return(&sync_sched_expedited_started);
-	get_online_cpus();
+/*
+ * Funnel-lock acquisition for expedited grace periods.  Returns the
+ * root rcu_node structure's ->exp_funnel_mutex held, or NULL if some
+ * other task did our work for us along the way.  Requesters contend
+ * first at their own leaf rcu_node structure, so that only one task
+ * per leaf reaches the next level, and so on up to the root.  Whoever
+ * ends up holding the root mutex runs a grace period that covers all
+ * the requests queued up behind it.
+ */
+static struct rcu_node *exp_funnel_lock(struct rcu_state *rsp, unsigned long s)
+{
+	struct rcu_data *rdp;
+	struct rcu_node *rnp0;
+	struct rcu_node *rnp1 = NULL;
 
 	/*
-	 * Each pass through the following loop attempts to force a
-	 * context switch on each CPU.
+	 * First try directly acquiring the root lock in order to reduce
+	 * latency in the common case where expedited grace periods are
+	 * rare.  We check mutex_is_locked() to avoid pathological levels of
+	 * memory contention on ->exp_funnel_mutex in the heavy-load case.
 	 */
-	while (try_stop_cpus(cpu_online_mask,
-			     synchronize_sched_expedited_cpu_stop,
-			     NULL) == -EAGAIN) {
-		put_online_cpus();
-
-		/* No joy, try again later.  Or just synchronize_sched(). */
-		if (trycount++ < 10)
-			udelay(trycount * num_online_cpus());
-		else {
-			synchronize_sched();
-			return;
-		}
-
-		/* Check to see if someone else did our work for us. */
-		s = atomic_read(&sync_sched_expedited_done);
-		if (UINT_CMP_GE((unsigned)s, (unsigned)firstsnap)) {
-			smp_mb(); /* ensure test happens before caller kfree */
-			return;
+	rnp0 = rcu_get_root(rsp);
+	if (!mutex_is_locked(&rnp0->exp_funnel_mutex)) {
+		if (mutex_trylock(&rnp0->exp_funnel_mutex)) {
+			if (sync_exp_work_done(rsp, rnp0,
+					       &rsp->expedited_workdone1, s))
+				return NULL;
+			return rnp0;
 		}
-
-		/*
-		 * Refetching sync_sched_expedited_started allows later
-		 * callers to piggyback on our grace period.  We subtract
-		 * 1 to get the same token that the last incrementer got.
-		 * We retry after they started, so our grace period works
-		 * for them, and they started after our first try, so their
-		 * grace period works for us.
-		 */
-		get_online_cpus();
-		snap = atomic_read(&sync_sched_expedited_started) - 1;
-		smp_mb(); /* ensure read is before try_stop_cpus(). */
 	}
 
 	/*
-	 * Everyone up to our most recent fetch is covered by our grace
-	 * period.  Update the counter, but only if our work is still
-	 * relevant -- which it won't be if someone who started later
-	 * than we did beat us to the punch.
+	 * Each pass through the following loop works its way up the
+	 * rcu_node tree, returning if others have done the work or
+	 * otherwise falls through holding the root rcu_node structure's
+	 * ->exp_funnel_mutex.
 	 */
-	do {
-		s = atomic_read(&sync_sched_expedited_done);
-		if (UINT_CMP_GE((unsigned)s, (unsigned)snap)) {
-			smp_mb(); /* ensure test happens before caller kfree */
+	rdp = per_cpu_ptr(rsp->rda, raw_smp_processor_id());
+	for (rnp0 = rdp->mynode; rnp0 != NULL; rnp0 = rnp0->parent) {
+		if (sync_exp_work_done(rsp, rnp1,
+				       &rsp->expedited_workdone2, s))
+			return NULL;
+		mutex_lock(&rnp0->exp_funnel_mutex);
+		if (rnp1)
+			mutex_unlock(&rnp1->exp_funnel_mutex);
+		rnp1 = rnp0;
+	}
+	if (sync_exp_work_done(rsp, rnp1, &rsp->expedited_workdone3, s))
+		return NULL;
+	return rnp1;
+}
+
+/*
+ * Report an expedited quiescent state for the specified CPU, if the
+ * current expedited grace period is still waiting on it.  Called from
+ * rcu_sched_qs(), and thus on every context switch, so the common case
+ * must be cheap.  The cmpxchg() provides the full memory barrier that
+ * orders the CPU's prior RCU read-side critical sections before the
+ * end of the expedited grace period.
+ */
+static void rcu_report_exp_rdp(struct rcu_state *rsp, struct rcu_data *rdp)
+{
+	if (likely(!ACCESS_ONCE(rdp->exp_need_qs)))
+		return;
+	if (cmpxchg(&rdp->exp_need_qs, 1, 0) != 1)
+		return;
+	if (atomic_dec_and_test(&rsp->expedited_need_qs))
+		wake_up(&rsp->expedited_wq);
+}
+
+/*
+ * Is the specified CPU in dyntick-idle mode, and thus in an extended
+ * quiescent state?  The value-returning atomic supplies the needed
+ * memory barrier.
+ */
+static bool sync_sched_exp_cpu_idle(struct rcu_data *rdp)
+{
+#ifdef CONFIG_NO_HZ
+	return !(atomic_add_return(0, &rdp->dynticks->dynticks) & 0x1);
+#else /* #ifdef CONFIG_NO_HZ */
+	return false;
+#endif /* #else #ifdef CONFIG_NO_HZ */
+}
+
+/*
+ * Expedited-grace-period IPI handler.  If this CPU still owes the
+ * expedited grace period a quiescent state, force a trip through the
+ * scheduler, whose rcu_sched_qs() will report it.
+ */
+static void sync_sched_exp_handler(void *data)
+{
+	struct rcu_state *rsp = data;
+	struct rcu_data *rdp = this_cpu_ptr(rsp->rda);
+
+	if (!ACCESS_ONCE(rdp->exp_need_qs))
+		return;
+	set_tsk_need_resched(current);
+}
+
+/*
+ * Select the CPUs that the current expedited grace period must wait
+ * on, and IPI them.  Offline CPUs, dyntick-idle CPUs and the current
+ * CPU (we are preemptible, so not in an RCU-sched read-side critical
+ * section) are already quiescent and are left alone.  The caller holds
+ * get_online_cpus().  Returns with ->expedited_need_qs biased by one,
+ * which sync_sched_exp_wait() removes.
+ */
+static void sync_sched_exp_select_cpus(struct rcu_state *rsp)
+{
+	int cpu;
+	struct rcu_data *rdp;
+
+	atomic_set(&rsp->expedited_need_qs, 1);
+	for_each_online_cpu(cpu) {
+		rdp = per_cpu_ptr(rsp->rda, cpu);
+		if (cpu == raw_smp_processor_id() ||
+		    sync_sched_exp_cpu_idle(rdp)) {
+			rsp->expedited_idle++;
+			continue;
+		}
+		atomic_inc(&rsp->expedited_need_qs);
+		smp_mb__after_atomic_inc(); /* Count before flag. */
+		ACCESS_ONCE(rdp->exp_need_qs) = 1;
+		rdp->n_exp_ipis++;
+		rsp->expedited_ipis++;
+		smp_call_function_single(cpu, sync_sched_exp_handler, rsp, 0);
+	}
+}
+
+/* Wait for all the CPUs selected above to check in, complaining if slow. */
+static void sync_sched_exp_wait(struct rcu_state *rsp)
+{
+	int cpu;
+	unsigned long jiffies_start = jiffies;
+	struct rcu_data *rdp;
+	int ret;
+
+	if (atomic_dec_and_test(&rsp->expedited_need_qs))
+		return;
+	for (;;) {
+		ret = wait_event_timeout(rsp->expedited_wq,
+					 !atomic_read(&rsp->expedited_need_qs),
+					 RCU_SECONDS_TILL_STALL_CHECK);
+		if (ret > 0)
 			break;
+		if (rcu_cpu_stall_suppress)
+			continue;
+		printk(KERN_ERR "INFO: %s detected expedited stalls on CPUs: {",
+		       rsp->name);
+		for_each_online_cpu(cpu) {
+			rdp = per_cpu_ptr(rsp->rda, cpu);
+			if (ACCESS_ONCE(rdp->exp_need_qs))
+				printk(" %d", cpu);
 		}
-	} while (atomic_cmpxchg(&sync_sched_expedited_done, s, snap) != s);
+		printk(" } %lu jiffies s: %lu\n",
+		       jiffies - jiffies_start, rsp->expedited_sequence);
+		dump_stack();
+	}
+	smp_mb(); /* Check-ins happen before caller's subsequent accesses. */
+}
 
+/**
+ * synchronize_sched_expedited - Brute-force RCU-sched grace period
+ *
+ * Wait for an RCU-sched grace period to elapse, but use a "big hammer"
+ * approach to force the grace period to end quickly.  This consumes
+ * significant time on all CPUs and is unfriendly to real-time workloads,
+ * so is thus not recommended for any sort of common-case code.  In fact,
+ * if you are using synchronize_sched_expedited() in a loop, please
+ * restructure your code to batch your updates, and then use a single
+ * synchronize_sched() instead.
+ *
+ * Only CPUs that are not already in a quiescent state are IPIed, and
+ * then only to force a pass through the scheduler; idle and offline
+ * CPUs are never disturbed.  Concurrent callers funnel up the rcu_node
+ * tree as described at exp_funnel_lock(), and all of them are satisfied
+ * by the grace period that the winner runs.
+ *
+ * Note that it is illegal to call this function while holding any
+ * lock that is acquired by a CPU-hotplug notifier.  Failing to
+ * observe this restriction will result in deadlock.
+ */
+void synchronize_sched_expedited(void)
+{
+	unsigned long s;
+	struct rcu_node *rnp;
+	struct rcu_state *rsp = &rcu_sched_state;
+
+	/* Take a snapshot of the sequence number.  */
+	s = rcu_exp_gp_seq_snap(rsp);
+
+	rnp = exp_funnel_lock(rsp, s);
+	if (rnp == NULL)
+		return;  /* Someone else did our work for us. */
+
+	get_online_cpus();
+	rcu_exp_gp_seq_start(rsp);
+	sync_sched_exp_select_cpus(rsp);
+	sync_sched_exp_wait(rsp);
+	rcu_exp_gp_seq_end(rsp);
 	put_online_cpus();
+	mutex_unlock(&rnp->exp_funnel_mutex);
 }
 EXPORT_SYMBOL_GPL(synchronize_sched_expedited);
 
@@ -1988,7 +2136,7 @@ int rcu_needs_cpu(int cpu)
 	/* If RCU callbacks are still pending, RCU still needs this CPU. */
 	if (c)
 		invoke_rcu_core();
-	return c;
+	return c || rcu_nocb_needs_cpu(cpu);
 }
 
 /*
@@ -2008,3 +2156,286 @@ static void rcu_needs_cpu_flush(void)
 }
 
 #endif /* #else #if !defined(CONFIG_RCU_FAST_NO_HZ) */
+
+#ifdef CONFIG_RCU_NOCB_CPU
+
+/*
+ * Offload callback processing from the boot-time-specified set of CPUs
+ * specified by rcu_nocb_mask.  For each CPU in the set, there is a
+ * kthread for each flavor of RCU ("rcuo" followed by the flavor's
+ * abbreviation and the CPU number) that dequeues the callbacks queued
+ * on that CPU, waits for a grace period, and then invokes them.  The
+ * no-CBs CPU thus invokes no RCU callbacks from softirq context, and the
+ * rcuo kthreads may be affinitied to housekeeping CPUs.
+ *
+ * The rcuo kthreads wait for grace periods by queueing a wakeup callback
+ * on whatever CPU they happen to be running on, bypassing the offload.
+ * Those callbacks are the only ones that a no-CBs CPU might invoke, and
+ * only if its rcuo kthreads have not been moved elsewhere.
+ */
+
+static cpumask_var_t rcu_nocb_mask; /* CPUs to have callbacks offloaded. */
+static bool have_rcu_nocb_mask;	    /* Was rcu_nocb_mask allocated? */
+
+/* Parse the boot-time rcu_nocbs= CPU list from the kernel parameters. */
+static int __init rcu_nocb_setup(char *str)
+{
+	alloc_bootmem_cpumask_var(&rcu_nocb_mask);
+	have_rcu_nocb_mask = true;
+	cpulist_parse(str, rcu_nocb_mask);
+	return 1;
+}
+__setup("rcu_nocbs=", rcu_nocb_setup);
+
+/* Is the specified CPU a no-CBs CPU? */
+bool is_nocb_cpu(int cpu)
+{
+	if (have_rcu_nocb_mask)
+		return cpumask_test_cpu(cpu, rcu_nocb_mask);
+	return false;
+}
+
+/*
+ * Enqueue the specified callback onto the specified no-CBs CPU's list,
+ * which is lockless: concurrent enqueuers are ordered by the xchg() of
+ * the tail pointer.  If the list was empty, the rcuo kthread might be
+ * asleep, so wake it -- or, if irqs were disabled by our caller, who
+ * might hold scheduler locks, leave that to the next scheduling-clock
+ * interrupt.
+ */
+static void __call_rcu_nocb_enqueue(struct rcu_data *rdp,
+				    struct rcu_head *rhp, bool defer_wakeup)
+{
+	struct rcu_head **old_rhpp;
+
+	old_rhpp = xchg(&rdp->nocb_tail, &rhp->next);
+	ACCESS_ONCE(*old_rhpp) = rhp;
+	atomic_long_inc(&rdp->nocb_q_count);
+
+	if (old_rhpp == &rdp->nocb_head) {
+		if (defer_wakeup)
+			rdp->nocb_defer_wakeup = true;
+		else
+			wake_up(&rdp->nocb_wq);
+	}
+}
+
+/*
+ * This is a helper for __call_rcu(), which invokes this when the normal
+ * callback queue is inoperable.  If this is not a no-CBs CPU, this
+ * function returns failure back to __call_rcu(), which can complain
+ * appropriately.
+ */
+static bool __call_rcu_nocb(struct rcu_data *rdp, struct rcu_head *rhp,
+			    unsigned long flags)
+{
+	if (!is_nocb_cpu(rdp->cpu))
+		return false;
+	__call_rcu_nocb_enqueue(rdp, rhp, irqs_disabled_flags(flags));
+	return true;
+}
+
+/* Do a wakeup of an rcuo kthread that __call_rcu_nocb() had to defer. */
+static void do_nocb_deferred_wakeup_one(struct rcu_data *rdp)
+{
+	if (!rdp->nocb_defer_wakeup)
+		return;
+	rdp->nocb_defer_wakeup = false;
+	wake_up(&rdp->nocb_wq);
+}
+
+static void do_nocb_deferred_wakeup(int cpu)
+{
+	if (!is_nocb_cpu(cpu))
+		return;
+	do_nocb_deferred_wakeup_one(&per_cpu(rcu_sched_data, cpu));
+	do_nocb_deferred_wakeup_one(&per_cpu(rcu_bh_data, cpu));
+#ifdef CONFIG_TREE_PREEMPT_RCU
+	do_nocb_deferred_wakeup_one(&per_cpu(rcu_preempt_data, cpu));
+#endif /* #ifdef CONFIG_TREE_PREEMPT_RCU */
+}
+
+/*
+ * A no-CBs CPU with a deferred wakeup pending must keep its scheduling
+ * clock tick so that the wakeup actually happens.
+ */
+static bool rcu_nocb_needs_cpu(int cpu)
+{
+	if (!is_nocb_cpu(cpu))
+		return false;
+	return per_cpu(rcu_sched_data, cpu).nocb_defer_wakeup ||
+#ifdef CONFIG_TREE_PREEMPT_RCU
+	       per_cpu(rcu_preempt_data, cpu).nocb_defer_wakeup ||
+#endif /* #ifdef CONFIG_TREE_PREEMPT_RCU */
+	       per_cpu(rcu_bh_data, cpu).nocb_defer_wakeup;
+}
+
+/*
+ * Offline no-CBs CPUs may still have callbacks queued for their rcuo
+ * kthreads, which on_each_cpu() in _rcu_barrier() cannot reach.  Queue
+ * a barrier callback behind them.  The caller holds get_online_cpus().
+ */
+static void rcu_nocb_barrier_offline(struct rcu_state *rsp,
+				     void (*func)(struct rcu_head *head))
+{
+	struct rcu_data *rdp;
+	struct rcu_head *rhp;
+	int cpu;
+
+	if (!have_rcu_nocb_mask)
+		return;
+	for_each_cpu(cpu, rcu_nocb_mask) {
+		if (cpu_online(cpu))
+			continue;
+		rdp = per_cpu_ptr(rsp->rda, cpu);
+		if (!rdp->nocb_kthread)
+			continue;
+		rhp = &per_cpu(rcu_barrier_head, cpu);
+		debug_rcu_head_queue(rhp);
+		rhp->func = func;
+		rhp->next = NULL;
+		atomic_inc(&rcu_barrier_cpu_count);
+		__call_rcu_nocb_enqueue(rdp, rhp, false);
+	}
+}
+
+/*
+ * Wait for a full grace period of the rcuo kthread's flavor to elapse.
+ * The wakeup callback is queued on the current CPU's normal list, so
+ * that the grace-period machinery sees it.
+ */
+static void rcu_nocb_wait_gp(struct rcu_data *rdp)
+{
+	struct rcu_synchronize rcu;
+
+	init_rcu_head_on_stack(&rcu.head);
+	init_completion(&rcu.completion);
+	__call_rcu(&rcu.head, wakeme_after_rcu, rdp->rsp, true);
+	wait_for_completion(&rcu.completion);
+	destroy_rcu_head_on_stack(&rcu.head);
+}
+
+/*
+ * Per-rcu_data kthread, but only for no-CBs CPUs.  Each kthread invokes
+ * callbacks queued by the corresponding no-CBs CPU.
+ */
+static int rcu_nocb_kthread(void *arg)
+{
+	long c;
+	struct rcu_head *list;
+	struct rcu_head *next;
+	struct rcu_head **tail;
+	struct rcu_data *rdp = arg;
+
+	/* Each pass through this loop invokes one batch of callbacks. */
+	for (;;) {
+		wait_event_interruptible(rdp->nocb_wq,
+					 ACCESS_ONCE(rdp->nocb_head));
+		list = ACCESS_ONCE(rdp->nocb_head);
+		if (!list)
+			continue;
+
+		/*
+		 * Extract queued callbacks, update counts, and wait
+		 * for a grace period to elapse.
+		 */
+		ACCESS_ONCE(rdp->nocb_head) = NULL;
+		tail = xchg(&rdp->nocb_tail, &rdp->nocb_head);
+		c = atomic_long_xchg(&rdp->nocb_q_count, 0);
+		ACCESS_ONCE(rdp->nocb_p_count) += c;
+		rcu_nocb_wait_gp(rdp);
+
+		/* Each pass through the following loop invokes a callback. */
+		c = 0;
+		while (list) {
+			next = list->next;
+			/* Wait for enqueuing to complete, if needed. */
+			while (next == NULL && &list->next != tail) {
+				schedule_timeout_interruptible(1);
+				next = ACCESS_ONCE(list->next);
+			}
+			debug_rcu_head_unqueue(list);
+			local_bh_disable();
+			__rcu_reclaim(list);
+			local_bh_enable();
+			list = next;
+			c++;
+			cond_resched();
+		}
+		ACCESS_ONCE(rdp->nocb_p_count) -= c;
+		rdp->n_nocbs_invoked += c;
+	}
+	return 0;
+}
+
+/* Initialize per-rcu_data variables for no-CBs CPUs. */
+static void __init rcu_boot_init_nocb_percpu_data(struct rcu_data *rdp,
+						  struct rcu_state *rsp)
+{
+	rdp->nocb_tail = &rdp->nocb_head;
+	init_waitqueue_head(&rdp->nocb_wq);
+	rdp->rsp = rsp;
+}
+
+/* Create a kthread for each RCU flavor for each no-CBs CPU. */
+static void __init rcu_spawn_nocb_kthreads(struct rcu_state *rsp)
+{
+	int cpu;
+	struct rcu_data *rdp;
+	struct task_struct *t;
+
+	for_each_cpu(cpu, rcu_nocb_mask) {
+		rdp = per_cpu_ptr(rsp->rda, cpu);
+		t = kthread_run(rcu_nocb_kthread, rdp,
+				"rcuo%c/%d", rsp->abbr, cpu);
+		BUG_ON(IS_ERR(t));
+		ACCESS_ONCE(rdp->nocb_kthread) = t;
+	}
+}
+
+static int __init rcu_spawn_all_nocb_kthreads(void)
+{
+	static char __initdata nocb_buf[NR_CPUS * 5];
+
+	if (!have_rcu_nocb_mask)
+		return 0;
+	cpumask_and(rcu_nocb_mask, rcu_nocb_mask, cpu_possible_mask);
+	cpulist_scnprintf(nocb_buf, sizeof(nocb_buf), rcu_nocb_mask);
+	printk(KERN_INFO "\tOffload RCU callbacks from CPUs: %s.\n", nocb_buf);
+#ifdef CONFIG_TREE_PREEMPT_RCU
+	rcu_spawn_nocb_kthreads(&rcu_preempt_state);
+#endif /* #ifdef CONFIG_TREE_PREEMPT_RCU */
+	rcu_spawn_nocb_kthreads(&rcu_sched_state);
+	rcu_spawn_nocb_kthreads(&rcu_bh_state);
+	return 0;
+}
+early_initcall(rcu_spawn_all_nocb_kthreads);
+
+#else /* #ifdef CONFIG_RCU_NOCB_CPU */
+
+static bool __call_rcu_nocb(struct rcu_data *rdp, struct rcu_head *rhp,
+			    unsigned long flags)
+{
+	return false;
+}
+
+static void do_nocb_deferred_wakeup(int cpu)
+{
+}
+
+static bool rcu_nocb_needs_cpu(int cpu)
+{
+	return false;
+}
+
+static void rcu_nocb_barrier_offline(struct rcu_state *rsp,
+				     void (*func)(struct rcu_head *head))
+{
+}
+
+static void __init rcu_boot_init_nocb_percpu_data(struct rcu_data *rdp,
+						  struct rcu_state *rsp)
+{
+}
+
+#endif /* #else #ifdef CONFIG_RCU_NOCB_CPU */
@@ -98,6 +98,13 @@ static void print_one_rcu_data(struct seq_file *m, struct rcu_data *rdp)
 		   per_cpu(rcu_cpu_kthread_loops, rdp->cpu) & 0xffff);
 #endif /* #ifdef CONFIG_RCU_BOOST */
 	seq_printf(m, " b=%ld", rdp->blimit);
+#ifdef CONFIG_RCU_NOCB_CPU
+	if (is_nocb_cpu(rdp->cpu))
+		seq_printf(m, " nq=%ld/%ld ni=%lu",
+			   atomic_long_read(&rdp->nocb_q_count),
+			   ACCESS_ONCE(rdp->nocb_p_count),
+			   rdp->n_nocbs_invoked);
+#endif /* #ifdef CONFIG_RCU_NOCB_CPU */
 	seq_printf(m, " ci=%lu co=%lu ca=%lu\n",
 		   rdp->n_cbs_invoked, rdp->n_cbs_orphaned, rdp->n_cbs_adopted);
 }
@@ -352,6 +359,32 @@ static void show_one_rcugp(struct seq_file *m, struct rcu_state *rsp)
 		   rsp->name, completed, gpnum, gpage, gpmax);
 }
 
+static int show_rcuexp(struct seq_file *m, void *unused)
+{
+	struct rcu_state *rsp = &rcu_sched_state;
+
+	seq_printf(m, "s=%lu wd1=%lu wd2=%lu wd3=%lu ipi=%lu idle=%lu\n",
+		   rsp->expedited_sequence,
+		   atomic_long_read(&rsp->expedited_workdone1),
+		   atomic_long_read(&rsp->expedited_workdone2),
+		   atomic_long_read(&rsp->expedited_workdone3),
+		   rsp->expedited_ipis, rsp->expedited_idle);
+	return 0;
+}
+
+static int rcuexp_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, show_rcuexp, NULL);
+}
+
+static const struct file_operations rcuexp_fops = {
+	.owner = THIS_MODULE,
+	.open = rcuexp_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int show_rcugp(struct seq_file *m, void *unused)
 {
 #ifdef CONFIG_TREE_PREEMPT_RCU
@@ -481,6 +514,11 @@ static int __init rcutree_trace_init(void)
 	if (!retval)
 		goto free_out;
 
+	retval = debugfs_create_file("rcuexp", 0444, rcudir,
+						NULL, &rcuexp_fops);
+	if (!retval)
+		goto free_out;
+
 	retval = debugfs_create_file("rcuhier", 0444, rcudir,
 						NULL, &rcuhier_fops);
 	if (!retval)
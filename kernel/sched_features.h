@@ -71,4 +71,10 @@ SCHED_FEAT(NONTASK_POWER, 1)
  */
 SCHED_FEAT(TTWU_QUEUE, 1)
 
+/*
+ * Bound the select_idle_sibling() scan of the LLC by the expected idle
+ * time of the waking cpu.
+ */
+SCHED_FEAT(SIS_PROP, 1)
+
 SCHED_FEAT(FORCE_SD_OVERLAP, 0)
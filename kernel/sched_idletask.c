@@ -22,6 +22,7 @@ static void check_preempt_curr_idle(struct rq *rq, struct task_struct *p, int fl
 
 static struct task_struct *pick_next_task_idle(struct rq *rq)
 {
+	update_idle_core(rq);
 	schedstat_inc(rq, sched_goidle);
 	calc_load_account_idle(rq);
 	return rq->idle;
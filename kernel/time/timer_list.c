@@ -187,6 +187,27 @@ static void print_cpu(struct seq_file *m, int cpu, u64 now)
 
 #undef P
 #undef P_ns
+
+	{
+		struct timer_wheel_info twi;
+		unsigned int lvl;
+
+		timer_wheel_get_info(cpu, &twi);
+		SEQ_printf(m, "timer wheel:\n");
+		SEQ_printf(m, "  .%-15s: %Lu\n", "clk",
+			   (unsigned long long)twi.clk);
+		SEQ_printf(m, "  .%-15s: %Lu\n", "next_timer",
+			   (unsigned long long)twi.next_timer);
+		SEQ_printf(m, "  .%-15s: %Lu\n", "nr_pending",
+			   (unsigned long long)twi.nr_pending);
+		SEQ_printf(m, "  .%-15s: %Lu\n", "nr_expired",
+			   (unsigned long long)twi.nr_expired);
+		for (lvl = 0; lvl < twi.levels; lvl++)
+			SEQ_printf(m, "  level %u: granularity %lu jiffies, "
+				   "%u/%u buckets pending\n", lvl,
+				   twi.level_granularity[lvl],
+				   twi.level_buckets[lvl], twi.level_size);
+	}
 }
 
 #ifdef CONFIG_GENERIC_CLOCKEVENTS
@@ -259,7 +280,7 @@ static int timer_list_show(struct seq_file *m, void *v)
 	u64 now = ktime_to_ns(ktime_get());
 	int cpu;
 
-	SEQ_printf(m, "Timer List Version: v0.6\n");
+	SEQ_printf(m, "Timer List Version: v0.7\n");
 	SEQ_printf(m, "HRTIMER_MAX_CLOCK_BASES: %d\n", HRTIMER_MAX_CLOCK_BASES);
 	SEQ_printf(m, "now at %Ld nsecs\n", (unsigned long long)now);
 
@@ -0,0 +1,153 @@
+/*
+ * Timer wheel benchmark module
+ *
+ * Models the timer population of a busy network server: a large number
+ * of far-future timeouts (retransmit, keepalive, delayed ack) which are
+ * re-armed and mostly cancelled long before they expire, plus a batch of
+ * near-term timers whose expiry latency is measured.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ * of the License.
+ */
+
+#include <linux/atomic.h>
+#include <linux/completion.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/timer.h>
+#include <linux/vmalloc.h>
+
+static unsigned int nr_timers = 100000;
+module_param(nr_timers, uint, 0444);
+MODULE_PARM_DESC(nr_timers, "Number of long-term timers to arm");
+
+static unsigned int cancel_pct = 90;
+module_param(cancel_pct, uint, 0444);
+MODULE_PARM_DESC(cancel_pct, "Percentage of timers cancelled before expiry");
+
+static unsigned int nr_short = 10000;
+module_param(nr_short, uint, 0444);
+MODULE_PARM_DESC(nr_short, "Number of near-term timers to expire");
+
+static struct timer_list *timers;
+static struct timer_list *short_timers;
+static atomic_t short_pending;
+static DECLARE_COMPLETION(short_done);
+static unsigned long short_late;
+
+static void timerbench_long_fn(unsigned long data)
+{
+}
+
+static void timerbench_short_fn(unsigned long data)
+{
+	struct timer_list *timer = short_timers + data;
+
+	/* Benign race, only used for a rough lateness figure */
+	short_late += jiffies - timer->expires;
+	if (atomic_dec_and_test(&short_pending))
+		complete(&short_done);
+}
+
+/* A timeout between 200ms and two minutes, as TCP would use */
+static unsigned long timerbench_timeout(void)
+{
+	return jiffies + HZ / 5 + random32() % (120 * HZ);
+}
+
+static void timerbench_report(const char *what, ktime_t start,
+			      unsigned int count)
+{
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	printk(KERN_INFO "timerbench: %-10s %8u timers %10lld ns/op\n",
+	       what, count, count ? div_s64(ns, count) : 0);
+}
+
+static void timerbench_long(void)
+{
+	unsigned int i, cancelled = 0;
+	ktime_t start;
+
+	for (i = 0; i < nr_timers; i++)
+		setup_timer(timers + i, timerbench_long_fn, i);
+
+	start = ktime_get();
+	for (i = 0; i < nr_timers; i++)
+		mod_timer(timers + i, timerbench_timeout());
+	timerbench_report("arm", start, nr_timers);
+
+	start = ktime_get();
+	for (i = 0; i < nr_timers; i++)
+		mod_timer(timers + i, timerbench_timeout());
+	timerbench_report("rearm", start, nr_timers);
+
+	start = ktime_get();
+	for (i = 0; i < nr_timers; i++) {
+		if (random32() % 100 < cancel_pct) {
+			del_timer(timers + i);
+			cancelled++;
+		}
+	}
+	timerbench_report("cancel", start, cancelled);
+}
+
+static void timerbench_short(void)
+{
+	unsigned int i;
+	ktime_t start;
+
+	atomic_set(&short_pending, nr_short);
+	for (i = 0; i < nr_short; i++) {
+		setup_timer(short_timers + i, timerbench_short_fn, i);
+		short_timers[i].expires = jiffies + 1 + random32() % (HZ / 10 + 1);
+	}
+
+	start = ktime_get();
+	for (i = 0; i < nr_short; i++)
+		add_timer(short_timers + i);
+	wait_for_completion(&short_done);
+	timerbench_report("expire", start, nr_short);
+	printk(KERN_INFO "timerbench: average expiry lateness %lu jiffies\n",
+	       short_late / nr_short);
+}
+
+static int __init timerbench_init(void)
+{
+	if (!nr_short)
+		nr_short = 1;
+
+	timers = vzalloc(nr_timers * sizeof(*timers));
+	short_timers = vzalloc(nr_short * sizeof(*short_timers));
+	if (!timers || !short_timers) {
+		vfree(timers);
+		vfree(short_timers);
+		return -ENOMEM;
+	}
+
+	printk(KERN_INFO "====[ timer wheel benchmark ]===========\n");
+	timerbench_long();
+	timerbench_short();
+	printk(KERN_INFO "====[ end of timer wheel benchmark ]====\n");
+	return 0;
+}
+
+static void __exit timerbench_exit(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_timers; i++)
+		del_timer_sync(timers + i);
+	vfree(timers);
+	vfree(short_timers);
+}
+
+module_init(timerbench_init);
+module_exit(timerbench_exit);
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Timer wheel benchmark");
@@ -0,0 +1,158 @@
+/*
+ * LZ4 decompressor for the Linux kernel and the pre-boot environment.
+ *
+ * Decodes the "legacy" LZ4 stream format written by "lz4 -l": a 32 bit
+ * little endian magic number followed by blocks, each a 32 bit little
+ * endian compressed size and an LZ4 block that decodes to at most 8MB.
+ * There is no end marker; the stream ends with the input.  The four bytes
+ * that size_append adds after a compressed kernel image are recognised as
+ * a trailing size field and skipped.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#ifdef STATIC
+#include "lz4/lz4_decompress.c"
+#else
+#include <linux/decompress/unlz4.h>
+#endif
+
+#include <linux/types.h>
+#include <linux/lz4.h>
+#include <linux/decompress/mm.h>
+
+#include <linux/compiler.h>
+#include <asm/unaligned.h>
+
+#define ARCHIVE_MAGICNUMBER	0x184C2102
+#define LZ4_CHUNK_SIZE		(8 << 20)
+
+STATIC inline int INIT unlz4(u8 *input, int in_len,
+				int (*fill) (void *, unsigned int),
+				int (*flush) (void *, unsigned int),
+				u8 *output, int *posp,
+				void (*error) (char *x))
+{
+	size_t chunk_max = lz4_compressbound(LZ4_CHUNK_SIZE);
+	size_t dest_len;
+	u32 chunksize;
+	int size;
+	u8 *in_buf, *out_buf;
+	int ret = -1;
+
+	if (output) {
+		out_buf = output;
+	} else if (!flush) {
+		error("NULL output pointer and no flush function provided");
+		goto exit;
+	} else {
+		out_buf = large_malloc(LZ4_CHUNK_SIZE);
+		if (!out_buf) {
+			error("Could not allocate output buffer");
+			goto exit;
+		}
+	}
+
+	if (input && fill) {
+		error("Both input pointer and fill function provided, don't know what to do");
+		goto exit_1;
+	} else if (input) {
+		in_buf = input;
+	} else if (!fill) {
+		error("NULL input pointer and missing fill function");
+		goto exit_1;
+	} else {
+		in_buf = large_malloc(chunk_max);
+		if (!in_buf) {
+			error("Could not allocate input buffer");
+			goto exit_1;
+		}
+	}
+
+	if (posp)
+		*posp = 0;
+
+	if (fill)
+		in_len = fill(in_buf, 4);
+	if (in_len < 4 || get_unaligned_le32(in_buf) != ARCHIVE_MAGICNUMBER) {
+		error("invalid header");
+		goto exit_2;
+	}
+	if (!fill) {
+		in_buf += 4;
+		in_len -= 4;
+	}
+	if (posp)
+		*posp = 4;
+
+	for (;;) {
+		/* read compressed block size */
+		if (fill) {
+			in_len = fill(in_buf, 4);
+			if (in_len <= 0)
+				break;
+		} else if (!in_len) {
+			break;
+		}
+		if (in_len < 4) {
+			error("file corrupted");
+			goto exit_2;
+		}
+		chunksize = get_unaligned_le32(in_buf);
+		if (!fill) {
+			in_buf += 4;
+			in_len -= 4;
+		}
+		if (posp)
+			*posp += 4;
+
+		/* concatenated streams each start with a magic number */
+		if (chunksize == ARCHIVE_MAGICNUMBER)
+			continue;
+
+		/* only the size_append trailer may be followed by nothing */
+		if (fill)
+			size = fill(in_buf, chunksize > chunk_max ?
+					chunk_max : chunksize);
+		else
+			size = in_len;
+		if (size == 0)
+			break;
+
+		if (chunksize > chunk_max || size < (int)chunksize) {
+			error("file corrupted");
+			goto exit_2;
+		}
+
+		dest_len = LZ4_CHUNK_SIZE;
+		if (lz4_decompress_unknownoutputsize(in_buf, chunksize,
+						     out_buf, &dest_len)) {
+			error("Decoding failed");
+			goto exit_2;
+		}
+
+		if (flush && flush(out_buf, dest_len) != dest_len)
+			goto exit_2;
+		if (output)
+			out_buf += dest_len;
+		if (posp)
+			*posp += chunksize;
+
+		if (!fill) {
+			in_buf += chunksize;
+			in_len -= chunksize;
+		}
+	}
+
+	ret = 0;
+exit_2:
+	if (!input)
+		large_free(in_buf);
+exit_1:
+	if (!output)
+		large_free(out_buf);
+exit:
+	return ret;
+}
+
+#define decompress unlz4
@@ -0,0 +1,102 @@
+/*
+ * LZ4 - fast LZ77 compressor
+ *
+ * A single entry hash table maps the hash of the next four input bytes to
+ * the most recent position they were seen at.  Each position is probed
+ * once; on a miss the scan step grows with the number of consecutive
+ * misses so incompressible data is skipped over quickly.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/bitops.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+#define LZ4_HASH_SIZE	(1 << LZ4_HASHLOG)
+
+/* Misses after which the scan step is increased by one byte */
+#define LZ4_SKIPTRIGGER	6
+
+static inline u32 lz4_hash(const u8 *p)
+{
+	return (get_unaligned_le32(p) * LZ4_HASH_PRIME) >> (32 - LZ4_HASHLOG);
+}
+
+int lz4_compress(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len, void *wrkmem)
+{
+	u32 *table = wrkmem;
+	const u8 *ip = src, *anchor = src;
+	const u8 *const iend = src + src_len;
+	const u8 *const mflimit = iend - MFLIMIT;
+	const u8 *const matchlimit = iend - LASTLITERALS;
+	u8 *op = dst;
+	u8 *const oend = dst + *dst_len;
+
+	if (src_len > LZ4_MAX_INPUT_SIZE)
+		return -1;
+	if (src_len < MINLENGTH)
+		goto last_literals;
+
+	memset(table, 0, LZ4_MEM_COMPRESS);
+	ip++;
+
+	for (;;) {
+		const u8 *ref;
+		size_t mlen;
+		u32 h, step = 1, misses = 1 << LZ4_SKIPTRIGGER;
+
+		/* find a four byte match within MAX_DISTANCE */
+		for (;;) {
+			if (unlikely(ip > mflimit))
+				goto last_literals;
+			h = lz4_hash(ip);
+			ref = src + table[h];
+			table[h] = ip - src;
+			if (ip - ref <= MAX_DISTANCE &&
+			    get_unaligned((const u32 *)ref) ==
+			    get_unaligned((const u32 *)ip))
+				break;
+			ip += step;
+			step = misses++ >> LZ4_SKIPTRIGGER;
+		}
+
+		/* the match may extend backwards into pending literals */
+		while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+
+		mlen = MINMATCH + lz4_count(ip + MINMATCH, ref + MINMATCH,
+					    matchlimit);
+		op = lz4_emit_sequence(op, oend, anchor, ip - anchor,
+				       ip - ref, mlen);
+		if (!op)
+			return -1;
+
+		ip += mlen;
+		anchor = ip;
+		if (ip > mflimit)
+			break;
+
+		/* seed the table with a position inside the match */
+		table[lz4_hash(ip - 2)] = ip - 2 - src;
+	}
+
+last_literals:
+	op = lz4_emit_last_literals(op, oend, anchor, iend - anchor);
+	if (!op)
+		return -1;
+
+	*dst_len = op - dst;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(lz4_compress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 compressor");
@@ -0,0 +1,160 @@
+/*
+ * LZ4 decompressor
+ *
+ * Every read from the input and every write to the output is bounds
+ * checked, so corrupt or malicious input can make decoding fail but never
+ * touch memory outside the two buffers.  Literal runs and matches are
+ * copied eight bytes at a time whenever both buffers have that much slack.
+ *
+ * This file is also included by the pre-boot decompressor (STATIC).
+ *
+ * This file is released under the GPLv2.
+ */
+
+#ifndef STATIC
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#endif
+
+#include <asm/unaligned.h>
+#include <linux/lz4.h>
+
+#define LZ4_DECOMPRESS_ONLY
+#include "lz4defs.h"
+
+/*
+ * Decode the block at src into dst.  If stop_on_full is set, decoding
+ * ends once dst_len bytes have been produced; otherwise it ends when the
+ * input is exhausted.  Either way a block must end right after a literal
+ * run.
+ */
+static int lz4_decompress_generic(const u8 *src, size_t src_len,
+				  u8 *dst, size_t dst_len, int stop_on_full,
+				  size_t *consumed, size_t *produced)
+{
+	const u8 *ip = src;
+	const u8 *const iend = src + src_len;
+	u8 *op = dst;
+	u8 *const oend = dst + dst_len;
+
+	for (;;) {
+		const u8 *ref;
+		size_t len, offset;
+		unsigned int token;
+		u8 s;
+
+		if (ip >= iend)
+			return -1;
+		token = *ip++;
+
+		/* literal run */
+		len = token >> ML_BITS;
+		if (len == RUN_MASK) {
+			do {
+				if (unlikely(ip >= iend))
+					return -1;
+				s = *ip++;
+				len += s;
+			} while (s == 255);
+		}
+		if (unlikely(len > (size_t)(iend - ip) ||
+			     len > (size_t)(oend - op)))
+			return -1;
+
+		if (len + COPYLENGTH <= (size_t)(iend - ip) &&
+		    len + COPYLENGTH <= (size_t)(oend - op)) {
+			u8 *cpy = op + len;
+
+			do {
+				COPY8(op, ip);
+				op += COPYLENGTH;
+				ip += COPYLENGTH;
+			} while (op < cpy);
+			ip -= op - cpy;
+			op = cpy;
+		} else {
+			memcpy(op, ip, len);
+			op += len;
+			ip += len;
+		}
+
+		if (ip == iend || (stop_on_full && op == oend))
+			break;
+
+		/* match */
+		if (unlikely(iend - ip < 2))
+			return -1;
+		offset = get_unaligned_le16(ip);
+		ip += 2;
+		if (unlikely(!offset || offset > (size_t)(op - dst)))
+			return -1;
+		ref = op - offset;
+
+		len = token & ML_MASK;
+		if (len == ML_MASK) {
+			do {
+				if (unlikely(ip >= iend))
+					return -1;
+				s = *ip++;
+				len += s;
+			} while (s == 255);
+		}
+		len += MINMATCH;
+		if (unlikely(len > (size_t)(oend - op)))
+			return -1;
+
+		if (offset >= COPYLENGTH &&
+		    len + COPYLENGTH <= (size_t)(oend - op)) {
+			u8 *cpy = op + len;
+
+			do {
+				COPY8(op, ref);
+				op += COPYLENGTH;
+				ref += COPYLENGTH;
+			} while (op < cpy);
+			op = cpy;
+		} else {
+			/* overlapping copy replicates the last offset bytes */
+			while (len--)
+				*op++ = *ref++;
+		}
+	}
+
+	*consumed = ip - src;
+	*produced = op - dst;
+	return 0;
+}
+
+int lz4_decompress(const unsigned char *src, size_t *src_len,
+		unsigned char *dest, size_t actual_dest_len)
+{
+	size_t in, out;
+
+	if (lz4_decompress_generic(src, *src_len, dest, actual_dest_len, 1,
+				   &in, &out) || out != actual_dest_len)
+		return -1;
+	*src_len = in;
+	return 0;
+}
+#ifndef STATIC
+EXPORT_SYMBOL_GPL(lz4_decompress);
+#endif
+
+int lz4_decompress_unknownoutputsize(const unsigned char *src, size_t src_len,
+		unsigned char *dest, size_t *dest_len)
+{
+	size_t in, out;
+
+	if (lz4_decompress_generic(src, src_len, dest, *dest_len, 0,
+				   &in, &out))
+		return -1;
+	*dest_len = out;
+	return 0;
+}
+#ifndef STATIC
+EXPORT_SYMBOL_GPL(lz4_decompress_unknownoutputsize);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Decompressor");
+#endif
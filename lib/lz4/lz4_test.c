@@ -0,0 +1,175 @@
+/*
+ * LZ4 self-test and throughput benchmark
+ *
+ * Compresses three kinds of data (text-like, all zeroes and random) with
+ * both LZ4 compressors, decompresses the result with both decompressor
+ * entry points and checks the round trip.  It also checks that truncated
+ * input and a too small output buffer are rejected.  Compression ratio
+ * and MB/s figures are written to the system log.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <linux/kernel.h>
+#include <linux/hrtimer.h>
+#include <linux/lz4.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+static unsigned int size = 1 << 20;
+module_param(size, uint, 0444);
+MODULE_PARM_DESC(size, "Size of each test buffer in bytes");
+
+static unsigned int iterations = 10;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Timed runs of each operation");
+
+static u8 *src, *dst, *out;
+static void *wrkmem;
+
+static const char *const words[] = {
+	"the ", "kernel ", "page ", "inode ", "struct ", "return ", "if (",
+	"0x", "lock", "unlock", "(void *)", "NULL", ";\n", "\t", "static ",
+	"int ", "= ", "->", "buffer", "error",
+};
+
+static void lz4_test_fill(const char *kind)
+{
+	unsigned int i = 0;
+
+	if (!strcmp(kind, "zero")) {
+		memset(src, 0, size);
+	} else if (!strcmp(kind, "random")) {
+		get_random_bytes(src, size);
+	} else {
+		while (i < size) {
+			const char *w = words[random32() % ARRAY_SIZE(words)];
+			unsigned int len = min_t(unsigned int, strlen(w),
+						 size - i);
+
+			memcpy(src + i, w, len);
+			i += len;
+		}
+	}
+}
+
+/* bytes per microsecond is MB/s */
+static unsigned int lz4_test_mbps(size_t len, s64 ns)
+{
+	return ns > 0 ? div64_u64((u64)len * iterations * 1000, ns) : 0;
+}
+
+static int lz4_test_one(const char *kind, int hc)
+{
+	const char *name = hc ? "lz4hc" : "lz4";
+	size_t clen, dlen, slen;
+	unsigned int i, cmbps, dmbps, umbps;
+	ktime_t start;
+	s64 ns;
+
+	lz4_test_fill(kind);
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++) {
+		clen = lz4_compressbound(size);
+		if ((hc ? lz4hc_compress : lz4_compress)(src, size, dst, &clen,
+							 wrkmem)) {
+			printk(KERN_ERR "lz4_test: %s %s: compression failed\n",
+			       kind, name);
+			return -EINVAL;
+		}
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	cmbps = lz4_test_mbps(size, ns);
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++) {
+		slen = clen;
+		if (lz4_decompress(dst, &slen, out, size) || slen != clen)
+			goto fail;
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	dmbps = lz4_test_mbps(size, ns);
+	if (memcmp(src, out, size))
+		goto fail;
+
+	memset(out, 0, size);
+	start = ktime_get();
+	for (i = 0; i < iterations; i++) {
+		dlen = size;
+		if (lz4_decompress_unknownoutputsize(dst, clen, out, &dlen) ||
+		    dlen != size)
+			goto fail;
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	umbps = lz4_test_mbps(size, ns);
+	if (memcmp(src, out, size))
+		goto fail;
+
+	/* corrupt input must be rejected, not overrun the buffers */
+	slen = clen - 1;
+	if (!lz4_decompress(dst, &slen, out, size))
+		goto fail;
+	dlen = size - 1;
+	if (!lz4_decompress_unknownoutputsize(dst, clen, out, &dlen))
+		goto fail;
+
+	printk(KERN_INFO "lz4_test: %-6s %-5s %3u%% compress %5u MB/s "
+	       "decompress %5u MB/s (unknown size %5u MB/s)\n", kind, name,
+	       (unsigned int)div64_u64((u64)clen * 100, size),
+	       cmbps, dmbps, umbps);
+	return 0;
+
+fail:
+	printk(KERN_ERR "lz4_test: %s %s: decompression mismatch\n",
+	       kind, name);
+	return -EINVAL;
+}
+
+static int __init lz4_test_init(void)
+{
+	static const char *const kinds[] = { "text", "zero", "random" };
+	unsigned int i;
+	int err = 0;
+
+	if (!size || size > LZ4_MAX_INPUT_SIZE || !iterations)
+		return -EINVAL;
+
+	src = vmalloc(size);
+	dst = vmalloc(lz4_compressbound(size));
+	out = vmalloc(size);
+	wrkmem = vmalloc(LZ4HC_MEM_COMPRESS);
+	if (!src || !dst || !out || !wrkmem) {
+		err = -ENOMEM;
+		goto free;
+	}
+
+	printk(KERN_INFO "====[ lz4 self-test, %u bytes x %u ]====\n",
+	       size, iterations);
+	for (i = 0; i < ARRAY_SIZE(kinds) && !err; i++) {
+		err = lz4_test_one(kinds[i], 0);
+		if (!err)
+			err = lz4_test_one(kinds[i], 1);
+	}
+	printk(KERN_INFO "====[ lz4 self-test %s ]====\n",
+	       err ? "FAILED" : "passed");
+
+free:
+	vfree(src);
+	vfree(dst);
+	vfree(out);
+	vfree(wrkmem);
+	return err;
+}
+
+static void __exit lz4_test_exit(void)
+{
+}
+
+module_init(lz4_test_init);
+module_exit(lz4_test_exit);
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 self-test and benchmark");
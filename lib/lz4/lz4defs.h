@@ -0,0 +1,123 @@
+/*
+ * lz4defs.h -- LZ4 block format constants and helpers shared by the
+ * compressors and the decompressor.
+ *
+ * This file is released under the GPLv2.
+ */
+
+#define MINMATCH	4
+#define COPYLENGTH	8
+#define LASTLITERALS	5
+#define MFLIMIT		(COPYLENGTH + MINMATCH)
+#define MINLENGTH	(MFLIMIT + 1)
+
+#define ML_BITS		4
+#define ML_MASK		((1U << ML_BITS) - 1)
+#define RUN_BITS	(8 - ML_BITS)
+#define RUN_MASK	((1U << RUN_BITS) - 1)
+
+#define MAX_DISTANCE	((1 << 16) - 1)
+
+#define LZ4_HASH_PRIME	2654435761U
+
+#define COPY8(dst, src)	\
+		put_unaligned(get_unaligned((const u64 *)(src)), (u64 *)(dst))
+
+#ifndef LZ4_DECOMPRESS_ONLY
+
+/*
+ * Number of bytes that match at p and match, not looking at or beyond
+ * limit.  Compares a word at a time; the first differing byte is found
+ * from the lowest (little endian) or highest (big endian) set bit of the
+ * xor of the two words.
+ */
+static inline size_t lz4_count(const u8 *p, const u8 *match, const u8 *limit)
+{
+	const u8 *start = p;
+
+	while (p + sizeof(unsigned long) <= limit) {
+		unsigned long diff = get_unaligned((const unsigned long *)p) ^
+				get_unaligned((const unsigned long *)match);
+
+		if (diff) {
+#ifdef __LITTLE_ENDIAN
+			p += __ffs(diff) >> 3;
+#else
+			p += (BITS_PER_LONG - 1 - __fls(diff)) >> 3;
+#endif
+			return p - start;
+		}
+		p += sizeof(unsigned long);
+		match += sizeof(unsigned long);
+	}
+	while (p < limit && *p == *match) {
+		p++;
+		match++;
+	}
+	return p - start;
+}
+
+static inline u8 *lz4_write_length(u8 *op, size_t len)
+{
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+	return op;
+}
+
+/*
+ * Emit one sequence: the literals in [anchor, anchor + lit) followed by a
+ * match of mlen bytes at distance offset.  Returns NULL if the worst case
+ * encoding of the sequence would not leave room in the output for the final
+ * literal-only sequence.
+ */
+static inline u8 *lz4_emit_sequence(u8 *op, u8 *oend, const u8 *anchor,
+				    size_t lit, u16 offset, size_t mlen)
+{
+	u8 *token;
+
+	if (lit + lit / 255 + mlen / 255 + 4 + 1 + LASTLITERALS >
+	    (size_t)(oend - op))
+		return NULL;
+
+	token = op++;
+	if (lit >= RUN_MASK) {
+		*token = RUN_MASK << ML_BITS;
+		op = lz4_write_length(op, lit - RUN_MASK);
+	} else {
+		*token = lit << ML_BITS;
+	}
+	memcpy(op, anchor, lit);
+	op += lit;
+
+	put_unaligned_le16(offset, op);
+	op += 2;
+
+	mlen -= MINMATCH;
+	if (mlen >= ML_MASK) {
+		*token |= ML_MASK;
+		op = lz4_write_length(op, mlen - ML_MASK);
+	} else {
+		*token |= mlen;
+	}
+	return op;
+}
+
+/* The block always ends with a sequence of literals only. */
+static inline u8 *lz4_emit_last_literals(u8 *op, u8 *oend, const u8 *anchor,
+					 size_t lit)
+{
+	if (lit + (lit + 255 - RUN_MASK) / 255 + 1 > (size_t)(oend - op))
+		return NULL;
+
+	if (lit >= RUN_MASK) {
+		*op++ = RUN_MASK << ML_BITS;
+		op = lz4_write_length(op, lit - RUN_MASK);
+	} else {
+		*op++ = lit << ML_BITS;
+	}
+	memcpy(op, anchor, lit);
+	return op + lit;
+}
+
+#endif /* LZ4_DECOMPRESS_ONLY */
@@ -0,0 +1,150 @@
+/*
+ * LZ4 HC - high compression mode of LZ4
+ *
+ * Every input position is linked into a hash chain, and for each position
+ * up to LZ4HC_MAX_ATTEMPTS earlier candidates within the 64KB window are
+ * compared to find the longest match.  A match is deferred by one byte when
+ * the next position has a longer one (lazy matching).  The output is plain
+ * LZ4 and is decoded by lz4_decompress().
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/bitops.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+#define LZ4HC_HASH_SIZE		(1 << LZ4HC_HASHLOG)
+#define LZ4HC_MAX_ATTEMPTS	256
+
+struct lz4hc_data {
+	const u8 *base;
+	const u8 *next;		/* first position not yet in the chains */
+	u32 hash_table[LZ4HC_HASH_SIZE];
+	u16 chain_table[LZ4HC_CHAINSIZE];	/* distance to the previous
+						   position with this hash */
+};
+
+static inline u32 lz4hc_hash(const u8 *p)
+{
+	return (get_unaligned_le32(p) * LZ4_HASH_PRIME) >> (32 - LZ4HC_HASHLOG);
+}
+
+static inline void lz4hc_insert(struct lz4hc_data *hc, const u8 *ip)
+{
+	while (hc->next < ip) {
+		u32 pos = hc->next - hc->base;
+		u32 h = lz4hc_hash(hc->next);
+		u32 delta = pos - hc->hash_table[h];
+
+		if (delta > MAX_DISTANCE)
+			delta = MAX_DISTANCE;
+		hc->chain_table[pos & MAX_DISTANCE] = delta;
+		hc->hash_table[h] = pos;
+		hc->next++;
+	}
+}
+
+/*
+ * Longest match for ip among the earlier positions sharing its hash.
+ * Returns its length (0 if there is none) and sets *match.
+ */
+static size_t lz4hc_find_match(struct lz4hc_data *hc, const u8 *ip,
+			       const u8 *matchlimit, const u8 **match)
+{
+	u32 pos = ip - hc->base;
+	u32 ref, delta;
+	size_t best = 0;
+	int attempts = LZ4HC_MAX_ATTEMPTS;
+
+	lz4hc_insert(hc, ip);
+	ref = hc->hash_table[lz4hc_hash(ip)];
+
+	while (ref < pos && pos - ref <= MAX_DISTANCE && attempts--) {
+		const u8 *r = hc->base + ref;
+
+		if (r[best] == ip[best] &&
+		    get_unaligned((const u32 *)r) ==
+		    get_unaligned((const u32 *)ip)) {
+			size_t len = MINMATCH + lz4_count(ip + MINMATCH,
+						r + MINMATCH, matchlimit);
+
+			if (len > best) {
+				best = len;
+				*match = r;
+			}
+		}
+
+		delta = hc->chain_table[ref & MAX_DISTANCE];
+		if (!delta || delta > ref)
+			break;
+		ref -= delta;
+	}
+	return best;
+}
+
+int lz4hc_compress(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len, void *wrkmem)
+{
+	struct lz4hc_data *hc = wrkmem;
+	const u8 *ip = src, *anchor = src;
+	const u8 *const iend = src + src_len;
+	const u8 *const mflimit = iend - MFLIMIT;
+	const u8 *const matchlimit = iend - LASTLITERALS;
+	u8 *op = dst;
+	u8 *const oend = dst + *dst_len;
+
+	BUILD_BUG_ON(sizeof(struct lz4hc_data) > LZ4HC_MEM_COMPRESS);
+
+	if (src_len > LZ4_MAX_INPUT_SIZE)
+		return -1;
+	if (src_len < MINLENGTH)
+		goto last_literals;
+
+	memset(hc->hash_table, 0, sizeof(hc->hash_table));
+	hc->base = src;
+	hc->next = src;
+
+	while (ip <= mflimit) {
+		const u8 *ref, *ref2;
+		size_t mlen, mlen2;
+
+		mlen = lz4hc_find_match(hc, ip, matchlimit, &ref);
+		if (!mlen) {
+			ip++;
+			continue;
+		}
+
+		while (ip + 1 <= mflimit) {
+			mlen2 = lz4hc_find_match(hc, ip + 1, matchlimit, &ref2);
+			if (mlen2 <= mlen)
+				break;
+			ip++;
+			mlen = mlen2;
+			ref = ref2;
+		}
+
+		op = lz4_emit_sequence(op, oend, anchor, ip - anchor,
+				       ip - ref, mlen);
+		if (!op)
+			return -1;
+		ip += mlen;
+		anchor = ip;
+	}
+
+last_literals:
+	op = lz4_emit_last_literals(op, oend, anchor, iend - anchor);
+	if (!op)
+		return -1;
+
+	*dst_len = op - dst;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(lz4hc_compress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4HC compressor");
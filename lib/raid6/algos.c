@@ -63,6 +63,23 @@ const struct raid6_calls * const raid6_algos[] = {
 	NULL
 };
 
+void (*raid6_2data_recov)(int, size_t, int, int, void **);
+EXPORT_SYMBOL_GPL(raid6_2data_recov);
+
+void (*raid6_datap_recov)(int, size_t, int, void **);
+EXPORT_SYMBOL_GPL(raid6_datap_recov);
+
+const struct raid6_recov_calls *const raid6_recov_algos[] = {
+#if (defined(__i386__) || defined(__x86_64__)) && !defined(__arch_um__)
+#ifdef CONFIG_AS_AVX2
+	&raid6_recov_avx2,
+#endif
+	&raid6_recov_ssse3,
+#endif
+	&raid6_recov_intx1,
+	NULL
+};
+
 #ifdef __KERNEL__
 #define RAID6_TIME_JIFFIES_LG2	4
 #else
@@ -74,33 +91,15 @@ const struct raid6_calls * const raid6_algos[] = {
 /* Try to pick the best algorithm */
 /* This code uses the gfmul table as convenient data set to abuse */
 
-int __init raid6_select_algo(void)
+static const struct raid6_calls *__init raid6_choose_gen(void **dptrs,
+							 int disks)
 {
 	const struct raid6_calls * const * algo;
 	const struct raid6_calls * best;
-	char *syndromes;
-	void *dptrs[(65536/PAGE_SIZE)+2];
-	int i, disks;
 	unsigned long perf, bestperf;
 	int bestprefer;
 	unsigned long j0, j1;
 
-	disks = (65536/PAGE_SIZE)+2;
-	for ( i = 0 ; i < disks-2 ; i++ ) {
-		dptrs[i] = ((char *)raid6_gfmul) + PAGE_SIZE*i;
-	}
-
-	/* Normal code - use a 2-page allocation to avoid D$ conflict */
-	syndromes = (void *) __get_free_pages(GFP_KERNEL, 1);
-
-	if ( !syndromes ) {
-		printk("raid6: Yikes!  No memory available.\n");
-		return -ENOMEM;
-	}
-
-	dptrs[disks-2] = syndromes;
-	dptrs[disks-1] = syndromes + PAGE_SIZE;
-
 	bestperf = 0;  bestprefer = 0;  best = NULL;
 
 	for ( algo = raid6_algos ; *algo ; algo++ ) {
@@ -138,9 +137,116 @@ int __init raid6_select_algo(void)
 	} else
 		printk("raid6: Yikes!  No algorithm found!\n");
 
+	return best;
+}
+
+/*
+ * Time two-data-disk recovery of the first two pages, rebuilt into the
+ * scratch pages; the syndrome must already be valid for dptrs.  The
+ * throughput figure counts only the two reconstructed pages.
+ */
+static const struct raid6_recov_calls *__init raid6_choose_recov(void **dptrs,
+								 int disks,
+								 char *scratch)
+{
+	const struct raid6_recov_calls *const *algo;
+	const struct raid6_recov_calls *best;
+	void *data0, *data1;
+	unsigned long perf, bestperf;
+	unsigned long j0, j1;
+
+	data0 = dptrs[0];
+	data1 = dptrs[1];
+	dptrs[0] = scratch;
+	dptrs[1] = scratch + PAGE_SIZE;
+
+	bestperf = 0;  best = NULL;
+
+	for (algo = raid6_recov_algos; *algo; algo++) {
+		if (!(*algo)->valid || (*algo)->valid()) {
+			perf = 0;
+
+			preempt_disable();
+			j0 = jiffies;
+			while ((j1 = jiffies) == j0)
+				cpu_relax();
+			while (time_before(jiffies,
+					   j1 + (1<<RAID6_TIME_JIFFIES_LG2))) {
+				(*algo)->data2(disks, PAGE_SIZE, 0, 1, dptrs);
+				perf++;
+			}
+			preempt_enable();
+
+			if (perf > bestperf) {
+				best = *algo;
+				bestperf = perf;
+			}
+			printk("raid6: %-8s %5ld MB/s (recovery)\n",
+			       (*algo)->name,
+			       (perf*HZ*(2*PAGE_SIZE >> 10)) >>
+			       (10+RAID6_TIME_JIFFIES_LG2));
+		}
+	}
+
+	dptrs[0] = data0;
+	dptrs[1] = data1;
+
+	if (best) {
+		printk("raid6: using %s recovery algorithm\n", best->name);
+		raid6_2data_recov = best->data2;
+		raid6_datap_recov = best->datap;
+	} else
+		printk("raid6: Yikes!  No recovery algorithm found!\n");
+
+	return best;
+}
+
+int __init raid6_select_algo(void)
+{
+	const struct raid6_calls *gen_best;
+	const struct raid6_recov_calls *rec_best;
+	char *syndromes, *scratch;
+	void *dptrs[(65536/PAGE_SIZE)+2];
+	int i, disks;
+
+	disks = (65536/PAGE_SIZE)+2;
+	for ( i = 0 ; i < disks-2 ; i++ ) {
+		dptrs[i] = ((char *)raid6_gfmul) + PAGE_SIZE*i;
+	}
+
+	/* Normal code - use a 2-page allocation to avoid D$ conflict */
+	syndromes = (void *) __get_free_pages(GFP_KERNEL, 1);
+
+	if ( !syndromes ) {
+		printk("raid6: Yikes!  No memory available.\n");
+		return -ENOMEM;
+	}
+
+	dptrs[disks-2] = syndromes;
+	dptrs[disks-1] = syndromes + PAGE_SIZE;
+
+	/* select raid gen_syndrome function */
+	gen_best = raid6_choose_gen(dptrs, disks);
+
+	/* select raid recover functions; they need somewhere to write */
+	rec_best = NULL;
+	scratch = (void *) __get_free_pages(GFP_KERNEL, 1);
+	if (gen_best && scratch) {
+		/* Recovery rebuilds from the syndrome, so make it valid */
+		raid6_call.gen_syndrome(disks, PAGE_SIZE, dptrs);
+		rec_best = raid6_choose_recov(dptrs, disks, scratch);
+	}
+	if (!rec_best) {
+		/* Always have a working recovery path */
+		raid6_2data_recov = raid6_recov_intx1.data2;
+		raid6_datap_recov = raid6_recov_intx1.datap;
+	}
+
+	if (scratch)
+		free_pages((unsigned long)scratch, 1);
 	free_pages((unsigned long)syndromes, 1);
 
-	return best ? 0 : -EINVAL;
+	return gen_best ? 0 : -EINVAL;
 }
 
 static void raid6_exit(void)
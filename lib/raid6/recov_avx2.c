@@ -0,0 +1,293 @@
+/* -*- linux-c -*- ------------------------------------------------------- *
+ *
+ *   This file is part of the Linux kernel, and is made available under
+ *   the terms of the GNU General Public License version 2 or (at your
+ *   option) any later version; incorporated herein by reference.
+ *
+ * ----------------------------------------------------------------------- */
+
+/*
+ * raid6/recov_avx2.c
+ *
+ * AVX2 implementation of RAID-6 dual failure recovery.
+ *
+ * Same nibble table lookup as recov_ssse3.c, with the 16-byte raid6_vgfmul
+ * tables broadcast to both halves of a 256-bit register.
+ */
+
+#if (defined(__i386__) || defined(__x86_64__)) && !defined(__arch_um__) && \
+	defined(CONFIG_AS_AVX2)
+
+#include <linux/raid/pq.h>
+#include "x86.h"
+
+static const struct raid6_avx2_constants {
+	u64 x0f[4];
+} raid6_avx2_constants __attribute__((aligned(32))) = {
+	{ 0x0f0f0f0f0f0f0f0fULL, 0x0f0f0f0f0f0f0f0fULL,
+	  0x0f0f0f0f0f0f0f0fULL, 0x0f0f0f0f0f0f0f0fULL },
+};
+
+static int raid6_has_avx2(void)
+{
+	return boot_cpu_has(X86_FEATURE_AVX2) && raid6_avx_usable();
+}
+
+static void raid6_2data_recov_avx2(int disks, size_t bytes, int faila,
+				   int failb, void **ptrs)
+{
+	u8 *p, *q, *dp, *dq;
+	const u8 *pbmul;	/* P multiplier table for B data */
+	const u8 *qmul;		/* Q multiplier table (for both) */
+
+	p = (u8 *)ptrs[disks-2];
+	q = (u8 *)ptrs[disks-1];
+
+	/* Compute syndrome with zero for the missing data pages
+	   Use the dead data pages as temporary storage for
+	   delta p and delta q */
+	dp = (u8 *)ptrs[faila];
+	ptrs[faila] = (void *)raid6_empty_zero_page;
+	ptrs[disks-2] = dp;
+	dq = (u8 *)ptrs[failb];
+	ptrs[failb] = (void *)raid6_empty_zero_page;
+	ptrs[disks-1] = dq;
+
+	raid6_call.gen_syndrome(disks, bytes, ptrs);
+
+	/* Restore pointer table */
+	ptrs[faila]   = dp;
+	ptrs[failb]   = dq;
+	ptrs[disks-2] = p;
+	ptrs[disks-1] = q;
+
+	/* Now, pick the proper data tables */
+	pbmul = raid6_vgfmul[raid6_gfexi[failb-faila]];
+	qmul  = raid6_vgfmul[raid6_gfinv[raid6_gfexp[faila] ^
+					 raid6_gfexp[failb]]];
+
+	kernel_fpu_begin();
+
+	asm volatile("vmovdqa %0,%%ymm7" : : "m" (raid6_avx2_constants.x0f[0]));
+
+#ifdef __x86_64__
+	asm volatile("vbroadcasti128 %0,%%ymm12" : : "m" (qmul[0]));
+	asm volatile("vbroadcasti128 %0,%%ymm13" : : "m" (qmul[16]));
+	asm volatile("vbroadcasti128 %0,%%ymm14" : : "m" (pbmul[0]));
+	asm volatile("vbroadcasti128 %0,%%ymm15" : : "m" (pbmul[16]));
+#else
+	asm volatile("vbroadcasti128 %0,%%ymm4" : : "m" (qmul[0]));
+	asm volatile("vbroadcasti128 %0,%%ymm5" : : "m" (qmul[16]));
+	asm volatile("vbroadcasti128 %0,%%ymm6" : : "m" (pbmul[0]));
+#endif
+
+	/* Now do it... */
+	while (bytes) {
+#ifdef __x86_64__
+		asm volatile("vmovdqa %0,%%ymm1" : : "m" (q[0]));
+		asm volatile("vmovdqa %0,%%ymm9" : : "m" (q[32]));
+		asm volatile("vmovdqa %0,%%ymm0" : : "m" (p[0]));
+		asm volatile("vmovdqa %0,%%ymm8" : : "m" (p[32]));
+		asm volatile("vpxor %0,%%ymm1,%%ymm1" : : "m" (dq[0]));
+		asm volatile("vpxor %0,%%ymm9,%%ymm9" : : "m" (dq[32]));
+		asm volatile("vpxor %0,%%ymm0,%%ymm0" : : "m" (dp[0]));
+		asm volatile("vpxor %0,%%ymm8,%%ymm8" : : "m" (dp[32]));
+
+		/* ymm0/8 = px, ymm1/9 = q ^ dq */
+
+		asm volatile("vpsraw $4,%ymm1,%ymm2");
+		asm volatile("vpsraw $4,%ymm9,%ymm10");
+		asm volatile("vpand %ymm7,%ymm1,%ymm1");
+		asm volatile("vpand %ymm7,%ymm9,%ymm9");
+		asm volatile("vpand %ymm7,%ymm2,%ymm2");
+		asm volatile("vpand %ymm7,%ymm10,%ymm10");
+		asm volatile("vpshufb %ymm1,%ymm12,%ymm1");
+		asm volatile("vpshufb %ymm9,%ymm12,%ymm9");
+		asm volatile("vpshufb %ymm2,%ymm13,%ymm2");
+		asm volatile("vpshufb %ymm10,%ymm13,%ymm10");
+		asm volatile("vpxor %ymm2,%ymm1,%ymm1");
+		asm volatile("vpxor %ymm10,%ymm9,%ymm9");
+
+		/* ymm1/9 = qx */
+
+		asm volatile("vpsraw $4,%ymm0,%ymm2");
+		asm volatile("vpsraw $4,%ymm8,%ymm10");
+		asm volatile("vpand %ymm7,%ymm0,%ymm3");
+		asm volatile("vpand %ymm7,%ymm8,%ymm11");
+		asm volatile("vpand %ymm7,%ymm2,%ymm2");
+		asm volatile("vpand %ymm7,%ymm10,%ymm10");
+		asm volatile("vpshufb %ymm3,%ymm14,%ymm3");
+		asm volatile("vpshufb %ymm11,%ymm14,%ymm11");
+		asm volatile("vpshufb %ymm2,%ymm15,%ymm2");
+		asm volatile("vpshufb %ymm10,%ymm15,%ymm10");
+		asm volatile("vpxor %ymm3,%ymm1,%ymm1");
+		asm volatile("vpxor %ymm11,%ymm9,%ymm9");
+		asm volatile("vpxor %ymm2,%ymm1,%ymm1");
+		asm volatile("vpxor %ymm10,%ymm9,%ymm9");
+
+		/* ymm1/9 = pbmul[px] ^ qx = db = DQ */
+
+		asm volatile("vmovdqa %%ymm1,%0" : "=m" (dq[0]));
+		asm volatile("vmovdqa %%ymm9,%0" : "=m" (dq[32]));
+		asm volatile("vpxor %ymm1,%ymm0,%ymm0");
+		asm volatile("vpxor %ymm9,%ymm8,%ymm8");
+		asm volatile("vmovdqa %%ymm0,%0" : "=m" (dp[0]));
+		asm volatile("vmovdqa %%ymm8,%0" : "=m" (dp[32]));
+
+		bytes -= 64;
+		p += 64;
+		q += 64;
+		dp += 64;
+		dq += 64;
+#else
+		asm volatile("vmovdqa %0,%%ymm1" : : "m" (*q));
+		asm volatile("vmovdqa %0,%%ymm0" : : "m" (*p));
+		asm volatile("vpxor %0,%%ymm1,%%ymm1" : : "m" (*dq));
+		asm volatile("vpxor %0,%%ymm0,%%ymm0" : : "m" (*dp));
+
+		/* ymm0 = px, ymm1 = q ^ dq */
+
+		asm volatile("vpsraw $4,%ymm1,%ymm2");
+		asm volatile("vpand %ymm7,%ymm1,%ymm1");
+		asm volatile("vpand %ymm7,%ymm2,%ymm2");
+		asm volatile("vpshufb %ymm1,%ymm4,%ymm1");
+		asm volatile("vpshufb %ymm2,%ymm5,%ymm2");
+		asm volatile("vpxor %ymm2,%ymm1,%ymm1");
+
+		/* ymm1 = qx */
+
+		asm volatile("vpsraw $4,%ymm0,%ymm2");
+		asm volatile("vpand %ymm7,%ymm0,%ymm3");
+		asm volatile("vpand %ymm7,%ymm2,%ymm2");
+		asm volatile("vpshufb %ymm3,%ymm6,%ymm3");
+		asm volatile("vpxor %ymm3,%ymm1,%ymm1");
+		/* Out of registers: the last table comes from memory */
+		asm volatile("vbroadcasti128 %0,%%ymm3" : : "m" (pbmul[16]));
+		asm volatile("vpshufb %ymm2,%ymm3,%ymm2");
+		asm volatile("vpxor %ymm2,%ymm1,%ymm1");
+
+		/* ymm1 = pbmul[px] ^ qx = db = DQ */
+
+		asm volatile("vmovdqa %%ymm1,%0" : "=m" (*dq));
+		asm volatile("vpxor %ymm1,%ymm0,%ymm0");
+		asm volatile("vmovdqa %%ymm0,%0" : "=m" (*dp));
+
+		bytes -= 32;
+		p += 32;
+		q += 32;
+		dp += 32;
+		dq += 32;
+#endif
+	}
+
+	asm volatile("vzeroupper");
+	kernel_fpu_end();
+}
+
+static void raid6_datap_recov_avx2(int disks, size_t bytes, int faila,
+				   void **ptrs)
+{
+	u8 *p, *q, *dq;
+	const u8 *qmul;		/* Q multiplier table */
+
+	p = (u8 *)ptrs[disks-2];
+	q = (u8 *)ptrs[disks-1];
+
+	/* Compute syndrome with zero for the missing data page
+	   Use the dead data page as temporary storage for delta q */
+	dq = (u8 *)ptrs[faila];
+	ptrs[faila] = (void *)raid6_empty_zero_page;
+	ptrs[disks-1] = dq;
+
+	raid6_call.gen_syndrome(disks, bytes, ptrs);
+
+	/* Restore pointer table */
+	ptrs[faila]   = dq;
+	ptrs[disks-1] = q;
+
+	/* Now, pick the proper data tables */
+	qmul  = raid6_vgfmul[raid6_gfinv[raid6_gfexp[faila]]];
+
+	kernel_fpu_begin();
+
+	asm volatile("vmovdqa %0,%%ymm7" : : "m" (raid6_avx2_constants.x0f[0]));
+	asm volatile("vbroadcasti128 %0,%%ymm4" : : "m" (qmul[0]));
+	asm volatile("vbroadcasti128 %0,%%ymm5" : : "m" (qmul[16]));
+
+	while (bytes) {
+#ifdef __x86_64__
+		asm volatile("vmovdqa %0,%%ymm1" : : "m" (q[0]));
+		asm volatile("vmovdqa %0,%%ymm9" : : "m" (q[32]));
+		asm volatile("vpxor %0,%%ymm1,%%ymm1" : : "m" (dq[0]));
+		asm volatile("vpxor %0,%%ymm9,%%ymm9" : : "m" (dq[32]));
+
+		/* ymm1/9 = q ^ dq */
+
+		asm volatile("vpsraw $4,%ymm1,%ymm2");
+		asm volatile("vpsraw $4,%ymm9,%ymm10");
+		asm volatile("vpand %ymm7,%ymm1,%ymm1");
+		asm volatile("vpand %ymm7,%ymm9,%ymm9");
+		asm volatile("vpand %ymm7,%ymm2,%ymm2");
+		asm volatile("vpand %ymm7,%ymm10,%ymm10");
+		asm volatile("vpshufb %ymm1,%ymm4,%ymm1");
+		asm volatile("vpshufb %ymm9,%ymm4,%ymm9");
+		asm volatile("vpshufb %ymm2,%ymm5,%ymm2");
+		asm volatile("vpshufb %ymm10,%ymm5,%ymm10");
+		asm volatile("vpxor %ymm2,%ymm1,%ymm1");
+		asm volatile("vpxor %ymm10,%ymm9,%ymm9");
+
+		/* ymm1/9 = qmul[q ^ dq] = DQ */
+
+		asm volatile("vmovdqa %%ymm1,%0" : "=m" (dq[0]));
+		asm volatile("vmovdqa %%ymm9,%0" : "=m" (dq[32]));
+		asm volatile("vpxor %0,%%ymm1,%%ymm1" : : "m" (p[0]));
+		asm volatile("vpxor %0,%%ymm9,%%ymm9" : : "m" (p[32]));
+		asm volatile("vmovdqa %%ymm1,%0" : "=m" (p[0]));
+		asm volatile("vmovdqa %%ymm9,%0" : "=m" (p[32]));
+
+		bytes -= 64;
+		p += 64;
+		q += 64;
+		dq += 64;
+#else
+		asm volatile("vmovdqa %0,%%ymm1" : : "m" (*q));
+		asm volatile("vpxor %0,%%ymm1,%%ymm1" : : "m" (*dq));
+
+		/* ymm1 = q ^ dq */
+
+		asm volatile("vpsraw $4,%ymm1,%ymm2");
+		asm volatile("vpand %ymm7,%ymm1,%ymm1");
+		asm volatile("vpand %ymm7,%ymm2,%ymm2");
+		asm volatile("vpshufb %ymm1,%ymm4,%ymm1");
+		asm volatile("vpshufb %ymm2,%ymm5,%ymm2");
+		asm volatile("vpxor %ymm2,%ymm1,%ymm1");
+
+		/* ymm1 = qmul[q ^ dq] = DQ */
+
+		asm volatile("vmovdqa %%ymm1,%0" : "=m" (*dq));
+		asm volatile("vpxor %0,%%ymm1,%%ymm1" : : "m" (*p));
+		asm volatile("vmovdqa %%ymm1,%0" : "=m" (*p));
+
+		bytes -= 32;
+		p += 32;
+		q += 32;
+		dq += 32;
+#endif
+	}
+
+	asm volatile("vzeroupper");
+	kernel_fpu_end();
+}
+
+const struct raid6_recov_calls raid6_recov_avx2 = {
+	.data2 = raid6_2data_recov_avx2,
+	.datap = raid6_datap_recov_avx2,
+	.valid = raid6_has_avx2,
+#ifdef __x86_64__
+	.name = "avx2x2",
+#else
+	.name = "avx2x1",
+#endif
+};
+
+#endif
@@ -0,0 +1,313 @@
+/* -*- linux-c -*- ------------------------------------------------------- *
+ *
+ *   This file is part of the Linux kernel, and is made available under
+ *   the terms of the GNU General Public License version 2 or (at your
+ *   option) any later version; incorporated herein by reference.
+ *
+ * ----------------------------------------------------------------------- */
+
+/*
+ * raid6/recov_ssse3.c
+ *
+ * SSSE3 implementation of RAID-6 dual failure recovery.
+ *
+ * The GF(2^8) multiplication by a constant is split into two 16-entry
+ * table lookups, one for each nibble of the source byte, which PSHUFB
+ * performs 16 bytes at a time.  The tables come from raid6_vgfmul.
+ */
+
+#if (defined(__i386__) || defined(__x86_64__)) && !defined(__arch_um__)
+
+#include <linux/raid/pq.h>
+#include "x86.h"
+
+static const struct raid6_ssse3_constants {
+	u64 x0f[2];
+} raid6_ssse3_constants __attribute__((aligned(16))) = {
+	{ 0x0f0f0f0f0f0f0f0fULL, 0x0f0f0f0f0f0f0f0fULL },
+};
+
+static int raid6_has_ssse3(void)
+{
+	return boot_cpu_has(X86_FEATURE_XMM) &&
+		boot_cpu_has(X86_FEATURE_XMM2) &&
+		boot_cpu_has(X86_FEATURE_SSSE3);
+}
+
+static void raid6_2data_recov_ssse3(int disks, size_t bytes, int faila,
+				    int failb, void **ptrs)
+{
+	u8 *p, *q, *dp, *dq;
+	const u8 *pbmul;	/* P multiplier table for B data */
+	const u8 *qmul;		/* Q multiplier table (for both) */
+
+	p = (u8 *)ptrs[disks-2];
+	q = (u8 *)ptrs[disks-1];
+
+	/* Compute syndrome with zero for the missing data pages
+	   Use the dead data pages as temporary storage for
+	   delta p and delta q */
+	dp = (u8 *)ptrs[faila];
+	ptrs[faila] = (void *)raid6_empty_zero_page;
+	ptrs[disks-2] = dp;
+	dq = (u8 *)ptrs[failb];
+	ptrs[failb] = (void *)raid6_empty_zero_page;
+	ptrs[disks-1] = dq;
+
+	raid6_call.gen_syndrome(disks, bytes, ptrs);
+
+	/* Restore pointer table */
+	ptrs[faila]   = dp;
+	ptrs[failb]   = dq;
+	ptrs[disks-2] = p;
+	ptrs[disks-1] = q;
+
+	/* Now, pick the proper data tables */
+	pbmul = raid6_vgfmul[raid6_gfexi[failb-faila]];
+	qmul  = raid6_vgfmul[raid6_gfinv[raid6_gfexp[faila] ^
+					 raid6_gfexp[failb]]];
+
+	kernel_fpu_begin();
+
+	asm volatile("movdqa %0,%%xmm7" : : "m" (raid6_ssse3_constants.x0f[0]));
+
+	/* Now do it... */
+	while (bytes) {
+#ifdef __x86_64__
+		asm volatile("movdqa %0,%%xmm1" : : "m" (q[0]));
+		asm volatile("movdqa %0,%%xmm9" : : "m" (q[16]));
+		asm volatile("movdqa %0,%%xmm0" : : "m" (p[0]));
+		asm volatile("movdqa %0,%%xmm8" : : "m" (p[16]));
+		asm volatile("pxor %0,%%xmm1" : : "m" (dq[0]));
+		asm volatile("pxor %0,%%xmm9" : : "m" (dq[16]));
+		asm volatile("pxor %0,%%xmm0" : : "m" (dp[0]));
+		asm volatile("pxor %0,%%xmm8" : : "m" (dp[16]));
+
+		/* xmm0/8 = px, xmm1/9 = q ^ dq */
+
+		asm volatile("movdqa %xmm1,%xmm3");
+		asm volatile("movdqa %xmm9,%xmm11");
+		asm volatile("psraw $4,%xmm1");
+		asm volatile("psraw $4,%xmm9");
+		asm volatile("pand %xmm7,%xmm3");
+		asm volatile("pand %xmm7,%xmm11");
+		asm volatile("pand %xmm7,%xmm1");
+		asm volatile("pand %xmm7,%xmm9");
+		asm volatile("movdqa %0,%%xmm2" : : "m" (qmul[0]));
+		asm volatile("movdqa %0,%%xmm10" : : "m" (qmul[0]));
+		asm volatile("pshufb %xmm3,%xmm2");
+		asm volatile("pshufb %xmm11,%xmm10");
+		asm volatile("movdqa %0,%%xmm3" : : "m" (qmul[16]));
+		asm volatile("movdqa %0,%%xmm11" : : "m" (qmul[16]));
+		asm volatile("pshufb %xmm1,%xmm3");
+		asm volatile("pshufb %xmm9,%xmm11");
+		asm volatile("pxor %xmm2,%xmm3");
+		asm volatile("pxor %xmm10,%xmm11");
+
+		/* xmm3/11 = qx */
+
+		asm volatile("movdqa %xmm0,%xmm1");
+		asm volatile("movdqa %xmm8,%xmm9");
+		asm volatile("movdqa %xmm0,%xmm2");
+		asm volatile("movdqa %xmm8,%xmm10");
+		asm volatile("psraw $4,%xmm1");
+		asm volatile("psraw $4,%xmm9");
+		asm volatile("pand %xmm7,%xmm2");
+		asm volatile("pand %xmm7,%xmm10");
+		asm volatile("pand %xmm7,%xmm1");
+		asm volatile("pand %xmm7,%xmm9");
+		asm volatile("movdqa %0,%%xmm4" : : "m" (pbmul[0]));
+		asm volatile("movdqa %0,%%xmm12" : : "m" (pbmul[0]));
+		asm volatile("pshufb %xmm2,%xmm4");
+		asm volatile("pshufb %xmm10,%xmm12");
+		asm volatile("movdqa %0,%%xmm2" : : "m" (pbmul[16]));
+		asm volatile("movdqa %0,%%xmm10" : : "m" (pbmul[16]));
+		asm volatile("pshufb %xmm1,%xmm2");
+		asm volatile("pshufb %xmm9,%xmm10");
+		asm volatile("pxor %xmm4,%xmm2");
+		asm volatile("pxor %xmm12,%xmm10");
+
+		/* xmm2/10 = pbmul[px] */
+
+		asm volatile("pxor %xmm3,%xmm2");
+		asm volatile("pxor %xmm11,%xmm10");
+
+		/* xmm2/10 = db = DQ */
+
+		asm volatile("movdqa %%xmm2,%0" : "=m" (dq[0]));
+		asm volatile("movdqa %%xmm10,%0" : "=m" (dq[16]));
+		asm volatile("pxor %xmm2,%xmm0");
+		asm volatile("pxor %xmm10,%xmm8");
+		asm volatile("movdqa %%xmm0,%0" : "=m" (dp[0]));
+		asm volatile("movdqa %%xmm8,%0" : "=m" (dp[16]));
+
+		bytes -= 32;
+		p += 32;
+		q += 32;
+		dp += 32;
+		dq += 32;
+#else
+		asm volatile("movdqa %0,%%xmm1" : : "m" (*q));
+		asm volatile("movdqa %0,%%xmm0" : : "m" (*p));
+		asm volatile("pxor %0,%%xmm1" : : "m" (*dq));
+		asm volatile("pxor %0,%%xmm0" : : "m" (*dp));
+
+		/* xmm0 = px, xmm1 = q ^ dq */
+
+		asm volatile("movdqa %xmm1,%xmm3");
+		asm volatile("psraw $4,%xmm1");
+		asm volatile("pand %xmm7,%xmm3");
+		asm volatile("pand %xmm7,%xmm1");
+		asm volatile("movdqa %0,%%xmm2" : : "m" (qmul[0]));
+		asm volatile("pshufb %xmm3,%xmm2");
+		asm volatile("movdqa %0,%%xmm3" : : "m" (qmul[16]));
+		asm volatile("pshufb %xmm1,%xmm3");
+		asm volatile("pxor %xmm2,%xmm3");
+
+		/* xmm3 = qx */
+
+		asm volatile("movdqa %xmm0,%xmm1");
+		asm volatile("movdqa %xmm0,%xmm2");
+		asm volatile("psraw $4,%xmm1");
+		asm volatile("pand %xmm7,%xmm2");
+		asm volatile("pand %xmm7,%xmm1");
+		asm volatile("movdqa %0,%%xmm4" : : "m" (pbmul[0]));
+		asm volatile("pshufb %xmm2,%xmm4");
+		asm volatile("movdqa %0,%%xmm2" : : "m" (pbmul[16]));
+		asm volatile("pshufb %xmm1,%xmm2");
+		asm volatile("pxor %xmm4,%xmm2");
+
+		/* xmm2 = pbmul[px] */
+
+		asm volatile("pxor %xmm3,%xmm2");
+
+		/* xmm2 = db = DQ */
+
+		asm volatile("movdqa %%xmm2,%0" : "=m" (*dq));
+		asm volatile("pxor %xmm2,%xmm0");
+		asm volatile("movdqa %%xmm0,%0" : "=m" (*dp));
+
+		bytes -= 16;
+		p += 16;
+		q += 16;
+		dp += 16;
+		dq += 16;
+#endif
+	}
+
+	kernel_fpu_end();
+}
+
+static void raid6_datap_recov_ssse3(int disks, size_t bytes, int faila,
+				    void **ptrs)
+{
+	u8 *p, *q, *dq;
+	const u8 *qmul;		/* Q multiplier table */
+
+	p = (u8 *)ptrs[disks-2];
+	q = (u8 *)ptrs[disks-1];
+
+	/* Compute syndrome with zero for the missing data page
+	   Use the dead data page as temporary storage for delta q */
+	dq = (u8 *)ptrs[faila];
+	ptrs[faila] = (void *)raid6_empty_zero_page;
+	ptrs[disks-1] = dq;
+
+	raid6_call.gen_syndrome(disks, bytes, ptrs);
+
+	/* Restore pointer table */
+	ptrs[faila]   = dq;
+	ptrs[disks-1] = q;
+
+	/* Now, pick the proper data tables */
+	qmul  = raid6_vgfmul[raid6_gfinv[raid6_gfexp[faila]]];
+
+	kernel_fpu_begin();
+
+	asm volatile("movdqa %0,%%xmm7" : : "m" (raid6_ssse3_constants.x0f[0]));
+
+	while (bytes) {
+#ifdef __x86_64__
+		asm volatile("movdqa %0,%%xmm1" : : "m" (q[0]));
+		asm volatile("movdqa %0,%%xmm9" : : "m" (q[16]));
+		asm volatile("pxor %0,%%xmm1" : : "m" (dq[0]));
+		asm volatile("pxor %0,%%xmm9" : : "m" (dq[16]));
+
+		/* xmm1/9 = q ^ dq */
+
+		asm volatile("movdqa %xmm1,%xmm3");
+		asm volatile("movdqa %xmm9,%xmm11");
+		asm volatile("psraw $4,%xmm1");
+		asm volatile("psraw $4,%xmm9");
+		asm volatile("pand %xmm7,%xmm3");
+		asm volatile("pand %xmm7,%xmm11");
+		asm volatile("pand %xmm7,%xmm1");
+		asm volatile("pand %xmm7,%xmm9");
+		asm volatile("movdqa %0,%%xmm2" : : "m" (qmul[0]));
+		asm volatile("movdqa %0,%%xmm10" : : "m" (qmul[0]));
+		asm volatile("pshufb %xmm3,%xmm2");
+		asm volatile("pshufb %xmm11,%xmm10");
+		asm volatile("movdqa %0,%%xmm3" : : "m" (qmul[16]));
+		asm volatile("movdqa %0,%%xmm11" : : "m" (qmul[16]));
+		asm volatile("pshufb %xmm1,%xmm3");
+		asm volatile("pshufb %xmm9,%xmm11");
+		asm volatile("pxor %xmm2,%xmm3");
+		asm volatile("pxor %xmm10,%xmm11");
+
+		/* xmm3/11 = qmul[q ^ dq] = DQ */
+
+		asm volatile("movdqa %%xmm3,%0" : "=m" (dq[0]));
+		asm volatile("movdqa %%xmm11,%0" : "=m" (dq[16]));
+		asm volatile("pxor %0,%%xmm3" : : "m" (p[0]));
+		asm volatile("pxor %0,%%xmm11" : : "m" (p[16]));
+		asm volatile("movdqa %%xmm3,%0" : "=m" (p[0]));
+		asm volatile("movdqa %%xmm11,%0" : "=m" (p[16]));
+
+		bytes -= 32;
+		p += 32;
+		q += 32;
+		dq += 32;
+#else
+		asm volatile("movdqa %0,%%xmm1" : : "m" (*q));
+		asm volatile("pxor %0,%%xmm1" : : "m" (*dq));
+
+		/* xmm1 = q ^ dq */
+
+		asm volatile("movdqa %xmm1,%xmm3");
+		asm volatile("psraw $4,%xmm1");
+		asm volatile("pand %xmm7,%xmm3");
+		asm volatile("pand %xmm7,%xmm1");
+		asm volatile("movdqa %0,%%xmm2" : : "m" (qmul[0]));
+		asm volatile("pshufb %xmm3,%xmm2");
+		asm volatile("movdqa %0,%%xmm3" : : "m" (qmul[16]));
+		asm volatile("pshufb %xmm1,%xmm3");
+		asm volatile("pxor %xmm2,%xmm3");
+
+		/* xmm3 = qmul[q ^ dq] = DQ */
+
+		asm volatile("movdqa %%xmm3,%0" : "=m" (*dq));
+		asm volatile("pxor %0,%%xmm3" : : "m" (*p));
+		asm volatile("movdqa %%xmm3,%0" : "=m" (*p));
+
+		bytes -= 16;
+		p += 16;
+		q += 16;
+		dq += 16;
+#endif
+	}
+
+	kernel_fpu_end();
+}
+
+const struct raid6_recov_calls raid6_recov_ssse3 = {
+	.data2 = raid6_2data_recov_ssse3,
+	.datap = raid6_datap_recov_ssse3,
+	.valid = raid6_has_ssse3,
+#ifdef __x86_64__
+	.name = "ssse3x2",
+#else
+	.name = "ssse3x1",
+#endif
+};
+
+#endif
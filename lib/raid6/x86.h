@@ -24,6 +24,8 @@
 #ifdef __KERNEL__ /* Real code */
 
 #include <asm/i387.h>
+#include <asm/xcr.h>
+#include <asm/xsave.h>
 
 #else /* Dummy code for user space testing */
 
@@ -41,21 +43,73 @@ static inline void kernel_fpu_end(void)
 #define X86_FEATURE_XMM		(0*32+25) /* Streaming SIMD Extensions */
 #define X86_FEATURE_XMM2	(0*32+26) /* Streaming SIMD Extensions-2 */
 #define X86_FEATURE_MMXEXT	(1*32+22) /* AMD MMX extensions */
+#define X86_FEATURE_SSSE3	(4*32+ 9) /* Supplemental SSE-3 */
+#define X86_FEATURE_OSXSAVE	(4*32+27) /* XSAVE enabled in the OS */
+#define X86_FEATURE_AVX		(4*32+28) /* Advanced Vector Extensions */
+#define X86_FEATURE_AVX2	(9*32+ 5) /* AVX2 instructions */
 
 /* Should work well enough on modern CPUs for testing */
 static inline int boot_cpu_has(int flag)
 {
-	u32 eax = (flag >> 5) ? 0x80000001 : 1;
-	u32 edx;
+	u32 eax, ebx, ecx, edx;
+
+	switch (flag >> 5) {
+	case 1:		/* CPUID 0x80000001, edx */
+		eax = 0x80000001;
+		break;
+	case 9:		/* CPUID 7, ebx */
+		eax = 7;
+		break;
+	default:	/* CPUID 1, edx (word 0) or ecx (word 4) */
+		eax = 1;
+		break;
+	}
+	ecx = 0;
 
 	asm volatile("cpuid"
-		     : "+a" (eax), "=d" (edx)
-		     : : "ecx", "ebx");
+		     : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
 
-	return (edx >> (flag & 31)) & 1;
+	switch (flag >> 5) {
+	case 4:
+		return (ecx >> (flag & 31)) & 1;
+	case 9:
+		return (ebx >> (flag & 31)) & 1;
+	default:
+		return (edx >> (flag & 31)) & 1;
+	}
+}
+
+#define XCR_XFEATURE_ENABLED_MASK	0x00000000
+#define XSTATE_SSE	0x2
+#define XSTATE_YMM	0x4
+
+static inline u64 xgetbv(u32 index)
+{
+	u32 eax, edx;
+
+	asm volatile(".byte 0x0f,0x01,0xd0" /* xgetbv */
+		     : "=a" (eax), "=d" (edx)
+		     : "c" (index));
+	return eax + ((u64)edx << 32);
 }
 
 #endif /* ndef __KERNEL__ */
 
+/*
+ * The CPUID bits only say that the CPU can do AVX; its instructions also
+ * #UD unless the OS (or hypervisor) has enabled the YMM state in XCR0.
+ */
+static inline int raid6_avx_usable(void)
+{
+	u64 xcr0;
+
+	if (!boot_cpu_has(X86_FEATURE_AVX) ||
+	    !boot_cpu_has(X86_FEATURE_OSXSAVE))
+		return 0;
+
+	xcr0 = xgetbv(XCR_XFEATURE_ENABLED_MASK);
+	return (xcr0 & (XSTATE_SSE | XSTATE_YMM)) == (XSTATE_SSE | XSTATE_YMM);
+}
+
 #endif
 #endif
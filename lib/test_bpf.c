@@ -0,0 +1,2681 @@
+/*
+ * Testsuite for BPF interpreter and BPF JIT compiler
+ *
+ * Classic filters are checked against sk_run_filter(), the reference
+ * classic interpreter, and after their translation to extended BPF
+ * against the extended BPF interpreter and, when net.core.bpf_jit_enable
+ * is set, the JIT.  Extended BPF programs are run through the interpreter
+ * and the JIT.  A good part of the programs are generated, with expected
+ * results computed in C.  With CONFIG_BPF_SYSCALL the verifier is
+ * checked as well.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/filter.h>
+#include <linux/bpf.h>
+#include <linux/skbuff.h>
+#include <linux/netdevice.h>
+#include <linux/if_ether.h>
+#include <linux/netlink.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/math64.h>
+#include <linux/ktime.h>
+#include <linux/vmalloc.h>
+
+#define MAX_SUBTESTS	4
+#define MAX_TESTRUNS	1000
+#define MAX_DATA	128
+#define MAX_INSNS	64
+#define MAX_GEN_INSNS	BPF_MAXINSNS
+
+/* few constants used to init test 'skb' */
+#define SKB_TYPE	3
+#define SKB_MARK	0x1234aaaa
+#define SKB_HASH	0x1234aaab
+#define SKB_QUEUE_MAP	123
+#define SKB_PROTO	0x0800
+#define SKB_DEV_IFINDEX	577
+#define SKB_DEV_TYPE	588
+
+/* redefine REGs to make tests less verbose */
+#define R0 BPF_REG_0
+#define R1 BPF_REG_1
+#define R2 BPF_REG_2
+#define R3 BPF_REG_3
+#define R4 BPF_REG_4
+#define R5 BPF_REG_5
+#define R6 BPF_REG_6
+#define R7 BPF_REG_7
+#define R8 BPF_REG_8
+#define R9 BPF_REG_9
+#define R10 BPF_REG_10
+
+/* test flags */
+#define CLASSIC		0x01	/* u.insns is a classic filter */
+#define INTERNAL	0x02	/* u.insns_int is an extended BPF program */
+#define FLAG_EXPECTED_FAIL 0x04	/* sk_chk_filter() must reject the filter */
+#define FLAG_SKB_FRAG	0x08	/* append skb_frag_data as a paged fragment */
+
+struct bpf_test {
+	const char *descr;
+	union {
+		struct sock_filter insns[MAX_INSNS];
+		struct bpf_insn insns_int[MAX_INSNS];
+	} u;
+	__u8 aux;
+	__u8 data[MAX_DATA];
+	struct {
+		int data_size;
+		__u32 result;
+	} test[MAX_SUBTESTS];
+};
+
+/* paged part of the skb for FLAG_SKB_FRAG tests */
+static const __u8 skb_frag_data[16] = {
+	0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+	0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f, 0x50, 0x51,
+};
+
+#define PATTERN16 {							\
+	0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,			\
+	0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10,			\
+}
+
+static struct bpf_test tests[] = {
+	{
+		"TAX",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 1),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_IMM, 2),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_ALU | BPF_NEG, 0), /* A == -3 */
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_LEN, 0),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0), /* X == len - 3 */
+			BPF_STMT(BPF_LD | BPF_B | BPF_IND, 1),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ 10, 20, 30, 40, 50 },
+		{ { 2, 10 }, { 3, 20 }, { 4, 30 } },
+	},
+	{
+		"TXA",
+		.u.insns = {
+			BPF_STMT(BPF_LDX | BPF_LEN, 0),
+			BPF_STMT(BPF_MISC | BPF_TXA, 0),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0) /* A == len * 2 */
+		},
+		CLASSIC,
+		{ 10, 20, 30, 40, 50 },
+		{ { 1, 2 }, { 3, 6 }, { 4, 8 } },
+	},
+	{
+		"ADD_SUB_MUL_K",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 1),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 2),
+			BPF_STMT(BPF_LDX | BPF_IMM, 3),
+			BPF_STMT(BPF_ALU | BPF_SUB | BPF_X, 0),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 0xffffffff),
+			BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 3),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 0, 0xfffffffd } }
+	},
+	{
+		"DIV_KX",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 8),
+			BPF_STMT(BPF_ALU | BPF_DIV | BPF_K, 2),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_IMM, 0xffffffff),
+			BPF_STMT(BPF_ALU | BPF_DIV | BPF_X, 0),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_IMM, 0xffffffff),
+			BPF_STMT(BPF_ALU | BPF_DIV | BPF_X, 0),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_IMM, 100),
+			BPF_STMT(BPF_ALU | BPF_DIV | BPF_K, 3),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 0, 37 } }
+	},
+	{
+		"DIV_X_ZERO",
+		.u.insns = {
+			BPF_STMT(BPF_LDX | BPF_IMM, 0),
+			BPF_STMT(BPF_LD | BPF_IMM, 42),
+			BPF_STMT(BPF_ALU | BPF_DIV | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_K, 1)
+		},
+		CLASSIC,
+		{ },
+		{ { 0, 0 } }
+	},
+	{
+		"AND_OR_LSH_K",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 0xff),
+			BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xf0),
+			BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 27),
+			BPF_STMT(BPF_LDX | BPF_IMM, 0xf),
+			BPF_STMT(BPF_ALU | BPF_OR | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 0, 0x8000000f } }
+	},
+	{
+		"RSH_LSH_X",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 0x80000000),
+			BPF_STMT(BPF_LDX | BPF_IMM, 31),
+			BPF_STMT(BPF_ALU | BPF_RSH | BPF_X, 0),
+			BPF_STMT(BPF_LDX | BPF_IMM, 4),
+			BPF_STMT(BPF_ALU | BPF_LSH | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 0, 16 } }
+	},
+	{
+		"AND_OR_X_RSH_K",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 0xf0f0f0f0),
+			BPF_STMT(BPF_LDX | BPF_IMM, 0xff00ff00),
+			BPF_STMT(BPF_ALU | BPF_AND | BPF_X, 0),
+			BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 4),
+			BPF_STMT(BPF_ALU | BPF_OR | BPF_K, 0x80000000),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 0, 0x8f000f00 } }
+	},
+	{
+		"LD_IMM_0",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 0),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 1),
+			BPF_STMT(BPF_RET | BPF_K, 1),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		},
+		CLASSIC,
+		{ },
+		{ { 1, 1 } },
+	},
+	{
+		"RET_K",
+		.u.insns = {
+			BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+		},
+		CLASSIC,
+		{ },
+		{ { 0, 0xffffffff }, { 10, 0xffffffff } },
+	},
+	{
+		"LD_LEN",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_LEN, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 0, 0 }, { 5, 5 }, { 100, 100 } },
+	},
+	{
+		"LD_ABS_W_H_B",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 0),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 6),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 15),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		PATTERN16,
+		{ { 16, 0x01020a1c }, { 15, 0 }, { 7, 0 }, { 3, 0 } },
+	},
+	{
+		"LD_IND",
+		.u.insns = {
+			BPF_STMT(BPF_LDX | BPF_IMM, 1),
+			BPF_STMT(BPF_LD | BPF_W | BPF_IND, 2),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		PATTERN16,
+		{ { 7, 0x04050607 }, { 6, 0 } },
+	},
+	{
+		"LD_IND_H_B",
+		.u.insns = {
+			BPF_STMT(BPF_LDX | BPF_LEN, 0),
+			BPF_STMT(BPF_LD | BPF_H | BPF_IND, -2),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_B | BPF_IND, -0x0f01),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		PATTERN16,
+		/* negative K: the byte at 0x0f10 - 0x0f01 */
+		{ { 16, 0x10 }, { 15, 0 } },
+	},
+	{
+		"LD_ABS_LL",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, SKF_LL_OFF),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, SKF_LL_OFF + 1),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ 1, 2, 3 },
+		{ { 1, 0 }, { 2, 3 } },
+	},
+	{
+		"LD_ABS_NET",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, SKF_NET_OFF),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		PATTERN16,
+		{ { 16, 0x0f10 }, { 15, 0 } },
+	},
+	{
+		"LD_IND_NET",
+		.u.insns = {
+			BPF_STMT(BPF_LDX | BPF_IMM, 1),
+			BPF_STMT(BPF_LD | BPF_B | BPF_IND, SKF_NET_OFF),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		PATTERN16,
+		{ { 16, 0x10 }, { 15, 0 } },
+	},
+	{
+		"LD_ABS_W_NEG_OUT_OF_RANGE",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_LL_OFF - 1),
+			BPF_STMT(BPF_RET | BPF_K, 1)
+		},
+		CLASSIC,
+		PATTERN16,
+		{ { 16, 0 } },
+	},
+	{
+		"LDX_MSH",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 0x12),
+			BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0), /* A preserved */
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ 0x45 },
+		{ { 1, 0x12 + 20 } },
+	},
+	{
+		"SCRATCH_MEM",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 0x1234),
+			BPF_STMT(BPF_ST, 0),
+			BPF_STMT(BPF_LD | BPF_IMM, 0x5678),
+			BPF_STMT(BPF_ST, 15),
+			BPF_STMT(BPF_LDX | BPF_MEM, 0),
+			BPF_STMT(BPF_LD | BPF_MEM, 15),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_ST, 3),
+			BPF_STMT(BPF_LDX | BPF_MEM, 3),
+			BPF_STMT(BPF_MISC | BPF_TXA, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 0, 0x68ac } },
+	},
+	{
+		"JGT_JGE_K",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_LEN, 0),
+			BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, 3, 0, 1),
+			BPF_STMT(BPF_RET | BPF_K, 10),
+			BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 3, 1, 0),
+			BPF_STMT(BPF_RET | BPF_K, 20),
+			BPF_STMT(BPF_RET | BPF_K, 30),
+		},
+		CLASSIC,
+		{ },
+		{ { 4, 10 }, { 3, 30 }, { 2, 20 } },
+	},
+	{
+		"JSET_K",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_LEN, 0),
+			BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 1, 0, 1),
+			BPF_STMT(BPF_RET | BPF_K, 10),
+			BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 6, 1, 0),
+			BPF_STMT(BPF_RET | BPF_K, 20),
+			BPF_STMT(BPF_RET | BPF_K, 30),
+		},
+		CLASSIC,
+		{ },
+		{ { 3, 10 }, { 2, 30 }, { 8, 20 } },
+	},
+	{
+		"JUMPS_X",
+		.u.insns = {
+			BPF_STMT(BPF_LDX | BPF_LEN, 0),
+			BPF_STMT(BPF_LD | BPF_IMM, 4),
+			BPF_JUMP(BPF_JMP | BPF_JGT | BPF_X, 0, 0, 1),
+			BPF_STMT(BPF_RET | BPF_K, 10),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_X, 0, 0, 1),
+			BPF_STMT(BPF_RET | BPF_K, 20),
+			BPF_JUMP(BPF_JMP | BPF_JSET | BPF_X, 0, 0, 1),
+			BPF_STMT(BPF_RET | BPF_K, 30),
+			BPF_JUMP(BPF_JMP | BPF_JGE | BPF_X, 0, 1, 0),
+			BPF_STMT(BPF_RET | BPF_K, 40),
+			BPF_STMT(BPF_RET | BPF_K, 50),
+		},
+		CLASSIC,
+		{ },
+		{ { 3, 10 }, { 4, 20 }, { 5, 30 }, { 8, 40 } },
+	},
+	{
+		"JUMPS_NEGATIVE_K",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 0xfffffff0),
+			BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, 0xffffffe0, 0, 5),
+			BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 0xfffffff0, 0, 4),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0xfffffff0, 0, 3),
+			BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x80000000, 0, 2),
+			BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, 0xfffffff0, 1, 0),
+			BPF_STMT(BPF_RET | BPF_K, 1),
+			BPF_STMT(BPF_RET | BPF_K, 2),
+		},
+		CLASSIC,
+		{ },
+		{ { 0, 1 } },
+	},
+	{
+		"JEQ_JT_JF_SAME",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_LEN, 0),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 5, 1, 1),
+			BPF_STMT(BPF_RET | BPF_K, 1),
+			BPF_STMT(BPF_RET | BPF_K, 2),
+		},
+		CLASSIC,
+		{ },
+		{ { 5, 2 }, { 6, 2 } },
+	},
+	{
+		"JA",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 1),
+			BPF_STMT(BPF_JMP | BPF_JA, 1),
+			BPF_STMT(BPF_RET | BPF_A, 0),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 1),
+			BPF_STMT(BPF_RET | BPF_A, 0),
+		},
+		CLASSIC,
+		{ },
+		{ { 0, 2 } },
+	},
+	{
+		"LD_PROTOCOL",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 1),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 20, 1, 0),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_PROTOCOL),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 2),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 30, 1, 0),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+			BPF_STMT(BPF_MISC | BPF_TXA, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ 10, 20, 30 },
+		{ { 10, SKB_PROTO }, { 2, 0 } },
+	},
+	{
+		"LD_PKTTYPE",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_PKTTYPE),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SKB_TYPE, 1, 0),
+			BPF_STMT(BPF_RET | BPF_K, 1),
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_PKTTYPE),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 1, SKB_TYPE }, { 10, SKB_TYPE } },
+	},
+	{
+		"LD_MARK",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_MARK),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 1, SKB_MARK}, { 10, SKB_MARK} },
+	},
+	{
+		"LD_RXHASH",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_RXHASH),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 1, SKB_HASH}, { 10, SKB_HASH} },
+	},
+	{
+		"LD_QUEUE",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_QUEUE),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 1, SKB_QUEUE_MAP }, { 10, SKB_QUEUE_MAP } },
+	},
+	{
+		"LD_IFINDEX",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_IFINDEX),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 1, SKB_DEV_IFINDEX }, { 10, SKB_DEV_IFINDEX } },
+	},
+	{
+		"LD_HATYPE",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_HATYPE),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 1, SKB_DEV_TYPE }, { 10, SKB_DEV_TYPE } },
+	},
+	{
+		"LD_CPU",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_CPU),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_CPU),
+			BPF_STMT(BPF_ALU | BPF_SUB | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		{ },
+		{ { 1, 0 }, { 10, 0 } },
+	},
+	{
+		"LD_NLATTR",
+		.u.insns = {
+			BPF_STMT(BPF_LDX | BPF_IMM, 3),
+			BPF_STMT(BPF_LD | BPF_IMM, 2),
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_NLATTR),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_IMM, 2),
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_NLATTR),
+			BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 8),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		/* two attributes of type 2 and 3 behind two bytes of padding,
+		 * X ends up holding the offset of the type 3 attribute and is
+		 * then used as the (absent) type to look up
+		 */
+#ifdef __BIG_ENDIAN
+		{ 0xff, 0xff, 0, 4, 0, 2, 0, 4, 0, 3 },
+#else
+		{ 0xff, 0xff, 4, 0, 2, 0, 4, 0, 3, 0 },
+#endif
+		{ { 10, 6 }, { 4, 0 } },
+	},
+	{
+		"LD_NLATTR_NEST",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 2),
+			BPF_STMT(BPF_LDX | BPF_IMM, 3),
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_NLATTR_NEST),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC,
+		/* an attribute nesting attributes of type 2 and 3 */
+#ifdef __BIG_ENDIAN
+		{ 0xff, 0xff, 0, 12, 0, 1, 0, 4, 0, 2, 0, 4, 0, 3 },
+#else
+		{ 0xff, 0xff, 12, 0, 1, 0, 4, 0, 2, 0, 4, 0, 3, 0 },
+#endif
+		{ { 14, 10 }, { 4, 0 } },
+	},
+	{
+		"LD_ABS_FRAG",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 14),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 18),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 31),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC | FLAG_SKB_FRAG,
+		PATTERN16,
+		/* 0x0f104243 + 0x4445 + 0x51 */
+		{ { 16, 0x0f1086d9 } },
+	},
+	{
+		"LD_IND_FRAG",
+		.u.insns = {
+			BPF_STMT(BPF_LDX | BPF_IMM, 0x10),
+			BPF_STMT(BPF_LD | BPF_W | BPF_IND, 0),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_IMM, 0),
+			BPF_STMT(BPF_LD | BPF_H | BPF_IND, -0x42434445 + 28),
+			BPF_STMT(BPF_RET | BPF_A, 0)
+		},
+		CLASSIC | FLAG_SKB_FRAG,
+		PATTERN16,
+		{ { 16, 0x4e4f }, { 10, 0 } },
+	},
+	{
+		"tcpdump port 22",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x86dd, 0, 8), /* IPv6 */
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 20),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x84, 2, 0),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x6, 1, 0),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x11, 0, 17),
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 54),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 22, 14, 0),
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 56),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 22, 12, 13),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x0800, 0, 12), /* IPv4 */
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x84, 2, 0),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x6, 1, 0),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x11, 0, 8),
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 20),
+			BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 6, 0),
+			BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+			BPF_STMT(BPF_LD | BPF_H | BPF_IND, 14),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 22, 2, 0),
+			BPF_STMT(BPF_LD | BPF_H | BPF_IND, 16),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 22, 0, 1),
+			BPF_STMT(BPF_RET | BPF_K, 0xffff),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		},
+		CLASSIC,
+		/* 3c:07:54:43:e5:76 > 10:bf:48:d6:43:d6, ethertype IPv4(0x0800)
+		 * length 114: 10.1.1.149.49700 > 10.1.2.10.22: Flags [P.],
+		 * seq 1305692979:1305693027, ack 3650467037, win 65535,
+		 * options [nop,nop,TS val 2502645400 ecr 3971138], length 48
+		 */
+		{ 0x10, 0xbf, 0x48, 0xd6, 0x43, 0xd6,
+		  0x3c, 0x07, 0x54, 0x43, 0xe5, 0x76,
+		  0x08, 0x00,
+		  0x45, 0x10, 0x00, 0x64, 0x75, 0xb5,
+		  0x40, 0x00, 0x40, 0x06, 0xad, 0x2e, /* IP header */
+		  0x0a, 0x01, 0x01, 0x95, /* ip src */
+		  0x0a, 0x01, 0x02, 0x0a, /* ip dst */
+		  0xc2, 0x24,
+		  0x00, 0x16 /* dst port */ },
+		{ { 10, 0 }, { 30, 0 }, { 100, 65535 } },
+	},
+	{
+		"tcpdump complex",
+		.u.insns = {
+			/* tcpdump -nei eth0 'tcp port 22 and (((ip[2:2] -
+			 * ((ip[0]&0xf)<<2)) - ((tcp[12]&0xf0)>>2)) != 0) and
+			 * (len > 115 or len < 30000000000)' -d
+			 */
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x86dd, 30, 0),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x800, 0, 29),
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x6, 0, 27),
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 20),
+			BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 25, 0),
+			BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+			BPF_STMT(BPF_LD | BPF_H | BPF_IND, 14),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 22, 2, 0),
+			BPF_STMT(BPF_LD | BPF_H | BPF_IND, 16),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 22, 0, 20),
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 16),
+			BPF_STMT(BPF_ST, 1),
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 14),
+			BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xf),
+			BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 2),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0x5), /* libpcap emits K on TAX */
+			BPF_STMT(BPF_LD | BPF_MEM, 1),
+			BPF_STMT(BPF_ALU | BPF_SUB | BPF_X, 0),
+			BPF_STMT(BPF_ST, 5),
+			BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+			BPF_STMT(BPF_LD | BPF_B | BPF_IND, 26),
+			BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xf0),
+			BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 2),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0x9), /* libpcap emits K on TAX */
+			BPF_STMT(BPF_LD | BPF_MEM, 5),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_X, 0, 4, 0),
+			BPF_STMT(BPF_LD | BPF_LEN, 0),
+			BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, 0x73, 1, 0),
+			BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 0xfc23ac00, 1, 0),
+			BPF_STMT(BPF_RET | BPF_K, 0xffff),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		},
+		CLASSIC,
+		{ 0x10, 0xbf, 0x48, 0xd6, 0x43, 0xd6,
+		  0x3c, 0x07, 0x54, 0x43, 0xe5, 0x76,
+		  0x08, 0x00,
+		  0x45, 0x10, 0x00, 0x64, 0x75, 0xb5,
+		  0x40, 0x00, 0x40, 0x06, 0xad, 0x2e, /* IP header */
+		  0x0a, 0x01, 0x01, 0x95, /* ip src */
+		  0x0a, 0x01, 0x02, 0x0a, /* ip dst */
+		  0xc2, 0x24,
+		  0x00, 0x16 /* dst port */ },
+		{ { 10, 0 }, { 30, 0 }, { 100, 65535 } },
+	},
+	{
+		"RET_A_after_failed_load",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 7),
+			BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 100),
+			BPF_STMT(BPF_RET | BPF_A, 0),
+		},
+		CLASSIC,
+		{ },
+		{ { 10, 0 } },
+	},
+	/* Filters sk_chk_filter() has to refuse */
+	{
+		"check: DIV_K by zero",
+		.u.insns = {
+			BPF_STMT(BPF_ALU | BPF_DIV | BPF_K, 0),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		},
+		CLASSIC | FLAG_EXPECTED_FAIL,
+		{ },
+		{ },
+	},
+	{
+		"check: no final RET",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_IMM, 1),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 1),
+		},
+		CLASSIC | FLAG_EXPECTED_FAIL,
+		{ },
+		{ },
+	},
+	{
+		"check: jump out of range",
+		.u.insns = {
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 5, 0),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		},
+		CLASSIC | FLAG_EXPECTED_FAIL,
+		{ },
+		{ },
+	},
+	{
+		"check: JA out of range",
+		.u.insns = {
+			BPF_STMT(BPF_JMP | BPF_JA, 0xffffffff),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		},
+		CLASSIC | FLAG_EXPECTED_FAIL,
+		{ },
+		{ },
+	},
+	{
+		"check: ST to M[16]",
+		.u.insns = {
+			BPF_STMT(BPF_ST, 16),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		},
+		CLASSIC | FLAG_EXPECTED_FAIL,
+		{ },
+		{ },
+	},
+	{
+		"check: LD M[] before ST",
+		.u.insns = {
+			BPF_STMT(BPF_LD | BPF_MEM, 3),
+			BPF_STMT(BPF_RET | BPF_A, 0),
+		},
+		CLASSIC | FLAG_EXPECTED_FAIL,
+		{ },
+		{ },
+	},
+	{
+		"check: unknown opcode",
+		.u.insns = {
+			BPF_STMT(BPF_ALU | 0xf0, 0),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		},
+		CLASSIC | FLAG_EXPECTED_FAIL,
+		{ },
+		{ },
+	},
+	/* Extended BPF programs */
+	{
+		"INT: ADD_SUB_MUL",
+		.u.insns_int = {
+			BPF_ALU64_IMM(BPF_MOV, R1, 1),
+			BPF_ALU64_IMM(BPF_ADD, R1, 2),
+			BPF_ALU64_IMM(BPF_MOV, R2, 3),
+			BPF_ALU64_REG(BPF_SUB, R1, R2),
+			BPF_ALU64_IMM(BPF_ADD, R1, -1),
+			BPF_ALU64_IMM(BPF_MUL, R1, 3),
+			BPF_ALU64_REG(BPF_MOV, R0, R1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 0xfffffffd } }
+	},
+	{
+		"INT: MUL_X",
+		.u.insns_int = {
+			BPF_ALU64_IMM(BPF_MOV, R0, -1),
+			BPF_ALU64_IMM(BPF_MOV, R1, -1),
+			BPF_ALU64_IMM(BPF_MOV, R2, 3),
+			BPF_ALU64_REG(BPF_MUL, R1, R2),
+			BPF_JMP_IMM(BPF_JEQ, R1, 0xfffffffd, 1),
+			BPF_EXIT_INSN(),
+			BPF_ALU64_IMM(BPF_MOV, R0, 1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 1 } }
+	},
+	{
+		"INT: MUL_X 32-bit",
+		.u.insns_int = {
+			BPF_ALU32_IMM(BPF_MOV, R0, -1),
+			BPF_ALU32_IMM(BPF_MOV, R1, -1),
+			BPF_ALU32_IMM(BPF_MOV, R2, 3),
+			BPF_ALU32_REG(BPF_MUL, R1, R2),
+			BPF_ALU64_IMM(BPF_RSH, R1, 8),
+			BPF_JMP_IMM(BPF_JEQ, R1, 0xffffff, 1),
+			BPF_EXIT_INSN(),
+			BPF_ALU32_IMM(BPF_MOV, R0, 1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 1 } }
+	},
+	{
+		"INT: all registers",
+		.u.insns_int = {
+			BPF_ALU64_IMM(BPF_MOV, R0, 1),
+			BPF_ALU64_IMM(BPF_MOV, R1, 2),
+			BPF_ALU64_IMM(BPF_MOV, R2, 3),
+			BPF_ALU64_IMM(BPF_MOV, R3, 4),
+			BPF_ALU64_IMM(BPF_MOV, R4, 5),
+			BPF_ALU64_IMM(BPF_MOV, R5, 6),
+			BPF_ALU64_IMM(BPF_MOV, R6, 7),
+			BPF_ALU64_IMM(BPF_MOV, R7, 8),
+			BPF_ALU64_IMM(BPF_MOV, R8, 9),
+			BPF_ALU64_IMM(BPF_MOV, R9, 10),
+			BPF_ALU64_REG(BPF_ADD, R0, R1),
+			BPF_ALU64_REG(BPF_ADD, R0, R2),
+			BPF_ALU64_REG(BPF_ADD, R0, R3),
+			BPF_ALU64_REG(BPF_ADD, R0, R4),
+			BPF_ALU64_REG(BPF_ADD, R0, R5),
+			BPF_ALU64_REG(BPF_ADD, R0, R6),
+			BPF_ALU64_REG(BPF_ADD, R0, R7),
+			BPF_ALU64_REG(BPF_ADD, R0, R8),
+			BPF_ALU64_REG(BPF_ADD, R0, R9), /* R0 == 55 */
+			BPF_ALU32_REG(BPF_SUB, R9, R0),
+			BPF_ALU32_REG(BPF_MUL, R8, R9),
+			BPF_ALU64_REG(BPF_XOR, R7, R8),
+			BPF_ALU32_REG(BPF_ADD, R6, R7),
+			BPF_ALU64_REG(BPF_OR, R5, R6),
+			BPF_ALU64_REG(BPF_MOV, R0, R5),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		/* R9 = -45, R8 = -405, R7 = 8 ^ -405, R6 = 7 + R7, R5 = 6 | R6 */
+		{ { 0, 0xfffffe6e } }
+	},
+	{
+		"INT: shifts by rcx",
+		.u.insns_int = {
+			BPF_ALU64_IMM(BPF_MOV, R4, 3),
+			BPF_ALU64_IMM(BPF_MOV, R1, 1),
+			BPF_ALU64_REG(BPF_LSH, R1, R4),
+			BPF_ALU64_REG(BPF_LSH, R4, R4),
+			BPF_ALU64_IMM(BPF_MOV, R2, 2),
+			BPF_ALU64_REG(BPF_RSH, R4, R2),
+			BPF_ALU64_REG(BPF_ADD, R1, R4),
+			BPF_ALU32_IMM(BPF_MOV, R9, 0x80000000),
+			BPF_ALU32_REG(BPF_ARSH, R9, R2),
+			BPF_ALU64_REG(BPF_ADD, R1, R9),
+			BPF_ALU64_REG(BPF_MOV, R0, R1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 0xe000000e } }
+	},
+	{
+		"INT: ARSH",
+		.u.insns_int = {
+			BPF_ALU64_IMM(BPF_MOV, R1, -16),
+			BPF_ALU64_IMM(BPF_ARSH, R1, 2),
+			BPF_ALU32_IMM(BPF_MOV, R2, 0x80000000),
+			BPF_ALU32_IMM(BPF_ARSH, R2, 31),
+			BPF_ALU64_REG(BPF_ADD, R1, R2),
+			BPF_ALU64_REG(BPF_MOV, R0, R1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 0xfffffffb } }
+	},
+	{
+		"INT: DIV_MOD_K",
+		.u.insns_int = {
+			BPF_LD_IMM64(R1, 0x100000000LL),
+			BPF_ALU64_IMM(BPF_DIV, R1, 3),
+			BPF_ALU64_IMM(BPF_MOV, R2, 100),
+			BPF_ALU64_IMM(BPF_MOD, R2, 7),
+			BPF_ALU64_REG(BPF_ADD, R1, R2),
+			BPF_ALU64_REG(BPF_MOV, R0, R1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 0x55555557 } }
+	},
+	{
+		"INT: DIV32_K",
+		.u.insns_int = {
+			BPF_ALU32_IMM(BPF_MOV, R0, -1),
+			BPF_ALU32_IMM(BPF_DIV, R0, 16),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 0x0fffffff } }
+	},
+	{
+		"INT: DIV_X by zero",
+		.u.insns_int = {
+			BPF_ALU64_IMM(BPF_MOV, R0, 1),
+			BPF_ALU64_IMM(BPF_MOV, R1, 0),
+			BPF_ALU64_REG(BPF_DIV, R0, R1),
+			BPF_ALU64_IMM(BPF_MOV, R0, 2),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 0 } }
+	},
+	{
+		"INT: MOD32_X by zero low half",
+		.u.insns_int = {
+			BPF_LD_IMM64(R1, 0x100000000LL),
+			BPF_ALU64_IMM(BPF_MOV, R0, 5),
+			BPF_ALU32_REG(BPF_MOD, R0, R1),
+			BPF_ALU64_IMM(BPF_MOV, R0, 2),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 0 } }
+	},
+	{
+		"INT: LD_IMM64",
+		.u.insns_int = {
+			BPF_LD_IMM64(R1, 0x0123456789abcdefLL),
+			BPF_ALU64_REG(BPF_MOV, R0, R1),
+			BPF_ALU64_IMM(BPF_RSH, R0, 32),
+			BPF_ALU64_REG(BPF_XOR, R0, R1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 0x88888888 } }
+	},
+	{
+		"INT: MOV_K sign extension",
+		.u.insns_int = {
+			BPF_ALU64_IMM(BPF_MOV, R1, -2),
+			BPF_ALU64_IMM(BPF_RSH, R1, 32),
+			BPF_ALU32_IMM(BPF_MOV, R2, -2),
+			BPF_ALU64_IMM(BPF_RSH, R2, 16),
+			BPF_ALU64_REG(BPF_ADD, R1, R2),
+			BPF_ALU64_REG(BPF_MOV, R0, R1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 0xfffe } }
+	},
+	{
+		"INT: stack spill and fill",
+		.u.insns_int = {
+			BPF_LD_IMM64(R1, 0xfedcba9876543210LL),
+			BPF_STX_MEM(BPF_DW, R10, R1, -8),
+			BPF_STX_MEM(BPF_W, R10, R1, -12),
+			BPF_ST_MEM(BPF_H, R10, -14, 0x5555),
+			BPF_ST_MEM(BPF_B, R10, -15, 0x77),
+			BPF_LDX_MEM(BPF_DW, R2, R10, -8),
+			BPF_LDX_MEM(BPF_W, R3, R10, -12),
+			BPF_LDX_MEM(BPF_H, R4, R10, -14),
+			BPF_LDX_MEM(BPF_B, R5, R10, -15),
+			BPF_JMP_REG(BPF_JEQ, R2, R1, 2),
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_EXIT_INSN(),
+			BPF_ALU64_REG(BPF_MOV, R0, R3),
+			BPF_ALU64_REG(BPF_ADD, R0, R4),
+			BPF_ALU64_REG(BPF_ADD, R0, R5),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 0x765487dc } }
+	},
+	{
+		"INT: stack bottom",
+		.u.insns_int = {
+			BPF_ST_MEM(BPF_DW, R10, -512, -1),
+			BPF_ALU64_REG(BPF_MOV, R9, R10),
+			BPF_ALU64_IMM(BPF_ADD, R9, -256),
+			BPF_ST_MEM(BPF_W, R9, -256 + 4, 2),
+			BPF_LDX_MEM(BPF_DW, R0, R10, -512),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+#ifdef __BIG_ENDIAN
+		{ { 0, 2 } }
+#else
+		{ { 0, 0xffffffff } }
+#endif
+	},
+	{
+		"INT: byte stores from rdi, rsi and rbp",
+		.u.insns_int = {
+			BPF_ALU64_IMM(BPF_MOV, R1, 0x111),
+			BPF_ALU64_IMM(BPF_MOV, R2, 0x222),
+			BPF_STX_MEM(BPF_B, R10, R1, -1),
+			BPF_STX_MEM(BPF_B, R10, R2, -2),
+			BPF_STX_MEM(BPF_B, R10, R10, -3),
+			BPF_LDX_MEM(BPF_B, R3, R10, -1),
+			BPF_LDX_MEM(BPF_B, R4, R10, -2),
+			BPF_LDX_MEM(BPF_B, R5, R10, -3),
+			BPF_ALU64_REG(BPF_MOV, R6, R10),
+			BPF_ALU64_IMM(BPF_AND, R6, 0xff),
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_JMP_REG(BPF_JNE, R5, R6, 3),
+			BPF_ALU64_IMM(BPF_LSH, R3, 8),
+			BPF_ALU64_REG(BPF_OR, R3, R4),
+			BPF_ALU64_REG(BPF_MOV, R0, R3),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 0x1122 } }
+	},
+	{
+		"INT: XADD",
+		.u.insns_int = {
+			BPF_ST_MEM(BPF_W, R10, -4, 0x10),
+			BPF_ALU64_IMM(BPF_MOV, R1, 2),
+			BPF_STX_XADD(BPF_W, R10, R1, -4),
+			BPF_LDX_MEM(BPF_W, R0, R10, -4),
+			BPF_ST_MEM(BPF_DW, R10, -16, 0),
+			BPF_LD_IMM64(R1, 0x100000000LL),
+			BPF_STX_XADD(BPF_DW, R10, R1, -16),
+			BPF_STX_XADD(BPF_DW, R10, R1, -16),
+			BPF_LDX_MEM(BPF_DW, R2, R10, -16),
+			BPF_ALU64_IMM(BPF_RSH, R2, 32),
+			BPF_ALU64_REG(BPF_ADD, R0, R2),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 0x14 } }
+	},
+	{
+		"INT: TO_BE 16",
+		.u.insns_int = {
+			BPF_LD_IMM64(R0, 0x0102030405060708LL),
+			BPF_ENDIAN(BPF_TO_BE, R0, 16),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+#ifdef __BIG_ENDIAN
+		{ { 0, 0x0708 } }
+#else
+		{ { 0, 0x0807 } }
+#endif
+	},
+	{
+		"INT: TO_BE 32",
+		.u.insns_int = {
+			BPF_LD_IMM64(R0, 0x0102030405060708LL),
+			BPF_ENDIAN(BPF_TO_BE, R0, 32),
+			BPF_ALU64_REG(BPF_MOV, R1, R0),
+			BPF_ALU64_IMM(BPF_RSH, R1, 32),
+			BPF_ALU64_REG(BPF_OR, R0, R1), /* upper half cleared */
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+#ifdef __BIG_ENDIAN
+		{ { 0, 0x05060708 } }
+#else
+		{ { 0, 0x08070605 } }
+#endif
+	},
+	{
+		"INT: TO_BE 64",
+		.u.insns_int = {
+			BPF_LD_IMM64(R0, 0x0102030405060708LL),
+			BPF_ENDIAN(BPF_TO_BE, R0, 64),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+#ifdef __BIG_ENDIAN
+		{ { 0, 0x05060708 } }
+#else
+		{ { 0, 0x04030201 } }
+#endif
+	},
+	{
+		"INT: TO_LE 16",
+		.u.insns_int = {
+			BPF_LD_IMM64(R9, 0x0102030405060708LL),
+			BPF_ENDIAN(BPF_TO_LE, R9, 16),
+			BPF_ALU64_REG(BPF_MOV, R0, R9),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+#ifdef __BIG_ENDIAN
+		{ { 0, 0x0807 } }
+#else
+		{ { 0, 0x0708 } }
+#endif
+	},
+	{
+		"INT: TO_LE 32",
+		.u.insns_int = {
+			BPF_LD_IMM64(R9, 0x0102030405060708LL),
+			BPF_ENDIAN(BPF_TO_LE, R9, 32),
+			BPF_ALU64_REG(BPF_MOV, R0, R9),
+			BPF_ALU64_IMM(BPF_RSH, R9, 32),
+			BPF_ALU64_REG(BPF_OR, R0, R9), /* upper half cleared */
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+#ifdef __BIG_ENDIAN
+		{ { 0, 0x08070605 } }
+#else
+		{ { 0, 0x05060708 } }
+#endif
+	},
+	{
+		"INT: signed jumps",
+		.u.insns_int = {
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_ALU64_IMM(BPF_MOV, R1, -1),
+			BPF_JMP_IMM(BPF_JSGT, R1, -2, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_IMM(BPF_JSGE, R1, -1, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_IMM(BPF_JGT, R1, 1, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_IMM(BPF_JSGT, R1, 0, 2),
+			BPF_ALU64_IMM(BPF_MOV, R0, 1),
+			BPF_EXIT_INSN(),
+			BPF_ALU64_IMM(BPF_MOV, R0, 2),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 1 } }
+	},
+	{
+		"INT: LD_ABS and LD_IND",
+		.u.insns_int = {
+			BPF_ALU64_REG(BPF_MOV, R6, R1),
+			BPF_LD_ABS(BPF_W, 0),
+			BPF_ALU64_REG(BPF_MOV, R7, R0),
+			BPF_ALU64_IMM(BPF_MOV, R2, 2),
+			BPF_LD_IND(BPF_H, R2, 4),
+			BPF_ALU64_REG(BPF_ADD, R0, R7),
+			BPF_LD_ABS(BPF_B, SKF_NET_OFF + 1),
+			BPF_ALU64_REG(BPF_ADD, R0, R7),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		PATTERN16,
+		{ { 16, 0x01020314 }, { 7, 0 }, { 15, 0 } },
+	},
+	{
+		"INT: LD_ABS frag",
+		.u.insns_int = {
+			BPF_ALU64_REG(BPF_MOV, R6, R1),
+			BPF_LD_ABS(BPF_W, 14),
+			BPF_ALU64_REG(BPF_MOV, R7, R0),
+			BPF_ALU64_IMM(BPF_MOV, R8, 17),
+			BPF_LD_IND(BPF_B, R8, 14),
+			BPF_ALU64_REG(BPF_ADD, R0, R7),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL | FLAG_SKB_FRAG,
+		PATTERN16,
+		{ { 16, 0x0f104243 + 0x51 } },
+	},
+};
+
+static u32 test_skb_len(struct bpf_test *t, int data_size)
+{
+	return data_size + (t->aux & FLAG_SKB_FRAG ? sizeof(skb_frag_data) : 0);
+}
+
+static struct sk_buff *populate_skb(const u8 *buf, int size, bool frag)
+{
+	static struct net_device dev;
+	struct sk_buff *skb;
+	struct page *page;
+
+	if (size >= MAX_DATA)
+		return NULL;
+
+	skb = alloc_skb(MAX_DATA, GFP_KERNEL);
+	if (!skb)
+		return NULL;
+
+	memcpy(__skb_put(skb, size), buf, size);
+
+	/* Initialize a fake skb with test pattern. */
+	skb_reset_mac_header(skb);
+	skb->protocol = htons(SKB_PROTO);
+	skb->pkt_type = SKB_TYPE;
+	skb->mark = SKB_MARK;
+	skb->rxhash = SKB_HASH;
+	skb->queue_mapping = SKB_QUEUE_MAP;
+	skb->dev = &dev;
+	skb->dev->ifindex = SKB_DEV_IFINDEX;
+	skb->dev->type = SKB_DEV_TYPE;
+	skb_set_network_header(skb, min(size, ETH_HLEN));
+
+	if (frag) {
+		page = alloc_page(GFP_KERNEL);
+		if (!page) {
+			kfree_skb(skb);
+			return NULL;
+		}
+		memcpy(page_address(page), skb_frag_data,
+		       sizeof(skb_frag_data));
+		skb_fill_page_desc(skb, 0, page, 0, sizeof(skb_frag_data));
+		skb->len += sizeof(skb_frag_data);
+		skb->data_len += sizeof(skb_frag_data);
+		skb->truesize += PAGE_SIZE;
+	}
+
+	return skb;
+}
+
+static int probe_filter_length(struct sock_filter *fp)
+{
+	int len;
+
+	for (len = MAX_INSNS - 1; len > 0; --len)
+		if (fp[len].code != 0 || fp[len].k != 0)
+			break;
+
+	return len + 1;
+}
+
+static int probe_insn_length(struct bpf_insn *insn)
+{
+	int len;
+
+	for (len = MAX_INSNS - 1; len > 0; --len)
+		if (insn[len].code != 0 || insn[len].imm != 0)
+			break;
+
+	return len + 1;
+}
+
+static struct sk_filter *alloc_internal_filter(struct bpf_insn *insns, int len)
+{
+	struct sk_filter *fp;
+
+	fp = kzalloc(sk_filter_size(len, true), GFP_KERNEL);
+	if (!fp)
+		return NULL;
+
+	atomic_set(&fp->refcnt, 1);
+	fp->len = len;
+	fp->ebpf = 1;
+	memcpy(fp->insnsi, insns, len * sizeof(struct bpf_insn));
+
+	bpf_prog_select_runtime(fp);
+	return fp;
+}
+
+/*
+ * Run @fp once in the extended BPF interpreter and, if it was compiled,
+ * once as native code.  Returns 0 if every run returned @expected.
+ */
+static int check_run(struct sk_filter *fp, void *ctx, u32 expected,
+		     u32 *ret)
+{
+	u32 r;
+	int err = 0;
+
+	preempt_disable();
+	r = __bpf_prog_run(ctx, fp->insnsi);
+	if (r != expected) {
+		*ret = r;
+		err = -EINVAL;
+	}
+	if (fp->jited) {
+		r = BPF_PROG_RUN(fp, ctx);
+		if (r != expected) {
+			*ret = r;
+			err = -EINVAL;
+		}
+	}
+	preempt_enable();
+
+	return err;
+}
+
+static u64 time_runs(struct sk_filter *fp, void *ctx, int runs)
+{
+	u64 start, finish;
+	int i;
+
+	preempt_disable();
+	start = ktime_to_ns(ktime_get());
+
+	for (i = 0; i < runs; i++)
+		BPF_PROG_RUN(fp, ctx);
+
+	finish = ktime_to_ns(ktime_get());
+	preempt_enable();
+
+	return div_u64(finish - start, runs);
+}
+
+static int run_classic_test(struct bpf_test *t)
+{
+	struct sock_filter ref[MAX_INSNS];
+	struct sock_fprog fprog;
+	struct sk_filter *fp;
+	int flen = probe_filter_length(t->u.insns);
+	int err, i, err_cnt = 0;
+
+	fprog.len = flen;
+	fprog.filter = (struct sock_filter __force __user *) t->u.insns;
+
+	err = sk_unattached_filter_create(&fp, &fprog);
+	if (t->aux & FLAG_EXPECTED_FAIL) {
+		if (err == -EINVAL) {
+			pr_cont("PASS\n");
+			return 0;
+		}
+		if (!err)
+			sk_unattached_filter_destroy(fp);
+		pr_cont("FAIL to prog_fail err=%d len=%d\n", err, flen);
+		return 1;
+	}
+	if (err) {
+		pr_cont("FAIL to prog_create err=%d len=%d\n", err, flen);
+		return 1;
+	}
+
+	/* reference copy for sk_run_filter() */
+	memcpy(ref, t->u.insns, flen * sizeof(struct sock_filter));
+	sk_chk_filter(ref, flen);
+
+	pr_cont("jited:%u ", fp->jited);
+
+	for (i = 0; i < MAX_SUBTESTS; i++) {
+		u32 expected = t->test[i].result;
+		struct sk_buff *skb;
+		u32 ret, ref_ret;
+		u64 duration;
+
+		if (t->test[i].data_size == 0 && t->test[i].result == 0 && i)
+			break;
+
+		skb = populate_skb(t->data, t->test[i].data_size,
+				   t->aux & FLAG_SKB_FRAG);
+		if (!skb) {
+			pr_cont("FAIL to alloc skb\n");
+			return 1;
+		}
+
+		preempt_disable();
+		ref_ret = sk_run_filter(skb, ref);
+		ret = SK_RUN_FILTER(fp, skb);
+		if (fp->ebpf && ret == expected)
+			ret = __bpf_prog_run(skb, fp->insnsi);
+		preempt_enable();
+
+		if (ref_ret != expected || ret != expected) {
+			pr_cont("ret %u (ref %u) != %u len %u ", ret, ref_ret,
+				expected, test_skb_len(t, t->test[i].data_size));
+			err_cnt++;
+		} else {
+			duration = time_runs(fp, skb, MAX_TESTRUNS);
+			pr_cont("%lld ", duration);
+		}
+		kfree_skb(skb);
+	}
+
+	sk_unattached_filter_destroy(fp);
+
+	if (err_cnt) {
+		pr_cont("FAIL (%d times)\n", err_cnt);
+		return 1;
+	}
+	pr_cont("PASS\n");
+	return 0;
+}
+
+static int run_internal_test(struct bpf_test *t)
+{
+	struct sk_filter *fp;
+	int i, err_cnt = 0;
+
+	fp = alloc_internal_filter(t->u.insns_int,
+				   probe_insn_length(t->u.insns_int));
+	if (!fp) {
+		pr_cont("FAIL to alloc\n");
+		return 1;
+	}
+
+	pr_cont("jited:%u ", fp->jited);
+
+	for (i = 0; i < MAX_SUBTESTS; i++) {
+		u32 expected = t->test[i].result;
+		struct sk_buff *skb;
+		u32 ret = expected;
+		u64 duration;
+
+		if (t->test[i].data_size == 0 && t->test[i].result == 0 && i)
+			break;
+
+		skb = populate_skb(t->data, t->test[i].data_size,
+				   t->aux & FLAG_SKB_FRAG);
+		if (!skb) {
+			pr_cont("FAIL to alloc skb\n");
+			bpf_prog_free(fp);
+			return 1;
+		}
+
+		if (check_run(fp, skb, expected, &ret)) {
+			pr_cont("ret %u != %u len %u ", ret, expected,
+				test_skb_len(t, t->test[i].data_size));
+			err_cnt++;
+		} else {
+			duration = time_runs(fp, skb, MAX_TESTRUNS);
+			pr_cont("%lld ", duration);
+		}
+		kfree_skb(skb);
+	}
+
+	bpf_prog_free(fp);
+
+	if (err_cnt) {
+		pr_cont("FAIL (%d times)\n", err_cnt);
+		return 1;
+	}
+	pr_cont("PASS\n");
+	return 0;
+}
+
+static int test_static(int *cnt)
+{
+	int i, err_cnt = 0;
+
+	for (i = 0; i < ARRAY_SIZE(tests); i++) {
+		struct bpf_test *t = &tests[i];
+
+		pr_info("#%d %s ", i, t->descr);
+
+		if (t->aux & CLASSIC)
+			err_cnt += run_classic_test(t);
+		else
+			err_cnt += run_internal_test(t);
+	}
+
+	*cnt += ARRAY_SIZE(tests);
+	return err_cnt;
+}
+
+/*
+ * Generated extended BPF tests.  Every program is self checking: it
+ * returns 1 if its computation produced the value the C code expects,
+ * 2 if it did not and 0 when it aborted (division by zero or a failed
+ * packet load).
+ */
+#define GEN_PASS	1
+#define GEN_MISMATCH	2
+
+static struct bpf_insn *gen_insns;
+
+/* append a two instruction BPF_LD_IMM64 at insn[i] */
+#define GEN_LD_IMM64(REG, VAL)						\
+	do {								\
+		struct bpf_insn __ld[2] = { BPF_LD_IMM64(REG, VAL) };	\
+		insn[i++] = __ld[0];					\
+		insn[i++] = __ld[1];					\
+	} while (0)
+
+static int bpf_size_bytes(u8 size)
+{
+	switch (size) {
+	case BPF_B: return 1;
+	case BPF_H: return 2;
+	default: return 4;
+	}
+}
+
+static int run_generated(const char *descr, int len, void *ctx, u32 expected)
+{
+	struct sk_filter *fp;
+	u32 ret = expected;
+	int err;
+
+	fp = alloc_internal_filter(gen_insns, len);
+	if (!fp) {
+		pr_err("%s: FAIL to alloc\n", descr);
+		return 1;
+	}
+
+	err = check_run(fp, ctx, expected, &ret);
+	if (err)
+		pr_err("%s: FAIL ret %u != %u jited:%u\n", descr, ret,
+		       expected, fp->jited);
+
+	bpf_prog_free(fp);
+	return err ? 1 : 0;
+}
+
+/* registers used by the generated programs, rotated to cover all x86-64
+ * encodings in the JIT
+ */
+static void gen_pick_regs(int n, u8 *dst, u8 *src, u8 *cmp)
+{
+	u8 r;
+
+	*dst = n % 10;
+	*src = (*dst + 1 + (n / 10) % 9) % 10;
+	for (r = 9; r == *dst || r == *src; r--)
+		;
+	*cmp = r;
+}
+
+static const u64 gen_vals[] = {
+	0, 1, 0x7f, 0x80, 0x7fffffff, 0x80000000ULL, 0xffffffffULL,
+	0x100000000ULL, 0x123456789abcdef0ULL, 0x8000000000000000ULL,
+	-1ULL, -0x80ULL,
+};
+
+static const s32 gen_imms[] = {
+	0, 1, 0x7f, 0x80, 0xffff, 0x7fffffff, -1, -0x80, -0x81, INT_MIN,
+};
+
+static const u8 gen_shifts[] = {
+	0, 1, 7, 31, 32, 63,
+};
+
+static const struct {
+	u8 op;
+	const char *name;
+} gen_alu_ops[] = {
+	{ BPF_ADD, "ADD" }, { BPF_SUB, "SUB" }, { BPF_MUL, "MUL" },
+	{ BPF_DIV, "DIV" }, { BPF_MOD, "MOD" }, { BPF_OR, "OR" },
+	{ BPF_AND, "AND" }, { BPF_XOR, "XOR" }, { BPF_MOV, "MOV" },
+	{ BPF_LSH, "LSH" }, { BPF_RSH, "RSH" }, { BPF_ARSH, "ARSH" },
+	{ BPF_NEG, "NEG" },
+};
+
+/*
+ * Result of ALU operation @op on @a and @b, where @b already has the
+ * operand semantics of the instruction (sign extended immediate etc).
+ * Returns false if the program aborts.
+ */
+static bool gen_alu_result(u8 op, bool alu64, u64 a, u64 b, u64 *res)
+{
+	u32 x = a, y = b;
+
+	if (alu64) {
+		switch (op) {
+		case BPF_ADD: *res = a + b; break;
+		case BPF_SUB: *res = a - b; break;
+		case BPF_MUL: *res = a * b; break;
+		case BPF_DIV:
+			if (!b)
+				return false;
+			*res = div64_u64(a, b);
+			break;
+		case BPF_MOD:
+			if (!b)
+				return false;
+			*res = a - div64_u64(a, b) * b;
+			break;
+		case BPF_OR: *res = a | b; break;
+		case BPF_AND: *res = a & b; break;
+		case BPF_XOR: *res = a ^ b; break;
+		case BPF_MOV: *res = b; break;
+		case BPF_LSH: *res = a << b; break;
+		case BPF_RSH: *res = a >> b; break;
+		case BPF_ARSH: *res = (s64) a >> b; break;
+		case BPF_NEG: *res = -a; break;
+		}
+		return true;
+	}
+
+	switch (op) {
+	case BPF_ADD: *res = (u32) (x + y); break;
+	case BPF_SUB: *res = (u32) (x - y); break;
+	case BPF_MUL: *res = (u32) (x * y); break;
+	case BPF_DIV:
+		if (!y)
+			return false;
+		*res = x / y;
+		break;
+	case BPF_MOD:
+		if (!y)
+			return false;
+		*res = x % y;
+		break;
+	case BPF_OR: *res = x | y; break;
+	case BPF_AND: *res = x & y; break;
+	case BPF_XOR: *res = x ^ y; break;
+	case BPF_MOV: *res = y; break;
+	case BPF_LSH: *res = (u32) (x << y); break;
+	case BPF_RSH: *res = x >> y; break;
+	case BPF_ARSH: *res = (u32) ((s32) x >> y); break;
+	case BPF_NEG: *res = (u32) -x; break;
+	}
+	return true;
+}
+
+static int gen_alu_prog(u8 code, u8 dst, u8 src, u8 cmp, u64 a, u64 b,
+			s32 imm, u64 res)
+{
+	struct bpf_insn *insn = gen_insns;
+	int i = 0;
+
+	GEN_LD_IMM64(dst, a);
+	if (BPF_SRC(code) == BPF_X)
+		GEN_LD_IMM64(src, b);
+	insn[i++] = BPF_RAW_INSN(code, dst,
+				 BPF_SRC(code) == BPF_X ? src : 0, 0,
+				 BPF_SRC(code) == BPF_X ? 0 : imm);
+	GEN_LD_IMM64(cmp, res);
+	insn[i++] = BPF_JMP_REG(BPF_JEQ, dst, cmp, 2);
+	insn[i++] = BPF_ALU32_IMM(BPF_MOV, R0, GEN_MISMATCH);
+	insn[i++] = BPF_EXIT_INSN();
+	insn[i++] = BPF_ALU32_IMM(BPF_MOV, R0, GEN_PASS);
+	insn[i++] = BPF_EXIT_INSN();
+	return i;
+}
+
+static int test_alu_one(u8 op, const char *name, bool alu64, bool src_x,
+			u64 a, u64 b, s32 imm, int n)
+{
+	u8 code = (alu64 ? BPF_ALU64 : BPF_ALU) | op |
+		  (src_x ? BPF_X : BPF_K);
+	char descr[80];
+	u8 dst, src, cmp;
+	u64 res = 0;
+	bool ok;
+	int len;
+
+	gen_pick_regs(n, &dst, &src, &cmp);
+	ok = gen_alu_result(op, alu64, a, b, &res);
+	len = gen_alu_prog(code, dst, src, cmp, a, b, imm, res);
+
+	snprintf(descr, sizeof(descr), "ALU%s_%s_%c 0x%llx 0x%llx",
+		 alu64 ? "64" : "", name, src_x ? 'X' : 'K',
+		 (unsigned long long) a,
+		 (unsigned long long) (src_x ? b : (u64) (s64) imm));
+	return run_generated(descr, len, NULL, ok ? GEN_PASS : 0);
+}
+
+static int test_alu(int *cnt)
+{
+	int i, j, k, c, err_cnt = 0, n = 0;
+
+	for (c = 0; c < 2; c++) {
+		bool alu64 = c;
+
+		for (i = 0; i < ARRAY_SIZE(gen_alu_ops); i++) {
+			u8 op = gen_alu_ops[i].op;
+			const char *name = gen_alu_ops[i].name;
+
+			for (j = 0; j < ARRAY_SIZE(gen_vals); j++) {
+				u64 a = gen_vals[j];
+
+				if (op == BPF_NEG) {
+					err_cnt += test_alu_one(op, name, alu64,
+								false, a, 0, 0,
+								n++);
+					continue;
+				}
+
+				if (op == BPF_LSH || op == BPF_RSH ||
+				    op == BPF_ARSH) {
+					for (k = 0; k < ARRAY_SIZE(gen_shifts); k++) {
+						u8 s = gen_shifts[k];
+
+						if (!alu64 && s >= 32)
+							continue;
+						err_cnt += test_alu_one(op, name,
+							alu64, true, a, s, 0, n++);
+						err_cnt += test_alu_one(op, name,
+							alu64, false, a, s, s, n++);
+					}
+					continue;
+				}
+
+				for (k = 0; k < ARRAY_SIZE(gen_vals); k++)
+					err_cnt += test_alu_one(op, name, alu64,
+								true, a,
+								gen_vals[k], 0,
+								n++);
+
+				for (k = 0; k < ARRAY_SIZE(gen_imms); k++) {
+					s32 imm = gen_imms[k];
+					u64 b = alu64 ? (u64) (s64) imm : (u32) imm;
+
+					/* rejected by the verifier */
+					if ((op == BPF_DIV || op == BPF_MOD) &&
+					    imm == 0)
+						continue;
+					err_cnt += test_alu_one(op, name, alu64,
+								false, a, b,
+								imm, n++);
+				}
+			}
+		}
+	}
+
+	pr_info("ALU: %d programs, %d failed\n", n, err_cnt);
+	*cnt += n;
+	return err_cnt;
+}
+
+static const struct {
+	u8 op;
+	const char *name;
+} gen_jmp_ops[] = {
+	{ BPF_JEQ, "JEQ" }, { BPF_JNE, "JNE" }, { BPF_JGT, "JGT" },
+	{ BPF_JGE, "JGE" }, { BPF_JSGT, "JSGT" }, { BPF_JSGE, "JSGE" },
+	{ BPF_JSET, "JSET" },
+};
+
+static bool gen_jmp_taken(u8 op, u64 a, u64 b)
+{
+	switch (op) {
+	case BPF_JEQ: return a == b;
+	case BPF_JNE: return a != b;
+	case BPF_JGT: return a > b;
+	case BPF_JGE: return a >= b;
+	case BPF_JSGT: return (s64) a > (s64) b;
+	case BPF_JSGE: return (s64) a >= (s64) b;
+	case BPF_JSET: return a & b;
+	}
+	return false;
+}
+
+static int test_jmp_one(u8 op, const char *name, bool src_x, u64 a, u64 b,
+			s32 imm, int n)
+{
+	struct bpf_insn *insn = gen_insns;
+	u8 code = BPF_JMP | op | (src_x ? BPF_X : BPF_K);
+	char descr[80];
+	u8 dst, src, cmp;
+	int i = 0;
+
+	gen_pick_regs(n, &dst, &src, &cmp);
+
+	GEN_LD_IMM64(dst, a);
+	if (src_x)
+		GEN_LD_IMM64(src, b);
+	insn[i++] = BPF_RAW_INSN(code, dst, src_x ? src : 0, 2,
+				 src_x ? 0 : imm);
+	insn[i++] = BPF_ALU32_IMM(BPF_MOV, R0, 2);
+	insn[i++] = BPF_EXIT_INSN();
+	insn[i++] = BPF_ALU32_IMM(BPF_MOV, R0, 1);
+	insn[i++] = BPF_EXIT_INSN();
+
+	snprintf(descr, sizeof(descr), "%s_%c 0x%llx 0x%llx", name,
+		 src_x ? 'X' : 'K', (unsigned long long) a,
+		 (unsigned long long) b);
+	return run_generated(descr, i, NULL, gen_jmp_taken(op, a, b) ? 1 : 2);
+}
+
+static int test_jmp(int *cnt)
+{
+	int i, j, k, err_cnt = 0, n = 0;
+
+	for (i = 0; i < ARRAY_SIZE(gen_jmp_ops); i++) {
+		u8 op = gen_jmp_ops[i].op;
+		const char *name = gen_jmp_ops[i].name;
+
+		for (j = 0; j < ARRAY_SIZE(gen_vals); j++) {
+			u64 a = gen_vals[j];
+
+			for (k = 0; k < ARRAY_SIZE(gen_vals); k++)
+				err_cnt += test_jmp_one(op, name, true, a,
+							gen_vals[k], 0, n++);
+
+			for (k = 0; k < ARRAY_SIZE(gen_imms); k++) {
+				s32 imm = gen_imms[k];
+
+				err_cnt += test_jmp_one(op, name, false, a,
+							(u64) (s64) imm, imm,
+							n++);
+			}
+		}
+	}
+
+	pr_info("JMP: %d programs, %d failed\n", n, err_cnt);
+	*cnt += n;
+	return err_cnt;
+}
+
+/* forward jumps over @skip instructions, in extended and classic BPF */
+static int test_far_jumps(int *cnt)
+{
+	static const int skips[] = { 1, 20, 32, 33, 100, 255, 1000, 4000 };
+	struct sock_filter *cinsn = (struct sock_filter *) gen_insns;
+	int i, j, err_cnt = 0, n = 0;
+	char descr[40];
+
+	for (i = 0; i < ARRAY_SIZE(skips); i++) {
+		struct bpf_insn *insn = gen_insns;
+		int skip = skips[i], len = 0;
+
+		insn[len++] = BPF_ALU64_IMM(BPF_MOV, R0, 1);
+		insn[len++] = BPF_ALU64_IMM(BPF_MOV, R1, 0);
+		insn[len++] = BPF_JMP_IMM(BPF_JEQ, R1, 0, skip);
+		for (j = 0; j < skip; j++)
+			insn[len++] = BPF_ALU64_IMM(BPF_ADD, R0, 1000);
+		insn[len++] = BPF_JMP_IMM(BPF_JNE, R0, 1, 1);
+		insn[len++] = BPF_JMP_A(1);
+		insn[len++] = BPF_ALU64_IMM(BPF_MOV, R0, 2);
+		insn[len++] = BPF_EXIT_INSN();
+
+		snprintf(descr, sizeof(descr), "INT: far jump %d", skip);
+		err_cnt += run_generated(descr, len, NULL, 1);
+		n++;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(skips) && skips[i] <= 255; i++) {
+		struct sock_fprog fprog;
+		struct sk_filter *fp;
+		struct sk_buff *skb;
+		int skip = skips[i], len = 0, err;
+		u32 ret;
+
+		cinsn[len++] = (struct sock_filter)
+			BPF_STMT(BPF_LD | BPF_IMM, 1);
+		cinsn[len++] = (struct sock_filter)
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 1, skip, 0);
+		for (j = 0; j < skip; j++)
+			cinsn[len++] = (struct sock_filter)
+				BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 1000);
+		cinsn[len++] = (struct sock_filter)
+			BPF_STMT(BPF_RET | BPF_A, 0);
+
+		fprog.len = len;
+		fprog.filter = (struct sock_filter __force __user *) cinsn;
+		n++;
+
+		err = sk_unattached_filter_create(&fp, &fprog);
+		if (err) {
+			pr_err("classic far jump %d: FAIL to create %d\n",
+			       skip, err);
+			err_cnt++;
+			continue;
+		}
+
+		skb = populate_skb(NULL, 0, false);
+		if (skb) {
+			ret = SK_RUN_FILTER(fp, skb);
+			if (ret != 1) {
+				pr_err("classic far jump %d: FAIL ret %u\n",
+				       skip, ret);
+				err_cnt++;
+			}
+			kfree_skb(skb);
+		}
+		sk_unattached_filter_destroy(fp);
+	}
+
+	pr_info("far jumps: %d programs, %d failed\n", n, err_cnt);
+	*cnt += n;
+	return err_cnt;
+}
+
+/* one load per packet byte/halfword/word, summed up */
+static int test_ld_abs_sweep(int *cnt)
+{
+	static const u8 sizes[] = { BPF_B, BPF_H, BPF_W };
+	static const int lens[] = { 64, 32 };
+	u8 data[MAX_DATA];
+	int i, s, l, err_cnt = 0, n = 0;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 7 + 3;
+
+	for (l = 0; l < ARRAY_SIZE(lens); l++) {
+		for (s = 0; s < ARRAY_SIZE(sizes); s++) {
+			struct bpf_insn *insn = gen_insns;
+			int bytes = bpf_size_bytes(sizes[s]);
+			struct sk_buff *skb;
+			bool frag = l == 1;
+			int len = 0, total;
+			u32 sum = 0;
+			char descr[40];
+
+			total = lens[l] + (frag ? sizeof(skb_frag_data) : 0);
+
+			insn[len++] = BPF_ALU64_REG(BPF_MOV, R6, R1);
+			insn[len++] = BPF_ALU64_IMM(BPF_MOV, R7, 0);
+			for (i = 0; i + bytes <= total; i++) {
+				u32 v = 0;
+				int b;
+
+				for (b = 0; b < bytes; b++) {
+					int off = i + b;
+
+					v <<= 8;
+					v |= off < lens[l] ? data[off] :
+					     skb_frag_data[off - lens[l]];
+				}
+				sum += v;
+
+				if (i & 1) {
+					insn[len++] = BPF_ALU64_IMM(BPF_MOV,
+								    R8, i - 1);
+					insn[len++] = BPF_LD_IND(sizes[s], R8, 1);
+				} else {
+					insn[len++] = BPF_LD_ABS(sizes[s], i);
+				}
+				insn[len++] = BPF_ALU32_REG(BPF_ADD, R7, R0);
+			}
+			insn[len++] = BPF_ALU64_REG(BPF_MOV, R0, R7);
+			insn[len++] = BPF_EXIT_INSN();
+
+			skb = populate_skb(data, lens[l], frag);
+			if (!skb)
+				return err_cnt + 1;
+
+			snprintf(descr, sizeof(descr),
+				 "INT: LD_ABS sweep size %d%s", bytes,
+				 frag ? " frag" : "");
+			err_cnt += run_generated(descr, len, skb, sum);
+			kfree_skb(skb);
+			n++;
+		}
+	}
+
+	pr_info("LD_ABS sweep: %d programs, %d failed\n", n, err_cnt);
+	*cnt += n;
+	return err_cnt;
+}
+
+/* fill the whole stack, then sum it up */
+static int test_stack(int *cnt)
+{
+	struct bpf_insn *insn = gen_insns;
+	int i, len = 0;
+	u32 sum = 0;
+
+	for (i = 1; i <= MAX_BPF_STACK / 8; i++) {
+		insn[len++] = BPF_ALU64_IMM(BPF_MOV, i % 9 + 1, i * 3);
+		insn[len++] = BPF_STX_MEM(BPF_DW, R10, i % 9 + 1, -i * 8);
+		sum += i * 3;
+	}
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R0, 0);
+	for (i = 1; i <= MAX_BPF_STACK / 8; i++) {
+		insn[len++] = BPF_LDX_MEM(BPF_DW, i % 9 + 1, R10, -i * 8);
+		insn[len++] = BPF_ALU64_REG(BPF_ADD, R0, i % 9 + 1);
+	}
+	insn[len++] = BPF_EXIT_INSN();
+
+	*cnt += 1;
+	return run_generated("INT: full stack", len, NULL, sum);
+}
+
+/* maximum length programs */
+static int test_large(int *cnt)
+{
+	struct sock_filter *cinsn = (struct sock_filter *) gen_insns;
+	struct bpf_insn *insn = gen_insns;
+	struct sock_fprog fprog;
+	struct sk_filter *fp;
+	struct sk_buff *skb;
+	int i, len = 0, err_cnt = 0, err;
+	u32 ret;
+
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R0, 0);
+	for (i = 0; i < MAX_GEN_INSNS - 2; i++)
+		insn[len++] = BPF_ALU32_IMM(BPF_ADD, R0, 1);
+	insn[len++] = BPF_EXIT_INSN();
+	err_cnt += run_generated("INT: large program", len, NULL,
+				 MAX_GEN_INSNS - 2);
+
+	len = 0;
+	cinsn[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_IMM, 0);
+	for (i = 0; i < BPF_MAXINSNS - 2; i++)
+		cinsn[len++] = (struct sock_filter)
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 1);
+	cinsn[len++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_A, 0);
+
+	fprog.len = len;
+	fprog.filter = (struct sock_filter __force __user *) cinsn;
+
+	err = sk_unattached_filter_create(&fp, &fprog);
+	if (err) {
+		pr_err("classic large program: FAIL to create %d\n", err);
+		err_cnt++;
+	} else {
+		skb = populate_skb(NULL, 0, false);
+		if (skb) {
+			ret = SK_RUN_FILTER(fp, skb);
+			if (ret != BPF_MAXINSNS - 2) {
+				pr_err("classic large program: FAIL ret %u\n",
+				       ret);
+				err_cnt++;
+			}
+			kfree_skb(skb);
+		}
+		sk_unattached_filter_destroy(fp);
+	}
+
+	/* A jump over BPF_MAXINSNS - 2 of the classic insns that expand
+	 * the most does not fit the s16 offset of an extended BPF jump,
+	 * so the conversion has to refuse it.  A classic JIT may still
+	 * take the filter, in which case it must run correctly.
+	 */
+	len = 0;
+	cinsn[len++] = (struct sock_filter)
+		BPF_JUMP(BPF_JMP | BPF_JA, BPF_MAXINSNS - 2, 0, 0);
+	for (i = 0; i < BPF_MAXINSNS - 2; i++)
+		cinsn[len++] = (struct sock_filter)
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_NLATTR);
+	cinsn[len++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, 1);
+
+	fprog.len = len;
+	fprog.filter = (struct sock_filter __force __user *) cinsn;
+
+	err = sk_unattached_filter_create(&fp, &fprog);
+	if (err) {
+		if (err != -EINVAL) {
+			pr_err("classic long JA: FAIL to create %d\n",
+			       err);
+			err_cnt++;
+		}
+	} else {
+		skb = populate_skb(NULL, 0, false);
+		if (skb) {
+			ret = SK_RUN_FILTER(fp, skb);
+			if (ret != 1) {
+				pr_err("classic long JA: FAIL ret %u\n",
+				       ret);
+				err_cnt++;
+			}
+			kfree_skb(skb);
+		}
+		sk_unattached_filter_destroy(fp);
+	}
+
+	*cnt += 3;
+	return err_cnt;
+}
+
+/* helper called from test programs, checks that arguments are passed
+ * in R1-R5
+ */
+static u64 test_helper(u64 r1, u64 r2, u64 r3, u64 r4, u64 r5)
+{
+	return r1 + 2 * r2 + 3 * r3 + 4 * r4 + 5 * r5;
+}
+
+static bool test_helper_reachable(s32 *imm)
+{
+	s64 off = (long) test_helper - (long) __bpf_call_base;
+
+	*imm = off;
+	return off == *imm;
+}
+
+static int test_calls(int *cnt)
+{
+	struct bpf_insn *insn = gen_insns;
+	u8 data[2] = { 0x11, 0x22 };
+	struct sk_buff *skb;
+	int len = 0, err_cnt = 0;
+	s32 imm;
+
+	if (!test_helper_reachable(&imm)) {
+		pr_info("CALL: helper out of range, skipped\n");
+		return 0;
+	}
+
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R6, 6);
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R7, 7);
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R8, 8);
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R9, 9);
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R1, 1);
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R2, 2);
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R3, 3);
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R4, 4);
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R5, 5);
+	insn[len++] = BPF_EMIT_CALL(imm);
+	insn[len++] = BPF_ALU64_REG(BPF_ADD, R0, R6);
+	insn[len++] = BPF_ALU64_REG(BPF_ADD, R0, R7);
+	insn[len++] = BPF_ALU64_REG(BPF_ADD, R0, R8);
+	insn[len++] = BPF_ALU64_REG(BPF_ADD, R0, R9);
+	insn[len++] = BPF_EXIT_INSN();
+	err_cnt += run_generated("INT: CALL", len, NULL, 55 + 30);
+
+	/* packet loads must still work after a helper call */
+	len = 0;
+	insn[len++] = BPF_ALU64_REG(BPF_MOV, R6, R1);
+	insn[len++] = BPF_LD_ABS(BPF_B, 0);
+	insn[len++] = BPF_ALU64_REG(BPF_MOV, R7, R0);
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R1, 1);
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R2, 0);
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R3, 0);
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R4, 0);
+	insn[len++] = BPF_ALU64_IMM(BPF_MOV, R5, 0);
+	insn[len++] = BPF_EMIT_CALL(imm);
+	insn[len++] = BPF_ALU64_REG(BPF_ADD, R7, R0);
+	insn[len++] = BPF_LD_ABS(BPF_B, 1);
+	insn[len++] = BPF_ALU64_REG(BPF_ADD, R0, R7);
+	insn[len++] = BPF_EXIT_INSN();
+
+	skb = populate_skb(data, sizeof(data), false);
+	if (!skb)
+		return err_cnt + 1;
+	err_cnt += run_generated("INT: LD_ABS after CALL", len, skb,
+				 0x11 + 1 + 0x22);
+	kfree_skb(skb);
+
+	*cnt += 2;
+	return err_cnt;
+}
+
+#ifdef CONFIG_BPF_SYSCALL
+static const struct bpf_func_proto test_helper_proto = {
+	.func		= test_helper,
+	.gpl_only	= false,
+	.ret_type	= RET_INTEGER,
+	.arg1_type	= ARG_ANYTHING,
+	.arg2_type	= ARG_ANYTHING,
+};
+
+static const struct bpf_func_proto test_gpl_helper_proto = {
+	.func		= test_helper,
+	.gpl_only	= true,
+	.ret_type	= RET_INTEGER,
+};
+
+static const struct bpf_func_proto *
+test_func_proto(enum bpf_func_id func_id)
+{
+	switch (func_id) {
+	case BPF_FUNC_get_prandom_u32:
+		return &test_helper_proto;
+	case BPF_FUNC_ktime_get_ns:
+		return &test_gpl_helper_proto;
+	default:
+		return NULL;
+	}
+}
+
+/* the context may only be read as a 32 bit word at offset 0 */
+static bool test_is_valid_access(int off, int size, enum bpf_access_type type)
+{
+	return off == 0 && size == 4 && type == BPF_READ;
+}
+
+static const struct bpf_verifier_ops test_verifier_ops = {
+	.get_func_proto = test_func_proto,
+	.is_valid_access = test_is_valid_access,
+	.ld_abs = true,
+};
+
+#define FLAG_NOT_GPL	0x01
+
+static struct {
+	const char *descr;
+	struct bpf_insn insns[MAX_INSNS];
+	int errcode;	/* 0 if the program has to be accepted */
+	int flags;
+} verifier_tests[] = {
+	{
+		"verifier: exit without R0",
+		{ BPF_EXIT_INSN() },
+		-EACCES,
+	},
+	{
+		"verifier: minimal program",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_EXIT_INSN(),
+		},
+		0,
+	},
+	{
+		"verifier: unreachable insn",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_EXIT_INSN(),
+			BPF_EXIT_INSN(),
+		},
+		-EINVAL,
+	},
+	{
+		"verifier: back-edge",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_JMP_IMM(BPF_JEQ, R0, 0, -2),
+			BPF_EXIT_INSN(),
+		},
+		-EINVAL,
+	},
+	{
+		"verifier: jump out of range",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_JMP_A(10),
+			BPF_EXIT_INSN(),
+		},
+		-EINVAL,
+	},
+	{
+		"verifier: no exit",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_ALU64_IMM(BPF_MOV, R0, 1),
+		},
+		-EINVAL,
+	},
+	{
+		"verifier: read uninitialized register",
+		{
+			BPF_ALU64_REG(BPF_MOV, R0, R2),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: write to frame pointer",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R10, 0),
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: invalid register",
+		{
+			BPF_ALU64_IMM(BPF_MOV, 11, 0),
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_EXIT_INSN(),
+		},
+		-EINVAL,
+	},
+	{
+		"verifier: unknown opcode",
+		{
+			BPF_RAW_INSN(BPF_ALU64 | 0xf0 | BPF_K, R0, 0, 0, 0),
+			BPF_EXIT_INSN(),
+		},
+		-EINVAL,
+	},
+	{
+		"verifier: ALU reserved fields",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_RAW_INSN(BPF_ALU64 | BPF_ADD | BPF_K, R0, 0, 1, 1),
+			BPF_EXIT_INSN(),
+		},
+		-EINVAL,
+	},
+	{
+		"verifier: DIV by zero constant",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R0, 1),
+			BPF_ALU32_IMM(BPF_DIV, R0, 0),
+			BPF_EXIT_INSN(),
+		},
+		-EINVAL,
+	},
+	{
+		"verifier: incomplete LD_IMM64",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_EXIT_INSN(),
+			BPF_RAW_INSN(BPF_LD | BPF_IMM | BPF_DW, R0, 0, 0, 1),
+		},
+		-EINVAL,
+	},
+	{
+		"verifier: LD_IMM64",
+		{
+			BPF_LD_IMM64(R0, 0x123456789abcdefLL),
+			BPF_EXIT_INSN(),
+		},
+		0,
+	},
+	{
+		"verifier: stack spill and fill",
+		{
+			BPF_STX_MEM(BPF_DW, R10, R1, -8),
+			BPF_LDX_MEM(BPF_DW, R2, R10, -8),
+			BPF_LDX_MEM(BPF_W, R0, R2, 0),
+			BPF_EXIT_INSN(),
+		},
+		0,
+	},
+	{
+		"verifier: partial fill of spilled pointer",
+		{
+			BPF_STX_MEM(BPF_DW, R10, R1, -8),
+			BPF_LDX_MEM(BPF_W, R0, R10, -8),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: corrupted spill",
+		{
+			BPF_STX_MEM(BPF_DW, R10, R1, -8),
+			BPF_ST_MEM(BPF_W, R10, -4, 0),
+			BPF_LDX_MEM(BPF_DW, R0, R10, -8),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: read uninitialized stack",
+		{
+			BPF_LDX_MEM(BPF_DW, R0, R10, -8),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: stack out of bounds",
+		{
+			BPF_ST_MEM(BPF_DW, R10, 8, 0),
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: stack bottom",
+		{
+			BPF_ST_MEM(BPF_DW, R10, -512, 0),
+			BPF_LDX_MEM(BPF_DW, R0, R10, -512),
+			BPF_EXIT_INSN(),
+		},
+		0,
+	},
+	{
+		"verifier: below stack bottom",
+		{
+			BPF_ST_MEM(BPF_DW, R10, -520, 0),
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: misaligned stack access",
+		{
+			BPF_ST_MEM(BPF_DW, R10, -4, 0),
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: stack pointer arithmetic",
+		{
+			BPF_ALU64_REG(BPF_MOV, R2, R10),
+			BPF_ALU64_IMM(BPF_ADD, R2, -16),
+			BPF_ST_MEM(BPF_DW, R2, 8, 7),
+			BPF_LDX_MEM(BPF_DW, R0, R10, -8),
+			BPF_EXIT_INSN(),
+		},
+		0,
+	},
+	{
+		"verifier: ctx read",
+		{
+			BPF_LDX_MEM(BPF_W, R0, R1, 0),
+			BPF_EXIT_INSN(),
+		},
+		0,
+	},
+	{
+		"verifier: ctx read at invalid offset",
+		{
+			BPF_LDX_MEM(BPF_W, R0, R1, 4),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: ctx write",
+		{
+			BPF_ST_MEM(BPF_W, R1, 0, 0),
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: ctx pointer arithmetic",
+		{
+			BPF_ALU64_IMM(BPF_ADD, R1, 4),
+			BPF_LDX_MEM(BPF_W, R0, R1, -4),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: access through scalar",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R1, 0),
+			BPF_LDX_MEM(BPF_W, R0, R1, 0),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: LD_ABS",
+		{
+			BPF_ALU64_REG(BPF_MOV, R6, R1),
+			BPF_LD_ABS(BPF_W, 0),
+			BPF_LD_IND(BPF_B, R0, 2),
+			BPF_EXIT_INSN(),
+		},
+		0,
+	},
+	{
+		"verifier: LD_ABS without ctx in R6",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R6, 0),
+			BPF_LD_ABS(BPF_W, 0),
+			BPF_EXIT_INSN(),
+		},
+		-EINVAL,
+	},
+	{
+		"verifier: LD_ABS clobbers R1-R5",
+		{
+			BPF_ALU64_REG(BPF_MOV, R6, R1),
+			BPF_ALU64_IMM(BPF_MOV, R2, 0),
+			BPF_LD_ABS(BPF_W, 0),
+			BPF_ALU64_REG(BPF_MOV, R0, R2),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: CALL",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R1, 1),
+			BPF_ALU64_IMM(BPF_MOV, R2, 2),
+			BPF_RAW_INSN(BPF_JMP | BPF_CALL, 0, 0, 0,
+				     BPF_FUNC_get_prandom_u32),
+			BPF_EXIT_INSN(),
+		},
+		0,
+	},
+	{
+		"verifier: CALL with uninitialized argument",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R1, 1),
+			BPF_RAW_INSN(BPF_JMP | BPF_CALL, 0, 0, 0,
+				     BPF_FUNC_get_prandom_u32),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: CALL clobbers R1-R5",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R1, 1),
+			BPF_ALU64_IMM(BPF_MOV, R2, 2),
+			BPF_RAW_INSN(BPF_JMP | BPF_CALL, 0, 0, 0,
+				     BPF_FUNC_get_prandom_u32),
+			BPF_ALU64_REG(BPF_MOV, R0, R1),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: CALL unknown function",
+		{
+			BPF_RAW_INSN(BPF_JMP | BPF_CALL, 0, 0, 0, 1234),
+			BPF_EXIT_INSN(),
+		},
+		-EINVAL,
+	},
+	{
+		"verifier: CALL function not offered",
+		{
+			BPF_RAW_INSN(BPF_JMP | BPF_CALL, 0, 0, 0,
+				     BPF_FUNC_get_smp_processor_id),
+			BPF_EXIT_INSN(),
+		},
+		-EINVAL,
+	},
+	{
+		"verifier: CALL GPL function",
+		{
+			BPF_RAW_INSN(BPF_JMP | BPF_CALL, 0, 0, 0,
+				     BPF_FUNC_ktime_get_ns),
+			BPF_EXIT_INSN(),
+		},
+		0,
+	},
+	{
+		"verifier: CALL GPL function from proprietary program",
+		{
+			BPF_RAW_INSN(BPF_JMP | BPF_CALL, 0, 0, 0,
+				     BPF_FUNC_ktime_get_ns),
+			BPF_EXIT_INSN(),
+		},
+		-EINVAL,
+		FLAG_NOT_GPL,
+	},
+	{
+		"verifier: uninitialized R0 on one branch",
+		{
+			BPF_JMP_IMM(BPF_JEQ, R1, 0, 1),
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_EXIT_INSN(),
+		},
+		-EACCES,
+	},
+	{
+		"verifier: many branches",
+		{
+			BPF_ALU64_IMM(BPF_MOV, R0, 0),
+			BPF_LDX_MEM(BPF_W, R2, R1, 0),
+			BPF_JMP_IMM(BPF_JGT, R2, 1, 1),
+			BPF_ALU64_IMM(BPF_ADD, R0, 1),
+			BPF_JMP_IMM(BPF_JGT, R2, 2, 1),
+			BPF_ALU64_IMM(BPF_ADD, R0, 1),
+			BPF_JMP_IMM(BPF_JGT, R2, 3, 1),
+			BPF_ALU64_IMM(BPF_ADD, R0, 1),
+			BPF_JMP_IMM(BPF_JGT, R2, 4, 1),
+			BPF_ALU64_IMM(BPF_ADD, R0, 1),
+			BPF_JMP_IMM(BPF_JSET, R2, 8, 1),
+			BPF_ALU64_IMM(BPF_ADD, R0, 1),
+			BPF_JMP_REG(BPF_JSGE, R2, R0, 1),
+			BPF_ALU64_IMM(BPF_ADD, R0, 1),
+			BPF_EXIT_INSN(),
+		},
+		0,
+	},
+};
+
+static int test_verifier(int *cnt)
+{
+	int i, err_cnt = 0;
+
+	for (i = 0; i < ARRAY_SIZE(verifier_tests); i++) {
+		union bpf_attr attr;
+		struct sk_filter *fp;
+		int len, err;
+
+		len = probe_insn_length(verifier_tests[i].insns);
+		fp = kzalloc(sk_filter_size(len, true), GFP_KERNEL);
+		if (!fp)
+			return err_cnt + 1;
+		fp->aux = kzalloc(sizeof(*fp->aux), GFP_KERNEL);
+		if (!fp->aux) {
+			kfree(fp);
+			return err_cnt + 1;
+		}
+
+		atomic_set(&fp->refcnt, 1);
+		fp->len = len;
+		fp->ebpf = 1;
+		fp->aux->ops = &test_verifier_ops;
+		fp->aux->is_gpl_compatible =
+			!(verifier_tests[i].flags & FLAG_NOT_GPL);
+		memcpy(fp->insnsi, verifier_tests[i].insns,
+		       len * sizeof(struct bpf_insn));
+
+		memset(&attr, 0, sizeof(attr));
+		err = bpf_check(fp, &attr);
+
+		if (err != verifier_tests[i].errcode) {
+			pr_err("%s: FAIL err %d != %d\n",
+			       verifier_tests[i].descr, err,
+			       verifier_tests[i].errcode);
+			err_cnt++;
+		}
+		bpf_prog_free(fp);
+	}
+
+	pr_info("verifier: %d programs, %d failed\n",
+		(int) ARRAY_SIZE(verifier_tests), err_cnt);
+	*cnt += ARRAY_SIZE(verifier_tests);
+	return err_cnt;
+}
+#else
+static int test_verifier(int *cnt)
+{
+	return 0;
+}
+#endif
+
+static int __init test_bpf_init(void)
+{
+	int cnt = 0, err_cnt = 0;
+
+	gen_insns = vmalloc(MAX_GEN_INSNS * sizeof(struct bpf_insn));
+	if (!gen_insns)
+		return -ENOMEM;
+
+	err_cnt += test_static(&cnt);
+	err_cnt += test_alu(&cnt);
+	err_cnt += test_jmp(&cnt);
+	err_cnt += test_far_jumps(&cnt);
+	err_cnt += test_ld_abs_sweep(&cnt);
+	err_cnt += test_stack(&cnt);
+	err_cnt += test_large(&cnt);
+	err_cnt += test_calls(&cnt);
+	err_cnt += test_verifier(&cnt);
+
+	vfree(gen_insns);
+
+	pr_info("Summary: %d PASSED, %d FAILED\n", cnt - err_cnt, err_cnt);
+	return err_cnt ? -EINVAL : 0;
+}
+
+static void __exit test_bpf_exit(void)
+{
+}
+
+module_init(test_bpf_init);
+module_exit(test_bpf_exit);
+
+MODULE_LICENSE("GPL");
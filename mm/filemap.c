@@ -1088,8 +1088,81 @@ static void shrink_readahead_size_eio(struct file *filp,
 	ra->ra_pages /= 4;
 }
 
+/*
+ * Wake function for an aio read waiting on a locked page: instead of
+ * waking a task, the unlock kicks the iocb so that its retry runs from
+ * the aio workqueue.
+ */
+static int kiocb_page_wake_function(wait_queue_t *wait, unsigned mode,
+				    int sync, void *arg)
+{
+	struct wait_bit_key *key = arg;
+	struct wait_bit_queue *wait_bit
+		= container_of(wait, struct wait_bit_queue, wait);
+
+	if (wait_bit->key.flags != key->flags ||
+			wait_bit->key.bit_nr != key->bit_nr ||
+			test_bit(key->bit_nr, key->flags))
+		return 0;
+	list_del_init(&wait->task_list);
+	kick_iocb(wait->private);
+	return 1;
+}
+
+/*
+ * Queue @iocb to be kicked when @page is unlocked.  Returns -EIOCBRETRY
+ * if the iocb is now waiting, or 0 if the page was unlocked already.
+ *
+ * If part of the read has been @copied already, the iocb is not queued
+ * and -EIOCBRETRY only tells the caller to stop: the short count is
+ * returned, and it is the retry of the remainder which waits.  Queueing
+ * ki_wait here too would leave it on the wait queue when the retry
+ * queues it again.
+ */
+static int wait_on_page_locked_async(struct page *page, struct kiocb *iocb,
+				     size_t copied)
+{
+	struct wait_bit_queue *wait = &iocb->ki_wait;
+	wait_queue_head_t *q = page_waitqueue(page);
+	unsigned long flags;
+	int ret = -EIOCBRETRY;
+
+	if (copied)
+		return PageLocked(page) ? -EIOCBRETRY : 0;
+
+	init_waitqueue_func_entry(&wait->wait, kiocb_page_wake_function);
+	wait->wait.private = iocb;
+	wait->key.flags = &page->flags;
+	wait->key.bit_nr = PG_locked;
+
+	spin_lock_irqsave(&q->lock, flags);
+	__add_wait_queue(q, &wait->wait);
+	/* pairs with the barrier between clear_bit and wake in unlock_page */
+	smp_mb();
+	if (!PageLocked(page)) {
+		__remove_wait_queue(q, &wait->wait);
+		ret = 0;
+	}
+	spin_unlock_irqrestore(&q->lock, flags);
+	return ret;
+}
+
+static int lock_page_async(struct page *page, struct kiocb *iocb,
+			   size_t copied)
+{
+	int ret;
+
+	while (!trylock_page(page)) {
+		ret = wait_on_page_locked_async(page, iocb, copied);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
 /**
  * do_generic_file_read - generic file read routine
+ * @iocb:	kernel I/O control block, may be NULL
  * @filp:	the file to read
  * @ppos:	current file position
  * @desc:	read_descriptor
@@ -1098,11 +1171,17 @@ static void shrink_readahead_size_eio(struct file *filp,
  * This is a generic file read routine, and uses the
  * mapping->a_ops->readpage() function for the actual low-level stuff.
  *
+ * If @iocb is an aio read marked KIF_ASYNC_BUFFERED, the routine never
+ * sleeps waiting for page I/O: it stops with -EIOCBRETRY in desc->error.
+ * If nothing was copied yet (desc->written is zero on entry and still
+ * zero), the iocb is queued on the page's wait queue, to be retried once
+ * the page is unlocked; otherwise the caller returns a short read.
+ *
  * This is really ugly. But the goto's actually try to clarify some
  * of the logic when it comes to error handling etc.
  */
-static void do_generic_file_read(struct file *filp, loff_t *ppos,
-		read_descriptor_t *desc, read_actor_t actor)
+static void do_generic_file_read(struct kiocb *iocb, struct file *filp,
+		loff_t *ppos, read_descriptor_t *desc, read_actor_t actor)
 {
 	struct address_space *mapping = filp->f_mapping;
 	struct inode *inode = mapping->host;
@@ -1112,6 +1191,7 @@ static void do_generic_file_read(struct file *filp, loff_t *ppos,
 	pgoff_t prev_index;
 	unsigned long offset;      /* offset into pagecache page */
 	unsigned int prev_offset;
+	int async = iocb && kiocbIsAsyncBuffered(iocb);
 	int error;
 
 	index = *ppos >> PAGE_CACHE_SHIFT;
@@ -1222,7 +1302,10 @@ page_ok:
 
 page_not_up_to_date:
 		/* Get exclusive access to the page ... */
-		error = lock_page_killable(page);
+		if (async)
+			error = lock_page_async(page, iocb, desc->written);
+		else
+			error = lock_page_killable(page);
 		if (unlikely(error))
 			goto readpage_error;
 
@@ -1240,6 +1323,18 @@ page_not_up_to_date_locked:
 			goto page_ok;
 		}
 
+		/*
+		 * An aio retry after waiting for the read of this very page:
+		 * if that failed, report it rather than reading it again.
+		 */
+		if (async && PageError(page) &&
+				iocb->ki_wait.key.flags == &page->flags) {
+			unlock_page(page);
+			shrink_readahead_size_eio(filp, ra);
+			error = -EIO;
+			goto readpage_error;
+		}
+
 readpage:
 		/*
 		 * A previous I/O error may have been due to temporary
@@ -1259,6 +1354,12 @@ readpage:
 		}
 
 		if (!PageUptodate(page)) {
+			if (async) {
+				error = wait_on_page_locked_async(page, iocb,
+								  desc->written);
+				if (error)
+					goto readpage_error;
+			}
 			error = lock_page_killable(page);
 			if (unlikely(error))
 				goto readpage_error;
@@ -1479,14 +1580,15 @@ generic_file_aio_read(struct kiocb *iocb, const struct iovec *iov,
 			count = 0;
 		}
 
-		desc.written = 0;
+		/* counts what earlier segments read, for async waits */
+		desc.written = retval;
 		desc.arg.buf = iov[seg].iov_base + offset;
 		desc.count = iov[seg].iov_len - offset;
 		if (desc.count == 0)
 			continue;
 		desc.error = 0;
-		do_generic_file_read(filp, ppos, &desc, file_read_actor);
-		retval += desc.written;
+		do_generic_file_read(iocb, filp, ppos, &desc, file_read_actor);
+		retval = desc.written;
 		if (desc.error) {
 			retval = retval ?: desc.error;
 			break;
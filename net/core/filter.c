@@ -63,6 +63,13 @@ static inline void *load_pointer(const struct sk_buff *skb, int k,
 	return __load_pointer(skb, k, size);
 }
 
+/* Out of line version used by the extended BPF interpreter */
+void *bpf_load_pointer(const struct sk_buff *skb, int k, unsigned int size,
+		       void *buffer)
+{
+	return load_pointer(skb, k, size, buffer);
+}
+
 /**
  *	sk_filter - run a packet through a socket filter
  *	@sk: sock associated with &sk_buff
@@ -362,6 +369,458 @@ load_b:
 }
 EXPORT_SYMBOL(sk_run_filter);
 
+/* Ancillary loads that need more than a plain field load are helper
+ * calls in the converted program.  A helper returns BPF_ANC_ABORT where
+ * sk_run_filter() would stop the filter with a return value of 0.
+ */
+#define BPF_ANC_ABORT	(1ULL << 32)
+
+static u64 __skb_get_pkt_type(u64 ctx, u64 a, u64 x, u64 r4, u64 r5)
+{
+	struct sk_buff *skb = (struct sk_buff *)(unsigned long) ctx;
+
+	return skb->pkt_type;
+}
+
+static u64 __get_raw_cpu_id(u64 ctx, u64 a, u64 x, u64 r4, u64 r5)
+{
+	return raw_smp_processor_id();
+}
+
+static u64 __skb_get_nlattr(u64 ctx, u64 a, u64 x, u64 r4, u64 r5)
+{
+	struct sk_buff *skb = (struct sk_buff *)(unsigned long) ctx;
+	u32 A = a, X = x;
+	struct nlattr *nla;
+
+	if (skb_is_nonlinear(skb))
+		return BPF_ANC_ABORT;
+	if (A > skb->len - sizeof(struct nlattr))
+		return BPF_ANC_ABORT;
+
+	nla = nla_find((struct nlattr *)&skb->data[A], skb->len - A, X);
+	if (nla)
+		return (void *)nla - (void *)skb->data;
+	return 0;
+}
+
+static u64 __skb_get_nlattr_nest(u64 ctx, u64 a, u64 x, u64 r4, u64 r5)
+{
+	struct sk_buff *skb = (struct sk_buff *)(unsigned long) ctx;
+	u32 A = a, X = x;
+	struct nlattr *nla;
+
+	if (skb_is_nonlinear(skb))
+		return BPF_ANC_ABORT;
+	if (A > skb->len - sizeof(struct nlattr))
+		return BPF_ANC_ABORT;
+
+	nla = (struct nlattr *)&skb->data[A];
+	if (nla->nla_len > A - skb->len)
+		return BPF_ANC_ABORT;
+
+	nla = nla_find_nested(nla, X);
+	if (nla)
+		return (void *)nla - (void *)skb->data;
+	return 0;
+}
+
+#define BPF_SIZEOF_PTR	(sizeof(void *) == 8 ? BPF_DW : BPF_W)
+
+/* offset of scratch memory cell k below the frame pointer */
+#define BPF_MEM_OFF(k)	(-(BPF_MEMWORDS - (int)(k)) * 4)
+
+/**
+ *	sk_convert_filter - convert a checked filter to extended BPF
+ *	@prog: filter already validated by sk_chk_filter()
+ *	@len: length of the filter
+ *	@new_prog: buffer for the extended BPF program, or NULL
+ *	@new_len: number of extended BPF instructions
+ *
+ * With @new_prog set to NULL only the length of the converted program
+ * is stored in @new_len, so the caller can size the buffer.  The
+ * second call with the buffer converts the program.
+ *
+ * A and X live in BPF_REG_A and BPF_REG_X as zero extended 32-bit
+ * values, the skb (a struct seccomp_data for seccomp filters) in
+ * BPF_REG_CTX and the scratch memory store in the stack frame.
+ * Returns 0 or -EINVAL for a filter that cannot be converted.
+ */
+int sk_convert_filter(struct sock_filter *prog, int len,
+		      struct bpf_insn *new_prog, int *new_len)
+{
+	int new_flen = 0, pass = 0, target, i;
+	struct bpf_insn *new_insn;
+	struct sock_filter *fp;
+	int *addrs = NULL;
+	u8 bpf_src;
+
+	if (len <= 0 || len > BPF_MAXINSNS)
+		return -EINVAL;
+
+	if (new_prog) {
+		addrs = kcalloc(len, sizeof(*addrs), GFP_KERNEL);
+		if (!addrs)
+			return -ENOMEM;
+	}
+
+do_pass:
+	new_insn = new_prog;
+	fp = prog;
+
+	/* classic BPF expects A and X to be reset first */
+	if (new_insn) {
+		new_insn[0] = BPF_ALU64_REG(BPF_XOR, BPF_REG_A, BPF_REG_A);
+		new_insn[1] = BPF_ALU64_REG(BPF_XOR, BPF_REG_X, BPF_REG_X);
+		new_insn[2] = BPF_MOV64_REG(BPF_REG_CTX, BPF_REG_ARG1);
+	}
+	new_insn += 3;
+
+	for (i = 0; i < len; fp++, i++) {
+		struct bpf_insn tmp_insns[10] = { };
+		struct bpf_insn *insn = tmp_insns;
+		u32 K = fp->k;
+		u8 op = 0;
+
+		if (addrs)
+			addrs[i] = new_insn - new_prog;
+
+		switch (fp->code) {
+		/* A op= X, A op= K */
+		case BPF_S_ALU_ADD_X:
+		case BPF_S_ALU_SUB_X:
+		case BPF_S_ALU_MUL_X:
+		case BPF_S_ALU_DIV_X:
+		case BPF_S_ALU_AND_X:
+		case BPF_S_ALU_OR_X:
+		case BPF_S_ALU_LSH_X:
+		case BPF_S_ALU_RSH_X:
+			switch (fp->code) {
+			case BPF_S_ALU_ADD_X: op = BPF_ADD; break;
+			case BPF_S_ALU_SUB_X: op = BPF_SUB; break;
+			case BPF_S_ALU_MUL_X: op = BPF_MUL; break;
+			case BPF_S_ALU_DIV_X: op = BPF_DIV; break;
+			case BPF_S_ALU_AND_X: op = BPF_AND; break;
+			case BPF_S_ALU_OR_X:  op = BPF_OR;  break;
+			case BPF_S_ALU_LSH_X: op = BPF_LSH; break;
+			case BPF_S_ALU_RSH_X: op = BPF_RSH; break;
+			}
+			*insn = BPF_ALU32_REG(op, BPF_REG_A, BPF_REG_X);
+			break;
+
+		case BPF_S_ALU_ADD_K:
+		case BPF_S_ALU_SUB_K:
+		case BPF_S_ALU_MUL_K:
+		case BPF_S_ALU_AND_K:
+		case BPF_S_ALU_OR_K:
+		case BPF_S_ALU_LSH_K:
+		case BPF_S_ALU_RSH_K:
+			switch (fp->code) {
+			case BPF_S_ALU_ADD_K: op = BPF_ADD; break;
+			case BPF_S_ALU_SUB_K: op = BPF_SUB; break;
+			case BPF_S_ALU_MUL_K: op = BPF_MUL; break;
+			case BPF_S_ALU_AND_K: op = BPF_AND; break;
+			case BPF_S_ALU_OR_K:  op = BPF_OR;  break;
+			case BPF_S_ALU_LSH_K: op = BPF_LSH; break;
+			case BPF_S_ALU_RSH_K: op = BPF_RSH; break;
+			}
+			*insn = BPF_ALU32_IMM(op, BPF_REG_A, K);
+			break;
+
+		case BPF_S_ALU_DIV_K:
+			/* sk_chk_filter() replaced K by its reciprocal value,
+			 * A = ((u64) A * K) >> 32 just like reciprocal_divide()
+			 */
+			*insn++ = BPF_MOV32_IMM(BPF_REG_TMP, K);
+			*insn++ = BPF_ALU64_REG(BPF_MUL, BPF_REG_A, BPF_REG_TMP);
+			*insn = BPF_ALU64_IMM(BPF_RSH, BPF_REG_A, 32);
+			break;
+
+		case BPF_S_ALU_NEG:
+			*insn = BPF_ALU32_IMM(BPF_NEG, BPF_REG_A, 0);
+			break;
+
+#define BPF_EMIT_JMP							\
+	do {								\
+		int off;						\
+									\
+		if (target >= len || target < 0)			\
+			goto err;					\
+		off = addrs ? addrs[target] - addrs[i] - 1 : 0;		\
+		/* Adjust pc relative offset for 2nd or 3rd insn. */	\
+		off -= insn - tmp_insns;				\
+		/* Expanded jumps must still fit the s16 insn->off. */	\
+		if (off < SHRT_MIN || off > SHRT_MAX)			\
+			goto err;					\
+		insn->off = off;					\
+	} while (0)
+
+		case BPF_S_JMP_JA:
+			target = i + K + 1;
+			*insn = BPF_JMP_A(0);
+			BPF_EMIT_JMP;
+			break;
+
+		case BPF_S_JMP_JEQ_K:
+		case BPF_S_JMP_JEQ_X:
+		case BPF_S_JMP_JGE_K:
+		case BPF_S_JMP_JGE_X:
+		case BPF_S_JMP_JGT_K:
+		case BPF_S_JMP_JGT_X:
+		case BPF_S_JMP_JSET_K:
+		case BPF_S_JMP_JSET_X:
+			switch (fp->code) {
+			case BPF_S_JMP_JEQ_K: op = BPF_JEQ;  bpf_src = BPF_K; break;
+			case BPF_S_JMP_JEQ_X: op = BPF_JEQ;  bpf_src = BPF_X; break;
+			case BPF_S_JMP_JGE_K: op = BPF_JGE;  bpf_src = BPF_K; break;
+			case BPF_S_JMP_JGE_X: op = BPF_JGE;  bpf_src = BPF_X; break;
+			case BPF_S_JMP_JGT_K: op = BPF_JGT;  bpf_src = BPF_K; break;
+			case BPF_S_JMP_JGT_X: op = BPF_JGT;  bpf_src = BPF_X; break;
+			case BPF_S_JMP_JSET_K: op = BPF_JSET; bpf_src = BPF_K; break;
+			default: op = BPF_JSET; bpf_src = BPF_X; break;
+			}
+
+			if (bpf_src == BPF_K && (int) K < 0 && op != BPF_JSET) {
+				/* extended BPF sign extends imm32, compare
+				 * against the zero extended constant instead
+				 */
+				*insn++ = BPF_MOV32_IMM(BPF_REG_TMP, K);
+				insn->code = BPF_JMP | op | BPF_X;
+				insn->src_reg = BPF_REG_TMP;
+			} else if (bpf_src == BPF_K) {
+				insn->code = BPF_JMP | op | BPF_K;
+				insn->imm = K;
+			} else {
+				insn->code = BPF_JMP | op | BPF_X;
+				insn->src_reg = BPF_REG_X;
+			}
+			insn->dst_reg = BPF_REG_A;
+
+			/* common case where 'jump_false' is next insn */
+			if (fp->jf == 0) {
+				target = i + fp->jt + 1;
+				BPF_EMIT_JMP;
+				break;
+			}
+
+			/* convert JEQ into JNE when 'jump_true' is next insn */
+			if (fp->jt == 0 && op == BPF_JEQ) {
+				insn->code = BPF_JMP | BPF_JNE | BPF_SRC(insn->code);
+				target = i + fp->jf + 1;
+				BPF_EMIT_JMP;
+				break;
+			}
+
+			/* other jumps are mapped into two insns: Jxx and JA */
+			target = i + fp->jt + 1;
+			BPF_EMIT_JMP;
+			insn++;
+
+			*insn = BPF_JMP_A(0);
+			target = i + fp->jf + 1;
+			BPF_EMIT_JMP;
+			break;
+
+		/* A = *(u8/u16/u32 *)(skb->data + K), A = ..(X + K) */
+		case BPF_S_LD_W_ABS:
+			*insn = BPF_LD_ABS(BPF_W, K);
+			break;
+		case BPF_S_LD_H_ABS:
+			*insn = BPF_LD_ABS(BPF_H, K);
+			break;
+		case BPF_S_LD_B_ABS:
+			*insn = BPF_LD_ABS(BPF_B, K);
+			break;
+		case BPF_S_LD_W_IND:
+			*insn = BPF_LD_IND(BPF_W, BPF_REG_X, K);
+			break;
+		case BPF_S_LD_H_IND:
+			*insn = BPF_LD_IND(BPF_H, BPF_REG_X, K);
+			break;
+		case BPF_S_LD_B_IND:
+			*insn = BPF_LD_IND(BPF_B, BPF_REG_X, K);
+			break;
+
+		case BPF_S_LD_W_LEN:
+			*insn = BPF_LDX_MEM(BPF_W, BPF_REG_A, BPF_REG_CTX,
+					    offsetof(struct sk_buff, len));
+			break;
+		case BPF_S_LDX_W_LEN:
+			*insn = BPF_LDX_MEM(BPF_W, BPF_REG_X, BPF_REG_CTX,
+					    offsetof(struct sk_buff, len));
+			break;
+
+		/* X = (*(u8 *)(skb->data + K) & 0xf) << 2, A is preserved */
+		case BPF_S_LDX_B_MSH:
+			*insn++ = BPF_MOV64_REG(BPF_REG_TMP, BPF_REG_A);
+			*insn++ = BPF_LD_ABS(BPF_B, K);
+			*insn++ = BPF_ALU32_IMM(BPF_AND, BPF_REG_A, 0xf);
+			*insn++ = BPF_ALU32_IMM(BPF_LSH, BPF_REG_A, 2);
+			*insn++ = BPF_MOV64_REG(BPF_REG_X, BPF_REG_A);
+			*insn = BPF_MOV64_REG(BPF_REG_A, BPF_REG_TMP);
+			break;
+
+		case BPF_S_LD_IMM:
+			*insn = BPF_MOV32_IMM(BPF_REG_A, K);
+			break;
+		case BPF_S_LDX_IMM:
+			*insn = BPF_MOV32_IMM(BPF_REG_X, K);
+			break;
+
+		/* mem[K] lives in the stack frame */
+		case BPF_S_LD_MEM:
+			*insn = BPF_LDX_MEM(BPF_W, BPF_REG_A, BPF_REG_FP,
+					    BPF_MEM_OFF(K));
+			break;
+		case BPF_S_LDX_MEM:
+			*insn = BPF_LDX_MEM(BPF_W, BPF_REG_X, BPF_REG_FP,
+					    BPF_MEM_OFF(K));
+			break;
+		case BPF_S_ST:
+			*insn = BPF_STX_MEM(BPF_W, BPF_REG_FP, BPF_REG_A,
+					    BPF_MEM_OFF(K));
+			break;
+		case BPF_S_STX:
+			*insn = BPF_STX_MEM(BPF_W, BPF_REG_FP, BPF_REG_X,
+					    BPF_MEM_OFF(K));
+			break;
+
+		case BPF_S_MISC_TAX:
+			*insn = BPF_MOV32_REG(BPF_REG_X, BPF_REG_A);
+			break;
+		case BPF_S_MISC_TXA:
+			*insn = BPF_MOV32_REG(BPF_REG_A, BPF_REG_X);
+			break;
+
+		case BPF_S_RET_K:
+			*insn++ = BPF_MOV32_IMM(BPF_REG_A, K);
+			*insn = BPF_EXIT_INSN();
+			break;
+		case BPF_S_RET_A:
+			*insn = BPF_EXIT_INSN();
+			break;
+
+		/* ancillary data */
+		case BPF_S_ANC_PROTOCOL:
+			*insn++ = BPF_LDX_MEM(BPF_H, BPF_REG_A, BPF_REG_CTX,
+					      offsetof(struct sk_buff, protocol));
+			/* A = ntohs(A) */
+			*insn = BPF_ENDIAN(BPF_TO_BE, BPF_REG_A, 16);
+			break;
+
+		case BPF_S_ANC_IFINDEX:
+		case BPF_S_ANC_HATYPE:
+			*insn++ = BPF_LDX_MEM(BPF_SIZEOF_PTR, BPF_REG_TMP,
+					      BPF_REG_CTX,
+					      offsetof(struct sk_buff, dev));
+			/* no device: the filter returns 0 */
+			*insn++ = BPF_JMP_IMM(BPF_JNE, BPF_REG_TMP, 0, 2);
+			*insn++ = BPF_MOV32_IMM(BPF_REG_A, 0);
+			*insn++ = BPF_EXIT_INSN();
+			if (fp->code == BPF_S_ANC_IFINDEX)
+				*insn = BPF_LDX_MEM(BPF_W, BPF_REG_A,
+						    BPF_REG_TMP,
+						    offsetof(struct net_device,
+							     ifindex));
+			else
+				*insn = BPF_LDX_MEM(BPF_H, BPF_REG_A,
+						    BPF_REG_TMP,
+						    offsetof(struct net_device,
+							     type));
+			break;
+
+		case BPF_S_ANC_MARK:
+			*insn = BPF_LDX_MEM(BPF_W, BPF_REG_A, BPF_REG_CTX,
+					    offsetof(struct sk_buff, mark));
+			break;
+		case BPF_S_ANC_QUEUE:
+			*insn = BPF_LDX_MEM(BPF_H, BPF_REG_A, BPF_REG_CTX,
+					    offsetof(struct sk_buff,
+						     queue_mapping));
+			break;
+		case BPF_S_ANC_RXHASH:
+			*insn = BPF_LDX_MEM(BPF_W, BPF_REG_A, BPF_REG_CTX,
+					    offsetof(struct sk_buff, rxhash));
+			break;
+		case BPF_S_ANC_SECCOMP_LD_W:
+			/* seccomp filters run over a struct seccomp_data */
+			*insn = BPF_LDX_MEM(BPF_W, BPF_REG_A, BPF_REG_CTX, K);
+			break;
+
+		case BPF_S_ANC_PKTTYPE:
+		case BPF_S_ANC_CPU:
+		case BPF_S_ANC_NLATTR:
+		case BPF_S_ANC_NLATTR_NEST:
+			/* arg1 = skb, arg2 = A, arg3 = X, A = helper() */
+			*insn++ = BPF_MOV64_REG(BPF_REG_ARG1, BPF_REG_CTX);
+			*insn++ = BPF_MOV64_REG(BPF_REG_2, BPF_REG_A);
+			*insn++ = BPF_MOV64_REG(BPF_REG_3, BPF_REG_X);
+
+			switch (fp->code) {
+			case BPF_S_ANC_PKTTYPE:
+				*insn = BPF_EMIT_CALL(__skb_get_pkt_type -
+						      __bpf_call_base);
+				break;
+			case BPF_S_ANC_CPU:
+				*insn = BPF_EMIT_CALL(__get_raw_cpu_id -
+						      __bpf_call_base);
+				break;
+			case BPF_S_ANC_NLATTR:
+				*insn = BPF_EMIT_CALL(__skb_get_nlattr -
+						      __bpf_call_base);
+				break;
+			default:
+				*insn = BPF_EMIT_CALL(__skb_get_nlattr_nest -
+						      __bpf_call_base);
+				break;
+			}
+
+			if (fp->code == BPF_S_ANC_NLATTR ||
+			    fp->code == BPF_S_ANC_NLATTR_NEST) {
+				insn++;
+				*insn++ = BPF_MOV64_REG(BPF_REG_TMP, BPF_REG_A);
+				*insn++ = BPF_ALU64_IMM(BPF_RSH, BPF_REG_TMP, 32);
+				*insn++ = BPF_JMP_IMM(BPF_JEQ, BPF_REG_TMP, 0, 2);
+				*insn++ = BPF_MOV32_IMM(BPF_REG_A, 0);
+				*insn = BPF_EXIT_INSN();
+			}
+			break;
+#undef BPF_EMIT_JMP
+
+		default:
+			goto err;
+		}
+
+		insn++;
+		if (new_prog)
+			memcpy(new_insn, tmp_insns,
+			       sizeof(*insn) * (insn - tmp_insns));
+		new_insn += insn - tmp_insns;
+	}
+
+	if (!new_prog) {
+		/* Only calculating new length. */
+		*new_len = new_insn - new_prog;
+		return 0;
+	}
+
+	pass++;
+	if (new_flen != new_insn - new_prog) {
+		new_flen = new_insn - new_prog;
+		if (pass > 2)
+			goto err;
+		goto do_pass;
+	}
+
+	kfree(addrs);
+	BUG_ON(*new_len != new_flen);
+	return 0;
+err:
+	kfree(addrs);
+	return -EINVAL;
+}
+EXPORT_SYMBOL_GPL(sk_convert_filter);
+
 /*
  * Security :
  * A BPF program is able to use 16 cells of memory to store intermediate
@@ -582,11 +1041,166 @@ void sk_filter_release_rcu(struct rcu_head *rcu)
 {
 	struct sk_filter *fp = container_of(rcu, struct sk_filter, rcu);
 
-	bpf_jit_free(fp);
-	kfree(fp);
+	bpf_prog_free(fp);
 }
 EXPORT_SYMBOL(sk_filter_release_rcu);
 
+static void __sk_filter_free_classic(struct sk_filter *fp, struct sock *sk)
+{
+	if (sk)
+		sock_kfree_s(sk, fp, sk_filter_len(fp));
+	else
+		kfree(fp);
+}
+
+/*
+ * Replace a checked classic filter by its extended BPF translation.  The
+ * classic copy is freed; for a socket filter the translation is charged
+ * to the socket in its place.
+ */
+static struct sk_filter *__sk_migrate_filter(struct sk_filter *fp,
+					     struct sock *sk)
+{
+	struct sk_filter *new_fp;
+	int err, new_len;
+
+	err = sk_convert_filter(fp->insns, fp->len, NULL, &new_len);
+	if (err)
+		goto out_err;
+
+	err = -ENOMEM;
+	new_fp = kmalloc(sk_filter_size(new_len, true), GFP_KERNEL);
+	if (!new_fp)
+		goto out_err;
+
+	err = sk_convert_filter(fp->insns, fp->len, new_fp->insnsi, &new_len);
+	if (err) {
+		kfree(new_fp);
+		goto out_err;
+	}
+
+	atomic_set(&new_fp->refcnt, 1);
+	new_fp->len = new_len;
+	new_fp->jited = 0;
+	new_fp->ebpf = 1;
+	new_fp->aux = NULL;
+
+	__sk_filter_free_classic(fp, sk);
+	if (sk)
+		atomic_add(sk_filter_len(new_fp), &sk->sk_omem_alloc);
+	return new_fp;
+
+out_err:
+	__sk_filter_free_classic(fp, sk);
+	return ERR_PTR(err);
+}
+
+/*
+ * Turn a checked classic filter into something runnable: native code
+ * from an architecture JIT for classic BPF, otherwise extended BPF run
+ * by its JIT or the interpreter.  Frees @fp on failure.
+ */
+static struct sk_filter *__sk_prepare_filter(struct sk_filter *fp,
+					     struct sock *sk)
+{
+	fp->jited = 0;
+	fp->ebpf = 0;
+	fp->aux = NULL;
+
+	bpf_jit_compile(fp);
+	if (fp->jited)
+		return fp;
+
+	fp = __sk_migrate_filter(fp, sk);
+	if (IS_ERR(fp))
+		return fp;
+
+	bpf_prog_select_runtime(fp);
+	return fp;
+}
+
+/**
+ *	sk_unattached_filter_migrate - run a checked filter as extended BPF
+ *	@fp: unattached classic filter, already checked by sk_chk_filter()
+ *
+ * For users such as seccomp that rewrite the checked program before
+ * it runs: the filter is converted to extended BPF and handed to its
+ * JIT or the interpreter, never to a classic BPF JIT.  @fp is consumed.
+ * Returns the new filter, freed with sk_unattached_filter_destroy(),
+ * or an ERR_PTR().
+ */
+struct sk_filter *sk_unattached_filter_migrate(struct sk_filter *fp)
+{
+	fp = __sk_migrate_filter(fp, NULL);
+	if (IS_ERR(fp))
+		return fp;
+
+	bpf_prog_select_runtime(fp);
+	return fp;
+}
+EXPORT_SYMBOL_GPL(sk_unattached_filter_migrate);
+
+/**
+ *	sk_unattached_filter_create - create a filter not attached to a socket
+ *	@pfp: the unattached filter that is created
+ *	@fprog: the filter program, in kernel memory
+ *
+ * Create a filter independent of any socket, for users like the PTP
+ * classifier or the BPF test module.  The filter is run with
+ * SK_RUN_FILTER() and freed with sk_unattached_filter_destroy().
+ */
+int sk_unattached_filter_create(struct sk_filter **pfp,
+				struct sock_fprog *fprog)
+{
+	unsigned int fsize = sizeof(struct sock_filter) * fprog->len;
+	struct sk_filter *fp;
+	int err;
+
+	/* Make sure new filter is there and in the right amounts. */
+	if (fprog->filter == NULL)
+		return -EINVAL;
+
+	fp = kmalloc(sk_filter_size(fprog->len, false), GFP_KERNEL);
+	if (!fp)
+		return -ENOMEM;
+	memcpy(fp->insns, fprog->filter, fsize);
+
+	atomic_set(&fp->refcnt, 1);
+	fp->len = fprog->len;
+
+	err = sk_chk_filter(fp->insns, fp->len);
+	if (err) {
+		kfree(fp);
+		return err;
+	}
+
+	fp = __sk_prepare_filter(fp, NULL);
+	if (IS_ERR(fp))
+		return PTR_ERR(fp);
+
+	*pfp = fp;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sk_unattached_filter_create);
+
+void sk_unattached_filter_destroy(struct sk_filter *fp)
+{
+	sk_filter_release(fp);
+}
+EXPORT_SYMBOL_GPL(sk_unattached_filter_destroy);
+
+static void __sk_replace_filter(struct sock *sk, struct sk_filter *fp)
+{
+	struct sk_filter *old_fp;
+
+	old_fp = rcu_dereference_protected(sk->sk_filter,
+					   sock_owned_by_user(sk));
+	rcu_assign_pointer(sk->sk_filter, fp);
+
+	if (old_fp)
+		sk_filter_uncharge(sk, old_fp);
+}
+
 /**
  *	sk_attach_filter - attach a socket filter
  *	@fprog: the filter program
@@ -599,44 +1213,118 @@ EXPORT_SYMBOL(sk_filter_release_rcu);
  */
 int sk_attach_filter(struct sock_fprog *fprog, struct sock *sk)
 {
-	struct sk_filter *fp, *old_fp;
+	struct sk_filter *fp;
 	unsigned int fsize = sizeof(struct sock_filter) * fprog->len;
+	unsigned int sk_fsize = sk_filter_size(fprog->len, false);
 	int err;
 
 	/* Make sure new filter is there and in the right amounts. */
 	if (fprog->filter == NULL)
 		return -EINVAL;
 
-	fp = sock_kmalloc(sk, fsize+sizeof(*fp), GFP_KERNEL);
+	fp = sock_kmalloc(sk, sk_fsize, GFP_KERNEL);
 	if (!fp)
 		return -ENOMEM;
 	if (copy_from_user(fp->insns, fprog->filter, fsize)) {
-		sock_kfree_s(sk, fp, fsize+sizeof(*fp));
+		sock_kfree_s(sk, fp, sk_fsize);
 		return -EFAULT;
 	}
 
 	atomic_set(&fp->refcnt, 1);
 	fp->len = fprog->len;
-	fp->bpf_func = sk_run_filter;
 
 	err = sk_chk_filter(fp->insns, fp->len);
 	if (err) {
-		sk_filter_uncharge(sk, fp);
+		sock_kfree_s(sk, fp, sk_fsize);
 		return err;
 	}
 
-	bpf_jit_compile(fp);
-
-	old_fp = rcu_dereference_protected(sk->sk_filter,
-					   sock_owned_by_user(sk));
-	rcu_assign_pointer(sk->sk_filter, fp);
+	fp = __sk_prepare_filter(fp, sk);
+	if (IS_ERR(fp))
+		return PTR_ERR(fp);
 
-	if (old_fp)
-		sk_filter_uncharge(sk, old_fp);
+	__sk_replace_filter(sk, fp);
 	return 0;
 }
 EXPORT_SYMBOL_GPL(sk_attach_filter);
 
+/**
+ *	sk_attach_bpf - attach an extended BPF program as socket filter
+ *	@ufd: file descriptor returned by BPF_PROG_LOAD
+ *	@sk: the socket to use
+ *
+ * The program must be of type BPF_PROG_TYPE_SOCKET_FILTER.  The socket
+ * holds its own reference, @ufd can be closed afterwards.
+ */
+int sk_attach_bpf(u32 ufd, struct sock *sk)
+{
+	struct sk_filter *prog;
+
+	prog = bpf_prog_get(ufd);
+	if (IS_ERR(prog))
+		return PTR_ERR(prog);
+
+	if (prog->aux->prog_type != BPF_PROG_TYPE_SOCKET_FILTER) {
+		sk_filter_release(prog);
+		return -EINVAL;
+	}
+
+	/* bpf_prog_get() already took the reference the socket keeps */
+	atomic_add(sk_filter_len(prog), &sk->sk_omem_alloc);
+
+	__sk_replace_filter(sk, prog);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sk_attach_bpf);
+
+#ifdef CONFIG_BPF_SYSCALL
+static const struct bpf_func_proto *
+sk_filter_func_proto(enum bpf_func_id func_id)
+{
+	switch (func_id) {
+	case BPF_FUNC_map_lookup_elem:
+		return &bpf_map_lookup_elem_proto;
+	case BPF_FUNC_map_update_elem:
+		return &bpf_map_update_elem_proto;
+	case BPF_FUNC_map_delete_elem:
+		return &bpf_map_delete_elem_proto;
+	case BPF_FUNC_get_prandom_u32:
+		return &bpf_get_prandom_u32_proto;
+	case BPF_FUNC_get_smp_processor_id:
+		return &bpf_get_smp_processor_id_proto;
+	case BPF_FUNC_ktime_get_ns:
+		return &bpf_ktime_get_ns_proto;
+	default:
+		return NULL;
+	}
+}
+
+/* socket filters read the packet with BPF_LD_ABS/IND only */
+static bool sk_filter_is_valid_access(int off, int size,
+				      enum bpf_access_type type)
+{
+	return false;
+}
+
+static const struct bpf_verifier_ops sk_filter_ops = {
+	.get_func_proto = sk_filter_func_proto,
+	.is_valid_access = sk_filter_is_valid_access,
+	.ld_abs = true,
+};
+
+static struct bpf_prog_type_list sk_filter_type __read_mostly = {
+	.ops = &sk_filter_ops,
+	.type = BPF_PROG_TYPE_SOCKET_FILTER,
+};
+
+static int __init register_sk_filter_ops(void)
+{
+	bpf_register_prog_type(&sk_filter_type);
+	return 0;
+}
+late_initcall(register_sk_filter_ops);
+#endif
+
 int sk_detach_filter(struct sock *sk)
 {
 	int ret = -ENOENT;
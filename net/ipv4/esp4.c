@@ -261,6 +261,11 @@ static int esp_output(struct xfrm_state *x, struct sk_buff *skb)
 			      XFRM_SKB_CB(skb)->seq.output.low);
 
 	ESP_SKB_CB(skb)->tmp = tmp;
+
+	/* Batched with the other segments of a GSO packet, if plugged. */
+	if (crypto_plug_request(&req->areq.base, crypto_aead_givencrypt_list))
+		return -EINPROGRESS;
+
 	err = crypto_aead_givencrypt(req);
 	if (err == -EINPROGRESS)
 		goto error;
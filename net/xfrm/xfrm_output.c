@@ -9,6 +9,7 @@
  * 2 of the License, or (at your option) any later version.
  */
 
+#include <linux/crypto.h>
 #include <linux/errno.h>
 #include <linux/module.h>
 #include <linux/netdevice.h>
@@ -145,16 +146,24 @@ static int xfrm_output2(struct sk_buff *skb)
 
 static int xfrm_output_gso(struct sk_buff *skb)
 {
+	struct crypto_plug plug;
 	struct sk_buff *segs;
+	int err = 0;
 
 	segs = skb_gso_segment(skb, 0);
 	kfree_skb(skb);
 	if (IS_ERR(segs))
 		return PTR_ERR(segs);
 
+	/*
+	 * Let the transforms collect the segments' crypto requests and
+	 * submit them as one batch.
+	 */
+	local_bh_disable();
+	crypto_start_plug(&plug);
+
 	do {
 		struct sk_buff *nskb = segs->next;
-		int err;
 
 		segs->next = NULL;
 		err = xfrm_output2(segs);
@@ -165,13 +174,16 @@ static int xfrm_output_gso(struct sk_buff *skb)
 				segs->next = NULL;
 				kfree_skb(segs);
 			}
-			return err;
+			break;
 		}
 
 		segs = nskb;
 	} while (segs);
 
-	return 0;
+	crypto_finish_plug(&plug);
+	local_bh_enable();
+
+	return err;
 }
 
 int xfrm_output(struct sk_buff *skb)
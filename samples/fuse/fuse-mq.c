@@ -0,0 +1,437 @@
+/*
+ * fuse-mq - multi-queue /dev/fuse example
+ *
+ * Mounts a tiny filesystem with a single file, "data", speaking the raw
+ * FUSE protocol, and serves it with one thread per CPU.  By default every
+ * server thread clones the /dev/fuse descriptor with FUSE_DEV_IOC_CLONE
+ * and binds its CPU with FUSE_DEV_IOC_BIND_CPU, so requests are queued,
+ * read and answered on the CPU that submitted them.  With -1 all threads
+ * share the connection's main channel instead, which is how a daemon
+ * behaves on kernels without channel support.
+ *
+ * After mounting, one reader thread per CPU preads the (direct I/O) file
+ * for the given number of seconds and the total request rate is printed.
+ * Needs root to mount.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <linux/fuse.h>
+
+#define DATA_ID		2
+#define DATA_NAME	"data"
+#define DATA_SIZE	(1ULL << 30)
+#define MAX_WRITE	(128 * 1024)
+#define BUF_SIZE	(MAX_WRITE + 4096)
+#define IO_SIZE		4096
+
+struct server {
+	pthread_t thread;
+	int cpu;		/* -1: main channel, unbound */
+	int fd;
+};
+
+struct reader {
+	pthread_t thread;
+	int cpu;
+	unsigned long long ops;
+};
+
+static const char *mnt;
+static int devfd;
+static volatile int stop;
+static char zeroes[MAX_WRITE];
+
+static void pin_cpu(int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static int reply(int fd, struct fuse_in_header *in, int error,
+		 const void *arg, size_t len)
+{
+	struct fuse_out_header out;
+	struct iovec iov[2];
+
+	out.unique = in->unique;
+	out.error = error;
+	out.len = sizeof(out) + (error ? 0 : len);
+	iov[0].iov_base = &out;
+	iov[0].iov_len = sizeof(out);
+	iov[1].iov_base = (void *)arg;
+	iov[1].iov_len = error ? 0 : len;
+
+	if (writev(fd, iov, 2) < 0 && errno != ENOENT) {
+		perror("fuse: writev");
+		return -1;
+	}
+	return 0;
+}
+
+static void fill_attr(struct fuse_attr *attr, __u64 nodeid)
+{
+	memset(attr, 0, sizeof(*attr));
+	attr->ino = nodeid;
+	if (nodeid == FUSE_ROOT_ID) {
+		attr->mode = S_IFDIR | 0755;
+		attr->nlink = 2;
+	} else {
+		attr->mode = S_IFREG | 0444;
+		attr->nlink = 1;
+		attr->size = DATA_SIZE;
+		attr->blocks = DATA_SIZE / 512;
+	}
+}
+
+static size_t add_dirent(char *buf, size_t size, __u64 ino, __u64 off,
+			 unsigned type, const char *name)
+{
+	struct fuse_dirent *d = (struct fuse_dirent *)buf;
+	size_t namelen = strlen(name);
+	size_t entlen = FUSE_DIRENT_ALIGN(FUSE_NAME_OFFSET + namelen);
+
+	if (entlen > size)
+		return 0;
+	memset(buf, 0, entlen);
+	d->ino = ino;
+	d->off = off;
+	d->namelen = namelen;
+	d->type = type;
+	memcpy(d->name, name, namelen);
+	return entlen;
+}
+
+static int do_readdir(int fd, struct fuse_in_header *in,
+		      struct fuse_read_in *arg)
+{
+	static const struct {
+		__u64 ino;
+		unsigned type;
+		const char *name;
+	} ents[] = {
+		{ FUSE_ROOT_ID, S_IFDIR >> 12, "." },
+		{ FUSE_ROOT_ID, S_IFDIR >> 12, ".." },
+		{ DATA_ID, S_IFREG >> 12, DATA_NAME },
+	};
+	char buf[512];
+	size_t len = 0, size = arg->size;
+	__u64 i;
+
+	if (size > sizeof(buf))
+		size = sizeof(buf);
+	for (i = arg->offset; i < sizeof(ents) / sizeof(ents[0]); i++) {
+		size_t n = add_dirent(buf + len, size - len, ents[i].ino,
+				      i + 1, ents[i].type, ents[i].name);
+		if (!n)
+			break;
+		len += n;
+	}
+	return reply(fd, in, 0, buf, len);
+}
+
+static int handle(int fd, void *buf)
+{
+	struct fuse_in_header *in = buf;
+	void *arg = in + 1;
+
+	switch (in->opcode) {
+	case FUSE_INIT: {
+		struct fuse_init_in *init = arg;
+		struct fuse_init_out out;
+
+		memset(&out, 0, sizeof(out));
+		out.major = FUSE_KERNEL_VERSION;
+		out.minor = FUSE_KERNEL_MINOR_VERSION;
+		out.max_readahead = init->max_readahead;
+		out.max_write = MAX_WRITE;
+		if (init->major != FUSE_KERNEL_VERSION)
+			return reply(fd, in, -EPROTO, NULL, 0);
+		return reply(fd, in, 0, &out, sizeof(out));
+	}
+	case FUSE_LOOKUP: {
+		struct fuse_entry_out out;
+
+		if (in->nodeid != FUSE_ROOT_ID || strcmp(arg, DATA_NAME))
+			return reply(fd, in, -ENOENT, NULL, 0);
+		memset(&out, 0, sizeof(out));
+		out.nodeid = DATA_ID;
+		out.attr_valid = 3600;
+		out.entry_valid = 3600;
+		fill_attr(&out.attr, DATA_ID);
+		return reply(fd, in, 0, &out, sizeof(out));
+	}
+	case FUSE_GETATTR: {
+		struct fuse_attr_out out;
+
+		memset(&out, 0, sizeof(out));
+		out.attr_valid = 3600;
+		fill_attr(&out.attr, in->nodeid);
+		return reply(fd, in, 0, &out, sizeof(out));
+	}
+	case FUSE_OPEN:
+	case FUSE_OPENDIR: {
+		struct fuse_open_out out;
+
+		memset(&out, 0, sizeof(out));
+		/* make every read reach the daemon */
+		if (in->opcode == FUSE_OPEN)
+			out.open_flags = FOPEN_DIRECT_IO;
+		return reply(fd, in, 0, &out, sizeof(out));
+	}
+	case FUSE_READ: {
+		struct fuse_read_in *read = arg;
+		size_t size = read->size;
+
+		if (read->offset >= DATA_SIZE)
+			size = 0;
+		else if (size > DATA_SIZE - read->offset)
+			size = DATA_SIZE - read->offset;
+		if (size > sizeof(zeroes))
+			size = sizeof(zeroes);
+		return reply(fd, in, 0, zeroes, size);
+	}
+	case FUSE_READDIR:
+		return do_readdir(fd, in, arg);
+	case FUSE_STATFS: {
+		struct fuse_statfs_out out;
+
+		memset(&out, 0, sizeof(out));
+		out.st.bsize = 4096;
+		out.st.frsize = 4096;
+		out.st.namelen = 255;
+		return reply(fd, in, 0, &out, sizeof(out));
+	}
+	case FUSE_RELEASE:
+	case FUSE_RELEASEDIR:
+	case FUSE_FLUSH:
+	case FUSE_DESTROY:
+		return reply(fd, in, 0, NULL, 0);
+	case FUSE_FORGET:
+	case FUSE_BATCH_FORGET:
+	case FUSE_INTERRUPT:
+		/* no reply; requests complete too quickly to interrupt */
+		return 0;
+	default:
+		return reply(fd, in, -ENOSYS, NULL, 0);
+	}
+}
+
+/* serve requests until the connection goes away */
+static int serve(int fd)
+{
+	void *buf = malloc(BUF_SIZE);
+
+	if (!buf)
+		return -1;
+	for (;;) {
+		ssize_t res = read(fd, buf, BUF_SIZE);
+
+		if (res < 0) {
+			if (errno == EINTR || errno == ENOENT ||
+			    errno == EAGAIN)
+				continue;
+			if (errno != ENODEV)
+				perror("fuse: read");
+			break;
+		}
+		if ((size_t)res < sizeof(struct fuse_in_header))
+			break;
+		if (handle(fd, buf))
+			break;
+	}
+	free(buf);
+	return 0;
+}
+
+static void *server_thread(void *data)
+{
+	struct server *s = data;
+
+	if (s->cpu >= 0)
+		pin_cpu(s->cpu);
+	serve(s->fd);
+	return NULL;
+}
+
+/* give a server thread its own channel bound to its CPU */
+static int clone_chan(struct server *s)
+{
+	__u32 oldfd = devfd;
+	__u32 cpu = s->cpu;
+
+	s->fd = open("/dev/fuse", O_RDWR);
+	if (s->fd < 0) {
+		perror("/dev/fuse");
+		return -1;
+	}
+	if (ioctl(s->fd, FUSE_DEV_IOC_CLONE, &oldfd)) {
+		perror("FUSE_DEV_IOC_CLONE");
+		return -1;
+	}
+	if (ioctl(s->fd, FUSE_DEV_IOC_BIND_CPU, &cpu)) {
+		perror("FUSE_DEV_IOC_BIND_CPU");
+		return -1;
+	}
+	return 0;
+}
+
+static void *reader_thread(void *data)
+{
+	struct reader *r = data;
+	char buf[IO_SIZE];
+	char path[4096];
+	unsigned long long off = (unsigned long long)r->cpu << 20;
+	int fd;
+
+	pin_cpu(r->cpu);
+	snprintf(path, sizeof(path), "%s/%s", mnt, DATA_NAME);
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		perror(path);
+		return NULL;
+	}
+	while (!stop) {
+		if (pread(fd, buf, IO_SIZE, off) != IO_SIZE) {
+			perror("pread");
+			break;
+		}
+		r->ops++;
+		off = (off + IO_SIZE) % DATA_SIZE;
+	}
+	close(fd);
+	return NULL;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-1] [-t seconds] mountpoint\n"
+		"  -1  serve all CPUs from the main channel\n"
+		"  -t  length of the read benchmark (default 5)\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct server *servers;
+	struct reader *readers;
+	unsigned long long total = 0;
+	int single = 0, seconds = 5;
+	int ncpus, nservers, opt, i;
+	char opts[128];
+	void *buf;
+	ssize_t res;
+
+	while ((opt = getopt(argc, argv, "1t:")) != -1) {
+		switch (opt) {
+		case '1':
+			single = 1;
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || seconds <= 0)
+		usage(argv[0]);
+	mnt = argv[optind];
+
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpus < 1)
+		ncpus = 1;
+
+	devfd = open("/dev/fuse", O_RDWR);
+	if (devfd < 0) {
+		perror("/dev/fuse");
+		return 1;
+	}
+	snprintf(opts, sizeof(opts),
+		 "fd=%d,rootmode=40000,user_id=%d,group_id=%d",
+		 devfd, getuid(), getgid());
+	if (mount("fuse-mq", mnt, "fuse", MS_NOSUID | MS_NODEV,
+		  opts)) {
+		perror("mount");
+		return 1;
+	}
+
+	/* INIT is queued on the main channel while mounting */
+	buf = malloc(BUF_SIZE);
+	if (!buf)
+		goto out_umount;
+	res = read(devfd, buf, BUF_SIZE);
+	if (res < (ssize_t)sizeof(struct fuse_in_header) ||
+	    ((struct fuse_in_header *)buf)->opcode != FUSE_INIT) {
+		fprintf(stderr, "fuse: expected INIT\n");
+		goto out_umount;
+	}
+	if (handle(devfd, buf))
+		goto out_umount;
+	free(buf);
+
+	/*
+	 * With channels, one extra unbound thread keeps serving the main
+	 * channel for CPUs that come online later.
+	 */
+	nservers = single ? ncpus : ncpus + 1;
+	servers = calloc(nservers, sizeof(*servers));
+	readers = calloc(ncpus, sizeof(*readers));
+	if (!servers || !readers)
+		goto out_umount;
+	for (i = 0; i < nservers; i++) {
+		servers[i].cpu = i < ncpus ? i : -1;
+		servers[i].fd = devfd;
+		if (!single && i < ncpus && clone_chan(&servers[i]))
+			goto out_umount;
+		pthread_create(&servers[i].thread, NULL, server_thread,
+			       &servers[i]);
+	}
+
+	for (i = 0; i < ncpus; i++) {
+		readers[i].cpu = i;
+		pthread_create(&readers[i].thread, NULL, reader_thread,
+			       &readers[i]);
+	}
+	sleep(seconds);
+	stop = 1;
+	for (i = 0; i < ncpus; i++) {
+		pthread_join(readers[i].thread, NULL);
+		total += readers[i].ops;
+	}
+
+	printf("%s: %d cpus, %llu reads in %d s, %llu reads/s\n",
+	       single ? "main channel" : "per-cpu channels", ncpus,
+	       total, seconds, total / seconds);
+
+	/* unmounting disconnects every channel and ends the servers */
+	umount2(mnt, MNT_DETACH);
+	for (i = 0; i < nservers; i++)
+		pthread_join(servers[i].thread, NULL);
+	return 0;
+
+out_umount:
+	umount2(mnt, MNT_DETACH);
+	return 1;
+}
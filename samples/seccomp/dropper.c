@@ -0,0 +1,81 @@
+/*
+ * dropper - run a program with one system call failing
+ *
+ * Usage: dropper <syscall_nr> <errno> <prog> [<args>]
+ *
+ * Installs a seccomp filter which makes system call <syscall_nr> fail
+ * with <errno> and allows everything else, then executes <prog>.  The
+ * filter checks the architecture first, so a 32-bit program run under
+ * a 64-bit kernel is killed rather than mismatched.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+
+#ifndef PR_SET_NO_NEW_PRIVS
+#define PR_SET_NO_NEW_PRIVS 38
+#endif
+
+#if defined(__i386__)
+#define ARCH_NR	AUDIT_ARCH_I386
+#elif defined(__x86_64__)
+#define ARCH_NR	AUDIT_ARCH_X86_64
+#else
+#error "seccomp filters are only available on x86"
+#endif
+
+static int install_filter(int nr, int error)
+{
+	struct sock_filter filter[] = {
+		BPF_STMT(BPF_LD+BPF_W+BPF_ABS,
+			 offsetof(struct seccomp_data, arch)),
+		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, ARCH_NR, 0, 3),
+		BPF_STMT(BPF_LD+BPF_W+BPF_ABS,
+			 offsetof(struct seccomp_data, nr)),
+		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, nr, 0, 2),
+		BPF_STMT(BPF_RET+BPF_K,
+			 SECCOMP_RET_ERRNO|(error & SECCOMP_RET_DATA)),
+		BPF_STMT(BPF_RET+BPF_K, SECCOMP_RET_KILL),
+		BPF_STMT(BPF_RET+BPF_K, SECCOMP_RET_ALLOW),
+	};
+	struct sock_fprog prog = {
+		.len = (unsigned short)(sizeof(filter)/sizeof(filter[0])),
+		.filter = filter,
+	};
+
+	/* without CAP_SYS_ADMIN a filter can only be set with no_new_privs */
+	if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0)) {
+		perror("prctl(NO_NEW_PRIVS)");
+		return 1;
+	}
+	if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog)) {
+		perror("prctl(SECCOMP)");
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 4) {
+		fprintf(stderr, "Usage:\n"
+			"dropper <syscall_nr> <errno> <prog> [<args>]\n\n");
+		return 1;
+	}
+	if (install_filter(strtol(argv[1], NULL, 0), strtol(argv[2], NULL, 0)))
+		return 1;
+	execv(argv[3], &argv[3]);
+	perror("execv");
+	return 1;
+}
@@ -0,0 +1,254 @@
+/*
+ * seccomp-bench - system call latency under seccomp filters
+ *
+ * Usage: seccomp-bench [<iterations>]
+ *
+ * Times a cheap system call (getppid) in a tight loop, once in each of
+ * these setups, every one in a fresh child process:
+ *
+ *   none		no policy at all
+ *   allow		one filter returning SECCOMP_RET_ALLOW
+ *   whitelist-N	an architecture check followed by N syscall number
+ *			comparisons, the benchmarked call matching last
+ *   stacked-4		four "allow" filters on top of each other
+ *   ptrace		no filter, but a parent tracing every system call
+ *			with PTRACE_SYSCALL and reading its number, the way
+ *			a ptrace based sandbox polices a task
+ *
+ * Filters are JIT compiled when /proc/sys/net/core/bpf_jit_enable is
+ * set; run the benchmark with it set to 0 and to 1 to compare the JIT
+ * with the interpreter.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+
+#ifndef PR_SET_NO_NEW_PRIVS
+#define PR_SET_NO_NEW_PRIVS 38
+#endif
+
+#if defined(__i386__)
+#define ARCH_NR	AUDIT_ARCH_I386
+#define ORIG_AX	orig_eax
+#elif defined(__x86_64__)
+#define ARCH_NR	AUDIT_ARCH_X86_64
+#define ORIG_AX	orig_rax
+#else
+#error "seccomp filters are only available on x86"
+#endif
+
+#define MAX_RULES	256
+
+struct bench {
+	const char *name;
+	int filters;		/* number of filters stacked */
+	int rules;		/* 0: allow everything, else whitelist size */
+	int ptrace;
+};
+
+static const struct bench benches[] = {
+	{ "none",		0, 0,	0 },
+	{ "allow",		1, 0,	0 },
+	{ "whitelist-8",	1, 8,	0 },
+	{ "whitelist-32",	1, 32,	0 },
+	{ "whitelist-128",	1, 128,	0 },
+	{ "stacked-4",		4, 0,	0 },
+	{ "ptrace",		0, 0,	1 },
+};
+
+static unsigned long iters = 1000000;
+static struct sock_filter insns[MAX_RULES + 8];
+
+static double time_syscalls(void)
+{
+	struct timespec start, end;
+	unsigned long i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < iters; i++)
+		syscall(__NR_getppid);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return ((end.tv_sec - start.tv_sec) * 1e9 +
+		(end.tv_nsec - start.tv_nsec)) / iters;
+}
+
+static int build_filter(int rules)
+{
+	/* what the child needs to report back and exit */
+	static const int needed[] = {
+		__NR_write, __NR_exit, __NR_exit_group,
+	};
+	int n = 0, i;
+
+	if (!rules) {
+		insns[n++] = (struct sock_filter)
+			BPF_STMT(BPF_RET+BPF_K, SECCOMP_RET_ALLOW);
+		return n;
+	}
+
+	insns[n++] = (struct sock_filter)
+		BPF_STMT(BPF_LD+BPF_W+BPF_ABS,
+			 offsetof(struct seccomp_data, arch));
+	insns[n++] = (struct sock_filter)
+		BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, ARCH_NR, 1, 0);
+	insns[n++] = (struct sock_filter)
+		BPF_STMT(BPF_RET+BPF_K, SECCOMP_RET_KILL);
+	insns[n++] = (struct sock_filter)
+		BPF_STMT(BPF_LD+BPF_W+BPF_ABS,
+			 offsetof(struct seccomp_data, nr));
+	for (i = 0; i < rules; i++) {
+		/* needed calls, unused numbers, then the one we call last */
+		int nr = i == rules - 1 ? __NR_getppid : 1000 + i;
+
+		if (i < (int)(sizeof(needed) / sizeof(needed[0])))
+			nr = needed[i];
+
+		insns[n++] = (struct sock_filter)
+			BPF_JUMP(BPF_JMP+BPF_JEQ+BPF_K, nr, rules - i, 0);
+	}
+	insns[n++] = (struct sock_filter)
+		BPF_STMT(BPF_RET+BPF_K, SECCOMP_RET_ERRNO|EPERM);
+	insns[n++] = (struct sock_filter)
+		BPF_STMT(BPF_RET+BPF_K, SECCOMP_RET_ALLOW);
+	return n;
+}
+
+static int install_filters(const struct bench *b)
+{
+	struct sock_fprog prog = {
+		.len = build_filter(b->rules),
+		.filter = insns,
+	};
+	int i;
+
+	if (!b->filters)
+		return 0;
+	if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0))
+		return -1;
+	for (i = 0; i < b->filters; i++)
+		if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog))
+			return -1;
+	return 0;
+}
+
+/* Play a ptrace based sandbox: stop at every syscall entry and exit. */
+static void trace_child(pid_t pid)
+{
+	int status, sig = 0;
+
+	if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status))
+		return;
+	ptrace(PTRACE_SETOPTIONS, pid, 0, PTRACE_O_TRACESYSGOOD);
+
+	for (;;) {
+		if (ptrace(PTRACE_SYSCALL, pid, 0, sig))
+			return;
+		if (waitpid(pid, &status, 0) < 0 ||
+		    WIFEXITED(status) || WIFSIGNALED(status))
+			return;
+		sig = 0;
+		if (WSTOPSIG(status) == (SIGTRAP | 0x80))
+			/* fetch the syscall number, as a policy check would */
+			ptrace(PTRACE_PEEKUSER, pid,
+			       offsetof(struct user_regs_struct, ORIG_AX), 0);
+		else
+			sig = WSTOPSIG(status);
+	}
+}
+
+static double run_bench(const struct bench *b)
+{
+	double result = -1;
+	int pfd[2], status;
+	pid_t pid;
+
+	if (pipe(pfd)) {
+		perror("pipe");
+		exit(1);
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(1);
+	}
+	if (!pid) {
+		close(pfd[0]);
+		if (b->ptrace) {
+			ptrace(PTRACE_TRACEME, 0, 0, 0);
+			raise(SIGSTOP);
+		}
+		if (!install_filters(b))
+			result = time_syscalls();
+		if (write(pfd[1], &result, sizeof(result)) != sizeof(result))
+			_exit(1);
+		_exit(0);
+	}
+
+	close(pfd[1]);
+	if (b->ptrace)
+		trace_child(pid);
+	if (read(pfd[0], &result, sizeof(result)) != sizeof(result))
+		result = -1;
+	waitpid(pid, &status, 0);
+	close(pfd[0]);
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	double base = 0;
+	FILE *f;
+	int jit = -1;
+	unsigned int i;
+
+	if (argc > 1)
+		iters = strtoul(argv[1], NULL, 0);
+	if (!iters) {
+		fprintf(stderr, "Usage:\nseccomp-bench [<iterations>]\n\n");
+		return 1;
+	}
+
+	f = fopen("/proc/sys/net/core/bpf_jit_enable", "r");
+	if (f) {
+		if (fscanf(f, "%d", &jit) != 1)
+			jit = -1;
+		fclose(f);
+	}
+	printf("%lu getppid() calls per test, bpf_jit_enable=%d\n\n",
+	       iters, jit);
+	printf("%-16s %10s %10s\n", "policy", "ns/call", "overhead");
+
+	for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+		const struct bench *b = &benches[i];
+		double ns = run_bench(b);
+
+		if (ns < 0) {
+			printf("%-16s %10s\n", b->name, "failed");
+			continue;
+		}
+		if (!i)
+			base = ns;
+		printf("%-16s %10.1f %10.1f\n", b->name, ns, ns - base);
+	}
+	return 0;
+}
@@ -0,0 +1,250 @@
+/*
+ * aio-submit-lat - measure io_submit() latency of native AIO
+ *
+ * Issues random reads (or writes, optionally followed by fsyncs) against
+ * a file without O_DIRECT, keeping a fixed number of iocbs in flight, and
+ * reports how long each io_submit() call took.  With truly asynchronous
+ * buffered AIO a page cache miss must not show up in the submission
+ * latency, only in the completion latency.
+ *
+ * The figures are reported as fio does for its "slat" and "clat" columns,
+ * so they can be compared directly with fio's libaio engine running the
+ * job files next to this program.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/aio_abi.h>
+
+static int io_setup(unsigned nr, aio_context_t *ctx)
+{
+	return syscall(__NR_io_setup, nr, ctx);
+}
+
+static int io_destroy(aio_context_t ctx)
+{
+	return syscall(__NR_io_destroy, ctx);
+}
+
+static int io_submit(aio_context_t ctx, long nr, struct iocb **iocbs)
+{
+	return syscall(__NR_io_submit, ctx, nr, iocbs);
+}
+
+static int io_getevents(aio_context_t ctx, long min_nr, long nr,
+			struct io_event *events, struct timespec *timeout)
+{
+	return syscall(__NR_io_getevents, ctx, min_nr, nr, events, timeout);
+}
+
+struct lat_stat {
+	uint64_t	min, max, sum;
+	unsigned long	nr;
+	uint64_t	*samples;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void lat_add(struct lat_stat *s, uint64_t ns)
+{
+	if (!s->nr || ns < s->min)
+		s->min = ns;
+	if (ns > s->max)
+		s->max = ns;
+	s->sum += ns;
+	s->samples[s->nr++] = ns;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void lat_report(const char *name, struct lat_stat *s)
+{
+	if (!s->nr)
+		return;
+	qsort(s->samples, s->nr, sizeof(*s->samples), cmp_u64);
+	printf("    %s (usec): min=%llu, max=%llu, avg=%.2f, "
+	       "50.00th=%llu, 99.00th=%llu, 99.90th=%llu\n", name,
+	       (unsigned long long)s->min / 1000,
+	       (unsigned long long)s->max / 1000,
+	       (double)s->sum / s->nr / 1000,
+	       (unsigned long long)s->samples[s->nr / 2] / 1000,
+	       (unsigned long long)s->samples[s->nr * 99 / 100] / 1000,
+	       (unsigned long long)s->samples[s->nr * 999 / 1000] / 1000);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-w] [-f N] [-b bs] [-d depth] [-n ios] file\n"
+		"  -w        write instead of read\n"
+		"  -f N      follow every N writes with an IOCB_CMD_FSYNC\n"
+		"  -b bs     block size in bytes (default 4096)\n"
+		"  -d depth  iocbs kept in flight (default 32)\n"
+		"  -n ios    number of iocbs to issue (default 100000)\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long nr_ios = 100000, issued = 0, done = 0, writes = 0;
+	unsigned int bs = 4096, depth = 32, fsync_every = 0;
+	struct lat_stat slat = { 0 }, clat = { 0 };
+	struct io_event *events;
+	struct iocb *iocbs, **free_iocbs;
+	uint64_t *issue_time;
+	unsigned int nr_free;
+	aio_context_t ctx = 0;
+	int write = 0, fd, opt, nr;
+	unsigned long i;
+	struct stat st;
+	uint64_t blocks, start;
+	char *bufs;
+
+	while ((opt = getopt(argc, argv, "wf:b:d:n:")) != -1) {
+		switch (opt) {
+		case 'w':
+			write = 1;
+			break;
+		case 'f':
+			fsync_every = atoi(optarg);
+			break;
+		case 'b':
+			bs = atoi(optarg);
+			break;
+		case 'd':
+			depth = atoi(optarg);
+			break;
+		case 'n':
+			nr_ios = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || !bs || !depth)
+		usage(argv[0]);
+
+	fd = open(argv[optind], write ? O_RDWR : O_RDONLY);
+	if (fd < 0 || fstat(fd, &st)) {
+		perror(argv[optind]);
+		return 1;
+	}
+	blocks = st.st_size / bs;
+	if (!blocks) {
+		fprintf(stderr, "%s: file smaller than one block\n",
+			argv[optind]);
+		return 1;
+	}
+
+	if (io_setup(depth, &ctx)) {
+		perror("io_setup");
+		return 1;
+	}
+
+	iocbs = calloc(depth, sizeof(*iocbs));
+	free_iocbs = calloc(depth, sizeof(*free_iocbs));
+	events = calloc(depth, sizeof(*events));
+	issue_time = calloc(depth, sizeof(*issue_time));
+	slat.samples = calloc(nr_ios, sizeof(uint64_t));
+	clat.samples = calloc(nr_ios, sizeof(uint64_t));
+	if (posix_memalign((void **)&bufs, 4096, (size_t)bs * depth) ||
+	    !iocbs || !free_iocbs || !events || !issue_time ||
+	    !slat.samples || !clat.samples) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	memset(bufs, 0xa5, (size_t)bs * depth);
+	for (i = 0; i < depth; i++)
+		free_iocbs[i] = &iocbs[i];
+	nr_free = depth;
+
+	srandom(getpid());
+	start = now_ns();
+	while (done < nr_ios) {
+		while (nr_free && issued < nr_ios) {
+			struct iocb *cb = free_iocbs[--nr_free];
+			unsigned long idx = cb - iocbs;
+			uint64_t t;
+
+			memset(cb, 0, sizeof(*cb));
+			cb->aio_fildes = fd;
+			cb->aio_data = idx;
+			if (write && fsync_every && writes &&
+			    writes % fsync_every == 0) {
+				cb->aio_lio_opcode = IOCB_CMD_FSYNC;
+				writes = 0;
+			} else {
+				cb->aio_lio_opcode = write ? IOCB_CMD_PWRITE :
+							     IOCB_CMD_PREAD;
+				cb->aio_buf = (uintptr_t)(bufs + idx * bs);
+				cb->aio_nbytes = bs;
+				cb->aio_offset = (random() % blocks) * bs;
+				writes++;
+			}
+
+			t = now_ns();
+			if (io_submit(ctx, 1, &cb) != 1) {
+				perror("io_submit");
+				return 1;
+			}
+			issue_time[idx] = now_ns();
+			lat_add(&slat, issue_time[idx] - t);
+			issued++;
+		}
+
+		nr = io_getevents(ctx, 1, depth, events, NULL);
+		if (nr < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("io_getevents");
+			return 1;
+		}
+		for (i = 0; i < (unsigned long)nr; i++) {
+			unsigned long idx = events[i].data;
+
+			if ((long)events[i].res < 0) {
+				fprintf(stderr, "iocb %lu failed: %s\n", idx,
+					strerror(-(long)events[i].res));
+				return 1;
+			}
+			lat_add(&clat, now_ns() - issue_time[idx]);
+			free_iocbs[nr_free++] = &iocbs[idx];
+			done++;
+		}
+	}
+
+	printf("%s: bs=%u, iodepth=%u, ios=%lu, runt=%llu msec\n",
+	       write ? "write" : "read", bs, depth, done,
+	       (unsigned long long)(now_ns() - start) / 1000000);
+	lat_report("slat", &slat);
+	lat_report("clat", &clat);
+
+	io_destroy(ctx);
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,391 @@
+/*
+ * io_uring-cp - copy a file using io_uring
+ *
+ * Keeps a queue of reads in flight on the source file and turns each
+ * completed read into a write to the destination, so both files are
+ * driven through a single ring.  With -f the two files are registered
+ * as a fixed file set, with -b the I/O buffers are registered as fixed
+ * buffers, and with -p submission is left to the kernel's SQ thread.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#ifndef __NR_io_uring_setup
+# if defined(__x86_64__)
+#  define __NR_io_uring_setup		310
+#  define __NR_io_uring_enter		311
+#  define __NR_io_uring_register	312
+# elif defined(__i386__)
+#  define __NR_io_uring_setup		347
+#  define __NR_io_uring_enter		348
+#  define __NR_io_uring_register	349
+# else
+#  error "io_uring syscall numbers unknown for this architecture"
+# endif
+#endif
+
+#define read_barrier()	__sync_synchronize()
+#define write_barrier()	__sync_synchronize()
+
+#define QD	64
+#define BS	(32 * 1024)
+
+struct sq_ring {
+	unsigned *head, *tail, *ring_mask, *ring_entries, *flags, *array;
+};
+
+struct cq_ring {
+	unsigned *head, *tail, *ring_mask, *ring_entries;
+	struct io_uring_cqe *cqes;
+};
+
+struct ring {
+	int fd;
+	unsigned int setup_flags;
+	struct sq_ring sq;
+	struct io_uring_sqe *sqes;
+	struct cq_ring cq;
+	unsigned sqe_tail;	/* local tail, published on submit */
+};
+
+struct io_data {
+	int read;
+	off_t start;		/* file range of the whole block */
+	size_t len;
+	off_t offset;		/* remaining part of the current transfer */
+	struct iovec iov;
+	void *buf;
+	int index;
+};
+
+static int infd, outfd, fixed_files, fixed_bufs;
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+			  unsigned flags)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+		       flags, NULL, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, void *arg,
+			     unsigned nr_args)
+{
+	return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static int setup_ring(struct ring *r, unsigned entries, unsigned flags)
+{
+	struct io_uring_params p;
+	void *ptr;
+
+	memset(&p, 0, sizeof(p));
+	p.flags = flags;
+	r->fd = io_uring_setup(entries, &p);
+	if (r->fd < 0) {
+		perror("io_uring_setup");
+		return -1;
+	}
+	r->setup_flags = flags;
+
+	ptr = mmap(NULL, p.sq_off.array + p.sq_entries * sizeof(unsigned),
+		   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd,
+		   IORING_OFF_SQ_RING);
+	if (ptr == MAP_FAILED)
+		goto err;
+	r->sq.head = ptr + p.sq_off.head;
+	r->sq.tail = ptr + p.sq_off.tail;
+	r->sq.ring_mask = ptr + p.sq_off.ring_mask;
+	r->sq.ring_entries = ptr + p.sq_off.ring_entries;
+	r->sq.flags = ptr + p.sq_off.flags;
+	r->sq.array = ptr + p.sq_off.array;
+	r->sqe_tail = *r->sq.tail;
+
+	r->sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+		       PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		       r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED)
+		goto err;
+
+	ptr = mmap(NULL, p.cq_off.cqes +
+		   p.cq_entries * sizeof(struct io_uring_cqe),
+		   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd,
+		   IORING_OFF_CQ_RING);
+	if (ptr == MAP_FAILED)
+		goto err;
+	r->cq.head = ptr + p.cq_off.head;
+	r->cq.tail = ptr + p.cq_off.tail;
+	r->cq.ring_mask = ptr + p.cq_off.ring_mask;
+	r->cq.ring_entries = ptr + p.cq_off.ring_entries;
+	r->cq.cqes = ptr + p.cq_off.cqes;
+	return 0;
+err:
+	perror("mmap");
+	return -1;
+}
+
+static struct io_uring_sqe *get_sqe(struct ring *r)
+{
+	unsigned head = *r->sq.head;
+	unsigned idx;
+
+	read_barrier();
+	if (r->sqe_tail - head == *r->sq.ring_entries)
+		return NULL;
+
+	idx = r->sqe_tail & *r->sq.ring_mask;
+	r->sq.array[idx] = idx;
+	r->sqe_tail++;
+	return &r->sqes[idx];
+}
+
+/* publish queued sqes and optionally wait for at least one completion */
+static int submit(struct ring *r, int wait)
+{
+	unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+	unsigned to_submit;
+
+	write_barrier();
+	to_submit = r->sqe_tail - *r->sq.tail;
+	*r->sq.tail = r->sqe_tail;
+	write_barrier();
+
+	if (r->setup_flags & IORING_SETUP_SQPOLL) {
+		if (*r->sq.flags & IORING_SQ_NEED_WAKEUP)
+			flags |= IORING_ENTER_SQ_WAKEUP;
+		else if (!wait)
+			return 0;
+		to_submit = 0;
+	} else if (!to_submit && !wait) {
+		return 0;
+	}
+
+	if (io_uring_enter(r->fd, to_submit, wait ? 1 : 0, flags) < 0) {
+		if (errno == EINTR)
+			return 0;
+		perror("io_uring_enter");
+		return -1;
+	}
+	return 0;
+}
+
+static struct io_uring_cqe *peek_cqe(struct ring *r)
+{
+	unsigned head = *r->cq.head;
+
+	read_barrier();
+	if (head == *r->cq.tail)
+		return NULL;
+	return &r->cq.cqes[head & *r->cq.ring_mask];
+}
+
+static void cqe_seen(struct ring *r)
+{
+	write_barrier();
+	(*r->cq.head)++;
+	write_barrier();
+}
+
+static void queue_io(struct ring *r, struct io_data *data)
+{
+	struct io_uring_sqe *sqe = get_sqe(r);
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->fd = data->read ? infd : outfd;
+	if (fixed_files) {
+		sqe->fd = data->read ? 0 : 1;
+		sqe->flags = IOSQE_FIXED_FILE;
+	}
+	sqe->off = data->offset;
+	if (fixed_bufs) {
+		sqe->opcode = data->read ? IORING_OP_READ_FIXED :
+					   IORING_OP_WRITE_FIXED;
+		sqe->addr = (unsigned long)data->iov.iov_base;
+		sqe->len = data->iov.iov_len;
+		sqe->buf_index = data->index;
+	} else {
+		sqe->opcode = data->read ? IORING_OP_READV : IORING_OP_WRITEV;
+		sqe->addr = (unsigned long)&data->iov;
+		sqe->len = 1;
+	}
+	sqe->user_data = (unsigned long)data;
+}
+
+static int copy_file(struct ring *r, off_t insize, struct io_data *slots)
+{
+	unsigned long inflight = 0, nr_free = QD;
+	struct io_data *free_slots[QD];
+	off_t read_off = 0, written = 0;
+	int i;
+
+	for (i = 0; i < QD; i++)
+		free_slots[i] = &slots[i];
+
+	while (written < insize) {
+		struct io_uring_cqe *cqe;
+
+		/* fill the queue with reads */
+		while (nr_free && read_off < insize) {
+			struct io_data *data = free_slots[--nr_free];
+			size_t len = insize - read_off;
+
+			if (len > BS)
+				len = BS;
+			data->read = 1;
+			data->start = read_off;
+			data->len = len;
+			data->offset = read_off;
+			data->iov.iov_base = data->buf;
+			data->iov.iov_len = len;
+			queue_io(r, data);
+			read_off += len;
+			inflight++;
+		}
+
+		if (submit(r, inflight > 0) < 0)
+			return 1;
+
+		while ((cqe = peek_cqe(r)) != NULL) {
+			struct io_data *data = (void *)(uintptr_t)cqe->user_data;
+			int res = cqe->res;
+
+			cqe_seen(r);
+			if (res < 0) {
+				fprintf(stderr, "%s at %lld: %s\n",
+					data->read ? "read" : "write",
+					(long long)data->offset, strerror(-res));
+				return 1;
+			}
+			if (!res) {
+				fprintf(stderr, "unexpected end of file\n");
+				return 1;
+			}
+			if ((size_t)res != data->iov.iov_len) {
+				/* short transfer, requeue the remainder */
+				data->iov.iov_base = (char *)data->iov.iov_base + res;
+				data->iov.iov_len -= res;
+				data->offset += res;
+				queue_io(r, data);
+				continue;
+			}
+			data->offset = data->start;
+			data->iov.iov_base = data->buf;
+			data->iov.iov_len = data->len;
+			if (data->read) {
+				data->read = 0;
+				queue_io(r, data);
+			} else {
+				written += data->len;
+				free_slots[nr_free++] = data;
+				inflight--;
+			}
+		}
+	}
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-f] [-b] [-p] infile outfile\n"
+		"  -f  register the files as a fixed file set\n"
+		"  -b  register the copy buffers as fixed buffers\n"
+		"  -p  use a kernel SQ polling thread (needs -f, root)\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct io_data slots[QD];
+	struct iovec bufs[QD];
+	unsigned flags = 0;
+	struct ring r;
+	struct stat st;
+	int opt, ret, i;
+
+	while ((opt = getopt(argc, argv, "fbp")) != -1) {
+		switch (opt) {
+		case 'f':
+			fixed_files = 1;
+			break;
+		case 'b':
+			fixed_bufs = 1;
+			break;
+		case 'p':
+			flags |= IORING_SETUP_SQPOLL;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 2 ||
+	    ((flags & IORING_SETUP_SQPOLL) && !fixed_files))
+		usage(argv[0]);
+
+	infd = open(argv[optind], O_RDONLY);
+	if (infd < 0 || fstat(infd, &st)) {
+		perror(argv[optind]);
+		return 1;
+	}
+	outfd = open(argv[optind + 1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (outfd < 0) {
+		perror(argv[optind + 1]);
+		return 1;
+	}
+
+	/* room for every slot to have both a read and a write queued */
+	if (setup_ring(&r, 2 * QD, flags))
+		return 1;
+
+	for (i = 0; i < QD; i++) {
+		if (posix_memalign(&bufs[i].iov_base, 4096, BS)) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		bufs[i].iov_len = BS;
+		slots[i].index = i;
+		slots[i].buf = bufs[i].iov_base;
+	}
+
+	if (fixed_files) {
+		int fds[2] = { infd, outfd };
+
+		if (io_uring_register(r.fd, IORING_REGISTER_FILES, fds, 2)) {
+			perror("IORING_REGISTER_FILES");
+			return 1;
+		}
+	}
+	if (fixed_bufs &&
+	    io_uring_register(r.fd, IORING_REGISTER_BUFFERS, bufs, QD)) {
+		perror("IORING_REGISTER_BUFFERS");
+		return 1;
+	}
+
+	ret = copy_file(&r, st.st_size, slots);
+
+	close(r.fd);
+	close(infd);
+	close(outfd);
+	return ret;
+}
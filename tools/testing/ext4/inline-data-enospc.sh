@@ -0,0 +1,73 @@
+#!/bin/sh
+#
+# Check that a file whose inline data cannot be moved out to a block
+# because the filesystem is full keeps its contents.
+#
+# Needs root, a loop device and an mke2fs which knows about inline_data.
+#
+# Usage:
+# inline-data-enospc.sh [scratch directory]
+#
+
+dir=${1:-/tmp}
+img=$dir/inline-enospc.img
+mnt=$dir/inline-enospc.mnt
+data="inline data that has to survive a failed conversion"
+
+fail() {
+	echo "FAIL: $*"
+	umount $mnt 2>/dev/null
+	exit 1
+}
+
+check_contents() {
+	[ "$(cat $mnt/small)" = "$data" ] || fail "contents lost $1"
+}
+
+rm -f $img
+mkdir -p $mnt
+dd if=/dev/zero of=$img bs=1k count=4096 2>/dev/null || exit 1
+mke2fs -q -F -t ext4 -b 1024 -I 256 -m 0 \
+	-O inline_data,^metadata_csum,^64bit $img ||
+	{ echo "SKIP: mke2fs cannot create inline_data filesystems"; exit 0; }
+mount -o loop $img $mnt || fail "mount"
+
+echo "$data" > $mnt/small
+sync
+[ "$(stat -c %b $mnt/small)" = 0 ] || fail "small file is not inline"
+
+# Eat every free block, including what delalloc holds back at first
+dd if=/dev/zero of=$mnt/fill bs=1k 2>/dev/null
+sync
+i=0
+while dd if=/dev/zero of=$mnt/fill.$i bs=1k count=1 2>/dev/null; do
+	i=$((i + 1))
+done
+sync
+
+# Growing past the inode forces the conversion, which cannot get a block
+if dd if=/dev/zero of=$mnt/small bs=1k count=4 seek=1 conv=notrunc \
+	2>/dev/null; then
+	umount $mnt
+	echo "SKIP: could not run the filesystem out of space"
+	exit 0
+fi
+
+check_contents "in the page cache"
+echo 3 > /proc/sys/vm/drop_caches
+check_contents "after dropping caches"
+umount $mnt || fail "umount"
+
+mount -o loop $img $mnt || fail "remount"
+check_contents "after remount"
+rm -f $mnt/fill*
+dd if=/dev/zero of=$mnt/small bs=1k count=4 seek=1 conv=notrunc \
+	2>/dev/null || fail "conversion after freeing space"
+[ "$(head -c ${#data} $mnt/small)" = "$data" ] ||
+	fail "contents lost in conversion"
+umount $mnt || fail "umount"
+
+e2fsck -fn $img >/dev/null || fail "e2fsck found errors"
+rm -f $img
+rmdir $mnt
+echo "PASS"
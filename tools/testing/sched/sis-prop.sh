@@ -0,0 +1,52 @@
+#!/bin/sh
+#
+# Check that SIS_PROP bounds the select_idle_cpu() scan under a wakeup
+# heavy load: the cpus examined per LLC search (schedstat fields 14 and
+# 10 of the cpu lines) have to drop compared to NO_SIS_PROP.
+#
+# Needs root, CONFIG_SCHEDSTATS, CONFIG_SCHED_DEBUG with debugfs mounted
+# and perf for the load.
+#
+# Usage:
+# sis-prop.sh [perf bench sched messaging arguments]
+#
+
+features=/sys/kernel/debug/sched_features
+load=${*:--g 40 -l 2000}
+
+[ -w $features ] || { echo "SKIP: $features not writable"; exit 0; }
+grep -q "^version 16" /proc/schedstat ||
+	{ echo "SKIP: schedstat version 16 not available"; exit 0; }
+perf bench sched messaging -g 1 -l 1 >/dev/null 2>&1 ||
+	{ echo "SKIP: perf bench not available"; exit 0; }
+
+# Print "searches scanned" summed over all cpus
+sis_stats() {
+	awk '/^cpu[0-9]/ { search += $11; scanned += $15 }
+	     END { print search, scanned }' /proc/schedstat
+}
+
+# Print the cpus examined per search, times 100, while the load runs
+scan_ratio() {
+	echo $1 > $features
+	set -- $(sis_stats)
+	perf bench sched messaging $load >/dev/null 2>&1
+	set -- $1 $2 $(sis_stats)
+	search=$(($3 - $1))
+	scanned=$(($4 - $2))
+	[ $search -gt 0 ] || return 1
+	echo $((scanned * 100 / search))
+}
+
+orig=$(grep -ow "NO_SIS_PROP\|SIS_PROP" $features)
+unbound=$(scan_ratio NO_SIS_PROP) && bound=$(scan_ratio SIS_PROP)
+ret=$?
+echo $orig > $features
+[ $ret = 0 ] || { echo "SKIP: no LLC searches during the load"; exit 0; }
+
+echo "cpus scanned per search x100: NO_SIS_PROP $unbound, SIS_PROP $bound"
+if [ $bound -ge $unbound ]; then
+	echo "FAIL: SIS_PROP did not reduce the scan"
+	exit 1
+fi
+echo "PASS"
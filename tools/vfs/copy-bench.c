@@ -0,0 +1,260 @@
+/*
+ * copy-bench - file copy throughput: read/write vs copy_file_range()
+ *
+ * For every directory given on the command line a source file of the
+ * requested size is written, and then copied within that directory with
+ *
+ *   rw       read() + write() through a user space buffer
+ *   sendfile sendfile(), i.e. splice through the page cache
+ *   copy     copy_file_range(), which lets the filesystem share extents
+ *            (btrfs) and otherwise splices in the kernel (e.g. tmpfs)
+ *
+ * Each copy is checked against the source after it has been timed, so the
+ * program doubles as a functional test: it exits non-zero on a mismatch.
+ * A typical run compares a btrfs mount with tmpfs:
+ *
+ *   ./copy-bench -s 1024 /mnt/btrfs /dev/shm
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#ifndef __NR_copy_file_range
+# if defined(__x86_64__)
+#  define __NR_copy_file_range		313
+# elif defined(__i386__)
+#  define __NR_copy_file_range		350
+# else
+#  error "copy_file_range syscall number unknown for this architecture"
+# endif
+#endif
+
+#define BUF_SIZE	(1024 * 1024)
+
+enum method {
+	M_RW,
+	M_SENDFILE,
+	M_COPY,
+	NR_METHODS,
+};
+
+static const char *method_name[NR_METHODS] = {
+	"rw", "sendfile", "copy",
+};
+
+static unsigned long long size_mb = 256;
+static unsigned runs = 3;
+static int do_fsync;
+static char buf[BUF_SIZE], vbuf[BUF_SIZE];
+
+static long sys_copy_file_range(int fd_in, loff_t *off_in, int fd_out,
+				loff_t *off_out, size_t len, unsigned flags)
+{
+	return syscall(__NR_copy_file_range, fd_in, off_in, fd_out, off_out,
+		       len, flags);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void die(const char *what, const char *path)
+{
+	fprintf(stderr, "%s %s: %s\n", what, path, strerror(errno));
+	exit(1);
+}
+
+static void make_source(const char *path, unsigned long long bytes)
+{
+	unsigned long long done = 0;
+	unsigned i;
+	int fd;
+
+	fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+	if (fd < 0)
+		die("create", path);
+	srandom(getpid());
+	while (done < bytes) {
+		size_t n = bytes - done < BUF_SIZE ? bytes - done : BUF_SIZE;
+
+		for (i = 0; i < n / sizeof(long); i++)
+			((long *)buf)[i] = random();
+		if (write(fd, buf, n) != (ssize_t)n)
+			die("write", path);
+		done += n;
+	}
+	if (fsync(fd))
+		die("fsync", path);
+	close(fd);
+}
+
+static int copy_rw(int in, int out)
+{
+	ssize_t n;
+
+	while ((n = read(in, buf, BUF_SIZE)) > 0)
+		if (write(out, buf, n) != n)
+			return -1;
+	return n;
+}
+
+static int copy_sendfile(int in, int out, unsigned long long bytes)
+{
+	ssize_t n;
+
+	while (bytes) {
+		n = sendfile(out, in, NULL, bytes);
+		if (n <= 0)
+			return n;
+		bytes -= n;
+	}
+	return 0;
+}
+
+static int copy_cfr(int in, int out, unsigned long long bytes)
+{
+	long n;
+
+	while (bytes) {
+		n = sys_copy_file_range(in, NULL, out, NULL, bytes, 0);
+		if (n <= 0)
+			return n;
+		bytes -= n;
+	}
+	return 0;
+}
+
+static int verify(const char *src, const char *dst)
+{
+	int a, b, ret = 0;
+	ssize_t na, nb;
+
+	a = open(src, O_RDONLY);
+	b = open(dst, O_RDONLY);
+	if (a < 0 || b < 0)
+		die("open", dst);
+	do {
+		na = read(a, buf, BUF_SIZE);
+		nb = read(b, vbuf, BUF_SIZE);
+		if (na != nb || (na > 0 && memcmp(buf, vbuf, na))) {
+			ret = -1;
+			break;
+		}
+	} while (na > 0);
+	close(a);
+	close(b);
+	return ret;
+}
+
+static int bench_dir(const char *dir)
+{
+	unsigned long long bytes = size_mb << 20;
+	char src[4096], dst[4096];
+	int m, failed = 0;
+
+	snprintf(src, sizeof(src), "%s/copy-bench.src", dir);
+	snprintf(dst, sizeof(dst), "%s/copy-bench.dst", dir);
+	make_source(src, bytes);
+
+	printf("%s: %llu MB, %u runs\n", dir, size_mb, runs);
+	for (m = 0; m < NR_METHODS; m++) {
+		uint64_t total = 0, t;
+		unsigned r;
+		int in, out, err = 0;
+
+		for (r = 0; r < runs; r++) {
+			in = open(src, O_RDONLY);
+			if (in < 0)
+				die("open", src);
+			out = open(dst, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+			if (out < 0)
+				die("open", dst);
+
+			t = now_ns();
+			switch (m) {
+			case M_RW:
+				err = copy_rw(in, out);
+				break;
+			case M_SENDFILE:
+				err = copy_sendfile(in, out, bytes);
+				break;
+			case M_COPY:
+				err = copy_cfr(in, out, bytes);
+				break;
+			}
+			if (!err && do_fsync)
+				err = fsync(out);
+			total += now_ns() - t;
+			if (err)
+				die(method_name[m], dst);
+
+			close(in);
+			close(out);
+			if (verify(src, dst)) {
+				fprintf(stderr, "%s: %s copy differs from source\n",
+					dir, method_name[m]);
+				failed = 1;
+			}
+			unlink(dst);
+		}
+		printf("  %-8s %10.1f MB/s\n", method_name[m],
+		       (double)size_mb * runs / (total / 1e9));
+	}
+	unlink(src);
+	return failed;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-s size-mb] [-r runs] [-f] dir...\n"
+		"  -f  fsync the destination as part of each timed copy\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int opt, failed = 0;
+
+	while ((opt = getopt(argc, argv, "s:r:fh")) != -1) {
+		switch (opt) {
+		case 's':
+			size_mb = strtoull(optarg, NULL, 0);
+			break;
+		case 'r':
+			runs = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			do_fsync = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind >= argc || !size_mb || !runs)
+		usage(argv[0]);
+
+	for (; optind < argc; optind++)
+		failed |= bench_dir(argv[optind]);
+	return failed;
+}
@@ -0,0 +1,207 @@
+/*
+ * inode-bench - multi-threaded inode cache create/lookup/evict benchmark
+ *
+ * Each thread works in a private directory so that the directory's
+ * i_mutex is not the bottleneck; what is left is the inode cache itself:
+ * the inode hash, the superblock inode list and the inode LRU.  The run
+ * is split into phases that all threads start together:
+ *
+ *   create   open(O_CREAT) + close of every file
+ *   stat     stat() of every file with the inodes cached
+ *   evict    (with -e) drop the dentry and inode caches
+ *   restat   stat() again, which now instantiates every inode afresh
+ *   unlink   unlink() of every file
+ *
+ * and the aggregate operations per second of each phase are reported.
+ * Dropping caches needs root.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+enum phase {
+	PH_CREATE,
+	PH_STAT,
+	PH_RESTAT,
+	PH_UNLINK,
+	NR_PHASES,
+};
+
+static const char *phase_name[NR_PHASES] = {
+	"create", "stat", "restat", "unlink",
+};
+
+static const char *top = ".";
+static unsigned nr_threads = 4;
+static unsigned nr_files = 100000;
+static int evict;
+
+static pthread_barrier_t start_barrier, end_barrier;
+static uint64_t phase_ns[NR_PHASES];
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void die(const char *what, const char *path)
+{
+	fprintf(stderr, "%s %s: %s\n", what, path, strerror(errno));
+	exit(1);
+}
+
+static void run_phase(unsigned id, enum phase ph)
+{
+	char path[4096];
+	struct stat st;
+	unsigned i;
+	int fd;
+
+	for (i = 0; i < nr_files; i++) {
+		snprintf(path, sizeof(path), "%s/ib.%u/f%u", top, id, i);
+		switch (ph) {
+		case PH_CREATE:
+			fd = open(path, O_CREAT | O_WRONLY | O_EXCL, 0644);
+			if (fd < 0)
+				die("create", path);
+			close(fd);
+			break;
+		case PH_STAT:
+		case PH_RESTAT:
+			if (stat(path, &st))
+				die("stat", path);
+			break;
+		case PH_UNLINK:
+			if (unlink(path))
+				die("unlink", path);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void *worker(void *arg)
+{
+	unsigned id = (unsigned long)arg;
+	int ph;
+
+	for (ph = 0; ph < NR_PHASES; ph++) {
+		pthread_barrier_wait(&start_barrier);
+		if (ph != PH_RESTAT || evict)
+			run_phase(id, ph);
+		pthread_barrier_wait(&end_barrier);
+	}
+	return NULL;
+}
+
+static void drop_caches(void)
+{
+	int fd;
+
+	sync();
+	fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+	if (fd < 0 || write(fd, "2", 1) != 1)
+		die("write", "/proc/sys/vm/drop_caches");
+	close(fd);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-t threads] [-n files-per-thread] [-e] [dir]\n"
+		"  -e  drop dentry and inode caches before the restat phase\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t *threads;
+	char path[4096];
+	unsigned long i;
+	uint64_t t;
+	int ph, opt;
+
+	while ((opt = getopt(argc, argv, "t:n:eh")) != -1) {
+		switch (opt) {
+		case 't':
+			nr_threads = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			nr_files = strtoul(optarg, NULL, 0);
+			break;
+		case 'e':
+			evict = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind < argc)
+		top = argv[optind];
+	if (!nr_threads || !nr_files)
+		usage(argv[0]);
+
+	for (i = 0; i < nr_threads; i++) {
+		snprintf(path, sizeof(path), "%s/ib.%lu", top, i);
+		if (mkdir(path, 0755) && errno != EEXIST)
+			die("mkdir", path);
+	}
+
+	threads = calloc(nr_threads, sizeof(*threads));
+	if (!threads)
+		return 1;
+	pthread_barrier_init(&start_barrier, NULL, nr_threads + 1);
+	pthread_barrier_init(&end_barrier, NULL, nr_threads + 1);
+	for (i = 0; i < nr_threads; i++) {
+		if (pthread_create(&threads[i], NULL, worker, (void *)i)) {
+			perror("pthread_create");
+			return 1;
+		}
+	}
+
+	for (ph = 0; ph < NR_PHASES; ph++) {
+		if (ph == PH_RESTAT && evict)
+			drop_caches();
+		t = now_ns();
+		pthread_barrier_wait(&start_barrier);
+		pthread_barrier_wait(&end_barrier);
+		phase_ns[ph] = now_ns() - t;
+	}
+
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(threads[i], NULL);
+	for (i = 0; i < nr_threads; i++) {
+		snprintf(path, sizeof(path), "%s/ib.%lu", top, i);
+		rmdir(path);
+	}
+
+	printf("%u threads, %u files each\n", nr_threads, nr_files);
+	for (ph = 0; ph < NR_PHASES; ph++) {
+		double secs = phase_ns[ph] / 1e9;
+
+		if (ph == PH_RESTAT && !evict)
+			continue;
+		printf("%-8s %10.3f s %12.0f ops/s\n", phase_name[ph], secs,
+		       (double)nr_threads * nr_files / secs);
+	}
+	return 0;
+}